@@ -5,36 +5,90 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 CPP_SRCS += \
 ../src/Actor.cpp \
+../src/Animation.cpp \
+../src/Animator.cpp \
 ../src/Camera.cpp \
+../src/JobSystem.cpp \
+../src/Light.cpp \
+../src/LightGrid.cpp \
 ../src/Mesh.cpp \
 ../src/Model.cpp \
+../src/OcclusionBuffer.cpp \
+../src/PrimitiveMesh.cpp \
 ../src/PrimitiveShape.cpp \
+../src/Profiler.cpp \
 ../src/Resource.cpp \
 ../src/ResourceManager.cpp \
 ../src/Scene.cpp \
-../src/ShaderProgram.cpp 
+../src/ShaderPermutation.cpp \
+../src/ShaderProgram.cpp \
+../src/ShadowMap.cpp \
+../src/Snapshot.cpp \
+../src/SpatialIndex.cpp \
+../src/StaticBatch.cpp \
+../src/StreamBuffer.cpp \
+../src/TextureLoader.cpp \
+../src/TextureStreamer.cpp \
+../src/ThreadPool.cpp \
+../src/TransformHierarchy.cpp 
 
 OBJS += \
 ./src/Actor.o \
+./src/Animation.o \
+./src/Animator.o \
 ./src/Camera.o \
+./src/JobSystem.o \
+./src/Light.o \
+./src/LightGrid.o \
 ./src/Mesh.o \
 ./src/Model.o \
+./src/OcclusionBuffer.o \
+./src/PrimitiveMesh.o \
 ./src/PrimitiveShape.o \
+./src/Profiler.o \
 ./src/Resource.o \
 ./src/ResourceManager.o \
 ./src/Scene.o \
-./src/ShaderProgram.o 
+./src/ShaderPermutation.o \
+./src/ShaderProgram.o \
+./src/ShadowMap.o \
+./src/Snapshot.o \
+./src/SpatialIndex.o \
+./src/StaticBatch.o \
+./src/StreamBuffer.o \
+./src/TextureLoader.o \
+./src/TextureStreamer.o \
+./src/ThreadPool.o \
+./src/TransformHierarchy.o 
 
 CPP_DEPS += \
 ./src/Actor.d \
+./src/Animation.d \
+./src/Animator.d \
 ./src/Camera.d \
+./src/JobSystem.d \
+./src/Light.d \
+./src/LightGrid.d \
 ./src/Mesh.d \
 ./src/Model.d \
+./src/OcclusionBuffer.d \
+./src/PrimitiveMesh.d \
 ./src/PrimitiveShape.d \
+./src/Profiler.d \
 ./src/Resource.d \
 ./src/ResourceManager.d \
 ./src/Scene.d \
-./src/ShaderProgram.d 
+./src/ShaderPermutation.d \
+./src/ShaderProgram.d \
+./src/ShadowMap.d \
+./src/Snapshot.d \
+./src/SpatialIndex.d \
+./src/StaticBatch.d \
+./src/StreamBuffer.d \
+./src/TextureLoader.d \
+./src/TextureStreamer.d \
+./src/ThreadPool.d \
+./src/TransformHierarchy.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
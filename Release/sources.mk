@@ -0,0 +1,47 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+TESSCTRL_SRCS := 
+SAU_SRCS := 
+CMAP_SRCS := 
+FRAG_SRCS := 
+ASM_SRCS := 
+CPP_SRCS := 
+GEOM_SRCS := 
+O_SRCS := 
+S_UPPER_SRCS := 
+TESSEVAL_SRCS := 
+C_UPPER_SRCS := 
+CXX_SRCS := 
+COMP_SRCS := 
+OBJ_SRCS := 
+C++_SRCS := 
+CC_SRCS := 
+FRAGX_SRCS := 
+VERT_SRCS := 
+STOY_SRCS := 
+C_SRCS := 
+STOY_DEPS := 
+SAU_DEPS := 
+ARCHIVES := 
+C_UPPER_DEPS := 
+TESSCTRL_DEPS := 
+VERT_DEPS := 
+C_DEPS := 
+COMP_DEPS := 
+FRAGX_DEPS := 
+CC_DEPS := 
+C++_DEPS := 
+CXX_DEPS := 
+OBJS := 
+TESSEVAL_DEPS := 
+CMAP_DEPS := 
+CPP_DEPS := 
+FRAG_DEPS := 
+GEOM_DEPS := 
+
+# Every subdirectory with source files must be described here
+SUBDIRS := \
+src \
+
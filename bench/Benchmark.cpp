@@ -0,0 +1,434 @@
+#include "Benchmark.h"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <SOIL2/SOIL2.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+
+namespace CGLBench {
+
+Summary Summarize(std::vector<double> samples) {
+	Summary summary = Summary();
+	summary.count = samples.size();
+	if(samples.empty()) return summary;
+
+	std::sort(samples.begin(), samples.end());
+	double sum = 0.0;
+	for(double sample : samples) sum += sample;
+
+	// Nearest-rank percentiles
+	auto percentile = [&samples](double p) {
+		size_t rank = (size_t)(p / 100.0 * (double)samples.size() + .5);
+		if(rank < 1) rank = 1;
+		if(rank > samples.size()) rank = samples.size();
+		return samples[rank - 1];
+	};
+
+	summary.mean = sum / (double)samples.size();
+	summary.p50 = percentile(50.0);
+	summary.p90 = percentile(90.0);
+	summary.p99 = percentile(99.0);
+	summary.max = samples.back();
+	return summary;
+}
+
+long PeakRSS() {
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+	return usage.ru_maxrss; // kilobytes on Linux
+}
+
+/* Report */
+void Report::Set(std::string key, double value) {
+	std::ostringstream text;
+	text << value;
+	fields.push_back(std::make_pair(key, text.str()));
+}
+
+void Report::Set(std::string key, long long value) {
+	fields.push_back(std::make_pair(key, std::to_string(value)));
+}
+
+void Report::Set(std::string key, std::string value) {
+	std::string escaped = "\"";
+	for(char c : value) {
+		if(c == '"' || c == '\\') escaped += '\\';
+		if((unsigned char)c >= 0x20) escaped += c;
+	}
+	fields.push_back(std::make_pair(key, escaped + "\""));
+}
+
+void Report::Set(std::string key, const Summary & summary) {
+	Report object;
+	object.Set("mean", summary.mean);
+	object.Set("p50", summary.p50);
+	object.Set("p90", summary.p90);
+	object.Set("p99", summary.p99);
+	object.Set("max", summary.max);
+	object.Set("count", (long long)summary.count);
+	Set(key, object);
+}
+
+void Report::Set(std::string key, const Report & object) {
+	fields.push_back(std::make_pair(key, object.ToJSON()));
+}
+
+std::string Report::ToJSON() const {
+	std::string json = "{";
+	for(size_t i = 0; i < fields.size(); i++) {
+		if(i) json += ",";
+		json += "\"" + fields[i].first + "\":" + fields[i].second;
+	}
+	return json + "}";
+}
+/* Report */
+/* Assets */
+Assets::Assets() {
+	char pattern[] = "/tmp/cgl-bench-XXXXXX";
+	char * created = mkdtemp(pattern);
+	if(!created) {
+		std::cout << "CGLBENCH::ERROR::ASSETS Could not create temporary directory\n";
+		directory = ".";
+	}
+	else directory = created;
+}
+
+Assets::~Assets() {
+	for(auto & file : files)
+		std::remove(file.c_str());
+	if(directory != ".") rmdir(directory.c_str());
+}
+
+std::string Assets::VertexShader() {
+	return write("bench.vert",
+		"#version 330 core\n"
+		"layout (location = 0) in vec3 aPos;\n"
+		"layout (location = 1) in vec3 aNormal;\n"
+		"layout (location = 2) in vec2 aTexCoords;\n"
+		"uniform mat4 model;\n"
+		"uniform mat4 view;\n"
+		"uniform mat4 projection;\n"
+		"out vec3 normal;\n"
+		"void main() {\n"
+		"	normal = mat3(model) * aNormal;\n"
+		"	gl_Position = projection * view * model * vec4(aPos, 1.0);\n"
+		"}\n");
+}
+
+std::string Assets::FragmentShader() {
+	return write("bench.frag",
+		"#version 330 core\n"
+		"in vec3 normal;\n"
+		"out vec4 color;\n"
+		"void main() {\n"
+		"	float light = max(dot(normalize(normal), normalize(vec3(.3, 1., .5))), .1);\n"
+		"	color = vec4(vec3(light), 1.0);\n"
+		"}\n");
+}
+
+std::string Assets::LitVertexShader() {
+	return write("bench-lit.vert",
+		"#version 430 core\n"
+		"layout (location = 0) in vec3 aPos;\n"
+		"layout (location = 1) in vec3 aNormal;\n"
+		"layout (location = 2) in vec2 aTexCoords;\n"
+		"uniform mat4 model;\n"
+		"uniform mat4 view;\n"
+		"uniform mat4 projection;\n"
+		"out vec3 position;\n"
+		"out vec3 normal;\n"
+		"out float viewDepth;\n"
+		"void main() {\n"
+		"	vec4 world = model * vec4(aPos, 1.0);\n"
+		"	vec4 eye = view * world;\n"
+		"	position = world.xyz;\n"
+		"	normal = mat3(model) * aNormal;\n"
+		"	viewDepth = -eye.z;\n"
+		"	gl_Position = projection * eye;\n"
+		"}\n");
+}
+
+std::string Assets::LitFragmentShader() {
+	return write("bench-lit.frag",
+		"#version 430 core\n"
+		"layout(std430, binding = 1) readonly buffer CGLLights {\n"
+		"	uvec4 cglLightGrid;\n"
+		"	vec4 cglLightSlices;\n"
+		"	vec4 cglLightViewport;\n"
+		"	vec4 cglLights[];\n"
+		"};\n"
+		"layout(std430, binding = 2) readonly buffer CGLLightClusters { uvec2 cglLightClusters[]; };\n"
+		"layout(std430, binding = 3) readonly buffer CGLLightIndices { uint cglLightIndices[]; };\n"
+		"in vec3 position;\n"
+		"in vec3 normal;\n"
+		"in float viewDepth;\n"
+		"out vec4 color;\n"
+		"void main() {\n"
+		"	vec3 n = normalize(normal);\n"
+		"	vec3 result = vec3(.02);\n"
+		"	for(uint i = 0u; i < cglLightGrid.w; i++)\n"
+		"		result += max(dot(n, -cglLights[2u * i].xyz), 0.0) * cglLights[2u * i + 1u].rgb;\n"
+		"	uint slice = min(uint(max(log(viewDepth) * cglLightSlices.x + cglLightSlices.y, 0.0)), cglLightGrid.z - 1u);\n"
+		"	uvec2 tile = min(uvec2((gl_FragCoord.xy - cglLightViewport.xy) / cglLightSlices.zw), cglLightGrid.xy - 1u);\n"
+		"	uvec2 range = cglLightClusters[tile.x + cglLightGrid.x * (tile.y + cglLightGrid.y * slice)];\n"
+		"	for(uint i = 0u; i < range.y; i++) {\n"
+		"		uint light = cglLightIndices[range.x + i];\n"
+		"		vec4 source = cglLights[2u * light];\n"
+		"		vec3 toLight = source.xyz - position;\n"
+		"		float distance = length(toLight);\n"
+		"		float falloff = pow(clamp(1.0 - pow(distance / source.w, 4.0), 0.0, 1.0), 2.0) / (distance * distance + 1.0);\n"
+		"		result += max(dot(n, toLight / distance), 0.0) * falloff * cglLights[2u * light + 1u].rgb;\n"
+		"	}\n"
+		"	color = vec4(result, 1.0);\n"
+		"}\n");
+}
+
+std::string Assets::ShadowedFragmentShader() {
+	return write("bench-shadowed.frag",
+		"#version 330 core\n"
+		"layout(std140) uniform CGLShadows {\n"
+		"	mat4 cglShadowMatrices[4];\n"
+		"	vec4 cglShadowParams;\n"
+		"};\n"
+		"uniform sampler2DArrayShadow cglShadowMap;\n"
+		"in vec3 position;\n"
+		"in vec3 normal;\n"
+		"in float viewDepth;\n"
+		"out vec4 color;\n"
+		"void main() {\n"
+		"	float lit = 1.0;\n"
+		"	for(int i = 0; i < int(cglShadowParams.x); i++) {\n"
+		"		vec4 coords = cglShadowMatrices[i] * vec4(position, 1.0);\n"
+		"		if(all(greaterThan(coords.xy, vec2(0.0))) && all(lessThan(coords.xy, vec2(1.0)))) {\n"
+		"			lit = texture(cglShadowMap, vec4(coords.xy, float(i), coords.z));\n"
+		"			break;\n"
+		"		}\n"
+		"	}\n"
+		"	float light = max(dot(normalize(normal), normalize(vec3(.3, 1., .5))), 0.0) * lit;\n"
+		"	color = vec4(vec3(.1 + .9 * light), 1.0);\n"
+		"}\n");
+}
+
+std::string Assets::SkinnedVertexShader() {
+	return write("bench-skinned.vert",
+		"#version 430 core\n"
+		"layout (location = 0) in vec3 aPos;\n"
+		"layout (location = 1) in vec3 aNormal;\n"
+		"layout (location = 2) in vec2 aTexCoords;\n"
+		"#ifdef CGL_SKINNING\n"
+		"layout (location = 3) in uvec4 aBoneIds;\n"
+		"layout (location = 4) in vec4 aBoneWeights;\n"
+		"layout(std430, binding = 5) readonly buffer CGLBones { mat4 cglBones[]; };\n"
+		"#endif\n"
+		"uniform mat4 model;\n"
+		"uniform mat4 view;\n"
+		"uniform mat4 projection;\n"
+		"out vec3 normal;\n"
+		"void main() {\n"
+		"	mat4 transform = model;\n"
+		"#ifdef CGL_SKINNING\n"
+		"	transform = model * (aBoneWeights.x * cglBones[aBoneIds.x] + aBoneWeights.y * cglBones[aBoneIds.y]\n"
+		"			+ aBoneWeights.z * cglBones[aBoneIds.z] + aBoneWeights.w * cglBones[aBoneIds.w]);\n"
+		"#endif\n"
+		"	normal = mat3(transform) * aNormal;\n"
+		"	gl_Position = projection * view * transform * vec4(aPos, 1.0);\n"
+		"}\n");
+}
+
+/*
+ * Base64 of binary data (for data URIs of glTF buffers)
+ */
+static std::string base64(const std::vector<unsigned char> & data) {
+	static const char digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	std::string text;
+	for(size_t i = 0; i < data.size(); i += 3) {
+		unsigned int bits = (unsigned int)data[i] << 16;
+		if(i + 1 < data.size()) bits |= (unsigned int)data[i + 1] << 8;
+		if(i + 2 < data.size()) bits |= data[i + 2];
+		text += digits[(bits >> 18) & 63];
+		text += digits[(bits >> 12) & 63];
+		text += i + 1 < data.size() ? digits[(bits >> 6) & 63] : '=';
+		text += i + 2 < data.size() ? digits[bits & 63] : '=';
+	}
+	return text;
+}
+
+std::string Assets::SkinnedModel(std::string name, int joints, float length, float radius) {
+	const int sides = 8, ringsPerJoint = 4;
+	const int rings = joints * ringsPerJoint + 1;
+	float jointLength = length / (float)joints;
+
+	// Buffer views in order: positions, normals, joints, weights, indices,
+	// inverse bind matrices, key times, key rotations
+	std::vector<unsigned char> buffer;
+	std::vector<size_t> views;
+	auto append = [&](const void * data, size_t size) {
+		views.push_back(buffer.size());
+		buffer.insert(buffer.end(), (const unsigned char*)data, (const unsigned char*)data + size);
+		while(buffer.size() % 4) buffer.push_back(0);
+	};
+
+	// Rings around the joint chain, each vertex weighted between the two closest joints
+	std::vector<float> positions, normals, weights;
+	std::vector<uint16_t> jointIds, indices;
+	for(int ring = 0; ring < rings; ring++) {
+		float y = length * (float)ring / (float)(rings - 1);
+		float along = y / jointLength - .5f;
+		int lower = std::max(0, std::min(joints - 1, (int)std::floor(along)));
+		int upper = std::min(joints - 1, lower + 1);
+		float blend = upper == lower ? 0.f : std::max(0.f, std::min(1.f, along - (float)lower));
+		for(int side = 0; side < sides; side++) {
+			float angle = 6.2831853f * (float)side / (float)sides;
+			float x = std::cos(angle), z = std::sin(angle);
+			positions.insert(positions.end(), { x * radius, y, z * radius });
+			normals.insert(normals.end(), { x, 0.f, z });
+			jointIds.insert(jointIds.end(), { (uint16_t)lower, (uint16_t)upper, 0, 0 });
+			weights.insert(weights.end(), { 1.f - blend, blend, 0.f, 0.f });
+		}
+	}
+	for(int ring = 0; ring + 1 < rings; ring++)
+		for(int side = 0; side < sides; side++) {
+			uint16_t a = (uint16_t)(ring * sides + side), b = (uint16_t)(ring * sides + (side + 1) % sides);
+			indices.insert(indices.end(), { a, (uint16_t)(a + sides), b, b, (uint16_t)(a + sides), (uint16_t)(b + sides) });
+		}
+
+	// Joints are spaced along +Y, their bind matrices undo that
+	std::vector<float> inverseBinds;
+	for(int joint = 0; joint < joints; joint++) {
+		float bind[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, -jointLength * (float)joint, 0, 1 };
+		inverseBinds.insert(inverseBinds.end(), bind, bind + 16);
+	}
+	// Sway around Z: 0, +20, 0, -20, 0 degrees
+	std::vector<float> times = { 0.f, .5f, 1.f, 1.5f, 2.f }, rotations;
+	for(float degrees : { 0.f, 20.f, 0.f, -20.f, 0.f }) {
+		float half = .5f * degrees * 3.14159265f / 180.f;
+		rotations.insert(rotations.end(), { 0.f, 0.f, std::sin(half), std::cos(half) });
+	}
+
+	append(positions.data(), positions.size() * sizeof(float));
+	append(normals.data(), normals.size() * sizeof(float));
+	append(jointIds.data(), jointIds.size() * sizeof(uint16_t));
+	append(weights.data(), weights.size() * sizeof(float));
+	append(indices.data(), indices.size() * sizeof(uint16_t));
+	append(inverseBinds.data(), inverseBinds.size() * sizeof(float));
+	append(times.data(), times.size() * sizeof(float));
+	append(rotations.data(), rotations.size() * sizeof(float));
+	size_t sizes[] = {
+		positions.size() * sizeof(float), normals.size() * sizeof(float), jointIds.size() * sizeof(uint16_t),
+		weights.size() * sizeof(float), indices.size() * sizeof(uint16_t), inverseBinds.size() * sizeof(float),
+		times.size() * sizeof(float), rotations.size() * sizeof(float) };
+
+	std::ostringstream gltf;
+	int vertices = rings * sides;
+	gltf << "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0,1]}],\"nodes\":["
+		<< "{\"mesh\":0,\"skin\":0}";
+	for(int joint = 0; joint < joints; joint++) {
+		gltf << ",{\"name\":\"joint" << joint << "\",\"translation\":[0," << (joint ? jointLength : 0.f) << ",0]";
+		if(joint + 1 < joints) gltf << ",\"children\":[" << joint + 2 << "]";
+		gltf << "}";
+	}
+	gltf << "],\"skins\":[{\"inverseBindMatrices\":5,\"joints\":[";
+	for(int joint = 0; joint < joints; joint++) gltf << (joint ? "," : "") << joint + 1;
+	gltf << "]}],\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"NORMAL\":1,\"JOINTS_0\":2,\"WEIGHTS_0\":3},\"indices\":4}]}],"
+		<< "\"animations\":[{\"name\":\"bend\",\"samplers\":[{\"input\":6,\"output\":7}],\"channels\":[";
+	for(int joint = 0; joint < joints; joint++)
+		gltf << (joint ? "," : "") << "{\"sampler\":0,\"target\":{\"node\":" << joint + 1 << ",\"path\":\"rotation\"}}";
+	gltf << "]}],\"buffers\":[{\"byteLength\":" << buffer.size()
+		<< ",\"uri\":\"data:application/octet-stream;base64," << base64(buffer) << "\"}],\"bufferViews\":[";
+	for(size_t view = 0; view < views.size(); view++)
+		gltf << (view ? "," : "") << "{\"buffer\":0,\"byteOffset\":" << views[view] << ",\"byteLength\":" << sizes[view] << "}";
+	gltf << "],\"accessors\":["
+		<< "{\"bufferView\":0,\"componentType\":5126,\"count\":" << vertices << ",\"type\":\"VEC3\",\"min\":["
+		<< -radius << ",0," << -radius << "],\"max\":[" << radius << "," << length << "," << radius << "]},"
+		<< "{\"bufferView\":1,\"componentType\":5126,\"count\":" << vertices << ",\"type\":\"VEC3\"},"
+		<< "{\"bufferView\":2,\"componentType\":5123,\"count\":" << vertices << ",\"type\":\"VEC4\"},"
+		<< "{\"bufferView\":3,\"componentType\":5126,\"count\":" << vertices << ",\"type\":\"VEC4\"},"
+		<< "{\"bufferView\":4,\"componentType\":5123,\"count\":" << indices.size() << ",\"type\":\"SCALAR\"},"
+		<< "{\"bufferView\":5,\"componentType\":5126,\"count\":" << joints << ",\"type\":\"MAT4\"},"
+		<< "{\"bufferView\":6,\"componentType\":5126,\"count\":" << times.size() << ",\"type\":\"SCALAR\",\"min\":[0],\"max\":[2]},"
+		<< "{\"bufferView\":7,\"componentType\":5126,\"count\":" << times.size() << ",\"type\":\"VEC4\"}]}\n";
+	return write(name + ".gltf", gltf.str());
+}
+
+std::string Assets::Box(std::string name, glm::vec3 h) {
+	std::ostringstream obj;
+	// 8 corners
+	for(int i = 0; i < 8; i++)
+		obj << "v " << ((i & 1) ? h.x : -h.x) << " " << ((i & 2) ? h.y : -h.y) << " " << ((i & 4) ? h.z : -h.z) << "\n";
+	// 6 faces as quads (counter clockwise from outside); Assimp triangulates them
+	obj << "vn -1 0 0\nvn 1 0 0\nvn 0 -1 0\nvn 0 1 0\nvn 0 0 -1\nvn 0 0 1\n";
+	obj << "f 1//1 5//1 7//1 3//1\n"
+		<< "f 2//2 4//2 8//2 6//2\n"
+		<< "f 1//3 2//3 6//3 5//3\n"
+		<< "f 3//4 7//4 8//4 4//4\n"
+		<< "f 1//5 3//5 4//5 2//5\n"
+		<< "f 5//6 6//6 8//6 7//6\n";
+	return write(name + ".obj", obj.str());
+}
+
+std::string Assets::Plane(std::string name, float s) {
+	std::ostringstream obj;
+	obj << "v " << -s << " 0 " << -s << "\n"
+		<< "v " << s << " 0 " << -s << "\n"
+		<< "v " << s << " 0 " << s << "\n"
+		<< "v " << -s << " 0 " << s << "\n"
+		<< "vn 0 1 0\n"
+		<< "f 1//1 4//1 3//1 2//1\n";
+	return write(name + ".obj", obj.str());
+}
+
+std::string Assets::Image(std::string name, int size, unsigned seed) {
+	std::mt19937 random(seed);
+	std::vector<unsigned char> pixels((size_t)size * size * 4);
+	// Gradient with noise, so PNG compression doesn't make decoding trivial
+	for(int y = 0; y < size; y++)
+		for(int x = 0; x < size; x++) {
+			unsigned char* pixel = &pixels[((size_t)y * size + x) * 4];
+			pixel[0] = (unsigned char)(x * 255 / size);
+			pixel[1] = (unsigned char)(y * 255 / size);
+			pixel[2] = (unsigned char)(random() & 0xFF);
+			pixel[3] = 255;
+		}
+
+	std::string path = directory + "/" + name + ".png";
+	if(!SOIL_save_image(path.c_str(), SOIL_SAVE_TYPE_PNG, size, size, 4, pixels.data()))
+		std::cout << "CGLBENCH::ERROR::ASSETS Could not write " << path << "\n";
+	files.push_back(path);
+	return name + ".png";
+}
+
+std::string Assets::TexturedModel(std::string name, const std::vector<std::string> & images) {
+	std::ostringstream mtl, obj;
+	obj << "mtllib " << name << ".mtl\n";
+	for(size_t i = 0; i < images.size(); i++) {
+		mtl << "newmtl m" << i << "\nKd 1 1 1\nmap_Kd " << images[i] << "\n";
+		float x = 2.f * (float)i;
+		obj << "v " << x << " 0 0\nv " << x + 1.f << " 0 0\nv " << x + 1.f << " 1 0\nv " << x << " 1 0\n";
+	}
+	obj << "vt 0 0\nvt 1 0\nvt 1 1\nvt 0 1\nvn 0 0 1\n";
+	for(size_t i = 0; i < images.size(); i++) {
+		size_t v = 4 * i + 1;
+		obj << "usemtl m" << i << "\nf " << v << "/1/1 " << v + 1 << "/2/1 " << v + 2 << "/3/1 " << v + 3 << "/4/1\n";
+	}
+	write(name + ".mtl", mtl.str());
+	return write(name + ".obj", obj.str());
+}
+
+std::string Assets::GetDirectory() const {
+	return directory;
+}
+
+std::string Assets::write(std::string name, std::string content) {
+	std::string path = directory + "/" + name;
+	std::ofstream file(path);
+	file << content;
+	files.push_back(path);
+	return path;
+}
+/* Assets */
+} /* namespace CGLBench */
@@ -0,0 +1,139 @@
+/*
+ * Helpers shared by benchmark workloads:
+ * - statistics of samples (mean and percentiles)
+ * - flat JSON report
+ * - generated assets (shaders and OBJ models) in a temporary directory,
+ *   so workloads don't depend on any files outside the repository
+ */
+
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace CGLBench {
+
+/*
+ * Statistics of a set of samples (in whatever unit they were collected)
+ */
+struct Summary {
+	double mean, p50, p90, p99, max;
+	size_t count;
+};
+
+Summary Summarize(std::vector<double> samples);
+
+/*
+ * Peak resident set size of the process in kilobytes
+ */
+long PeakRSS();
+
+/*
+ * Wall clock stopwatch in milliseconds
+ */
+class Stopwatch {
+public:
+	Stopwatch() { Restart(); }
+	void Restart() { start = std::chrono::steady_clock::now(); }
+	double Elapsed() const { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count(); }
+private:
+	std::chrono::steady_clock::time_point start;
+};
+
+/*
+ * JSON object with fields in insertion order
+ */
+class Report {
+public:
+	void Set(std::string key, double value);
+	void Set(std::string key, long long value);
+	void Set(std::string key, std::string value);
+	void Set(std::string key, const Summary & summary);
+	void Set(std::string key, const Report & object);
+
+	std::string ToJSON() const;
+
+private:
+	std::vector<std::pair<std::string, std::string>> fields;
+};
+
+/*
+ * Temporary directory with generated assets, removed in the dtor
+ */
+class Assets {
+public:
+	Assets();
+	~Assets();
+
+	Assets(const Assets &other) = delete;
+	Assets& operator=(const Assets &other) = delete;
+
+	/*
+	 * Vertex and fragment shader with model/view/projection uniforms
+	 * and color from normals (no textures needed)
+	 */
+	std::string VertexShader();
+	std::string FragmentShader();
+
+	/*
+	 * Same inputs, lit by the Scene's clustered lights (#version 430, see LightGrid.h)
+	 */
+	std::string LitVertexShader();
+	std::string LitFragmentShader();
+
+	/*
+	 * Fragment shader for LitVertexShader() lit by a sun with cascaded shadows (see ShaderProgram.h)
+	 */
+	std::string ShadowedFragmentShader();
+
+	/*
+	 * Vertex shader of a ShaderPermutation skinning with the Scene's bone palette
+	 * under CGL_SKINNING (#version 430, see Animator.h); FragmentShader() fits it
+	 */
+	std::string SkinnedVertexShader();
+
+	/*
+	 * Tube along +Y of the given length and radius over a chain of joints (glTF with
+	 * an embedded buffer) and a looping 2 second clip "bend" swaying all joints
+	 */
+	std::string SkinnedModel(std::string name, int joints, float length, float radius);
+
+	/*
+	 * Box centered at the origin, and a plane in XZ with normal +Y
+	 */
+	std::string Box(std::string name, glm::vec3 halfExtents);
+	std::string Plane(std::string name, float halfSize);
+
+	/*
+	 * Noisy RGBA PNG image size x size (different for every seed)
+	 */
+	std::string Image(std::string name, int size, unsigned seed);
+
+	/*
+	 * Model with one quad per texture, each with its own material
+	 * which diffuse map is the given image (file name in the assets directory)
+	 */
+	std::string TexturedModel(std::string name, const std::vector<std::string> & images);
+
+	std::string GetDirectory() const;
+
+private:
+	std::string directory;
+	std::vector<std::string> files;
+
+	std::string write(std::string name, std::string content);
+};
+
+} /* namespace CGLBench */
+
+#endif /* BENCHMARK_H_ */
@@ -0,0 +1,127 @@
+#include "OffscreenContext.h"
+
+namespace CGLBench {
+
+/* Ctor & Dtor */
+OffscreenContext::OffscreenContext(int width, int height) {
+	this->width = width;
+	this->height = height;
+	display = EGL_NO_DISPLAY;
+	context = EGL_NO_CONTEXT;
+	fbo = colorBuffer = depthBuffer = 0;
+
+	valid = createContext() && createFramebuffer();
+}
+
+OffscreenContext::~OffscreenContext() {
+	if(fbo) {
+		glDeleteFramebuffers(1, &fbo);
+		glDeleteRenderbuffers(1, &colorBuffer);
+		glDeleteRenderbuffers(1, &depthBuffer);
+	}
+	if(display != EGL_NO_DISPLAY) {
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if(context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+		eglTerminate(display);
+	}
+}
+/* Ctor & Dtor */
+/* Public Methods */
+bool OffscreenContext::IsValid() const {
+	return valid;
+}
+
+int OffscreenContext::GetWidth() const {
+	return width;
+}
+
+int OffscreenContext::GetHeight() const {
+	return height;
+}
+
+GLuint OffscreenContext::GetFramebuffer() const {
+	return fbo;
+}
+
+std::string OffscreenContext::GetRenderer() const {
+	if(!valid) return std::string();
+	const GLubyte * renderer = glGetString(GL_RENDERER);
+	return renderer ? std::string((const char*)renderer) : std::string();
+}
+/* Public Methods */
+/* Private Methods */
+bool OffscreenContext::createContext() {
+	// Surfaceless platform needs neither X11 nor a GPU
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+			(PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if(getPlatformDisplay)
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	if(display == EGL_NO_DISPLAY)
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if(display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL)) {
+		std::cout << "CGLBENCH::ERROR::OFFSCREENCONTEXT Could not initialize EGL display\n";
+		return false;
+	}
+
+	if(!eglBindAPI(EGL_OPENGL_API)) {
+		std::cout << "CGLBENCH::ERROR::OFFSCREENCONTEXT Desktop OpenGL is not supported by EGL\n";
+		return false;
+	}
+
+	const EGLint configAttribs[] = {
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_NONE
+	};
+	EGLConfig config; EGLint numConfigs = 0;
+	if(!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs < 1) {
+		std::cout << "CGLBENCH::ERROR::OFFSCREENCONTEXT No EGL config for OpenGL\n";
+		return false;
+	}
+
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+	if(context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		std::cout << "CGLBENCH::ERROR::OFFSCREENCONTEXT Could not create surfaceless OpenGL 3.3 core context\n";
+		return false;
+	}
+
+	// GLEW built for GLX reports missing GLX display, but GL entry points are loaded by then
+	glewExperimental = GL_TRUE;
+	GLenum glewResult = glewInit();
+	if(glewResult != GLEW_OK && glewResult != GLEW_ERROR_NO_GLX_DISPLAY) {
+		std::cout << "CGLBENCH::ERROR::OFFSCREENCONTEXT GLEW initialization failed (" << glewResult << ")\n";
+		return false;
+	}
+	return true;
+}
+
+bool OffscreenContext::createFramebuffer() {
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+	glGenRenderbuffers(1, &colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+	if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "CGLBENCH::ERROR::OFFSCREENCONTEXT Framebuffer is not complete\n";
+		return false;
+	}
+
+	glViewport(0, 0, width, height);
+	glEnable(GL_DEPTH_TEST);
+	return true;
+}
+/* Private Methods */
+} /* namespace CGLBench */
@@ -0,0 +1,57 @@
+/*
+ * OffscreenContext creates an OpenGL context without any window system
+ * (EGL with Mesa's surfaceless platform, so it works with llvmpipe on a GPU-less machine)
+ * and a framebuffer object to render into.
+ */
+
+#ifndef OFFSCREENCONTEXT_H_
+#define OFFSCREENCONTEXT_H_
+
+#include <GL/glew.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <iostream>
+#include <string>
+
+namespace CGLBench {
+
+class OffscreenContext {
+public:
+	OffscreenContext(int width, int height);
+	~OffscreenContext();
+
+	OffscreenContext(const OffscreenContext &other) = delete;
+	OffscreenContext& operator=(const OffscreenContext &other) = delete;
+
+	/*
+	 * True if the context is current and the framebuffer is complete
+	 */
+	bool IsValid() const;
+
+	int GetWidth() const;
+	int GetHeight() const;
+	GLuint GetFramebuffer() const;
+
+	/*
+	 * GL_RENDERER string, to tell llvmpipe from a real GPU in results
+	 */
+	std::string GetRenderer() const;
+
+private:
+	int width, height;
+	bool valid;
+
+	EGLDisplay display;
+	EGLContext context;
+
+	GLuint fbo, colorBuffer, depthBuffer;
+
+	bool createContext();
+	bool createFramebuffer();
+};
+
+} /* namespace CGLBench */
+
+#endif /* OFFSCREENCONTEXT_H_ */
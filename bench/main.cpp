@@ -0,0 +1,901 @@
+/*
+ * cgl-bench -- reproducible CGL workloads with JSON results
+ *
+ * Usage: cgl-bench <workload> [--count N] [--frames F] [--width W] [--height H]
+ *                  [--frames-in-flight N] [--out FILE]
+ * Workloads:
+ *   boxes       - N boxes falling on a plane (rendered)
+ *   models      - N distinct models, one Actor each (rendered)
+ *   primitives  - the boxes of models (every fourth a sphere) drawn with the
+ *                 built-in primitive meshes instead of loaded models (rendered)
+ *   transparent - N transparent Actors over a plane (rendered)
+ *   physics     - N boxes falling on a plane, headless Scene, F fixed steps,
+ *                 then a check that stepping from a loaded snapshot is repeatable
+ *   spatial     - SpatialIndex update + query cost with N boxes, F iterations
+ *   hierarchy   - TransformHierarchy of N transforms in chains 64 deep, F iterations
+ *                 moving 16 of them, incremental and full world matrix updates
+ *   textures    - load of a model with N distinct PNG textures, F loads per
+ *                 texture decoding thread count (1, 2, 4, ... hardware threads)
+ *   views       - N boxes rendered from 1, 2, 4 and 8 Cameras in split-screen
+ *                 viewports, F frozen frames per view count
+ *   occlusion   - street level view of a city block grid with N small props,
+ *                 F frames without and with occlusion culling (buildings are occluders)
+ *   lights      - N moving point lights over a field of boxes with clustered
+ *                 forward lighting, F frozen frames
+ *   shadows     - N boxes falling into a field of static boxes under a sun with
+ *                 cascaded shadow maps, F frames without and with static shadow caching
+ *   animation   - N skinned Actors playing a looping clip, F frames with GPU and
+ *                 with CPU skinning
+ *   static      - field of N static boxes with a few falling ones, F frames
+ *                 without and with static batching
+ *
+ * Rendered workloads run on an offscreen EGL context (Mesa llvmpipe works),
+ * so they need no display and no GPU. --frames-in-flight sets the Scene's
+ * frame pipeline depth (0 is the low latency mode), frame_ms is then the
+ * interval between frames rather than the latency of a single one.
+ */
+
+#include "Benchmark.h"
+#include "OffscreenContext.h"
+
+#include "Scene.h"
+#include "SpatialIndex.h"
+#include "TransformHierarchy.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+
+using namespace CGLBench;
+
+struct Options {
+	std::string workload;
+	long count;
+	long frames;
+	int width, height;
+	int framesInFlight;
+	std::string out;
+};
+
+/*
+ * Deterministic position of i-th box in a grid of layers above the plane
+ */
+static glm::mat4 gridPosition(long i, long count, float spacing, float height) {
+	long side = (long)std::ceil(std::sqrt((double)std::min(count, 400L)));
+	long perLayer = side * side;
+	long layer = i / perLayer, cell = i % perLayer;
+	float offset = .5f * spacing * (float)(side - 1);
+	glm::vec3 position(
+			(float)(cell % side) * spacing - offset,
+			height + (float)layer * spacing,
+			(float)(cell / side) * spacing - offset);
+	return glm::translate(glm::mat4(1.f), position);
+}
+
+/*
+ * Busy time of every JobSystem thread relative to the wall time of the run
+ * (thread_0 stands for the thread driving the Scene)
+ */
+static void reportWorkers(CGL::Scene & scene, double elapsedMs, Report & report) {
+	Report workers;
+	std::vector<CGL::WorkerStats> stats = scene.GetJobSystem().GetWorkerStats();
+	for(size_t i = 0; i < stats.size(); i++) {
+		Report worker;
+		worker.Set("utilization", elapsedMs > 0.0 ? stats[i].busyMs / elapsedMs : 0.0);
+		worker.Set("jobs", (long long)stats[i].jobs);
+		worker.Set("steals", (long long)stats[i].steals);
+		workers.Set("thread_" + std::to_string(i), worker);
+	}
+	report.Set("job_threads", (long long)stats.size());
+	report.Set("job_workers", workers);
+}
+
+/*
+ * Render F frames of a prepared Scene and collect frame, physics and draw statistics
+ */
+static void runFrames(CGL::Scene & scene, OffscreenContext & context, const Options & options, Report & report) {
+	if(options.framesInFlight > 0) scene.SetFramesInFlight((unsigned int)options.framesInFlight);
+	scene.SetLowLatencyMode(options.framesInFlight == 0);
+
+	std::vector<double> frameTimes;
+	Stopwatch total, stopwatch;
+	scene.GetJobSystem().ResetWorkerStats();
+	for(long frame = 0; frame < options.frames; frame++) {
+		glClearColor(0.f, 0.f, 0.f, 1.f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// The Scene bounds the frames queued on the GPU itself
+		scene.RunScene(context.GetWidth(), context.GetHeight(), false);
+		if(frame > 0) frameTimes.push_back(stopwatch.Elapsed());
+		stopwatch.Restart();
+	}
+	glFinish();
+	double totalTime = total.Elapsed();
+
+	std::vector<double> waitTimes, physicsTimes, syncTimes, queueTimes, drawTimes, gpuTimes, drawCalls, triangles;
+	for(auto & event : scene.GetProfiler().GetEvents()) {
+		if(event.gpu) continue;
+		if(std::strcmp(event.name, "FrameWait") == 0) waitTimes.push_back(event.duration / 1000.0);
+		else if(std::strcmp(event.name, "Physics") == 0) physicsTimes.push_back(event.duration / 1000.0);
+		else if(std::strcmp(event.name, "Sync") == 0) syncTimes.push_back(event.duration / 1000.0);
+		else if(std::strcmp(event.name, "Queue") == 0) queueTimes.push_back(event.duration / 1000.0);
+		else if(std::strcmp(event.name, "Draw") == 0) drawTimes.push_back(event.duration / 1000.0);
+	}
+	for(auto & record : scene.GetProfiler().GetFrameRecords()) {
+		drawCalls.push_back((double)record.counters.drawCalls);
+		triangles.push_back((double)record.counters.triangles);
+		if(record.gpuTime > 0.0) gpuTimes.push_back(record.gpuTime);
+	}
+
+	CGL::SceneStats stats = scene.GetSceneStats();
+	report.Set("frame_ms", Summarize(frameTimes));
+	report.Set("frames_in_flight", (long long)options.framesInFlight);
+	report.Set("frame_wait_ms", Summarize(waitTimes));
+	report.Set("physics_step_ms", Summarize(physicsTimes));
+	report.Set("sync_ms", Summarize(syncTimes));
+	report.Set("queue_ms", Summarize(queueTimes));
+	report.Set("draw_cpu_ms", Summarize(drawTimes));
+	report.Set("draw_gpu_ms", Summarize(gpuTimes));
+	report.Set("draw_calls", Summarize(drawCalls));
+	report.Set("triangles", Summarize(triangles));
+	report.Set("drawn_actors", (long long)stats.drawnActors);
+	report.Set("culled_actors", (long long)stats.culledActors);
+	report.Set("active_bodies", (long long)stats.activeBodies);
+	report.Set("sleeping_bodies", (long long)stats.sleepingBodies);
+	reportWorkers(scene, totalTime, report);
+}
+
+static void addGround(CGL::Scene & scene, Assets & assets, std::string shader) {
+	scene.AddModel("ground-model", assets.Plane("ground", 50.f));
+	scene.AddPrimitivePlane("ground-body", glm::mat4(1.f), btVector3(0.f, 1.f, 0.f), 0.f);
+	scene.AddActor("ground", "ground-model", shader, "ground-body");
+}
+
+static bool boxesWorkload(const Options & options, Report & report) {
+	OffscreenContext context(options.width, options.height);
+	if(!context.IsValid()) return false;
+	report.Set("renderer", context.GetRenderer());
+
+	Assets assets;
+	CGL::Scene scene;
+	std::string shader = scene.AddShaderProgram("shader", assets.VertexShader(), assets.FragmentShader());
+	addGround(scene, assets, shader);
+	scene.AddModel("box-model", assets.Box("box", glm::vec3(.5f)));
+
+	Stopwatch setup;
+	for(long i = 0; i < options.count; i++) {
+		std::string name = "box-" + std::to_string(i);
+		scene.AddPrimitiveBox(name + "-body", gridPosition(i, options.count, 1.5f, 5.f), 1.f, btVector3(.5f, .5f, .5f));
+		scene.AddActor(name, "box-model", shader, name + "-body");
+	}
+	report.Set("setup_ms", setup.Elapsed());
+
+	runFrames(scene, context, options, report);
+	return true;
+}
+
+static bool modelsWorkload(const Options & options, Report & report) {
+	OffscreenContext context(options.width, options.height);
+	if(!context.IsValid()) return false;
+	report.Set("renderer", context.GetRenderer());
+
+	Assets assets;
+	CGL::Scene scene;
+	std::string shader = scene.AddShaderProgram("shader", assets.VertexShader(), assets.FragmentShader());
+	addGround(scene, assets, shader);
+
+	// Every model is a different box, so nothing is shared between Actors
+	Stopwatch setup;
+	for(long i = 0; i < options.count; i++) {
+		std::string name = "model-" + std::to_string(i);
+		glm::vec3 halfExtents(.3f + .002f * (float)(i % 100), .5f, .3f + .002f * (float)(i / 100 % 100));
+		scene.AddModel(name, assets.Box(name, halfExtents));
+		scene.AddPrimitiveBox(name + "-body", gridPosition(i, options.count, 2.f, 1.f), 0.f,
+				btVector3(halfExtents.x, halfExtents.y, halfExtents.z));
+		scene.AddActor(name + "-actor", name, shader, name + "-body");
+	}
+	report.Set("setup_ms", setup.Elapsed());
+
+	runFrames(scene, context, options, report);
+	return true;
+}
+
+static bool primitivesWorkload(const Options & options, Report & report) {
+	OffscreenContext context(options.width, options.height);
+	if(!context.IsValid()) return false;
+	report.Set("renderer", context.GetRenderer());
+
+	Assets assets;
+	CGL::Scene scene;
+	std::string shader = scene.AddShaderProgram("shader", assets.VertexShader(), assets.FragmentShader());
+
+	// Sizes of the models workload, but no file is loaded and all boxes share one mesh
+	Stopwatch setup;
+	scene.AddPrimitivePlane("ground-body", glm::mat4(1.f), btVector3(0.f, 1.f, 0.f), 0.f, 50.f);
+	scene.AddPrimitiveActor("ground", shader, "ground-body");
+	for(long i = 0; i < options.count; i++) {
+		std::string name = "primitive-" + std::to_string(i);
+		glm::vec3 halfExtents(.3f + .002f * (float)(i % 100), .5f, .3f + .002f * (float)(i / 100 % 100));
+		if(i % 4 == 3) scene.AddPrimitiveSphere(name + "-body", gridPosition(i, options.count, 2.f, 1.f), 0.f, halfExtents.x);
+		else scene.AddPrimitiveBox(name + "-body", gridPosition(i, options.count, 2.f, 1.f), 0.f,
+				btVector3(halfExtents.x, halfExtents.y, halfExtents.z));
+		scene.AddPrimitiveActor(name + "-actor", shader, name + "-body");
+	}
+	report.Set("setup_ms", setup.Elapsed());
+
+	runFrames(scene, context, options, report);
+	return true;
+}
+
+static bool transparentWorkload(const Options & options, Report & report) {
+	OffscreenContext context(options.width, options.height);
+	if(!context.IsValid()) return false;
+	report.Set("renderer", context.GetRenderer());
+
+	Assets assets;
+	CGL::Scene scene;
+	std::string shader = scene.AddShaderProgram("shader", assets.VertexShader(), assets.FragmentShader());
+	addGround(scene, assets, shader);
+	scene.AddModel("pane-model", assets.Box("pane", glm::vec3(1.f, 1.f, .05f)));
+
+	Stopwatch setup;
+	for(long i = 0; i < options.count; i++) {
+		std::string name = "pane-" + std::to_string(i);
+		scene.AddPrimitiveBox(name + "-body", gridPosition(i, options.count, 2.5f, 1.f), 0.f, btVector3(1.f, 1.f, .05f));
+		scene.AddActor(name, "pane-model", shader, name + "-body", true);
+	}
+	report.Set("setup_ms", setup.Elapsed());
+
+	runFrames(scene, context, options, report);
+	return true;
+}
+
+static bool physicsWorkload(const Options & options, Report & report) {
+	CGL::Scene scene(true);
+	scene.AddPrimitivePlane("ground-body", glm::mat4(1.f), btVector3(0.f, 1.f, 0.f), 0.f);
+	for(long i = 0; i < options.count; i++)
+		scene.AddPrimitiveBox("box-" + std::to_string(i), gridPosition(i, options.count, 1.5f, 5.f), 1.f, btVector3(.5f, .5f, .5f));
+
+	std::vector<double> stepTimes;
+	Stopwatch total, stopwatch;
+	scene.GetJobSystem().ResetWorkerStats();
+	for(long step = 0; step < options.frames; step++) {
+		stopwatch.Restart();
+		scene.StepScene(1.f/60.f);
+		stepTimes.push_back(stopwatch.Elapsed());
+	}
+	double totalTime = total.Elapsed();
+
+	CGL::SceneStats stats = scene.GetSceneStats();
+	report.Set("physics_step_ms", Summarize(stepTimes));
+	report.Set("steps_per_second", totalTime > 0.0 ? 1000.0 * (double)options.frames / totalTime : 0.0);
+	report.Set("active_bodies", (long long)stats.activeBodies);
+	report.Set("sleeping_bodies", (long long)stats.sleepingBodies);
+	char hash[32]; std::snprintf(hash, sizeof(hash), "%016llx", scene.GetSimulationStateHash());
+	report.Set("state_hash", std::string(hash));
+	reportWorkers(scene, totalTime, report);
+
+	// Rollback: stepping on from a loaded snapshot has to end in the same state
+	// whatever ran before the load (the first run leaves a different history)
+	std::vector<unsigned char> snapshot;
+	scene.SaveSnapshot(snapshot);
+	const long rollbackSteps = std::min(options.frames, 120L);
+	unsigned long long rollbackHashes[2];
+	for(long step = 0; step < rollbackSteps; step++) scene.StepScene(1.f/60.f);
+	for(int run = 0; run < 2; run++) {
+		scene.LoadSnapshot(snapshot);
+		for(long step = 0; step < rollbackSteps; step++) scene.StepScene(1.f/60.f);
+		rollbackHashes[run] = scene.GetSimulationStateHash();
+	}
+	bool deterministic = rollbackHashes[0] == rollbackHashes[1];
+	report.Set("rollback_deterministic", (long long)deterministic);
+	if(!deterministic) std::cout << "CGLBENCH::ERROR Stepping from a loaded snapshot diverged\n";
+	return deterministic;
+}
+
+static bool spatialWorkload(const Options & options, Report & report) {
+	// SpatialIndex never dereferences Actors, so ids stand in for them here
+	auto actorId = [](long i) { return reinterpret_cast<CGL::Actor*>((uintptr_t)(i + 1)); };
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> position(-500.f, 500.f), step(-.5f, .5f);
+	std::vector<glm::vec3> centers(options.count);
+	for(auto & center : centers) center = glm::vec3(position(random), position(random) * .1f, position(random));
+
+	CGL::SpatialIndex index;
+	const glm::vec3 half(.5f);
+	Stopwatch stopwatch;
+	for(long i = 0; i < options.count; i++)
+		index.Insert(actorId(i), centers[i] - half, centers[i] + half);
+	report.Set("build_ms", stopwatch.Elapsed());
+
+	// Every iteration 10% of boxes move, then frustum and radius queries run
+	glm::mat4 projection = glm::perspective(glm::radians(45.f), 16.f/9.f, .1f, 300.f);
+	std::vector<double> updateTimes, frustumTimes, radiusTimes, visible;
+	std::vector<CGL::Actor*> result;
+	for(long iteration = 0; iteration < options.frames; iteration++) {
+		stopwatch.Restart();
+		for(long i = iteration % 10; i < options.count; i += 10) {
+			centers[i] += glm::vec3(step(random), 0.f, step(random));
+			index.Update(actorId(i), centers[i] - half, centers[i] + half);
+		}
+		index.Optimize();
+		updateTimes.push_back(stopwatch.Elapsed());
+
+		float angle = .01f * (float)iteration;
+		glm::mat4 view = glm::lookAt(glm::vec3(0.f, 20.f, 0.f), glm::vec3(std::cos(angle), 20.f, std::sin(angle)), glm::vec3(0.f, 1.f, 0.f));
+		result.clear();
+		stopwatch.Restart();
+		index.QueryFrustum(projection * view, result);
+		frustumTimes.push_back(stopwatch.Elapsed());
+		visible.push_back((double)result.size());
+
+		result.clear();
+		stopwatch.Restart();
+		for(int query = 0; query < 100; query++)
+			index.QuerySphere(centers[(iteration * 100 + query) % options.count], 10.f, result);
+		radiusTimes.push_back(stopwatch.Elapsed() / 100.0);
+	}
+
+	report.Set("update_ms", Summarize(updateTimes));
+	report.Set("frustum_query_ms", Summarize(frustumTimes));
+	report.Set("radius_query_ms", Summarize(radiusTimes));
+	report.Set("visible", Summarize(visible));
+	return true;
+}
+
+static bool hierarchyWorkload(const Options & options, Report & report) {
+	const long depth = 64;
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> angle(-.1f, .1f);
+
+	// Chains like arms of a skeleton or long attachment chains: every transform
+	// is offset and rotated a little from its parent
+	CGL::TransformHierarchy hierarchy;
+	std::vector<CGL::TransformHandle> handles;
+	Stopwatch stopwatch;
+	for(long i = 0; i < options.count; i++) {
+		CGL::TransformHandle parent = i % depth ? handles.back() : CGL::INVALID_TRANSFORM;
+		glm::mat4 local = glm::rotate(glm::translate(glm::mat4(1.f), glm::vec3(0.f, 1.f, 0.f)), angle(random), glm::vec3(0.f, 0.f, 1.f));
+		handles.push_back(hierarchy.Create(parent, local));
+	}
+	hierarchy.Update();
+	report.Set("build_ms", stopwatch.Elapsed());
+
+	// A few transforms anywhere in the chains move every iteration
+	std::uniform_int_distribution<long> pick(0, options.count - 1);
+	std::vector<double> incrementalTimes, fullTimes, updated;
+	for(long iteration = 0; iteration < options.frames; iteration++) {
+		for(int moved = 0; moved < 16; moved++) {
+			CGL::TransformHandle handle = handles[pick(random)];
+			hierarchy.SetLocal(handle, glm::rotate(hierarchy.GetLocal(handle), angle(random), glm::vec3(0.f, 0.f, 1.f)));
+		}
+		stopwatch.Restart();
+		updated.push_back((double)hierarchy.Update());
+		incrementalTimes.push_back(stopwatch.Elapsed());
+
+		stopwatch.Restart();
+		hierarchy.Update(true);
+		fullTimes.push_back(stopwatch.Elapsed());
+	}
+
+	report.Set("depth", (long long)depth);
+	report.Set("incremental_ms", Summarize(incrementalTimes));
+	report.Set("full_ms", Summarize(fullTimes));
+	report.Set("updated_transforms", Summarize(updated));
+	return true;
+}
+
+static bool viewsWorkload(const Options & options, Report & report) {
+	OffscreenContext context(options.width, options.height);
+	if(!context.IsValid()) return false;
+	report.Set("renderer", context.GetRenderer());
+
+	Assets assets;
+	CGL::Scene scene;
+	std::string shader = scene.AddShaderProgram("shader", assets.VertexShader(), assets.FragmentShader());
+	addGround(scene, assets, shader);
+	scene.AddModel("box-model", assets.Box("box", glm::vec3(.5f)));
+	for(long i = 0; i < options.count; i++) {
+		std::string name = "box-" + std::to_string(i);
+		scene.AddPrimitiveBox(name + "-body", gridPosition(i, options.count, 1.5f, 5.f), 1.f, btVector3(.5f, .5f, .5f));
+		scene.AddActor(name, "box-model", shader, name + "-body");
+	}
+
+	// Cameras around the grid, all looking at its center
+	const int maxViews = 8;
+	for(int i = 0; i < maxViews; i++)
+		scene.AddCamera("view-" + std::to_string(i), glm::vec3(0.f, 15.f, 40.f), -20.f, -90.f + 360.f * (float)i / maxViews);
+
+	Report counts;
+	for(int viewCount = 1; viewCount <= maxViews; viewCount *= 2) {
+		// Split the frame buffer into a grid of viewports
+		int columns = viewCount > 2 ? viewCount / 2 : viewCount, rows = viewCount > 2 ? 2 : 1;
+		int width = context.GetWidth() / columns, height = context.GetHeight() / rows;
+		scene.ClearViews();
+		for(int i = 0; i < viewCount; i++)
+			scene.AddView("view-" + std::to_string(i), (i % columns) * width, (i / columns) * height, width, height, context.GetFramebuffer());
+
+		// Events of earlier view counts are skipped (the ring holds all of them at default sizes)
+		size_t firstEvent = scene.GetProfiler().GetEvents().size();
+		std::vector<double> frameTimes;
+		Stopwatch stopwatch;
+		for(long frame = 0; frame < options.frames; frame++) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			scene.RunScene(context.GetWidth(), context.GetHeight(), true);
+			if(frame > 0) frameTimes.push_back(stopwatch.Elapsed());
+			stopwatch.Restart();
+		}
+		glFinish();
+
+		std::vector<double> cullingTimes, drawTimes;
+		std::vector<CGL::ProfileEvent> events = scene.GetProfiler().GetEvents();
+		for(size_t i = std::min(firstEvent, events.size()); i < events.size(); i++) {
+			const CGL::ProfileEvent & event = events[i];
+			if(event.gpu) continue;
+			if(std::strcmp(event.name, "Culling") == 0) cullingTimes.push_back(event.duration / 1000.0);
+			else if(std::strcmp(event.name, "Draw") == 0) drawTimes.push_back(event.duration / 1000.0);
+		}
+		Report result;
+		result.Set("frame_ms", Summarize(frameTimes));
+		result.Set("culling_ms", Summarize(cullingTimes));
+		result.Set("draw_cpu_ms", Summarize(drawTimes));
+		result.Set("drawn_actors", (long long)scene.GetSceneStats().drawnActors);
+		counts.Set("views_" + std::to_string(viewCount), result);
+	}
+
+	report.Set("views", counts);
+	return true;
+}
+
+static bool occlusionWorkload(const Options & options, Report & report) {
+	OffscreenContext context(options.width, options.height);
+	if(!context.IsValid()) return false;
+	report.Set("renderer", context.GetRenderer());
+
+	Assets assets;
+	CGL::Scene scene;
+	std::string shader = scene.AddShaderProgram("shader", assets.VertexShader(), assets.FragmentShader());
+	addGround(scene, assets, shader);
+	scene.AddModel("building-model", assets.Box("building", glm::vec3(3.f, 8.f, 3.f)));
+	scene.AddModel("prop-model", assets.Box("prop", glm::vec3(.25f)));
+
+	// 8x8 blocks of static buildings, props scattered over the whole area
+	const int blocks = 8;
+	const float blockSpacing = 10.f;
+	for(int i = 0; i < blocks * blocks; i++) {
+		std::string name = "building-" + std::to_string(i);
+		glm::vec3 position((float)(i % blocks - blocks / 2) * blockSpacing + blockSpacing * .5f, 8.f, (float)(i / blocks - blocks / 2) * blockSpacing + blockSpacing * .5f);
+		scene.AddPrimitiveBox(name + "-body", glm::translate(glm::mat4(1.f), position), 0.f, btVector3(3.f, 8.f, 3.f));
+		scene.AddActor(name, "building-model", shader, name + "-body");
+		scene.SetActorOccluder(name, true);
+	}
+	unsigned seed = 1;
+	for(long i = 0; i < options.count; i++) {
+		std::string name = "prop-" + std::to_string(i);
+		seed = seed * 1103515245u + 12345u; float x = (float)(seed >> 8 & 0xffff) / 65535.f;
+		seed = seed * 1103515245u + 12345u; float z = (float)(seed >> 8 & 0xffff) / 65535.f;
+		float extent = blocks * blockSpacing * .5f;
+		glm::vec3 position((x * 2.f - 1.f) * extent, .25f, (z * 2.f - 1.f) * extent);
+		scene.AddPrimitiveBox(name + "-body", glm::translate(glm::mat4(1.f), position), 0.f, btVector3(.25f, .25f, .25f));
+		scene.AddActor(name, "prop-model", shader, name + "-body");
+	}
+
+	// Eye height at the edge of the grid, looking along a street
+	scene.AddCamera("street", glm::vec3(0.f, 1.7f, blocks * blockSpacing * .5f + 5.f), 0.f, -90.f);
+	scene.AddView("street", 0, 0, context.GetWidth(), context.GetHeight(), context.GetFramebuffer());
+
+	for(int enabled = 0; enabled < 2; enabled++) {
+		scene.SetOcclusionCulling(enabled != 0);
+		size_t firstEvent = scene.GetProfiler().GetEvents().size();
+		std::vector<double> frameTimes;
+		Stopwatch stopwatch;
+		for(long frame = 0; frame < options.frames; frame++) {
+			glClear(GL_COLOR_BUFFER_BIT);
+			scene.RunScene(context.GetWidth(), context.GetHeight(), true);
+			if(frame > 0) frameTimes.push_back(stopwatch.Elapsed());
+			stopwatch.Restart();
+		}
+		glFinish();
+
+		std::vector<double> occlusionTimes, drawTimes;
+		std::vector<CGL::ProfileEvent> events = scene.GetProfiler().GetEvents();
+		for(size_t i = std::min(firstEvent, events.size()); i < events.size(); i++) {
+			const CGL::ProfileEvent & event = events[i];
+			if(event.gpu) continue;
+			if(std::strcmp(event.name, "Occlusion") == 0) occlusionTimes.push_back(event.duration / 1000.0);
+			else if(std::strcmp(event.name, "Draw") == 0) drawTimes.push_back(event.duration / 1000.0);
+		}
+		CGL::SceneStats stats = scene.GetSceneStats();
+		Report result;
+		result.Set("frame_ms", Summarize(frameTimes));
+		result.Set("occlusion_ms", Summarize(occlusionTimes));
+		result.Set("draw_cpu_ms", Summarize(drawTimes));
+		result.Set("drawn_actors", (long long)stats.drawnActors);
+		result.Set("occluded_actors", (long long)stats.occludedActors);
+		result.Set("frustum_culled_actors", (long long)stats.culledActors);
+		report.Set(enabled ? "occlusion_on" : "occlusion_off", result);
+	}
+	return true;
+}
+
+static bool lightsWorkload(const Options & options, Report & report) {
+	OffscreenContext context(options.width, options.height);
+	if(!context.IsValid()) return false;
+	report.Set("renderer", context.GetRenderer());
+
+	Assets assets;
+	CGL::Scene scene;
+	std::string shader = scene.AddShaderProgram("shader", assets.LitVertexShader(), assets.LitFragmentShader());
+	addGround(scene, assets, shader);
+	scene.AddModel("box-model", assets.Box("box", glm::vec3(.5f)));
+	for(long i = 0; i < 400; i++) {
+		std::string name = "box-" + std::to_string(i);
+		scene.AddPrimitiveBox(name + "-body", gridPosition(i, 400, 3.f, .5f), 0.f, btVector3(.5f, .5f, .5f));
+		scene.AddActor(name, "box-model", shader, name + "-body");
+	}
+
+	// Lights of random colors just above the boxes, and a dim sun
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> unit(0.f, 1.f);
+	std::vector<glm::vec3> origins;
+	for(long i = 0; i < options.count; i++) {
+		glm::vec3 position((unit(random) * 2.f - 1.f) * 45.f, 1.5f + unit(random), (unit(random) * 2.f - 1.f) * 45.f);
+		scene.AddPointLight("light-" + std::to_string(i), position, glm::vec3(unit(random), unit(random), unit(random)), 4.f, 6.f);
+		origins.push_back(position);
+	}
+	scene.AddDirectionalLight("sun", glm::vec3(-.3f, -1.f, -.5f), glm::vec3(1.f), .1f);
+
+	std::vector<double> frameTimes, lightTimes, clusterLights;
+	Stopwatch stopwatch;
+	for(long frame = 0; frame < options.frames; frame++) {
+		// Lights circle around their origins, every frame rebuilds the clusters
+		float t = (float)frame * .05f;
+		for(long i = 0; i < options.count; i++)
+			scene.SetLightPosition("light-" + std::to_string(i), origins[i] + glm::vec3(std::cos(t + i), 0.f, std::sin(t + i)) * 2.f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		scene.RunScene(context.GetWidth(), context.GetHeight(), true);
+		if(frame > 0) frameTimes.push_back(stopwatch.Elapsed());
+		stopwatch.Restart();
+		clusterLights.push_back((double)scene.GetLightGridStats().maxClusterLights);
+	}
+	glFinish();
+
+	for(auto & event : scene.GetProfiler().GetEvents())
+		if(!event.gpu && std::strcmp(event.name, "Lights") == 0) lightTimes.push_back(event.duration / 1000.0);
+	CGL::LightGridStats stats = scene.GetLightGridStats();
+	report.Set("frame_ms", Summarize(frameTimes));
+	report.Set("lights_ms", Summarize(lightTimes));
+	report.Set("max_cluster_lights", Summarize(clusterLights));
+	report.Set("visible_point_lights", (long long)stats.pointLights);
+	report.Set("light_indices", (long long)stats.lightIndices);
+	return true;
+}
+
+static bool shadowsWorkload(const Options & options, Report & report) {
+	OffscreenContext context(options.width, options.height);
+	if(!context.IsValid()) return false;
+	report.Set("renderer", context.GetRenderer());
+
+	Assets assets;
+	CGL::Scene scene;
+	std::string shader = scene.AddShaderProgram("shader", assets.LitVertexShader(), assets.ShadowedFragmentShader());
+	addGround(scene, assets, shader);
+	scene.AddModel("box-model", assets.Box("box", glm::vec3(.5f)));
+	scene.AddModel("pillar-model", assets.Box("pillar", glm::vec3(.5f, 3.f, .5f)));
+
+	// Static level: a grid of pillars around the falling boxes
+	const long pillars = 2000;
+	for(long i = 0; i < pillars; i++) {
+		std::string name = "pillar-" + std::to_string(i);
+		glm::vec3 position((float)(i % 50 - 25) * 2.f + 1.f, 3.f, (float)(i / 50 - 20) * 2.f + 1.f);
+		scene.AddPrimitiveBox(name + "-body", glm::translate(glm::mat4(1.f), position), 0.f, btVector3(.5f, 3.f, .5f));
+		scene.AddActor(name, "pillar-model", shader, name + "-body");
+	}
+	for(long i = 0; i < options.count; i++) {
+		std::string name = "box-" + std::to_string(i);
+		scene.AddPrimitiveBox(name + "-body", gridPosition(i, options.count, 1.5f, 8.f), 1.f, btVector3(.5f, .5f, .5f));
+		scene.AddActor(name, "box-model", shader, name + "-body");
+	}
+	scene.AddDirectionalLight("sun", glm::vec3(-.3f, -1.f, -.5f), glm::vec3(1.f), 1.f);
+	scene.SetShadows("sun", 4, 2048, 100.f);
+
+	// The same falling boxes for both runs
+	std::vector<unsigned char> start;
+	scene.SaveSnapshot(start);
+	for(int caching = 0; caching < 2; caching++) {
+		scene.LoadSnapshot(start);
+		scene.SetShadowCaching(caching != 0);
+		size_t firstEvent = scene.GetProfiler().GetEvents().size();
+		std::vector<double> frameTimes, staticCasters, dynamicCasters, cacheUpdates;
+		Stopwatch stopwatch;
+		for(long frame = 0; frame < options.frames; frame++) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			scene.RunScene(context.GetWidth(), context.GetHeight(), false);
+			if(frame > 0) frameTimes.push_back(stopwatch.Elapsed());
+			stopwatch.Restart();
+			CGL::ShadowStats stats = scene.GetShadowStats();
+			staticCasters.push_back((double)stats.staticCasters);
+			dynamicCasters.push_back((double)stats.dynamicCasters);
+			cacheUpdates.push_back((double)stats.cacheUpdates);
+		}
+		glFinish();
+
+		std::vector<double> shadowTimes, shadowGpuTimes;
+		std::vector<CGL::ProfileEvent> events = scene.GetProfiler().GetEvents();
+		for(size_t i = std::min(firstEvent, events.size()); i < events.size(); i++) {
+			const CGL::ProfileEvent & event = events[i];
+			if(std::strcmp(event.name, "Shadows") != 0) continue;
+			(event.gpu ? shadowGpuTimes : shadowTimes).push_back(event.duration / 1000.0);
+		}
+		Report result;
+		result.Set("frame_ms", Summarize(frameTimes));
+		result.Set("shadows_cpu_ms", Summarize(shadowTimes));
+		result.Set("shadows_gpu_ms", Summarize(shadowGpuTimes));
+		result.Set("static_casters", Summarize(staticCasters));
+		result.Set("dynamic_casters", Summarize(dynamicCasters));
+		result.Set("cache_updates", Summarize(cacheUpdates));
+		report.Set(caching ? "caching_on" : "caching_off", result);
+	}
+	return true;
+}
+
+static bool animationWorkload(const Options & options, Report & report) {
+	OffscreenContext context(options.width, options.height);
+	if(!context.IsValid()) return false;
+	report.Set("renderer", context.GetRenderer());
+
+	Assets assets;
+	CGL::Scene scene;
+	std::string shader = scene.AddShaderPermutation("skinned", assets.SkinnedVertexShader(), assets.FragmentShader());
+	scene.AddModel("tube-model", assets.SkinnedModel("tube", 4, 1.2f, .15f));
+	for(long i = 0; i < options.count; i++) {
+		std::string name = "tube-" + std::to_string(i);
+		scene.AddPrimitiveBox(name + "-body", gridPosition(i, options.count, 1.5f, .6f), 0.f, btVector3(.2f, .6f, .2f));
+		scene.AddActor(name, "tube-model", shader, name + "-body");
+		// Different speeds, so the poses differ between Actors
+		scene.PlayAnimation(name, "bend", true, .8f + .04f * (float)(i % 10));
+	}
+
+	// The whole grid in one view
+	scene.AddCamera("overview", glm::vec3(0.f, 25.f, 45.f), -30.f, -90.f);
+	scene.AddView("overview", 0, 0, context.GetWidth(), context.GetHeight(), context.GetFramebuffer());
+
+	const CGL::SkinningMode modes[] = { CGL::SkinningMode::GPU, CGL::SkinningMode::CPU };
+	for(CGL::SkinningMode mode : modes) {
+		scene.SetSkinningMode(mode);
+		size_t firstEvent = scene.GetProfiler().GetEvents().size();
+		std::vector<double> frameTimes, gpuTimes;
+		Stopwatch stopwatch;
+		for(long frame = 0; frame < options.frames; frame++) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			scene.RunScene(context.GetWidth(), context.GetHeight(), false);
+			if(frame > 0) frameTimes.push_back(stopwatch.Elapsed());
+			stopwatch.Restart();
+		}
+		glFinish();
+
+		std::vector<double> animationTimes, drawTimes;
+		std::vector<CGL::ProfileEvent> events = scene.GetProfiler().GetEvents();
+		for(size_t i = std::min(firstEvent, events.size()); i < events.size(); i++) {
+			const CGL::ProfileEvent & event = events[i];
+			if(event.gpu) {
+				if(std::strcmp(event.name, "Draw") == 0) gpuTimes.push_back(event.duration / 1000.0);
+				continue;
+			}
+			if(std::strcmp(event.name, "Animation") == 0) animationTimes.push_back(event.duration / 1000.0);
+			else if(std::strcmp(event.name, "Draw") == 0) drawTimes.push_back(event.duration / 1000.0);
+		}
+		Report result;
+		result.Set("frame_ms", Summarize(frameTimes));
+		result.Set("animation_ms", Summarize(animationTimes));
+		result.Set("draw_cpu_ms", Summarize(drawTimes));
+		result.Set("draw_gpu_ms", Summarize(gpuTimes));
+		result.Set("animated_actors", (long long)scene.GetSceneStats().animatedActors);
+		report.Set(mode == CGL::SkinningMode::GPU ? "gpu_skinning" : "cpu_skinning", result);
+	}
+	return true;
+}
+
+static bool staticWorkload(const Options & options, Report & report) {
+	OffscreenContext context(options.width, options.height);
+	if(!context.IsValid()) return false;
+	report.Set("renderer", context.GetRenderer());
+
+	Assets assets;
+	CGL::Scene scene;
+	std::string shader = scene.AddShaderProgram("shader", assets.VertexShader(), assets.FragmentShader());
+	addGround(scene, assets, shader);
+	scene.AddModel("box-model", assets.Box("box", glm::vec3(.5f)));
+	scene.AddModel("pillar-model", assets.Box("pillar", glm::vec3(.4f, 1.f, .4f)));
+
+	// Static level: a square field of pillars, a few boxes keep falling into it
+	long side = (long)std::ceil(std::sqrt((double)options.count));
+	for(long i = 0; i < options.count; i++) {
+		std::string name = "pillar-" + std::to_string(i);
+		glm::vec3 position((float)(i % side) - .5f * (float)side, 1.f, (float)(i / side) - .5f * (float)side);
+		scene.AddPrimitiveBox(name + "-body", glm::translate(glm::mat4(1.f), position), 0.f, btVector3(.4f, 1.f, .4f));
+		scene.AddActor(name, "pillar-model", shader, name + "-body");
+	}
+	const long boxes = 100;
+	for(long i = 0; i < boxes; i++) {
+		std::string name = "box-" + std::to_string(i);
+		scene.AddPrimitiveBox(name + "-body", gridPosition(i, boxes, 1.5f, 8.f), 1.f, btVector3(.5f, .5f, .5f));
+		scene.AddActor(name, "box-model", shader, name + "-body");
+	}
+
+	// The whole field in one view
+	scene.AddCamera("overview", glm::vec3(0.f, .6f * (float)side, .8f * (float)side), -40.f, -90.f);
+	scene.AddView("overview", 0, 0, context.GetWidth(), context.GetHeight(), context.GetFramebuffer());
+
+	// The same falling boxes for both runs
+	std::vector<unsigned char> start;
+	scene.SaveSnapshot(start);
+	for(int batching = 0; batching < 2; batching++) {
+		scene.LoadSnapshot(start);
+		scene.SetStaticBatching(batching != 0);
+		size_t firstEvent = scene.GetProfiler().GetEvents().size();
+		size_t firstRecord = scene.GetProfiler().GetFrameRecords().size();
+		std::vector<double> frameTimes, batchDraws, visibleChunks;
+		Stopwatch stopwatch;
+		for(long frame = 0; frame < options.frames; frame++) {
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			scene.RunScene(context.GetWidth(), context.GetHeight(), false);
+			if(frame > 0) frameTimes.push_back(stopwatch.Elapsed());
+			stopwatch.Restart();
+			CGL::SceneStats stats = scene.GetSceneStats();
+			batchDraws.push_back((double)stats.staticBatchDraws);
+			visibleChunks.push_back((double)stats.visibleChunks);
+		}
+		glFinish();
+
+		std::vector<double> buildTimes, drawTimes, gpuTimes, drawCalls;
+		std::vector<CGL::ProfileEvent> events = scene.GetProfiler().GetEvents();
+		for(size_t i = std::min(firstEvent, events.size()); i < events.size(); i++) {
+			const CGL::ProfileEvent & event = events[i];
+			if(event.gpu) {
+				if(std::strcmp(event.name, "Draw") == 0) gpuTimes.push_back(event.duration / 1000.0);
+				continue;
+			}
+			if(std::strcmp(event.name, "Batching") == 0) buildTimes.push_back(event.duration / 1000.0);
+			else if(std::strcmp(event.name, "Draw") == 0) drawTimes.push_back(event.duration / 1000.0);
+		}
+		auto records = scene.GetProfiler().GetFrameRecords();
+		for(size_t i = std::min(firstRecord, records.size()); i < records.size(); i++)
+			drawCalls.push_back((double)records[i].counters.drawCalls);
+
+		CGL::StaticBatchStats batch = scene.GetStaticBatchStats();
+		Report result;
+		result.Set("frame_ms", Summarize(frameTimes));
+		result.Set("draw_cpu_ms", Summarize(drawTimes));
+		result.Set("draw_gpu_ms", Summarize(gpuTimes));
+		result.Set("draw_calls", Summarize(drawCalls));
+		result.Set("batch_draws", Summarize(batchDraws));
+		result.Set("visible_chunks", Summarize(visibleChunks));
+		result.Set("build_ms", Summarize(buildTimes));
+		result.Set("batched_actors", (long long)batch.actors);
+		result.Set("groups", (long long)batch.groups);
+		result.Set("chunks", (long long)batch.chunks);
+		report.Set(batching ? "batching_on" : "batching_off", result);
+	}
+	return true;
+}
+
+static bool texturesWorkload(const Options & options, Report & report) {
+	OffscreenContext context(options.width, options.height);
+	if(!context.IsValid()) return false;
+	report.Set("renderer", context.GetRenderer());
+
+	Assets assets;
+	std::vector<std::string> images;
+	for(long i = 0; i < options.count; i++)
+		images.push_back(assets.Image("texture-" + std::to_string(i), 512, (unsigned)i));
+	std::string model = assets.TexturedModel("textured", images);
+
+	std::vector<unsigned> threadCounts;
+	unsigned hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	for(unsigned threads = 1; threads < hardwareThreads; threads *= 2)
+		threadCounts.push_back(threads);
+	threadCounts.push_back(hardwareThreads);
+
+	// Every load is a new Model, textures aren't shared between them
+	Report loads;
+	for(unsigned threads : threadCounts) {
+		CGL::Model::SetTextureLoadThreads(threads);
+		std::vector<double> loadTimes;
+		for(long load = 0; load < options.frames; load++) {
+			Stopwatch stopwatch;
+			CGL::Model texturedModel("textured-" + std::to_string(threads) + "-" + std::to_string(load), model);
+			glFinish();
+			loadTimes.push_back(stopwatch.Elapsed());
+		}
+		loads.Set("threads_" + std::to_string(threads), Summarize(loadTimes));
+	}
+	CGL::Model::SetTextureLoadThreads(0);
+
+	report.Set("texture_size", (long long)512);
+	report.Set("load_ms", loads);
+	return true;
+}
+
+static void usage() {
+	std::cout << "Usage: cgl-bench <boxes|models|primitives|transparent|physics|spatial|hierarchy|textures|views|occlusion|lights|shadows|animation|static>"
+			" [--count N] [--frames F] [--width W] [--height H] [--frames-in-flight N] [--out FILE]\n";
+}
+
+int main(int argc, char ** argv) {
+	if(argc < 2) { usage(); return 1; }
+
+	Options options;
+	options.workload = argv[1];
+	options.count = -1;
+	options.frames = -1;
+	options.width = 1280; options.height = 720;
+	options.framesInFlight = 2;
+	for(int i = 2; i + 1 < argc; i += 2) {
+		std::string flag = argv[i], value = argv[i + 1];
+		if(flag == "--count") options.count = std::atol(value.c_str());
+		else if(flag == "--frames") options.frames = std::atol(value.c_str());
+		else if(flag == "--width") options.width = std::atoi(value.c_str());
+		else if(flag == "--height") options.height = std::atoi(value.c_str());
+		else if(flag == "--frames-in-flight") options.framesInFlight = std::atoi(value.c_str());
+		else if(flag == "--out") options.out = value;
+		else { usage(); return 1; }
+	}
+
+	// Defaults of every workload
+	struct Workload { const char * name; bool (*run)(const Options &, Report &); long count, frames; };
+	const Workload workloads[] = {
+		{ "boxes", boxesWorkload, 1000, 500 },
+		{ "models", modelsWorkload, 100, 500 },
+		{ "primitives", primitivesWorkload, 100, 500 },
+		{ "transparent", transparentWorkload, 500, 500 },
+		{ "physics", physicsWorkload, 1000, 2000 },
+		{ "spatial", spatialWorkload, 100000, 100 },
+		{ "hierarchy", hierarchyWorkload, 100000, 200 },
+		{ "textures", texturesWorkload, 200, 3 },
+		{ "views", viewsWorkload, 1000, 200 },
+		{ "occlusion", occlusionWorkload, 5000, 200 },
+		{ "lights", lightsWorkload, 1024, 200 },
+		{ "shadows", shadowsWorkload, 500, 300 },
+		{ "animation", animationWorkload, 1000, 300 },
+		{ "static", staticWorkload, 10000, 300 },
+	};
+
+	const Workload * workload = nullptr;
+	for(auto & w : workloads)
+		if(options.workload == w.name) workload = &w;
+	if(!workload) { usage(); return 1; }
+	if(options.count < 0) options.count = workload->count;
+	if(options.frames < 0) options.frames = workload->frames;
+
+	Report report;
+	report.Set("workload", options.workload);
+	report.Set("count", (long long)options.count);
+	report.Set("frames", (long long)options.frames);
+#ifdef NDEBUG
+	report.Set("build", std::string("release"));
+#else
+	report.Set("build", std::string("debug"));
+#endif
+
+	Stopwatch total;
+	if(!workload->run(options, report)) return 2;
+	report.Set("total_ms", total.Elapsed());
+	report.Set("peak_rss_kb", (long long)PeakRSS());
+
+	std::string json = report.ToJSON() + "\n";
+	if(options.out.empty()) std::cout << json;
+	else {
+		std::ofstream file(options.out);
+		file << json;
+		if(!file) { std::cout << "CGLBENCH::ERROR Could not write " << options.out << "\n"; return 2; }
+	}
+	return 0;
+}
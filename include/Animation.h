@@ -0,0 +1 @@
+../src/Animation.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/Animator.h
\ No newline at end of file
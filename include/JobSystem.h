@@ -0,0 +1 @@
+../src/JobSystem.h
\ No newline at end of file
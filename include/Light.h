@@ -0,0 +1 @@
+../src/Light.h
\ No newline at end of file
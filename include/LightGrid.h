@@ -0,0 +1 @@
+../src/LightGrid.h
\ No newline at end of file
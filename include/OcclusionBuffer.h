@@ -0,0 +1 @@
+../src/OcclusionBuffer.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/PrimitiveMesh.h
\ No newline at end of file
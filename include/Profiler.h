@@ -0,0 +1 @@
+../src/Profiler.h
\ No newline at end of file
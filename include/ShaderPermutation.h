@@ -0,0 +1 @@
+../src/ShaderPermutation.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/ShadowMap.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/Snapshot.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/SpatialIndex.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/StaticBatch.h
\ No newline at end of file
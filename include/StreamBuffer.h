@@ -0,0 +1 @@
+../src/StreamBuffer.h
\ No newline at end of file
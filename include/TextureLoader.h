@@ -0,0 +1 @@
+../src/TextureLoader.h
\ No newline at end of file
@@ -0,0 +1 @@
+../src/TextureStreamer.h
\ No newline at end of file
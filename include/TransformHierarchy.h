@@ -0,0 +1 @@
+../src/TransformHierarchy.h
\ No newline at end of file
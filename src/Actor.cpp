@@ -1,6 +1,8 @@
 #include "Actor.h"
 #include "Scene.h"
 
+#include <limits>
+
 namespace CGL {
 
 /* Ctor & Dtor */
@@ -19,6 +21,40 @@ Actor::Actor(
 	this->model = model;
 	this->shape = shape;
 	this->isTransparent = isTransparent;
+	this->isOccluder = false;
+	this->features = ShaderFeature::NONE;
+	this->modelMatrix = shape->GetModelMatrix();
+	this->transform = INVALID_TRANSFORM;
+	this->parent = nullptr;
+	this->isBatched = false;
+	this->hasShapeMatrix = false;
+	this->drawMatrix = modelMatrix;
+}
+
+Actor::Actor(
+		std::string name,
+		std::shared_ptr<ShaderPermutation> permutation,
+		ShaderFeatures features,
+		std::shared_ptr<Model> model,
+		std::shared_ptr<PrimitiveShape> shape,
+		bool isTransparent)
+{
+	// Resource configuration
+	setName(name); setType(Type::ACTOR);
+
+	// Actor configuration, the variant is resolved by Draw()
+	this->permutation = permutation;
+	this->features = features;
+	this->model = model;
+	this->shape = shape;
+	this->isTransparent = isTransparent;
+	this->isOccluder = false;
+	this->modelMatrix = shape->GetModelMatrix();
+	this->transform = INVALID_TRANSFORM;
+	this->parent = nullptr;
+	this->isBatched = false;
+	this->hasShapeMatrix = false;
+	this->drawMatrix = modelMatrix;
 }
 /* Ctor & Dtor */
 /* Public Methods */
@@ -27,27 +63,203 @@ void Actor::SetLinearVelocity(glm::vec3 vec, float value) {
 	shape->SetLinearVelocity(btDirection, value);
 } /* Actor::SetLinearVelocity(...) */
 
-void Actor::Draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrix) {
-	glm::mat4 modelMatrix = shape->GetModelMatrix();
+bool Actor::Draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrix, ShaderProgram * fallback) {
+	ShaderProgram * program = ResolveShaderProgram().get();
+	bool ready = program->IsReady();
+	if(!ready) {
+		if(!fallback || !fallback->IsReady()) return false;
+		program = fallback;
+	}
 
 	// Render Actor
-	shaderProgram->Use();
-	shaderProgram->SetUniformMatrix4f("model", modelMatrix);
-	shaderProgram->SetUniformMatrix4f("view", viewMatrix);
-	shaderProgram->SetUniformMatrix4f("projection", projectionMatrix);
-	model->Draw(shaderProgram.get());
+	program->Use();
+	program->SetUniformMatrix4f("model", drawMatrix);
+	if(!program->UsesFrameUniforms()) {
+		program->SetUniformMatrix4f("view", viewMatrix);
+		program->SetUniformMatrix4f("projection", projectionMatrix);
+	}
+	if(animator) animator->Draw(program);
+	else if(nodeMatrices.empty()) model->Draw(program);
+	else {
+		for(size_t i = 0; i < model->GetMeshes().size(); i++) {
+			program->SetUniformMatrix4f("model", GetMeshMatrix(i));
+			model->DrawMesh(i, program);
+		}
+	}
+	return ready;
+}
+
+std::shared_ptr<ShaderProgram> Actor::ResolveShaderProgram() {
+	if(!shaderProgram) shaderProgram = permutation->GetVariant(features);
+	return shaderProgram;
 }
 
+void Actor::DrawGeometry(GLint transformLocation, const glm::mat4 & viewProjection) {
+	if(animator || nodeMatrices.empty()) {
+		glm::mat4 transform = viewProjection * drawMatrix;
+		glUniformMatrix4fv(transformLocation, 1, GL_FALSE, &transform[0][0]);
+		if(animator) animator->DrawGeometry();
+		else model->DrawGeometry();
+		return;
+	}
+	for(size_t i = 0; i < model->GetMeshes().size(); i++) {
+		glm::mat4 transform = viewProjection * GetMeshMatrix(i);
+		glUniformMatrix4fv(transformLocation, 1, GL_FALSE, &transform[0][0]);
+		model->DrawMeshGeometry(i);
+	}
+}
+
+bool Actor::SyncTransform(bool force) {
+	if(parent) return false;
+	if(!force && !shape->NeedsTransformSync()) return false;
+	modelMatrix = shape->GetModelMatrix();
+	updateDrawMatrix();
+	return true;
+} /* Actor::SyncTransform(bool force) */
+
 std::shared_ptr<Model> Actor::GetModelPtr() const {
 	return model;
 }
 
+std::shared_ptr<PrimitiveShape> Actor::GetShapePtr() const {
+	return shape;
+}
+
+std::shared_ptr<ShaderProgram> Actor::GetShaderProgramPtr() const {
+	return shaderProgram;
+}
+
+std::shared_ptr<ShaderPermutation> Actor::GetShaderPermutationPtr() const {
+	return permutation;
+}
+
 glm::mat4 Actor::GetModelMatrix() const {
-	return shape->GetModelMatrix();
+	return modelMatrix;
+}
+
+const glm::mat4 & Actor::GetMeshMatrix(size_t mesh) const {
+	if(nodeMatrices.empty()) return drawMatrix;
+	return nodeMatrices[model->GetMeshNode(mesh)];
+}
+
+bool Actor::IsTransparent() const {
+	return isTransparent;
+}
+
+bool Actor::IsOccluder() const {
+	return isOccluder;
+}
+
+std::shared_ptr<Animator> Actor::GetAnimator() const {
+	return animator;
+}
+
+TransformHandle Actor::GetTransform() const {
+	return transform;
+}
+
+const std::vector<TransformHandle> & Actor::GetNodeTransforms() const {
+	return nodeTransforms;
+}
+
+Actor * Actor::GetParent() const {
+	return parent;
+}
+
+bool Actor::IsBatched() const {
+	return isBatched;
+}
+
+void Actor::GetWorldBounds(glm::vec3 & min, glm::vec3 & max) const {
+	glm::vec3 localMin, localMax;
+	if(nodeMatrices.empty() || model->GetMeshes().empty()) {
+		model->GetBounds(localMin, localMax);
+		transformBounds(drawMatrix, localMin, localMax, min, max);
+		return;
+	}
+
+	// Meshes move with their nodes, the file's bounds don't
+	min = glm::vec3(std::numeric_limits<float>::max());
+	max = glm::vec3(-std::numeric_limits<float>::max());
+	for(size_t i = 0; i < model->GetMeshes().size(); i++) {
+		glm::vec3 meshMin, meshMax;
+		model->GetMeshBounds(i, localMin, localMax);
+		transformBounds(GetMeshMatrix(i), localMin, localMax, meshMin, meshMax);
+		min = glm::min(min, meshMin);
+		max = glm::max(max, meshMax);
+	}
+}
+
+ShaderFeatures Actor::GetShaderFeatures() const {
+	return features;
+}
+
+void Actor::SetShaderFeatures(ShaderFeatures features) {
+	if(!permutation) {
+		std::cout << "CGL::WARNING::ACTOR::SETSHADERFEATURES() Actor " << mName << " isn't using a ShaderPermutation\n";
+		return;
+	}
+	if(features == this->features) return;
+	this->features = features;
+	shaderProgram.reset();
+}
+
+void Actor::SetOccluder(bool occluder) {
+	isOccluder = occluder;
+}
+
+void Actor::SetAnimator(std::shared_ptr<Animator> animator) {
+	this->animator = animator;
 }
 
-//void Actor::SetModelMatrix(glm::mat4 modelMatrix) {
-//	this->modelMatrix = modelMatrix;
-//}
+void Actor::SetTransform(TransformHandle transform) {
+	this->transform = transform;
+}
+
+void Actor::SetNodeTransforms(std::vector<TransformHandle> nodeTransforms) {
+	this->nodeTransforms = nodeTransforms;
+	nodeMatrices.assign(this->nodeTransforms.size(), modelMatrix);
+}
+
+void Actor::SetParent(Actor * parent) {
+	this->parent = parent;
+}
+
+void Actor::SetBatched(bool batched) {
+	this->isBatched = batched;
+}
+
+void Actor::SetModelMatrix(const glm::mat4 & modelMatrix) {
+	this->modelMatrix = modelMatrix;
+	updateDrawMatrix();
+}
+
+void Actor::SetNodeMatrix(size_t node, const glm::mat4 & nodeMatrix) {
+	nodeMatrices[node] = nodeMatrix;
+}
+
+void Actor::SetShapeMatrix(const glm::mat4 & shapeMatrix) {
+	this->shapeMatrix = shapeMatrix;
+	hasShapeMatrix = true;
+	updateDrawMatrix();
+}
 /* Public Methods */
+/* Private Methods */
+void Actor::transformBounds(const glm::mat4 & matrix, glm::vec3 localMin, glm::vec3 localMax, glm::vec3 & min, glm::vec3 & max) {
+	// Transform box center and extents (Arvo's method) instead of all 8 corners
+	glm::vec3 center = .5f * (localMin + localMax);
+	glm::vec3 extents = .5f * (localMax - localMin);
+	glm::vec3 worldCenter = glm::vec3(matrix * glm::vec4(center, 1.f));
+	glm::vec3 worldExtents(0.f);
+	for(int column = 0; column < 3; column++)
+		worldExtents += glm::abs(glm::vec3(matrix[column])) * extents[column];
+
+	min = worldCenter - worldExtents;
+	max = worldCenter + worldExtents;
+}
+
+void Actor::updateDrawMatrix() {
+	drawMatrix = hasShapeMatrix ? modelMatrix * shapeMatrix : modelMatrix;
+}
+/* Private Methods */
 } /* namespace CGL */
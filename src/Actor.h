@@ -3,8 +3,11 @@
 
 #include "Resource.h"
 #include "ShaderProgram.h"
+#include "ShaderPermutation.h"
 #include "Model.h"
 #include "PrimitiveShape.h"
+#include "Animator.h"
+#include "TransformHierarchy.h"
 
 #include <glm/glm.hpp>
 
@@ -23,6 +26,18 @@ public:
 			std::shared_ptr<PrimitiveShape> shape,
 			bool isTransparent);
 
+	/*
+	 * Actor drawn with a variant of the ShaderPermutation selected by features
+	 * The variant is looked up (and compiled if needed) on the first draw only
+	 */
+	Actor(
+			std::string name,
+			std::shared_ptr<ShaderPermutation> permutation,
+			ShaderFeatures features,
+			std::shared_ptr<Model> model,
+			std::shared_ptr<PrimitiveShape> shape,
+			bool isTransparent);
+
 	/*
 	 * Delete Copy Constructor and operator=
 	 */
@@ -31,30 +46,114 @@ public:
 
 	/*
 	 * Draw an actor
+	 * If its ShaderProgram isn't linked yet, draw it with the fallback program instead
+	 * (if given and ready). Return false if the actor wasn't drawn with its own program.
+	 */
+	bool Draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrix, ShaderProgram * fallback=nullptr);
+
+	/*
+	 * ShaderProgram the Actor is drawn with, the ShaderPermutation variant is
+	 * looked up (and compiled if needed) on the first call
+	 */
+	std::shared_ptr<ShaderProgram> ResolveShaderProgram();
+
+	/*
+	 * Draw the Model's geometry only (depth only passes, the caller sets the program):
+	 * the program's transformLocation gets viewProjection times the model matrix of every mesh
 	 */
-	void Draw(glm::mat4 viewMatrix, glm::mat4 projectionMatrix);
+	void DrawGeometry(GLint transformLocation, const glm::mat4 & viewProjection);
 
 	/*
 	 *  Set linear velocity of this actor
 	 */
 	void SetLinearVelocity(glm::vec3 direction, float value);
 
+	/*
+	 *  Fetch model matrix from the physics body, unless the body is sleeping
+	 *  (or force is set, e.g. after the body was moved by hand)
+	 *  Attached Actors follow their parent instead and never fetch it
+	 *  Return true if the cached model matrix was refreshed
+	 */
+	bool SyncTransform(bool force=false);
+
 	/*
 	 * Getters
 	 */
 	std::shared_ptr<Model> GetModelPtr() const;
+	std::shared_ptr<PrimitiveShape> GetShapePtr() const;
+	// Null for a ShaderPermutation variant not resolved by Draw() yet
+	std::shared_ptr<ShaderProgram> GetShaderProgramPtr() const;
+	// Null for Actors created with a ShaderProgram
+	std::shared_ptr<ShaderPermutation> GetShaderPermutationPtr() const;
 	glm::mat4 GetModelMatrix() const;
+	// Model matrix of a mesh: the Actor's one combined with the mesh's node (or shape matrix)
+	const glm::mat4 & GetMeshMatrix(size_t mesh) const;
+	bool IsTransparent() const;
+	// Rasterized into the occlusion buffer to hide Actors behind it
+	bool IsOccluder() const;
+	// Playback of a skinned Model, null for static Models
+	std::shared_ptr<Animator> GetAnimator() const;
+	// Transforms of the Actor and of its Model's nodes in the Scene's TransformHierarchy
+	TransformHandle GetTransform() const;
+	const std::vector<TransformHandle> & GetNodeTransforms() const;
+	// Actor this one is attached to (null for free Actors)
+	Actor * GetParent() const;
+	// Drawn by the Scene's StaticBatch instead of on its own
+	bool IsBatched() const;
+
+	/*
+	 * Get world space axis aligned bounding box of the Model
+	 * transformed with the current model matrix (the union of its
+	 * meshes' boxes when they are placed by node transforms)
+	 */
+	void GetWorldBounds(glm::vec3 & min, glm::vec3 & max) const;
+
+	ShaderFeatures GetShaderFeatures() const;
 
 	/*
 	 * Setters
 	 */
-	//void SetModelMatrix(glm::mat4 modelMatrix);
+	// Select another variant (Actors created with a ShaderPermutation only)
+	void SetShaderFeatures(ShaderFeatures features);
+	void SetOccluder(bool occluder);
+	void SetAnimator(std::shared_ptr<Animator> animator);
+	void SetTransform(TransformHandle transform);
+	void SetNodeTransforms(std::vector<TransformHandle> nodeTransforms);
+	void SetParent(Actor * parent);
+	void SetBatched(bool batched);
+	// World matrices from the TransformHierarchy
+	void SetModelMatrix(const glm::mat4 & modelMatrix);
+	void SetNodeMatrix(size_t node, const glm::mat4 & nodeMatrix);
+	// Fits a built-in primitive mesh to the body: the Model is drawn, culled and
+	// batched with the model matrix times shapeMatrix (children don't inherit it)
+	void SetShapeMatrix(const glm::mat4 & shapeMatrix);
 
 private:
 	std::shared_ptr<ShaderProgram> shaderProgram;
+	std::shared_ptr<ShaderPermutation> permutation;
+	ShaderFeatures features;
 	std::shared_ptr<Model> model;
 	std::shared_ptr<PrimitiveShape> shape;
 	bool isTransparent;
+	bool isOccluder;
+	std::shared_ptr<Animator> animator;
+
+	// Model matrix cached from the physics body by SyncTransform()
+	glm::mat4 modelMatrix;
+	// modelMatrix times shapeMatrix (if there is one), what the Model is drawn with
+	glm::mat4 shapeMatrix;
+	bool hasShapeMatrix;
+	glm::mat4 drawMatrix;
+
+	TransformHandle transform;
+	std::vector<TransformHandle> nodeTransforms;
+	// World matrices of the Model's nodes (empty without node transforms)
+	std::vector<glm::mat4> nodeMatrices;
+	Actor * parent;
+	bool isBatched;
+
+	void updateDrawMatrix();
+	static void transformBounds(const glm::mat4 & matrix, glm::vec3 localMin, glm::vec3 localMax, glm::vec3 & min, glm::vec3 & max);
 };
 
 }
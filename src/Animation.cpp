@@ -0,0 +1,18 @@
+#include "Animation.h"
+
+namespace CGL {
+
+/* Public Methods */
+int Skeleton::FindNode(const std::string & name) const {
+	for(size_t i = 0; i < nodes.size(); i++)
+		if(nodes[i].name == name) return (int)i;
+	return -1;
+}
+
+int Skeleton::FindBone(const std::string & name) const {
+	for(size_t i = 0; i < bones.size(); i++)
+		if(nodes[bones[i].node].name == name) return (int)i;
+	return -1;
+}
+/* Public Methods */
+} /* namespace CGL */
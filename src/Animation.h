@@ -0,0 +1,75 @@
+/*
+ * Skeletal animation data of a Model, imported from Assimp:
+ * - Skeleton is the node hierarchy of the Model in parent first order
+ *   (a node's parent always comes before it) with bind pose local transforms,
+ *   and the bones (nodes deforming skinned meshes) with their offset matrices
+ *   (mesh space to the bone's space in the bind pose)
+ * - AnimationClip holds key frames of node translations, rotations and scales,
+ *   times are in seconds
+ * Playback and skinning are done by Animator.
+ */
+
+#ifndef ANIMATION_H_
+#define ANIMATION_H_
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <string>
+#include <vector>
+
+namespace CGL {
+
+/*
+ * Bones influencing a vertex at most (Assimp limits weights to this on import)
+ */
+const unsigned int MAX_BONE_INFLUENCES = 4;
+
+struct SkeletonNode {
+	std::string name;
+	int parent;
+	glm::vec3 translation;
+	glm::quat rotation;
+	glm::vec3 scale;
+};
+
+struct Bone {
+	int node;
+	glm::mat4 offset;
+};
+
+struct Skeleton {
+	std::vector<SkeletonNode> nodes;
+	std::vector<Bone> bones;
+	// Inverse transform of the root node, palettes are relative to the Model's space
+	glm::mat4 globalInverse;
+
+	/*
+	 * Index of the node/bone with a given name, -1 if there is none
+	 */
+	int FindNode(const std::string & name) const;
+	int FindBone(const std::string & name) const;
+};
+
+/*
+ * Keys of a single node; each of the three tracks has its own key times
+ */
+struct AnimationChannel {
+	int node;
+	std::vector<float> positionTimes;
+	std::vector<glm::vec3> positions;
+	std::vector<float> rotationTimes;
+	std::vector<glm::quat> rotations;
+	std::vector<float> scaleTimes;
+	std::vector<glm::vec3> scales;
+};
+
+struct AnimationClip {
+	std::string name;
+	float duration;
+	std::vector<AnimationChannel> channels;
+};
+
+} /* namespace CGL */
+
+#endif /* ANIMATION_H_ */
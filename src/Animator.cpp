@@ -0,0 +1,392 @@
+#include "Animator.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CGL_ANIMATOR_SSE2
+#endif
+
+namespace CGL {
+
+/* Ctor & Dtor */
+Animator::Animator(std::shared_ptr<Model> model) {
+	this->model = model;
+	mode = SkinningMode::GPU;
+	current.clip = previous.clip = -1;
+	current.time = previous.time = 0.f;
+	current.speed = previous.speed = 1.f;
+	current.loop = previous.loop = true;
+	fadeTime = fadeDuration = 0.f;
+	paletteBuffer = 0;
+	paletteOffset = paletteSize = 0;
+
+	// Bind pose in SoA, padding nodes are identities
+	const Skeleton & skeleton = model->GetSkeleton();
+	nodeCount = skeleton.nodes.size();
+	paddedCount = (nodeCount + 3) & ~(size_t)3;
+	bindPose.assign(10 * paddedCount, 0.f);
+	for(size_t i = 0; i < paddedCount; i++) {
+		bindPose[6 * paddedCount + i] = 1.f;
+		for(int axis = 0; axis < 3; axis++) bindPose[(7 + axis) * paddedCount + i] = 1.f;
+	}
+	for(size_t i = 0; i < nodeCount; i++) {
+		const SkeletonNode & node = skeleton.nodes[i];
+		for(int axis = 0; axis < 3; axis++) {
+			bindPose[axis * paddedCount + i] = node.translation[axis];
+			bindPose[(7 + axis) * paddedCount + i] = node.scale[axis];
+		}
+		bindPose[3 * paddedCount + i] = node.rotation.x;
+		bindPose[4 * paddedCount + i] = node.rotation.y;
+		bindPose[5 * paddedCount + i] = node.rotation.z;
+		bindPose[6 * paddedCount + i] = node.rotation.w;
+	}
+	pose = fadePose = keysFrom = keysTo = bindPose;
+	factors.assign(3 * paddedCount, 0.f);
+	globals.assign(nodeCount, glm::mat4(1.f));
+	palette.assign(skeleton.bones.size(), glm::mat4(1.f));
+
+	// Texture coordinates of skinned vertices never change
+	const std::vector<Mesh> & meshes = model->GetMeshes();
+	skinnedVertices.resize(meshes.size());
+	for(size_t m = 0; m < meshes.size(); m++)
+		if(meshes[m].IsSkinned()) skinnedVertices[m] = meshes[m].vertices;
+}
+
+Animator::~Animator() {
+	for(GLuint array : skinnedArrays) if(array) glDeleteVertexArrays(1, &array);
+	for(GLuint buffer : skinnedBuffers) if(buffer) glDeleteBuffers(1, &buffer);
+}
+/* Ctor & Dtor */
+/* Public Methods */
+bool Animator::Play(int clip, bool loop, float speed, float fadeSeconds) {
+	if(clip < 0 || clip >= (int)model->GetAnimations().size()) return false;
+	if(fadeSeconds > 0.f && current.clip >= 0) {
+		previous = current;
+		fadeTime = 0.f;
+		fadeDuration = fadeSeconds;
+	}
+	else previous.clip = -1;
+	startPlayback(current, clip, loop, speed);
+	return true;
+}
+
+bool Animator::Play(const std::string & clipName, bool loop, float speed, float fadeSeconds) {
+	return Play(model->FindAnimation(clipName), loop, speed, fadeSeconds);
+}
+
+void Animator::Stop() {
+	current.clip = previous.clip = -1;
+}
+
+void Animator::Advance(float deltaTime) {
+	const std::vector<AnimationClip> & clips = model->GetAnimations();
+	auto advance = [&](Playback & playback) {
+		if(playback.clip < 0) return;
+		float duration = clips[playback.clip].duration;
+		playback.time += deltaTime * playback.speed;
+		if(duration <= 0.f) playback.time = 0.f;
+		else if(playback.loop) {
+			playback.time = std::fmod(playback.time, duration);
+			if(playback.time < 0.f) playback.time += duration;
+		}
+		else playback.time = glm::clamp(playback.time, 0.f, duration);
+	};
+	advance(current);
+	if(previous.clip >= 0) {
+		advance(previous);
+		fadeTime += deltaTime;
+		if(fadeTime >= fadeDuration) previous.clip = -1;
+	}
+}
+
+void Animator::Evaluate() {
+	if(current.clip < 0) pose = bindPose;
+	else samplePlayback(current, pose);
+
+	// Cross-fade from the previous clip with one weight for all nodes
+	if(previous.clip >= 0 && fadeDuration > 0.f) {
+		samplePlayback(previous, fadePose);
+		float weight = glm::clamp(fadeTime / fadeDuration, 0.f, 1.f);
+		std::fill(factors.begin(), factors.begin() + paddedCount, weight);
+		size_t p = paddedCount;
+		for(int axis = 0; axis < 3; axis++) {
+			lerp(&pose[axis * p], &fadePose[axis * p], &pose[axis * p], &factors[0], p);
+			lerp(&pose[(7 + axis) * p], &fadePose[(7 + axis) * p], &pose[(7 + axis) * p], &factors[0], p);
+		}
+		nlerp(&pose[3 * p], &fadePose[3 * p], &pose[3 * p], &factors[0], p, p);
+	}
+	buildPalette();
+}
+
+void Animator::Skin() {
+	const std::vector<Mesh> & meshes = model->GetMeshes();
+	size_t bones = palette.size();
+	for(size_t m = 0; m < meshes.size(); m++) {
+		const Mesh & mesh = meshes[m];
+		if(!mesh.IsSkinned() || bones == 0) continue;
+		std::vector<Vertex> & result = skinnedVertices[m];
+
+		for(size_t v = 0; v < mesh.vertices.size(); v++) {
+			const Vertex & vertex = mesh.vertices[v];
+			const VertexBones & vertexBones = mesh.bones[v];
+#ifdef CGL_ANIMATOR_SSE2
+			// Weighted sum of the bone matrices, one column per register
+			__m128 c0 = _mm_setzero_ps(), c1 = _mm_setzero_ps(), c2 = _mm_setzero_ps(), c3 = _mm_setzero_ps();
+			for(unsigned int k = 0; k < MAX_BONE_INFLUENCES; k++) {
+				float weight = vertexBones.Weights[k];
+				if(weight == 0.f || vertexBones.BoneIds[k] >= bones) continue;
+				const float * matrix = &palette[vertexBones.BoneIds[k]][0][0];
+				__m128 w = _mm_set1_ps(weight);
+				c0 = _mm_add_ps(c0, _mm_mul_ps(w, _mm_loadu_ps(matrix)));
+				c1 = _mm_add_ps(c1, _mm_mul_ps(w, _mm_loadu_ps(matrix + 4)));
+				c2 = _mm_add_ps(c2, _mm_mul_ps(w, _mm_loadu_ps(matrix + 8)));
+				c3 = _mm_add_ps(c3, _mm_mul_ps(w, _mm_loadu_ps(matrix + 12)));
+			}
+			__m128 position = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.Position.x)), _mm_mul_ps(c1, _mm_set1_ps(vertex.Position.y))),
+					_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(vertex.Position.z)), c3));
+			__m128 normal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.Normal.x)), _mm_mul_ps(c1, _mm_set1_ps(vertex.Normal.y))),
+					_mm_mul_ps(c2, _mm_set1_ps(vertex.Normal.z)));
+			float p[4], n[4];
+			_mm_storeu_ps(p, position);
+			_mm_storeu_ps(n, normal);
+			result[v].Position = glm::vec3(p[0], p[1], p[2]);
+			float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			result[v].Normal = length > 0.f ? glm::vec3(n[0], n[1], n[2]) / length : vertex.Normal;
+#else
+			glm::mat4 skin(0.f);
+			for(unsigned int k = 0; k < MAX_BONE_INFLUENCES; k++)
+				if(vertexBones.Weights[k] != 0.f && vertexBones.BoneIds[k] < bones)
+					skin = skin + palette[vertexBones.BoneIds[k]] * vertexBones.Weights[k];
+			result[v].Position = glm::vec3(skin * glm::vec4(vertex.Position, 1.f));
+			glm::vec3 normal(skin * glm::vec4(vertex.Normal, 0.f));
+			float length = glm::length(normal);
+			result[v].Normal = length > 0.f ? normal / length : vertex.Normal;
+#endif
+		}
+	}
+}
+
+void Animator::Upload() {
+	if(skinnedArrays.empty()) createSkinnedBuffers();
+	for(size_t m = 0; m < skinnedBuffers.size(); m++) {
+		if(!skinnedBuffers[m]) continue;
+		size_t size = skinnedVertices[m].size() * sizeof(Vertex);
+		glBindBuffer(GL_ARRAY_BUFFER, skinnedBuffers[m]);
+		// Orphan the storage the GPU may still be reading from
+		glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, size, skinnedVertices[m].data());
+		Profiler::CountUpload(size);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Animator::SetPaletteRange(GLuint buffer, size_t offset, size_t size) {
+	paletteBuffer = buffer;
+	paletteOffset = offset;
+	paletteSize = size;
+}
+
+void Animator::Draw(ShaderProgram * shader) {
+	if(mode == SkinningMode::GPU) {
+		if(paletteBuffer) {
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, BONE_BUFFER_BINDING, paletteBuffer, paletteOffset, paletteSize);
+			Profiler::CountStateChange();
+		}
+		model->Draw(shader);
+	}
+	else model->Draw(shader, skinnedArrays);
+}
+
+void Animator::DrawGeometry() {
+	if(mode == SkinningMode::GPU) {
+		if(paletteBuffer) {
+			glBindBufferRange(GL_SHADER_STORAGE_BUFFER, BONE_BUFFER_BINDING, paletteBuffer, paletteOffset, paletteSize);
+			Profiler::CountStateChange();
+		}
+		model->DrawGeometry();
+	}
+	else model->DrawGeometry(skinnedArrays);
+}
+
+void Animator::SetSkinningMode(SkinningMode mode) {
+	this->mode = mode;
+}
+
+SkinningMode Animator::GetSkinningMode() const {
+	return mode;
+}
+
+const std::vector<glm::mat4> & Animator::GetPalette() const {
+	return palette;
+}
+
+bool Animator::IsPlaying() const {
+	if(current.clip < 0) return false;
+	return current.loop || current.time < model->GetAnimations()[current.clip].duration;
+}
+/* Public Methods */
+/* Private Methods */
+void Animator::startPlayback(Playback & playback, int clip, bool loop, float speed) {
+	playback.clip = clip;
+	playback.time = speed < 0.f ? model->GetAnimations()[clip].duration : 0.f;
+	playback.speed = speed;
+	playback.loop = loop;
+	playback.cursors.assign(3 * model->GetAnimations()[clip].channels.size(), 0);
+}
+
+void Animator::samplePlayback(Playback & playback, std::vector<float> & result) {
+	const AnimationClip & clip = model->GetAnimations()[playback.clip];
+	size_t p = paddedCount;
+
+	// Gather the keys around the time (nodes without a track keep their bind pose),
+	// then blend all nodes at once
+	std::copy(bindPose.begin(), bindPose.end(), keysFrom.begin());
+	std::copy(bindPose.begin(), bindPose.end(), keysTo.begin());
+	std::fill(factors.begin(), factors.end(), 0.f);
+	auto factor = [&](const std::vector<float> & times, int key) {
+		if(key + 1 >= (int)times.size()) return 0.f;
+		float span = times[key + 1] - times[key];
+		return span > 0.f ? glm::clamp((playback.time - times[key]) / span, 0.f, 1.f) : 0.f;
+	};
+	for(size_t c = 0; c < clip.channels.size(); c++) {
+		const AnimationChannel & channel = clip.channels[c];
+		size_t n = (size_t)channel.node;
+		if(!channel.positions.empty()) {
+			int key = findKey(channel.positionTimes, playback.time, playback.cursors[3 * c]);
+			int next = std::min(key + 1, (int)channel.positions.size() - 1);
+			for(int axis = 0; axis < 3; axis++) {
+				keysFrom[axis * p + n] = channel.positions[key][axis];
+				keysTo[axis * p + n] = channel.positions[next][axis];
+			}
+			factors[n] = factor(channel.positionTimes, key);
+		}
+		if(!channel.rotations.empty()) {
+			int key = findKey(channel.rotationTimes, playback.time, playback.cursors[3 * c + 1]);
+			int next = std::min(key + 1, (int)channel.rotations.size() - 1);
+			const glm::quat & from = channel.rotations[key], & to = channel.rotations[next];
+			keysFrom[3 * p + n] = from.x; keysFrom[4 * p + n] = from.y; keysFrom[5 * p + n] = from.z; keysFrom[6 * p + n] = from.w;
+			keysTo[3 * p + n] = to.x; keysTo[4 * p + n] = to.y; keysTo[5 * p + n] = to.z; keysTo[6 * p + n] = to.w;
+			factors[p + n] = factor(channel.rotationTimes, key);
+		}
+		if(!channel.scales.empty()) {
+			int key = findKey(channel.scaleTimes, playback.time, playback.cursors[3 * c + 2]);
+			int next = std::min(key + 1, (int)channel.scales.size() - 1);
+			for(int axis = 0; axis < 3; axis++) {
+				keysFrom[(7 + axis) * p + n] = channel.scales[key][axis];
+				keysTo[(7 + axis) * p + n] = channel.scales[next][axis];
+			}
+			factors[2 * p + n] = factor(channel.scaleTimes, key);
+		}
+	}
+
+	for(int axis = 0; axis < 3; axis++) {
+		lerp(&result[axis * p], &keysFrom[axis * p], &keysTo[axis * p], &factors[0], p);
+		lerp(&result[(7 + axis) * p], &keysFrom[(7 + axis) * p], &keysTo[(7 + axis) * p], &factors[2 * p], p);
+	}
+	nlerp(&result[3 * p], &keysFrom[3 * p], &keysTo[3 * p], &factors[p], p, p);
+}
+
+void Animator::buildPalette() {
+	const Skeleton & skeleton = model->GetSkeleton();
+	size_t p = paddedCount;
+	for(size_t i = 0; i < nodeCount; i++) {
+		float x = pose[3 * p + i], y = pose[4 * p + i], z = pose[5 * p + i], w = pose[6 * p + i];
+		float sx = pose[7 * p + i], sy = pose[8 * p + i], sz = pose[9 * p + i];
+		glm::mat4 local(
+				glm::vec4((1.f - 2.f * (y * y + z * z)) * sx, 2.f * (x * y + w * z) * sx, 2.f * (x * z - w * y) * sx, 0.f),
+				glm::vec4(2.f * (x * y - w * z) * sy, (1.f - 2.f * (x * x + z * z)) * sy, 2.f * (y * z + w * x) * sy, 0.f),
+				glm::vec4(2.f * (x * z + w * y) * sz, 2.f * (y * z - w * x) * sz, (1.f - 2.f * (x * x + y * y)) * sz, 0.f),
+				glm::vec4(pose[i], pose[p + i], pose[2 * p + i], 1.f));
+		// Parents come first, their global transforms are ready
+		int parent = skeleton.nodes[i].parent;
+		globals[i] = parent >= 0 ? globals[parent] * local : local;
+	}
+	for(size_t b = 0; b < skeleton.bones.size(); b++)
+		palette[b] = skeleton.globalInverse * globals[skeleton.bones[b].node] * skeleton.bones[b].offset;
+}
+
+void Animator::createSkinnedBuffers() {
+	const std::vector<Mesh> & meshes = model->GetMeshes();
+	skinnedArrays.assign(meshes.size(), 0);
+	skinnedBuffers.assign(meshes.size(), 0);
+	for(size_t m = 0; m < meshes.size(); m++) {
+		if(!meshes[m].IsSkinned()) continue;
+		glGenVertexArrays(1, &skinnedArrays[m]);
+		glGenBuffers(1, &skinnedBuffers[m]);
+		glBindVertexArray(skinnedArrays[m]);
+		glBindBuffer(GL_ARRAY_BUFFER, skinnedBuffers[m]);
+		glBufferData(GL_ARRAY_BUFFER, skinnedVertices[m].size() * sizeof(Vertex), skinnedVertices[m].data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshes[m].GetElementBuffer());
+		// The Mesh's layout
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+		glBindVertexArray(0);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Animator::lerp(float * result, const float * a, const float * b, const float * f, size_t count) {
+	size_t i = 0;
+#ifdef CGL_ANIMATOR_SSE2
+	for(; i + 4 <= count; i += 4) {
+		__m128 va = _mm_loadu_ps(a + i), vb = _mm_loadu_ps(b + i);
+		_mm_storeu_ps(result + i, _mm_add_ps(va, _mm_mul_ps(_mm_sub_ps(vb, va), _mm_loadu_ps(f + i))));
+	}
+#endif
+	for(; i < count; i++) result[i] = a[i] + (b[i] - a[i]) * f[i];
+}
+
+void Animator::nlerp(float * result, const float * a, const float * b, const float * f, size_t count, size_t stride) {
+	size_t i = 0;
+#ifdef CGL_ANIMATOR_SSE2
+	const __m128 zero = _mm_setzero_ps(), signBit = _mm_set1_ps(-0.f);
+	for(; i + 4 <= count; i += 4) {
+		__m128 ax = _mm_loadu_ps(a + i), ay = _mm_loadu_ps(a + stride + i), az = _mm_loadu_ps(a + 2 * stride + i), aw = _mm_loadu_ps(a + 3 * stride + i);
+		__m128 bx = _mm_loadu_ps(b + i), by = _mm_loadu_ps(b + stride + i), bz = _mm_loadu_ps(b + 2 * stride + i), bw = _mm_loadu_ps(b + 3 * stride + i);
+		// Flip b where the quaternions are on opposite hemispheres (shorter arc)
+		__m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, bx), _mm_mul_ps(ay, by)), _mm_add_ps(_mm_mul_ps(az, bz), _mm_mul_ps(aw, bw)));
+		__m128 sign = _mm_and_ps(_mm_cmplt_ps(dot, zero), signBit);
+		bx = _mm_xor_ps(bx, sign); by = _mm_xor_ps(by, sign); bz = _mm_xor_ps(bz, sign); bw = _mm_xor_ps(bw, sign);
+
+		__m128 t = _mm_loadu_ps(f + i);
+		__m128 x = _mm_add_ps(ax, _mm_mul_ps(_mm_sub_ps(bx, ax), t));
+		__m128 y = _mm_add_ps(ay, _mm_mul_ps(_mm_sub_ps(by, ay), t));
+		__m128 z = _mm_add_ps(az, _mm_mul_ps(_mm_sub_ps(bz, az), t));
+		__m128 w = _mm_add_ps(aw, _mm_mul_ps(_mm_sub_ps(bw, aw), t));
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_add_ps(_mm_mul_ps(z, z), _mm_mul_ps(w, w))));
+		_mm_storeu_ps(result + i, _mm_div_ps(x, length));
+		_mm_storeu_ps(result + stride + i, _mm_div_ps(y, length));
+		_mm_storeu_ps(result + 2 * stride + i, _mm_div_ps(z, length));
+		_mm_storeu_ps(result + 3 * stride + i, _mm_div_ps(w, length));
+	}
+#endif
+	for(; i < count; i++) {
+		float ax = a[i], ay = a[stride + i], az = a[2 * stride + i], aw = a[3 * stride + i];
+		float bx = b[i], by = b[stride + i], bz = b[2 * stride + i], bw = b[3 * stride + i];
+		if(ax * bx + ay * by + az * bz + aw * bw < 0.f) { bx = -bx; by = -by; bz = -bz; bw = -bw; }
+		float x = ax + (bx - ax) * f[i], y = ay + (by - ay) * f[i], z = az + (bz - az) * f[i], w = aw + (bw - aw) * f[i];
+		float length = std::sqrt(x * x + y * y + z * z + w * w);
+		result[i] = x / length; result[stride + i] = y / length; result[2 * stride + i] = z / length; result[3 * stride + i] = w / length;
+	}
+}
+
+int Animator::findKey(const std::vector<float> & times, float time, int & cursor) {
+	int last = (int)times.size() - 1;
+	if(cursor < 0 || cursor > last || times[cursor] > time) {
+		// Jumped back (loop, new clip): binary search
+		cursor = (int)(std::upper_bound(times.begin(), times.end(), time) - times.begin()) - 1;
+		cursor = std::max(cursor, 0);
+		return cursor;
+	}
+	while(cursor < last && times[cursor + 1] <= time) cursor++;
+	return cursor;
+}
+/* Private Methods */
+} /* namespace CGL */
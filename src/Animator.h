@@ -0,0 +1,163 @@
+/*
+ * Animator plays AnimationClips of a skinned Model for one Actor:
+ * - Advance() moves the playback time, Play() starts a clip, optionally
+ *   cross-fading from the current one
+ * - Evaluate() samples the clips into a local pose stored as structure of arrays
+ *   (translations, rotations and scales of all nodes, padded to 4 nodes) and blends
+ *   4 nodes at once with SSE (normalized quaternion lerp), then builds the bone palette
+ * - the palette is used by either skinning path:
+ *   GPU - it's uploaded into a shader storage buffer and the vertex shader skins
+ *   CPU - Skin() transforms bind pose vertices with SSE into per Animator vertex
+ *         buffers (no GPU requirements beyond the usual vertex attributes)
+ * Evaluate() and Skin() touch only the Animator's own data, so many Animators
+ * run in parallel on a JobSystem; Upload() and Draw() need the OpenGL context.
+ *
+ * GPU skinning in GLSL (#version 430, CGL_SKINNING ShaderFeature):
+ *   layout (location = 3) in uvec4 aBoneIds;
+ *   layout (location = 4) in vec4 aBoneWeights;
+ *   layout(std430, binding = 5) readonly buffer CGLBones { mat4 cglBones[]; };
+ *   mat4 skin = aBoneWeights.x * cglBones[aBoneIds.x] + aBoneWeights.y * cglBones[aBoneIds.y]
+ *             + aBoneWeights.z * cglBones[aBoneIds.z] + aBoneWeights.w * cglBones[aBoneIds.w];
+ *   vec4 position = model * skin * vec4(aPos, 1.0);
+ */
+
+#ifndef ANIMATOR_H_
+#define ANIMATOR_H_
+
+#include "Animation.h"
+#include "Model.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace CGL {
+
+const GLuint BONE_BUFFER_BINDING = 5;
+
+enum class SkinningMode {
+	GPU,
+	CPU
+};
+
+class Animator {
+public:
+	Animator(std::shared_ptr<Model> model);
+	~Animator();
+
+	/*
+	 * Delete Copy Constructor and operator=
+	 */
+	Animator(const Animator & other) = delete;
+	Animator & operator=(const Animator & other) = delete;
+
+	/*
+	 * Start a clip of the Model (index or name); with fadeSeconds the current
+	 * clip keeps playing and fades out meanwhile. Returns false for unknown clips.
+	 */
+	bool Play(int clip, bool loop=true, float speed=1.f, float fadeSeconds=0.f);
+	bool Play(const std::string & clipName, bool loop=true, float speed=1.f, float fadeSeconds=0.f);
+	void Stop();
+
+	/*
+	 * Move the playback time of the clips
+	 */
+	void Advance(float deltaTime);
+
+	/*
+	 * Sample the clips into the bone palette (bind pose without a clip)
+	 */
+	void Evaluate();
+
+	/*
+	 * CPU skinning of all skinned meshes with the palette, Upload() copies
+	 * the result into the vertex buffers
+	 */
+	void Skin();
+	void Upload();
+
+	/*
+	 * Palette range for GPU skinning within a buffer (e.g. a StreamBuffer allocation),
+	 * bound at BONE_BUFFER_BINDING by Draw()
+	 */
+	void SetPaletteRange(GLuint buffer, size_t offset, size_t size);
+
+	/*
+	 * Draw the Model: GPU mode binds the palette and draws the Model's meshes,
+	 * CPU mode draws the skinned vertex buffers (static meshes as they are)
+	 * DrawGeometry() binds the palette too, in GPU mode the depth program has to skin
+	 */
+	void Draw(ShaderProgram * shader);
+	void DrawGeometry();
+
+	void SetSkinningMode(SkinningMode mode);
+	SkinningMode GetSkinningMode() const;
+
+	/*
+	 * Bone matrices (model space of the bind pose to model space of the current pose)
+	 */
+	const std::vector<glm::mat4> & GetPalette() const;
+	bool IsPlaying() const;
+
+private:
+	std::shared_ptr<Model> model;
+	SkinningMode mode;
+
+	/*
+	 * Playback of a clip; cursors remember the last key of every track
+	 * (3 per channel), so sampling a clip played forwards doesn't search
+	 */
+	struct Playback {
+		int clip;
+		float time;
+		float speed;
+		bool loop;
+		std::vector<int> cursors;
+	};
+	Playback current, previous;
+	float fadeTime, fadeDuration;
+
+	/*
+	 * Local poses in SoA: tx ty tz | qx qy qz qw | sx sy sz, each padded to a multiple of 4 nodes
+	 */
+	size_t nodeCount, paddedCount;
+	std::vector<float> bindPose;
+	std::vector<float> pose, fadePose;
+	// Key endpoints and blend factors per track type (translation, rotation, scale)
+	std::vector<float> keysFrom, keysTo, factors;
+	std::vector<glm::mat4> globals;
+	std::vector<glm::mat4> palette;
+
+	/*
+	 * CPU skinned vertices and their buffers, one per skinned mesh (others are 0/empty)
+	 */
+	std::vector<std::vector<Vertex>> skinnedVertices;
+	std::vector<GLuint> skinnedArrays, skinnedBuffers;
+
+	GLuint paletteBuffer;
+	size_t paletteOffset, paletteSize;
+
+	void startPlayback(Playback & playback, int clip, bool loop, float speed);
+	void samplePlayback(Playback & playback, std::vector<float> & result);
+	void buildPalette();
+	void createSkinnedBuffers();
+
+	/*
+	 * SoA kernels (SSE, 4 nodes per iteration): result = a + (b - a) * f for count floats,
+	 * and normalized lerp of quaternions along the shorter arc
+	 */
+	static void lerp(float * result, const float * a, const float * b, const float * f, size_t count);
+	static void nlerp(float * result, const float * a, const float * b, const float * f, size_t count, size_t stride);
+
+	/*
+	 * Index of the key before time (cursor is the guess from the last call)
+	 */
+	static int findKey(const std::vector<float> & times, float time, int & cursor);
+};
+
+} /* namespace CGL */
+
+#endif /* ANIMATOR_H_ */
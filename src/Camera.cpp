@@ -12,6 +12,13 @@ Camera::Camera(std::string name, glm::vec3 cameraPos, float pitch, float yaw, fl
 	this->pitch = pitch; this->yaw = yaw;
 	this->cameraPos = cameraPos;
 
+	// Projection configuration
+	fieldOfView = 45.f;
+	nearPlane = .1f; farPlane = 100.f;
+	aspectRatio = 1.f;
+	reverseZ = false;
+	viewDirty = projectionDirty = viewProjectionDirty = true;
+
 	// Initialize camera vectors
 	// camera reverse direction - assume that camera initially is looking at the origin of the world
 	glm::vec3 target = glm::vec3(0.f);
@@ -24,10 +31,76 @@ Camera::Camera(std::string name, glm::vec3 cameraPos, float pitch, float yaw, fl
 }
 /* Ctor & Dtor */
 /* Public Methods */
-glm::mat4 Camera::GetViewMatrix() const{
-	glm::vec3 target = cameraPos - cameraRevDir;
-	glm::mat4 view = glm::lookAt(cameraPos, target, cameraUp);
-	return view;
+const glm::mat4 & Camera::GetViewMatrix() const{
+	if(viewDirty) {
+		glm::vec3 target = cameraPos - cameraRevDir;
+		viewMatrix = glm::lookAt(cameraPos, target, cameraUp);
+		viewDirty = false;
+		viewProjectionDirty = true;
+	}
+	return viewMatrix;
+}
+
+const glm::mat4 & Camera::GetProjectionMatrix() const{
+	if(!projectionDirty) return projectionMatrix;
+	projectionDirty = false;
+	viewProjectionDirty = true;
+
+	if(!reverseZ) {
+		if(IsInfiniteProjection()) projectionMatrix = glm::infinitePerspective(glm::radians(fieldOfView), aspectRatio, nearPlane);
+		else projectionMatrix = glm::perspective(glm::radians(fieldOfView), aspectRatio, nearPlane, farPlane);
+		return projectionMatrix;
+	}
+
+	// Zero to one clip depth: 1 at the near plane, 0 at the far one (or infinity)
+	float focal = 1.f / glm::tan(glm::radians(fieldOfView) * .5f);
+	projectionMatrix = glm::mat4(0.f);
+	projectionMatrix[0][0] = focal / aspectRatio;
+	projectionMatrix[1][1] = focal;
+	projectionMatrix[2][3] = -1.f;
+	if(IsInfiniteProjection()) {
+		projectionMatrix[3][2] = nearPlane;
+	}
+	else {
+		projectionMatrix[2][2] = nearPlane / (farPlane - nearPlane);
+		projectionMatrix[3][2] = farPlane * nearPlane / (farPlane - nearPlane);
+	}
+	return projectionMatrix;
+}
+
+const glm::mat4 & Camera::GetViewProjectionMatrix() const{
+	const glm::mat4 & view = GetViewMatrix();
+	const glm::mat4 & projection = GetProjectionMatrix();
+	if(viewProjectionDirty) {
+		viewProjectionMatrix = projection * view;
+		viewProjectionDirty = false;
+	}
+	return viewProjectionMatrix;
+}
+
+int Camera::GetFrustumPlanes(glm::vec4 planes[6]) const{
+	// Gribb & Hartmann: planes are sums/differences of the matrix rows
+	const glm::mat4 & m = GetViewProjectionMatrix();
+	glm::vec4 rows[4];
+	for(int i = 0; i < 4; i++)
+		rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+
+	int count = 0;
+	planes[count++] = rows[3] + rows[0];
+	planes[count++] = rows[3] - rows[0];
+	planes[count++] = rows[3] + rows[1];
+	planes[count++] = rows[3] - rows[1];
+	// near: -w <= z (or z <= w for reverse-Z), far: z <= w (or 0 <= z)
+	planes[count++] = reverseZ ? rows[3] - rows[2] : rows[3] + rows[2];
+	if(!IsInfiniteProjection())
+		planes[count++] = reverseZ ? rows[2] : rows[3] - rows[2];
+
+	// Normalize, so the plane distance is meaningful
+	for(int i = 0; i < count; i++) {
+		float length = glm::length(glm::vec3(planes[i]));
+		if(length > 0.f) planes[i] /= length;
+	}
+	return count;
 }
 
 glm::vec3 Camera::GetPosition() const{
@@ -39,6 +112,7 @@ glm::vec3 Camera::GetFront() const{
 }
 
 void Camera::KeyInputProcess(GLFWwindow* window, float deltaTime) {
+	glm::vec3 lastPos = cameraPos;
 	// Forward, Backward and strife
 	// forward
 	if (glfwGetKey(window, GLFW_KEY_W))
@@ -58,6 +132,8 @@ void Camera::KeyInputProcess(GLFWwindow* window, float deltaTime) {
 	// down
 	if (glfwGetKey(window, GLFW_KEY_LEFT_CONTROL))
 		cameraPos -= deltaTime * cameraSpeed * cameraUp;
+
+	if(cameraPos != lastPos) viewDirty = true;
 }
 
 void Camera::MouseInputProcess(GLFWwindow* window) {
@@ -67,6 +143,7 @@ void Camera::MouseInputProcess(GLFWwindow* window) {
 
 	float dx = (float)(crs_x - (double)fbs_x / 2.0);
 	float dy = (float)((double)fbs_y / 2.0 - crs_y);
+	if(dx == 0.f && dy == 0.f) return;
 
 	yaw += dx * cameraSensitivity;
 	pitch += dy * cameraSensitivity;
@@ -80,11 +157,59 @@ void Camera::MouseInputProcess(GLFWwindow* window) {
 	newDirection.z = glm::sin(glm::radians(yaw)) * glm::cos(glm::radians(pitch));
 	cameraRevDir = glm::normalize(-newDirection);
 	updateCameraVectors();
+	viewDirty = true;
 }
 
 void Camera::SetCameraSpeed(float value) {
 	this->cameraSpeed = value;
 }
+
+void Camera::SetProjection(float fieldOfView, float nearPlane, float farPlane) {
+	if(nearPlane <= 0.f || (farPlane > 0.f && farPlane <= nearPlane)) {
+		std::cout << "CGL::WARNING::CAMERA::SETPROJECTION() Invalid clip planes " << nearPlane << ", " << farPlane << " of Camera " << mName << "\n";
+		return;
+	}
+	this->fieldOfView = fieldOfView;
+	this->nearPlane = nearPlane;
+	this->farPlane = farPlane > 0.f ? farPlane : 0.f;
+	projectionDirty = true;
+}
+
+void Camera::SetAspectRatio(float aspectRatio) {
+	if(aspectRatio <= 0.f || aspectRatio == this->aspectRatio) return;
+	this->aspectRatio = aspectRatio;
+	projectionDirty = true;
+}
+
+void Camera::SetReverseZ(bool enabled) {
+	if(enabled == reverseZ) return;
+	reverseZ = enabled;
+	projectionDirty = true;
+}
+
+float Camera::GetFieldOfView() const {
+	return fieldOfView;
+}
+
+float Camera::GetNearPlane() const {
+	return nearPlane;
+}
+
+float Camera::GetFarPlane() const {
+	return farPlane;
+}
+
+float Camera::GetAspectRatio() const {
+	return aspectRatio;
+}
+
+bool Camera::IsReverseZ() const {
+	return reverseZ;
+}
+
+bool Camera::IsInfiniteProjection() const {
+	return farPlane <= 0.f;
+}
 /* Public Methods */
 /* Private Methods */
 void Camera::updateCameraVectors() {
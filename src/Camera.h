@@ -2,7 +2,8 @@
  * Camera class was designed to simulate a camera behavior inside a OpenGL context
  * All it does is:
  * - determine UP, FRONT, and RIGHT of a camera
- * - get the VIEW MATRIX for transformation pipeline
+ * - get the VIEW and PROJECTION MATRICES for transformation pipeline
+ *   (cached, recalculated only after the camera moved or its projection changed)
  * - handle keyboard and mouse input to modify camera parameters accordingly
  */
 #ifndef CAMERAH
@@ -15,6 +16,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <iostream>
+
 namespace CGL {
 
 class Camera : public Resource {
@@ -26,9 +29,18 @@ public:
 	Camera(std::string name, glm::vec3 cameraPos=glm::vec3(0.f, 0.f, 2.f), float pitch=0.f, float yaw=-90.f, float camSensitivity=.1f, float camSpeed=2.f);
 
 	/*
-	 * Get the VIEW MATRIX from a camera
+	 * Get the VIEW, PROJECTION and their product (projection * view)
 	 */
-	glm::mat4 GetViewMatrix() const;
+	const glm::mat4 & GetViewMatrix() const;
+	const glm::mat4 & GetProjectionMatrix() const;
+	const glm::mat4 & GetViewProjectionMatrix() const;
+
+	/*
+	 * World space frustum planes (xyz normal pointing inside, w offset)
+	 * of the view-projection matrix: left, right, bottom, top, near and far.
+	 * Returns the number of planes, 5 for an infinite projection (no far plane)
+	 */
+	int GetFrustumPlanes(glm::vec4 planes[6]) const;
 
 	/*
 	 * Get camera position
@@ -69,6 +81,32 @@ public:
 	 */
 	void SetCameraSpeed(float value);
 
+	/*
+	 * Perspective projection: vertical field of view in degrees
+	 * and clip planes distances (farPlane <= 0 for no far plane at all)
+	 */
+	void SetProjection(float fieldOfView, float nearPlane, float farPlane);
+
+	/*
+	 * Width / height of the viewport (on resize)
+	 */
+	void SetAspectRatio(float aspectRatio);
+
+	/*
+	 * Reverse-Z maps the near plane to depth 1 and the far plane (or infinity) to 0,
+	 * which spreads float depth precision evenly over distance. It requires
+	 * zero to one clip space depth (glClipControl()) and GL_GREATER depth test,
+	 * Scene sets both for a reverse-Z Camera.
+	 */
+	void SetReverseZ(bool enabled);
+
+	float GetFieldOfView() const;
+	float GetNearPlane() const;
+	float GetFarPlane() const;
+	float GetAspectRatio() const;
+	bool IsReverseZ() const;
+	bool IsInfiniteProjection() const;
+
 private:
 	/*
 	 * Update camera's parameters (fields)
@@ -83,6 +121,19 @@ private:
 		pitch,
 		yaw;
 
+	float
+		fieldOfView,
+		nearPlane,
+		farPlane,
+		aspectRatio;
+	bool reverseZ;
+
+	/*
+	 * Cached matrices, recalculated by the getters when marked dirty
+	 */
+	mutable glm::mat4 viewMatrix, projectionMatrix, viewProjectionMatrix;
+	mutable bool viewDirty, projectionDirty, viewProjectionDirty;
+
 	glm::vec3
 		cameraPos,
 		cameraRevDir,
@@ -0,0 +1,261 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+namespace CGL {
+
+struct JobHandle::Job {
+	std::function<void()> function;
+	// Unfinished dependencies, +1 while the job is being scheduled
+	std::atomic<int> waitingFor;
+	std::mutex mutex;
+	std::vector<std::shared_ptr<Job>> continuations;
+	std::atomic<bool> finished;
+};
+
+bool JobHandle::IsDone() const {
+	return !job || job->finished.load(std::memory_order_acquire);
+}
+
+namespace {
+	// Slot of the current thread in the JobSystem which started it
+	thread_local const JobSystem * workerOwner = nullptr;
+	thread_local unsigned workerSlot = 0;
+}
+
+/* Ctor & Dtor */
+JobSystem::JobSystem(unsigned workers) : queued(0), stopping(false) {
+	if(workers == 0) {
+		unsigned hardware = std::thread::hardware_concurrency();
+		workers = hardware > 1 ? hardware - 1 : 1;
+	}
+
+	for(unsigned i = 0; i <= workers; i++) {
+		slots.emplace_back(new Slot());
+		slots.back()->busyNs = 0;
+		slots.back()->executed = 0;
+		slots.back()->steals = 0;
+	}
+	for(unsigned i = 1; i <= workers; i++)
+		this->workers.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem() {
+	// Queued jobs are still executed, by this thread if need be
+	while(std::shared_ptr<JobHandle::Job> job = take(currentSlot()))
+		execute(currentSlot(), job);
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+	for(std::thread & worker : workers)
+		worker.join();
+}
+/* Ctor & Dtor */
+/* Public Methods */
+JobHandle JobSystem::Schedule(std::function<void()> function) {
+	return Schedule(std::move(function), std::vector<JobHandle>());
+}
+
+JobHandle JobSystem::Schedule(std::function<void()> function, const std::vector<JobHandle> & dependencies) {
+	JobHandle handle;
+	handle.job = std::make_shared<JobHandle::Job>();
+	handle.job->function = std::move(function);
+	handle.job->waitingFor = (int)dependencies.size() + 1;
+	handle.job->finished = false;
+
+	for(const JobHandle & dependency : dependencies) {
+		bool pending = false;
+		if(dependency.job) {
+			std::lock_guard<std::mutex> lock(dependency.job->mutex);
+			if(!dependency.job->finished) {
+				dependency.job->continuations.push_back(handle.job);
+				pending = true;
+			}
+		}
+		if(!pending) handle.job->waitingFor--;
+	}
+
+	// The last finished dependency queues the job if it's still waiting
+	if(--handle.job->waitingFor == 0) push(handle.job);
+	return handle;
+}
+
+void JobSystem::Wait(const JobHandle & handle) {
+	unsigned slot = currentSlot();
+	while(!handle.IsDone()) {
+		if(std::shared_ptr<JobHandle::Job> job = take(slot)) execute(slot, job);
+		else std::this_thread::yield();
+	}
+}
+
+void JobSystem::ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> & body) {
+	if(count == 0) return;
+	if(grain == 0) grain = 1;
+
+	size_t chunks = (count + grain - 1) / grain;
+	if(chunks == 1 || workers.empty()) {
+		body(0, count);
+		return;
+	}
+
+	// Chunks 1..N go to the deque, chunk 0 is executed right away
+	std::atomic<size_t> remaining(chunks - 1);
+	for(size_t chunk = 1; chunk < chunks; chunk++) {
+		size_t begin = chunk * grain;
+		size_t end = std::min(count, begin + grain);
+		Schedule([&body, &remaining, begin, end]() {
+			body(begin, end);
+			remaining--;
+		});
+	}
+	body(0, std::min(count, grain));
+
+	unsigned slot = currentSlot();
+	while(remaining > 0) {
+		if(std::shared_ptr<JobHandle::Job> job = take(slot)) execute(slot, job);
+		else std::this_thread::yield();
+	}
+}
+
+unsigned JobSystem::GetThreadCount() const {
+	return (unsigned)workers.size() + 1;
+}
+
+std::vector<WorkerStats> JobSystem::GetWorkerStats() const {
+	std::vector<WorkerStats> stats;
+	for(const std::unique_ptr<Slot> & slot : slots)
+		stats.push_back(WorkerStats{slot->busyNs / 1e6, slot->executed, slot->steals});
+	return stats;
+}
+
+void JobSystem::ResetWorkerStats() {
+	for(std::unique_ptr<Slot> & slot : slots) {
+		slot->busyNs = 0;
+		slot->executed = 0;
+		slot->steals = 0;
+	}
+}
+/* Public Methods */
+/* Private Methods */
+unsigned JobSystem::currentSlot() const {
+	return workerOwner == this ? workerSlot : 0;
+}
+
+void JobSystem::push(const std::shared_ptr<JobHandle::Job> & job) {
+	Slot & slot = *slots[currentSlot()];
+	{
+		std::lock_guard<std::mutex> lock(slot.mutex);
+		slot.jobs.push_back(job);
+	}
+	{
+		// Taking the lock orders this with a worker about to sleep
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		queued++;
+	}
+	wakeUp.notify_one();
+}
+
+std::shared_ptr<JobHandle::Job> JobSystem::take(unsigned slot) {
+	if(queued.load() <= 0) return nullptr;
+
+	// Newest job of the own deque first
+	{
+		Slot & own = *slots[slot];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if(!own.jobs.empty()) {
+			std::shared_ptr<JobHandle::Job> job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			queued--;
+			return job;
+		}
+	}
+
+	// Then the oldest one of any other deque
+	for(size_t i = 1; i < slots.size(); i++) {
+		Slot & victim = *slots[(slot + i) % slots.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if(!victim.jobs.empty()) {
+			std::shared_ptr<JobHandle::Job> job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			queued--;
+			slots[slot]->steals++;
+			return job;
+		}
+	}
+	return nullptr;
+}
+
+void JobSystem::execute(unsigned slot, const std::shared_ptr<JobHandle::Job> & job) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	job->function();
+	job->function = nullptr;
+	slots[slot]->busyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+	slots[slot]->executed++;
+
+	std::vector<std::shared_ptr<JobHandle::Job>> continuations;
+	{
+		std::lock_guard<std::mutex> lock(job->mutex);
+		job->finished.store(true, std::memory_order_release);
+		continuations.swap(job->continuations);
+	}
+	for(std::shared_ptr<JobHandle::Job> & continuation : continuations)
+		if(--continuation->waitingFor == 0) push(continuation);
+}
+
+void JobSystem::workerLoop(unsigned slot) {
+	workerOwner = this;
+	workerSlot = slot;
+
+	while(true) {
+		if(std::shared_ptr<JobHandle::Job> job = take(slot)) {
+			execute(slot, job);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		wakeUp.wait(lock, [this]() { return stopping || queued > 0; });
+		if(stopping && queued <= 0) return;
+	}
+}
+/* Private Methods */
+#if BT_THREADSAFE
+/* Ctor & Dtor */
+BulletTaskScheduler::BulletTaskScheduler(JobSystem & jobs) : btITaskScheduler("CGL::JobSystem"), jobs(jobs) {
+}
+/* Ctor & Dtor */
+/* Public Methods */
+int BulletTaskScheduler::getMaxNumThreads() const {
+	return std::min((int)jobs.GetThreadCount(), (int)BT_MAX_THREAD_COUNT);
+}
+
+int BulletTaskScheduler::getNumThreads() const {
+	return getMaxNumThreads();
+}
+
+void BulletTaskScheduler::setNumThreads(int numThreads) {
+	// The JobSystem is shared with the Scene, its size is fixed
+	(void)numThreads;
+}
+
+void BulletTaskScheduler::parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody & body) {
+	jobs.ParallelFor(iEnd - iBegin, std::max(grainSize, 1), [&](size_t begin, size_t end) {
+		body.forLoop(iBegin + (int)begin, iBegin + (int)end);
+	});
+}
+
+btScalar BulletTaskScheduler::parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody & body) {
+	std::mutex mutex;
+	btScalar sum = 0;
+	jobs.ParallelFor(iEnd - iBegin, std::max(grainSize, 1), [&](size_t begin, size_t end) {
+		btScalar partial = body.sumLoop(iBegin + (int)begin, iBegin + (int)end);
+		std::lock_guard<std::mutex> lock(mutex);
+		sum += partial;
+	});
+	return sum;
+}
+/* Public Methods */
+#endif // BT_THREADSAFE
+} /* namespace CGL */
@@ -0,0 +1,145 @@
+/*
+ * JobSystem is a work stealing task scheduler:
+ * - every worker thread has its own deque: it pushes and pops jobs at the back
+ *   (LIFO, cache friendly), idle workers steal from the front of other deques
+ * - threads which aren't workers (e.g. the one running the Scene) share
+ *   one more deque and execute jobs while they wait for them (Wait(), ParallelFor())
+ * - a job can depend on other jobs, it's queued only after they finished
+ * Per worker statistics (busy time, executed and stolen jobs) are collected
+ * for utilization reports.
+ */
+
+#ifndef JOBSYSTEM_H_
+#define JOBSYSTEM_H_
+
+#include <LinearMath/btThreads.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CGL {
+
+class JobSystem;
+
+/*
+ * Handle of a scheduled job; an empty handle counts as finished
+ */
+class JobHandle {
+public:
+	bool IsDone() const;
+
+private:
+	friend class JobSystem;
+	struct Job;
+	std::shared_ptr<Job> job;
+};
+
+struct WorkerStats {
+	double busyMs;
+	unsigned long long jobs;
+	unsigned long long steals;
+};
+
+class JobSystem {
+public:
+	/*
+	 * Start workers threads (0 means one less than hardware threads,
+	 * the thread using the JobSystem being the last one)
+	 */
+	JobSystem(unsigned workers=0);
+
+	/*
+	 * Finish queued jobs and join the workers
+	 */
+	~JobSystem();
+
+	/*
+	 * Delete Copy Constructor and operator=
+	 */
+	JobSystem(const JobSystem & other) = delete;
+	JobSystem & operator=(const JobSystem & other) = delete;
+
+	/*
+	 * Queue a job, after all dependencies (if any) finished
+	 */
+	JobHandle Schedule(std::function<void()> function);
+	JobHandle Schedule(std::function<void()> function, const std::vector<JobHandle> & dependencies);
+
+	/*
+	 * Execute other jobs until the job is finished
+	 */
+	void Wait(const JobHandle & handle);
+
+	/*
+	 * Call body(begin, end) for ranges of at most grain items covering [0, count)
+	 * on all threads, the calling one included; returns when all are done
+	 */
+	void ParallelFor(size_t count, size_t grain, const std::function<void(size_t, size_t)> & body);
+
+	/*
+	 * Workers plus the thread(s) using the JobSystem
+	 */
+	unsigned GetThreadCount() const;
+
+	/*
+	 * Statistics since the last reset; index 0 is the shared deque of
+	 * non-worker threads, 1..N are the workers
+	 */
+	std::vector<WorkerStats> GetWorkerStats() const;
+	void ResetWorkerStats();
+
+private:
+	struct Slot {
+		std::mutex mutex;
+		std::deque<std::shared_ptr<JobHandle::Job>> jobs;
+		std::atomic<long long> busyNs;
+		std::atomic<unsigned long long> executed;
+		std::atomic<unsigned long long> steals;
+	};
+
+	std::vector<std::unique_ptr<Slot>> slots;
+	std::vector<std::thread> workers;
+
+	// Jobs sitting in deques, and sleeping of idle workers
+	std::atomic<long long> queued;
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+	std::atomic<bool> stopping;
+
+	unsigned currentSlot() const;
+	void push(const std::shared_ptr<JobHandle::Job> & job);
+	std::shared_ptr<JobHandle::Job> take(unsigned slot);
+	void execute(unsigned slot, const std::shared_ptr<JobHandle::Job> & job);
+	void workerLoop(unsigned slot);
+};
+
+#if BT_THREADSAFE
+/*
+ * Bullet's task scheduler running its parallel loops on a JobSystem
+ * (install with btSetTaskScheduler())
+ */
+class BulletTaskScheduler : public btITaskScheduler {
+public:
+	BulletTaskScheduler(JobSystem & jobs);
+
+	int getMaxNumThreads() const override;
+	int getNumThreads() const override;
+	void setNumThreads(int numThreads) override;
+	void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody & body) override;
+	btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody & body) override;
+
+private:
+	JobSystem & jobs;
+};
+#endif // BT_THREADSAFE
+
+} /* namespace CGL */
+
+#endif /* JOBSYSTEM_H_ */
@@ -0,0 +1,61 @@
+#include "Light.h"
+
+namespace CGL {
+
+/* Ctor & Dtor */
+Light::Light(std::string name, LightType lightType, glm::vec3 color, float intensity) {
+	// Resource configuration
+	setName(name), setType(Type::LIGHT);
+
+	this->lightType = lightType;
+	this->position = glm::vec3(0.f);
+	this->direction = glm::vec3(0.f, -1.f, 0.f);
+	this->color = color;
+	this->intensity = intensity;
+	this->radius = 10.f;
+}
+/* Ctor & Dtor */
+/* Public Methods */
+LightType Light::GetLightType() const {
+	return lightType;
+}
+
+glm::vec3 Light::GetPosition() const {
+	return position;
+}
+
+glm::vec3 Light::GetDirection() const {
+	return direction;
+}
+
+glm::vec3 Light::GetColor() const {
+	return color;
+}
+
+float Light::GetIntensity() const {
+	return intensity;
+}
+
+float Light::GetRadius() const {
+	return radius;
+}
+
+void Light::SetPosition(glm::vec3 position) {
+	this->position = position;
+}
+
+void Light::SetDirection(glm::vec3 direction) {
+	float length = glm::length(direction);
+	if(length > 0.f) this->direction = direction / length;
+}
+
+void Light::SetColor(glm::vec3 color, float intensity) {
+	this->color = color;
+	this->intensity = intensity;
+}
+
+void Light::SetRadius(float radius) {
+	this->radius = radius > 0.f ? radius : 0.f;
+}
+/* Public Methods */
+} /* namespace CGL */
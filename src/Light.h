@@ -0,0 +1,57 @@
+/*
+ * Light is a Resource describing a light source of a Scene:
+ * - POINT light has a position and a radius of influence (its light fades to zero there)
+ * - DIRECTIONAL light (sun, moon) has only a direction and lights everything
+ * Color is linear RGB, scaled by intensity.
+ * Point lights are assigned to clusters of the view frustum by LightGrid.
+ */
+
+#ifndef LIGHT_H_
+#define LIGHT_H_
+
+#include "Resource.h"
+
+#include <glm/glm.hpp>
+
+namespace CGL {
+
+enum class LightType {
+	POINT,
+	DIRECTIONAL
+};
+
+class Light : public Resource {
+public:
+	Light(std::string name, LightType lightType, glm::vec3 color=glm::vec3(1.f), float intensity=1.f);
+
+	/*
+	 * Getters
+	 */
+	LightType GetLightType() const;
+	glm::vec3 GetPosition() const;
+	glm::vec3 GetDirection() const;
+	glm::vec3 GetColor() const;
+	float GetIntensity() const;
+	float GetRadius() const;
+
+	/*
+	 * Setters
+	 */
+	void SetPosition(glm::vec3 position);
+	// Direction the light travels in (normalized here)
+	void SetDirection(glm::vec3 direction);
+	void SetColor(glm::vec3 color, float intensity);
+	void SetRadius(float radius);
+
+private:
+	LightType lightType;
+	glm::vec3 position;
+	glm::vec3 direction;
+	glm::vec3 color;
+	float intensity;
+	float radius;
+};
+
+} /* namespace CGL */
+
+#endif /* LIGHT_H_ */
@@ -0,0 +1,262 @@
+#include "LightGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CGL_LIGHTGRID_SSE2
+#endif
+
+namespace CGL {
+
+namespace {
+	// Depth of the far end of the last slice
+	const float UNBOUNDED_DEPTH = 1e30f;
+
+	// Header of the CGLLights buffer (std430)
+	struct LightHeader {
+		uint32_t grid[4];
+		float slices[4];
+		float viewport[4];
+	};
+}
+
+/* Ctor & Dtor */
+LightGrid::LightGrid(unsigned int regions) {
+	this->regions = regions;
+	sizeX = 16; sizeY = 9; sizeZ = 24;
+	maxDistance = 500.f;
+	bufferSize = 0;
+	alignment = 0;
+	frameStarted = false;
+	stats = LightGridStats();
+}
+/* Ctor & Dtor */
+/* Public Methods */
+void LightGrid::SetGridSize(int x, int y, int z) {
+	sizeX = std::max(1, x);
+	sizeY = std::max(1, y);
+	sizeZ = std::max(1, z);
+}
+
+void LightGrid::SetMaxDistance(float maxDistance) {
+	if(maxDistance > 0.f) this->maxDistance = maxDistance;
+}
+
+void LightGrid::BeginFrame() {
+	if(buffer) buffer->BeginFrame();
+	frameStarted = true;
+}
+
+void LightGrid::EndFrame() {
+	if(buffer) buffer->EndFrame();
+	frameStarted = false;
+}
+
+void LightGrid::Build(const Camera & camera, int viewportX, int viewportY, int viewportWidth, int viewportHeight,
+		const std::vector<std::shared_ptr<Light>> & lights, JobSystem & jobs) {
+	stats = LightGridStats();
+	if(!GLEW_ARB_shader_storage_buffer_object) {
+		static bool warned = false;
+		if(!warned) std::cout << "CGL::WARNING::LIGHTGRID::BUILD() shader storage buffers are not supported" << std::endl;
+		warned = true;
+		return;
+	}
+	const glm::mat4 & viewMatrix = camera.GetViewMatrix();
+
+	// Exponential slices between the near plane and the far one (or maxDistance)
+	float nearDepth = camera.GetNearPlane();
+	float farDepth = camera.IsInfiniteProjection() ? maxDistance : std::min(camera.GetFarPlane(), maxDistance);
+	farDepth = std::max(farDepth, nearDepth * 2.f);
+	float sliceScale = (float)sizeZ / std::log(farDepth / nearDepth);
+	float sliceBias = -sliceScale * std::log(nearDepth);
+	auto sliceOf = [&](float depth) {
+		if(depth <= nearDepth) return 0;
+		return std::min(sizeZ - 1, (int)(std::log(depth) * sliceScale + sliceBias));
+	};
+
+	// Point lights in view space
+	viewLights.clear();
+	uint32_t index = 0;
+	for(const std::shared_ptr<Light> & light : lights)
+		if(light->GetLightType() == LightType::DIRECTIONAL) index++;
+	stats.directionalLights = index;
+	for(const std::shared_ptr<Light> & light : lights) {
+		if(light->GetLightType() != LightType::POINT) continue;
+		ViewLight viewLight;
+		viewLight.center = glm::vec3(viewMatrix * glm::vec4(light->GetPosition(), 1.f));
+		viewLight.radius = light->GetRadius();
+		viewLight.index = index++;
+		float depth = -viewLight.center.z;
+		if(depth + viewLight.radius <= 0.f || viewLight.radius <= 0.f) continue;
+		viewLight.firstSlice = sliceOf(depth - viewLight.radius);
+		viewLight.lastSlice = sliceOf(depth + viewLight.radius);
+		viewLights.push_back(viewLight);
+	}
+
+	// Tile bounds per unit of depth
+	float tanY = std::tan(glm::radians(camera.GetFieldOfView()) * .5f);
+	float tanX = tanY * camera.GetAspectRatio();
+	int tiles = sizeX * sizeY, paddedTiles = (tiles + 3) & ~3;
+	tileMinX.assign(paddedTiles, 0.f); tileMaxX.assign(paddedTiles, 0.f);
+	tileMinY.assign(paddedTiles, 0.f); tileMaxY.assign(paddedTiles, 0.f);
+	for(int y = 0; y < sizeY; y++) {
+		for(int x = 0; x < sizeX; x++) {
+			int tile = y * sizeX + x;
+			tileMinX[tile] = (-1.f + 2.f * (float)x / (float)sizeX) * tanX;
+			tileMaxX[tile] = (-1.f + 2.f * (float)(x + 1) / (float)sizeX) * tanX;
+			tileMinY[tile] = (-1.f + 2.f * (float)y / (float)sizeY) * tanY;
+			tileMaxY[tile] = (-1.f + 2.f * (float)(y + 1) / (float)sizeY) * tanY;
+		}
+	}
+
+	// Slices are independent, each one fills only its own cluster lists
+	clusterLights.resize((size_t)tiles * sizeZ);
+	jobs.ParallelFor((size_t)sizeZ, 1, [&](size_t begin, size_t end) {
+		for(size_t slice = begin; slice < end; slice++) {
+			float sliceNear = slice == 0 ? 0.f : nearDepth * std::pow(farDepth / nearDepth, (float)slice / (float)sizeZ);
+			float sliceFar = (int)slice == sizeZ - 1 ? UNBOUNDED_DEPTH : nearDepth * std::pow(farDepth / nearDepth, (float)(slice + 1) / (float)sizeZ);
+			assignSlice((int)slice, sliceNear, sliceFar);
+		}
+	});
+
+	upload(lights, viewportX, viewportY,
+			(float)viewportWidth / (float)sizeX, (float)viewportHeight / (float)sizeY, sliceScale, sliceBias);
+}
+
+LightGridStats LightGrid::GetStats() const {
+	return stats;
+}
+/* Public Methods */
+/* Private Methods */
+void LightGrid::assignSlice(int slice, float nearDepth, float farDepth) {
+	int tiles = sizeX * sizeY, paddedTiles = (tiles + 3) & ~3;
+	std::vector<uint32_t> * lists = &clusterLights[(size_t)slice * tiles];
+	for(int tile = 0; tile < tiles; tile++) lists[tile].clear();
+
+	// View space boxes of the slice's clusters (view looks down -z)
+	std::vector<float> minX(paddedTiles), maxX(paddedTiles), minY(paddedTiles), maxY(paddedTiles);
+	for(int tile = 0; tile < paddedTiles; tile++) {
+		if(tile >= tiles) {
+			// Padding boxes are never touched
+			minX[tile] = minY[tile] = UNBOUNDED_DEPTH;
+			maxX[tile] = maxY[tile] = -UNBOUNDED_DEPTH;
+			continue;
+		}
+		minX[tile] = tileMinX[tile] * (tileMinX[tile] < 0.f ? farDepth : nearDepth);
+		maxX[tile] = tileMaxX[tile] * (tileMaxX[tile] > 0.f ? farDepth : nearDepth);
+		minY[tile] = tileMinY[tile] * (tileMinY[tile] < 0.f ? farDepth : nearDepth);
+		maxY[tile] = tileMaxY[tile] * (tileMaxY[tile] > 0.f ? farDepth : nearDepth);
+	}
+
+	for(const ViewLight & light : viewLights) {
+		if(slice < light.firstSlice || slice > light.lastSlice) continue;
+
+		// Squared distance from the sphere center to the boxes, z is common to the slice
+		float depth = -light.center.z;
+		float dz = std::max(0.f, std::max(nearDepth - depth, depth - farDepth));
+		float remaining = light.radius * light.radius - dz * dz;
+		if(remaining < 0.f) continue;
+
+#ifdef CGL_LIGHTGRID_SSE2
+		__m128 zero = _mm_setzero_ps();
+		__m128 cx = _mm_set1_ps(light.center.x), cy = _mm_set1_ps(light.center.y);
+		__m128 limit = _mm_set1_ps(remaining);
+		for(int tile = 0; tile < paddedTiles; tile += 4) {
+			__m128 dx = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minX[tile]), cx), _mm_sub_ps(cx, _mm_loadu_ps(&maxX[tile]))));
+			__m128 dy = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&minY[tile]), cy), _mm_sub_ps(cy, _mm_loadu_ps(&maxY[tile]))));
+			__m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+			int touched = _mm_movemask_ps(_mm_cmple_ps(distance, limit));
+			for(int i = 0; touched; i++, touched >>= 1)
+				if(touched & 1) lists[tile + i].push_back(light.index);
+		}
+#else
+		for(int tile = 0; tile < tiles; tile++) {
+			float dx = std::max(0.f, std::max(minX[tile] - light.center.x, light.center.x - maxX[tile]));
+			float dy = std::max(0.f, std::max(minY[tile] - light.center.y, light.center.y - maxY[tile]));
+			if(dx * dx + dy * dy <= remaining) lists[tile].push_back(light.index);
+		}
+#endif
+	}
+}
+
+void LightGrid::upload(const std::vector<std::shared_ptr<Light>> & lights,
+		int viewportX, int viewportY, float tileWidth, float tileHeight, float sliceScale, float sliceBias) {
+	size_t clusters = clusterLights.size();
+	size_t indices = 0;
+	for(const std::vector<uint32_t> & list : clusterLights) {
+		indices += list.size();
+		stats.maxClusterLights = std::max(stats.maxClusterLights, (unsigned int)list.size());
+	}
+	stats.lightIndices = (unsigned int)indices;
+
+	// Lights touching any cluster
+	std::vector<char> touched(lights.size(), 0);
+	for(const std::vector<uint32_t> & list : clusterLights)
+		for(uint32_t light : list) touched[light] = 1;
+	for(char t : touched) stats.pointLights += t;
+
+	size_t lightBytes = sizeof(LightHeader) + lights.size() * 2 * sizeof(glm::vec4);
+	size_t clusterBytes = clusters * 2 * sizeof(uint32_t);
+	size_t indexBytes = std::max<size_t>(indices, 1) * sizeof(uint32_t);
+
+	// Views of one frame share the ring, it grows when a frame's lists don't fit
+	if(!alignment) glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	size_t align = alignment > 0 ? (size_t)alignment : 256;
+	size_t needed = lightBytes + clusterBytes + indexBytes + 3 * align;
+	StreamAllocation lightData, clusterData, indexData;
+	for(int attempt = 0; attempt < 2; attempt++) {
+		if(!buffer || attempt > 0) {
+			bufferSize = std::max<size_t>(bufferSize * 2, std::max<size_t>(needed * 4, 1 << 20));
+			buffer.reset(new StreamBuffer(bufferSize, regions));
+			if(frameStarted) buffer->BeginFrame();
+		}
+		lightData = buffer->Allocate(lightBytes, align);
+		clusterData = buffer->Allocate(clusterBytes, align);
+		indexData = buffer->Allocate(indexBytes, align);
+		if(lightData.data && clusterData.data && indexData.data) break;
+	}
+	if(!lightData.data || !clusterData.data || !indexData.data) return;
+
+	LightHeader * header = (LightHeader*)lightData.data;
+	header->grid[0] = (uint32_t)sizeX; header->grid[1] = (uint32_t)sizeY; header->grid[2] = (uint32_t)sizeZ;
+	header->grid[3] = stats.directionalLights;
+	header->slices[0] = sliceScale; header->slices[1] = sliceBias;
+	header->slices[2] = tileWidth; header->slices[3] = tileHeight;
+	header->viewport[0] = (float)viewportX; header->viewport[1] = (float)viewportY;
+	header->viewport[2] = header->viewport[3] = 0.f;
+
+	// Directional lights first, then point lights (the order indices were given in)
+	glm::vec4 * gpuLights = (glm::vec4*)((unsigned char*)lightData.data + sizeof(LightHeader));
+	for(int pass = 0; pass < 2; pass++) {
+		for(const std::shared_ptr<Light> & light : lights) {
+			bool directional = light->GetLightType() == LightType::DIRECTIONAL;
+			if(directional != (pass == 0)) continue;
+			*gpuLights++ = directional ? glm::vec4(light->GetDirection(), 0.f) : glm::vec4(light->GetPosition(), light->GetRadius());
+			*gpuLights++ = glm::vec4(light->GetColor() * light->GetIntensity(), directional ? 1.f : 0.f);
+		}
+	}
+
+	uint32_t * ranges = (uint32_t*)clusterData.data;
+	uint32_t * lightIndices = (uint32_t*)indexData.data;
+	uint32_t offset = 0;
+	for(size_t cluster = 0; cluster < clusters; cluster++) {
+		const std::vector<uint32_t> & list = clusterLights[cluster];
+		ranges[2 * cluster] = offset;
+		ranges[2 * cluster + 1] = (uint32_t)list.size();
+		if(!list.empty()) std::memcpy(lightIndices + offset, list.data(), list.size() * sizeof(uint32_t));
+		offset += (uint32_t)list.size();
+	}
+	buffer->Flush();
+
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, LIGHT_BUFFER_BINDING, lightData.buffer, lightData.offset, lightBytes);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, LIGHT_CLUSTER_BINDING, clusterData.buffer, clusterData.offset, clusterBytes);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, LIGHT_INDEX_BINDING, indexData.buffer, indexData.offset, indexBytes);
+	Profiler::CountStateChange();
+	Profiler::CountUpload(lightBytes + clusterBytes + indexBytes);
+}
+/* Private Methods */
+} /* namespace CGL */
@@ -0,0 +1,139 @@
+/*
+ * LightGrid implements clustered forward lighting:
+ * - the view frustum of a Camera is split into X x Y screen tiles and Z slices
+ *   (exponential in depth), every cell is a cluster
+ * - point lights are assigned to clusters their sphere touches (SSE tests of 4 clusters
+ *   at once, slices in parallel on the JobSystem), directional lights touch all of them
+ * - lights, per cluster ranges and light indices are uploaded into shader storage buffers,
+ *   so a fragment shader evaluates only the lights of its own cluster
+ *
+ * In GLSL (#version 430, or the CGL_CLUSTERED_LIGHTING ShaderFeature for the define):
+ *   layout(std430, binding = 1) readonly buffer CGLLights {
+ *       uvec4 cglLightGrid;      // clusters in x, y, z; number of directional lights
+ *       vec4 cglLightSlices;     // slice = log(viewDepth) * x + y; tile size in pixels (z, w)
+ *       vec4 cglLightViewport;   // viewport origin in pixels (x, y)
+ *       vec4 cglLights[];        // 2 per light: position (direction) + radius; color * intensity
+ *   };
+ *   layout(std430, binding = 2) readonly buffer CGLLightClusters { uvec2 cglLightClusters[]; }; // offset, count
+ *   layout(std430, binding = 3) readonly buffer CGLLightIndices { uint cglLightIndices[]; };
+ *
+ *   uint slice = min(uint(max(log(viewDepth) * cglLightSlices.x + cglLightSlices.y, 0.0)), cglLightGrid.z - 1u);
+ *   uvec2 tile = min(uvec2((gl_FragCoord.xy - cglLightViewport.xy) / cglLightSlices.zw), cglLightGrid.xy - 1u);
+ *   uvec2 range = cglLightClusters[tile.x + cglLightGrid.x * (tile.y + cglLightGrid.y * slice)];
+ *   for(uint i = 0u; i < range.y; i++) { uint light = cglLightIndices[range.x + i]; ... cglLights[2u * light] ... }
+ * Directional lights are cglLights[0 .. cglLightGrid.w - 1] and aren't listed in clusters.
+ * A point light should fade out completely at its radius, e.g.
+ *   pow(clamp(1 - pow(distance / radius, 4), 0, 1), 2) / (distance * distance + 1)
+ */
+
+#ifndef LIGHTGRID_H_
+#define LIGHTGRID_H_
+
+#include "Light.h"
+#include "Camera.h"
+#include "JobSystem.h"
+#include "StreamBuffer.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace CGL {
+
+const GLuint LIGHT_BUFFER_BINDING = 1;
+const GLuint LIGHT_CLUSTER_BINDING = 2;
+const GLuint LIGHT_INDEX_BINDING = 3;
+
+struct LightGridStats {
+	// Point lights touching at least one cluster, and directional lights
+	unsigned int pointLights;
+	unsigned int directionalLights;
+	// Entries of all cluster lists, and the longest list
+	unsigned int lightIndices;
+	unsigned int maxClusterLights;
+};
+
+class LightGrid {
+public:
+	/*
+	 * Needs the OpenGL context (buffers are created with the first Build());
+	 * regions of the upload ring as in StreamBuffer
+	 */
+	LightGrid(unsigned int regions=3);
+
+	/*
+	 * Delete Copy Constructor and operator=
+	 */
+	LightGrid(const LightGrid & other) = delete;
+	LightGrid & operator=(const LightGrid & other) = delete;
+
+	/*
+	 * Clusters in x, y (screen tiles) and z (depth slices); 16x9x24 by default
+	 * maxDistance bounds the slices of infinite (or very far) projections,
+	 * the last slice reaches to infinity
+	 */
+	void SetGridSize(int x, int y, int z);
+	void SetMaxDistance(float maxDistance);
+
+	/*
+	 * Frame boundaries of the upload ring (fenced like StreamBuffer)
+	 */
+	void BeginFrame();
+	void EndFrame();
+
+	/*
+	 * Assign the lights to clusters of the Camera's view (drawn into the viewport)
+	 * and bind the buffers at LIGHT_BUFFER_BINDING, LIGHT_CLUSTER_BINDING and LIGHT_INDEX_BINDING
+	 */
+	void Build(const Camera & camera, int viewportX, int viewportY, int viewportWidth, int viewportHeight,
+			const std::vector<std::shared_ptr<Light>> & lights, JobSystem & jobs);
+
+	/*
+	 * Statistics of the last Build()
+	 */
+	LightGridStats GetStats() const;
+
+private:
+	int sizeX, sizeY, sizeZ;
+	float maxDistance;
+
+	std::unique_ptr<StreamBuffer> buffer;
+	unsigned int regions;
+	size_t bufferSize;
+	GLint alignment;
+	bool frameStarted;
+
+	/*
+	 * View space point lights of the current Build() with their slice range
+	 */
+	struct ViewLight {
+		glm::vec3 center;
+		float radius;
+		int firstSlice, lastSlice;
+		uint32_t index;
+	};
+	std::vector<ViewLight> viewLights;
+
+	/*
+	 * Tile bounds of one slice in view space (SoA, padded to a multiple of 4 tiles);
+	 * x/y bounds of a tile scale with depth, so they are stored per unit depth
+	 */
+	std::vector<float> tileMinX, tileMaxX, tileMinY, tileMaxY;
+
+	// Light list of every cluster, kept between frames for their capacity
+	std::vector<std::vector<uint32_t>> clusterLights;
+
+	LightGridStats stats;
+
+	void assignSlice(int slice, float nearDepth, float farDepth);
+	void upload(const std::vector<std::shared_ptr<Light>> & lights,
+			int viewportX, int viewportY, float tileWidth, float tileHeight, float sliceScale, float sliceBias);
+};
+
+} /* namespace CGL */
+
+#endif /* LIGHTGRID_H_ */
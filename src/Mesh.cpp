@@ -1,42 +1,114 @@
 #include "Mesh.h"
 namespace CGL {
 
+GLuint Mesh::boundTextures[Mesh::BINDING_CACHE_SIZE] = {};
+GLenum Mesh::boundTargets[Mesh::BINDING_CACHE_SIZE] = {};
+
 // - Ctors & Dtors
-	Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
-		: vertices(vertices), indices(indices), textures(textures) {
+	Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures, std::vector<VertexBones> bones)
+		: vertices(vertices), indices(indices), textures(textures), bones(bones) {
 		setupMesh();
+		nameSamplers();
 	}
 // - END Ctors & Dtors
 
 // - Public Methods
-	void Mesh::Draw(ShaderProgram * shader) {
+	void Mesh::Draw(ShaderProgram * shader, GLuint vertexArray) {
+		BindTextures(shader);
+
+		glBindVertexArray(vertexArray ? vertexArray : VAO);
+		Profiler::CountStateChange();
+		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+		Profiler::CountDrawCall(indices.size() / 3);
+		glBindVertexArray(0);
+	}
+
+	void Mesh::BindTextures(ShaderProgram * shader) const {
+		for (unsigned int i = 0; i < textures.size() && i < samplerNames.size(); i++) {
+			const Texture & texture = textures[i];
+
+			// Bindless: the sampler uniform takes the handle, no texture unit involved
+			if (texture.handle) {
+				shader->SetUniformHandle(samplerNames[i].c_str(), texture.handle);
+				continue;
+			}
+
+			shader->SetUniform1i(samplerNames[i].c_str(), i);
+			if (texture.layer >= 0) shader->SetUniform1i(layerNames[i].c_str(), texture.layer);
+
+			if (i < BINDING_CACHE_SIZE && boundTextures[i] == texture.id && boundTargets[i] == texture.target) continue;
+			glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
+			glBindTexture(texture.target, texture.id);
+			Profiler::CountStateChange();
+			if (i < BINDING_CACHE_SIZE) {
+				boundTextures[i] = texture.id;
+				boundTargets[i] = texture.target;
+			}
+		}
+		glActiveTexture(GL_TEXTURE0);
+	}
+
+	void Mesh::DrawGeometry(GLuint vertexArray) {
+		glBindVertexArray(vertexArray ? vertexArray : VAO);
+		Profiler::CountStateChange();
+		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+		Profiler::CountDrawCall(indices.size() / 3);
+		glBindVertexArray(0);
+	}
+
+	bool Mesh::IsSkinned() const {
+		return !bones.empty();
+	}
+
+	GLuint Mesh::GetElementBuffer() const {
+		return EBO;
+	}
+
+	MaterialRef Mesh::GetMaterialRef() const {
+		MaterialRef material = { 0, 0, -1, -1, 0, 0 };
+		bool diffuse = false, specular = false;
+		for (const Texture & texture : textures) {
+			if (texture.type == "texture_diffuse" && !diffuse) {
+				diffuse = true;
+				if (texture.layer >= 0) { material.diffuseArray = texture.id; material.diffuseLayer = texture.layer; }
+				material.diffuseHandle = texture.handle;
+			}
+			else if (texture.type == "texture_specular" && !specular) {
+				specular = true;
+				if (texture.layer >= 0) { material.specularArray = texture.id; material.specularLayer = texture.layer; }
+				material.specularHandle = texture.handle;
+			}
+		}
+		return material;
+	}
+
+	void Mesh::ResetTextureBindings() {
+		for (unsigned int i = 0; i < BINDING_CACHE_SIZE; i++) {
+			boundTextures[i] = 0;
+			boundTargets[i] = 0;
+		}
+	}
+// - END Public Methods
+
+// - Private Methods
+	void Mesh::nameSamplers() {
 		unsigned int diffuseNr = 1;
 		unsigned int specularNr = 1;
 		unsigned int normalNr = 1;
 		unsigned int heighNr = 1;
 
-		for (unsigned int i = 0; i < textures.size(); i++) {
-			glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
-
+		for (const Texture & texture : textures) {
 			std::string number;
-			std::string name = textures[i].type;
+			std::string name = texture.type;
 			if (name == "texture_diffuse") number = std::to_string(diffuseNr++);
 			else if (name == "texture_specular") number = std::to_string(specularNr++);
 			else if (name == "texture_normal") number = std::to_string(normalNr++);
 			else if (name == "texture_height") number = std::to_string(heighNr++);
-
-			shader->SetUniform1i((name + number).c_str(), i);
-			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+			samplerNames.push_back(name + number);
+			layerNames.push_back(name + number + "_layer");
 		}
-
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		glBindVertexArray(0);
-		glActiveTexture(GL_TEXTURE0);
 	}
-// - END Public Methods
 
-// - Private Methods
 	void Mesh::setupMesh() {
 		glGenVertexArrays(1, &VAO);
 		glGenBuffers(1, &VBO);
@@ -48,6 +120,8 @@ namespace CGL {
 
 		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		Profiler::CountUpload(vertices.size() * sizeof(Vertex));
+		Profiler::CountUpload(indices.size() * sizeof(unsigned int));
 
 		// vertex positions
 		glEnableVertexAttribArray(0);
@@ -59,6 +133,19 @@ namespace CGL {
 		glEnableVertexAttribArray(2);
 		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
 
+		// bone indices and weights of skinned meshes from their own buffer
+		boneVBO = 0;
+		if (!bones.empty()) {
+			glGenBuffers(1, &boneVBO);
+			glBindBuffer(GL_ARRAY_BUFFER, boneVBO);
+			glBufferData(GL_ARRAY_BUFFER, bones.size() * sizeof(VertexBones), &bones[0], GL_STATIC_DRAW);
+			Profiler::CountUpload(bones.size() * sizeof(VertexBones));
+			glEnableVertexAttribArray(3);
+			glVertexAttribIPointer(3, 4, GL_UNSIGNED_SHORT, sizeof(VertexBones), (void*)offsetof(VertexBones, BoneIds));
+			glEnableVertexAttribArray(4);
+			glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(VertexBones), (void*)offsetof(VertexBones, Weights));
+		}
+
 		glBindVertexArray(0);
 	}
 // - END Private Methods
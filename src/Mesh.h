@@ -12,6 +12,7 @@
 
 #include <glm/glm.hpp>
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -28,13 +29,39 @@ namespace CGL {
 		glm::vec2 TexCoords;
 	};
 
+	/*
+	 * Bones of a skinned vertex (indices into the Model's Skeleton bones) with their weights,
+	 * unused influences have zero weight. Kept apart from Vertex, so static meshes stay small.
+	 * In GLSL: layout (location = 3) in uvec4 aBoneIds; layout (location = 4) in vec4 aBoneWeights;
+	 */
+	struct VertexBones {
+		uint16_t BoneIds[4];
+		float Weights[4];
+	};
+
 	/*
 	 * A Texture structure which consist of a OpenGL's ID and a full path of a texture file
+	 * Packed textures are a layer of a GL_TEXTURE_2D_ARRAY (id is the array)
+	 * or have a resident bindless handle (then they are never bound)
 	 */
 	struct Texture {
 		GLuint id;
 		std::string type;
 		std::string path;
+		GLenum target = GL_TEXTURE_2D;
+		int layer = -1;
+		GLuint64 handle = 0;
+	};
+
+	/*
+	 * Per-draw material data of a mesh with packed textures, for paths which
+	 * batch meshes of different materials (StaticBatch's per vertex materials):
+	 * array and layer, or bindless handle, of the first diffuse and specular texture
+	 */
+	struct MaterialRef {
+		GLuint diffuseArray, specularArray;
+		int diffuseLayer, specularLayer;
+		GLuint64 diffuseHandle, specularHandle;
 	};
 
 	class Mesh {
@@ -42,13 +69,44 @@ namespace CGL {
 
 		/*
 		 * Creates a mesh from given vertices, indices (for rendering order) and textures
+		 * Skinned meshes have bones of every vertex as well
 		 */
-		Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+		Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures,
+				std::vector<VertexBones> bones=std::vector<VertexBones>());
 
 		/*
 		 * Render a mesh using given ShaderProgram
+		 * vertexArray replaces the mesh's own one (0), e.g. with CPU skinned vertices;
+		 * it has to use the mesh's element buffer
+		 */
+		void Draw(ShaderProgram * shader, GLuint vertexArray=0);
+
+		/*
+		 * Render only the geometry with whatever program is in use (no textures)
 		 */
-		void Draw(ShaderProgram * shader);
+		void DrawGeometry(GLuint vertexArray=0);
+
+		/*
+		 * Bind the mesh's textures and set their sampler uniforms (what Draw() does
+		 * before drawing), e.g. for other geometry with the same material
+		 */
+		void BindTextures(ShaderProgram * shader) const;
+
+		bool IsSkinned() const;
+		GLuint GetElementBuffer() const;
+
+		/*
+		 * Material data of packed textures (zeros and -1 layers if there are none)
+		 */
+		MaterialRef GetMaterialRef() const;
+
+		/*
+		 * Forget which textures are bound to which units
+		 * Draw() skips binds of textures which are already bound (e.g. the same
+		 * texture array for many meshes), call this whenever anything else may
+		 * have bound textures, e.g. once per frame before drawing
+		 */
+		static void ResetTextureBindings();
 
 		/*
 		 * Mesh data
@@ -56,6 +114,7 @@ namespace CGL {
 		std::vector<Vertex> vertices;
 		std::vector<unsigned int> indices;
 		std::vector<Texture> textures;
+		std::vector<VertexBones> bones;
 	private:
 
 		/*
@@ -65,12 +124,28 @@ namespace CGL {
 		 * EBO - Element Buffer Object (GL_ELEMENT_ARRAY_BUFFER)
 		 */
 		unsigned int VAO, VBO, EBO;
+		// Bones of skinned vertices (0 for static meshes)
+		unsigned int boneVBO;
 
 		/*
 		 * Create mesh from given vertices and indices and textures.
 		 * Generate OpenGL buffers to store this data on the GPU
 		 */
 		void setupMesh();
+
+		/*
+		 * Sampler (and layer) uniform names of the textures, e.g. texture_diffuse1,
+		 * built once instead of on every BindTextures()
+		 */
+		void nameSamplers();
+		std::vector<std::string> samplerNames, layerNames;
+
+		/*
+		 * Textures bound by Draw() per unit (0 when unknown)
+		 */
+		static const unsigned int BINDING_CACHE_SIZE = 16;
+		static GLuint boundTextures[BINDING_CACHE_SIZE];
+		static GLenum boundTargets[BINDING_CACHE_SIZE];
 	};
 } // namespace CGL
 
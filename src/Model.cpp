@@ -2,13 +2,80 @@
 
 namespace CGL {
 
+namespace {
+	// Assimp's matrices are row major
+	glm::mat4 toMat4(const aiMatrix4x4 & m) {
+		return glm::mat4(
+				glm::vec4(m.a1, m.b1, m.c1, m.d1),
+				glm::vec4(m.a2, m.b2, m.c2, m.d2),
+				glm::vec4(m.a3, m.b3, m.c3, m.d3),
+				glm::vec4(m.a4, m.b4, m.c4, m.d4));
+	}
+}
+
+unsigned Model::textureLoadThreads = 0;
+std::unique_ptr<ThreadPool> Model::texturePool;
+
 /* Ctor & Dtor */
-Model::Model(std::string name, std::string path) {
+Model::Model(std::string name, std::string path, std::shared_ptr<TextureStreamer> streamer, TexturePacking packing) {
 	// Resource configuration
 	setName(name); setType(Type::MODEL);
+	this->streamer = streamer;
+
+	// Streamed textures change their base level, which handles and arrays don't allow
+	if(streamer && packing != TexturePacking::NONE) {
+		std::cout << "CGL::WARNING::MODEL::MODEL() Texture packing of " << name << " is disabled by texture streaming\n";
+		packing = TexturePacking::NONE;
+	}
+	if(packing == TexturePacking::BINDLESS && !GLEW_ARB_bindless_texture) packing = TexturePacking::ARRAYS;
+	this->packing = packing;
 
 	// Model loading
+	boundsMin = glm::vec3(std::numeric_limits<float>::max());
+	boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+	skeleton.globalInverse = glm::mat4(1.f);
+	skinned = false;
+	nodeHierarchy = false;
 	loadModel(path);
+	computeMeshBounds();
+
+	// Empty model (or failed to load) is a point at the origin
+	if(boundsMin.x > boundsMax.x)
+		boundsMin = boundsMax = glm::vec3(0.f);
+}
+
+Model::Model(std::string name, std::vector<Mesh> meshes) {
+	// Resource configuration
+	setName(name); setType(Type::MODEL);
+	this->packing = TexturePacking::NONE;
+
+	boundsMin = glm::vec3(std::numeric_limits<float>::max());
+	boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+	skeleton.globalInverse = glm::mat4(1.f);
+	skinned = false;
+	nodeHierarchy = false;
+	this->meshes = std::move(meshes);
+	for(const Mesh & mesh : this->meshes) {
+		for(const Vertex & vertex : mesh.vertices) {
+			boundsMin = glm::min(boundsMin, vertex.Position);
+			boundsMax = glm::max(boundsMax, vertex.Position);
+		}
+		meshNodes.push_back(0);
+	}
+	computeMeshBounds();
+
+	if(boundsMin.x > boundsMax.x)
+		boundsMin = boundsMax = glm::vec3(0.f);
+}
+
+Model::~Model() {
+	for(Texture & texture : textures_loaded) {
+		if(!texture.id || texture.layer >= 0) continue;
+		if(texture.handle) glMakeTextureHandleNonResidentARB(texture.handle);
+		if(streamer) streamer->Unregister(texture.id);
+		else glDeleteTextures(1, &texture.id);
+	}
+	if(!textureArrays.empty()) glDeleteTextures((GLsizei)textureArrays.size(), textureArrays.data());
 }
 /* Ctor & Dtor */
 /* Public Methods */
@@ -17,44 +84,120 @@ void Model::Draw(ShaderProgram * shader) {
 		mesh.Draw(shader);
 }
 
-unsigned int TextureFromFile(const char* file, const std::string directory, bool gamma) {
-	std::string path = directory + '/' + std::string(file);
+void Model::DrawGeometry() {
+	for (Mesh& mesh : meshes)
+		mesh.DrawGeometry();
+}
 
-	unsigned int textureID = SOIL_load_OGL_texture(
-		path.c_str(),
-		SOIL_LOAD_AUTO,
-		SOIL_CREATE_NEW_ID,
-		SOIL_FLAG_MIPMAPS |
-#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
-		SOIL_FLAG_INVERT_Y |
-#endif
-		SOIL_FLAG_NTSC_SAFE_RGB |
-		SOIL_FLAG_COMPRESS_TO_DXT
-	);
+void Model::DrawMesh(size_t index, ShaderProgram * shader) {
+	meshes[index].Draw(shader);
+}
 
-#ifdef _DEBUG
-	if (textureID == 0) {
-		printf("CGL::ERROR::MODEL::SOIL2::LOADING '%s'\n", SOIL_last_result());
-		return textureID;
-	}
-#endif // _DEBUG
-	if (!textureID) {
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glGenerateMipmap(GL_TEXTURE_2D);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	}
+void Model::DrawMeshGeometry(size_t index) {
+	meshes[index].DrawGeometry();
+}
+
+void Model::Draw(ShaderProgram * shader, const std::vector<GLuint> & vertexArrays) {
+	for (size_t i = 0; i < meshes.size(); i++)
+		meshes[i].Draw(shader, i < vertexArrays.size() ? vertexArrays[i] : 0);
+}
+
+void Model::DrawGeometry(const std::vector<GLuint> & vertexArrays) {
+	for (size_t i = 0; i < meshes.size(); i++)
+		meshes[i].DrawGeometry(i < vertexArrays.size() ? vertexArrays[i] : 0);
+}
+
+unsigned int TextureFromFile(const char* file, const std::string directory, bool gamma) {
+	std::string path = directory + '/' + std::string(file);
 
-	return textureID;
+	DecodedTexture texture;
+	if(!DecodeTexture(path, gamma, texture)) return 0;
+	return UploadDecodedTexture(texture);
 }
 
 std::string Model::GetDirectory() const {
 	return directory;
 }
+
+TexturePacking Model::GetTexturePacking() const {
+	return packing;
+}
+
+ShaderFeatures Model::GetTexturePackingFeatures() const {
+	if(packing == TexturePacking::ARRAYS) return ShaderFeature::TEXTURE_ARRAY;
+	if(packing == TexturePacking::BINDLESS) return ShaderFeature::BINDLESS_TEXTURE;
+	return ShaderFeature::NONE;
+}
+
+const std::vector<Texture> & Model::GetTextures() const {
+	return textures_loaded;
+}
+
+const std::vector<Mesh> & Model::GetMeshes() const {
+	return meshes;
+}
+
+bool Model::IsSkinned() const {
+	return skinned;
+}
+
+const Skeleton & Model::GetSkeleton() const {
+	return skeleton;
+}
+
+const std::vector<AnimationClip> & Model::GetAnimations() const {
+	return animations;
+}
+
+bool Model::HasNodeTransforms() const {
+	return nodeHierarchy;
+}
+
+const glm::mat4 & Model::GetNodeTransform(int node) const {
+	return nodeTransforms[node];
+}
+
+int Model::GetMeshNode(size_t mesh) const {
+	return meshNodes[mesh];
+}
+
+int Model::FindAnimation(const std::string & name) const {
+	for(size_t i = 0; i < animations.size(); i++)
+		if(animations[i].name == name) return (int)i;
+	return -1;
+}
+
+void Model::GetBounds(glm::vec3 & min, glm::vec3 & max) const {
+	min = boundsMin;
+	max = boundsMax;
+}
+
+void Model::GetMeshBounds(size_t mesh, glm::vec3 & min, glm::vec3 & max) const {
+	min = meshBoundsMin[mesh];
+	max = meshBoundsMax[mesh];
+}
+void Model::SetTextureLoadThreads(unsigned threads) {
+	if(threads == textureLoadThreads) return;
+	textureLoadThreads = threads;
+	texturePool.reset();
+}
 /* Public Methods */
 /* Private Methods */
+void Model::computeMeshBounds() {
+	meshBoundsMin.clear();
+	meshBoundsMax.clear();
+	for(const Mesh & mesh : meshes) {
+		glm::vec3 min(std::numeric_limits<float>::max()), max(-std::numeric_limits<float>::max());
+		for(const Vertex & vertex : mesh.vertices) {
+			min = glm::min(min, vertex.Position);
+			max = glm::max(max, vertex.Position);
+		}
+		if(min.x > max.x) min = max = glm::vec3(0.f);
+		meshBoundsMin.push_back(min);
+		meshBoundsMax.push_back(max);
+	}
+}
+
 void Model::loadModel(std::string path) {
 	Assimp::Importer importer;
 	const aiScene* scene = importer.ReadFile(
@@ -62,7 +205,8 @@ void Model::loadModel(std::string path) {
 		aiProcess_Triangulate |
 //		aiProcess_FlipUVs | // commented on purpose, don't uncomment
 		aiProcess_GenSmoothNormals |
-		aiProcess_CalcTangentSpace
+		aiProcess_CalcTangentSpace |
+		aiProcess_LimitBoneWeights
 	);
 
 	if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !scene->mRootNode) {
@@ -74,22 +218,89 @@ void Model::loadModel(std::string path) {
 
 	directory = path.substr(0, path.find_last_of('/'));
 
-	processNode(scene->mRootNode, scene);
+	loadTextures(scene);
+	buildSkeleton(scene->mRootNode, -1);
+	skeleton.globalInverse = glm::inverse(toMat4(scene->mRootNode->mTransformation));
+	int nodeIndex = 0;
+	processNode(scene->mRootNode, scene, glm::mat4(1.f), nodeIndex);
+	loadAnimations(scene);
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene) {
+void Model::buildSkeleton(aiNode* node, int parent) {
+	SkeletonNode skeletonNode;
+	skeletonNode.name = node->mName.C_Str();
+	skeletonNode.parent = parent;
+
+	// Bind pose as translation, rotation and scale, the form clips are blended in
+	glm::mat4 transform = toMat4(node->mTransformation);
+	skeletonNode.translation = glm::vec3(transform[3]);
+	skeletonNode.scale = glm::vec3(glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])));
+	glm::mat4 rotation(1.f);
+	for(int column = 0; column < 3; column++)
+		rotation[column] = glm::vec4(glm::vec3(transform[column]) / skeletonNode.scale[column], 0.f);
+	skeletonNode.rotation = glm::normalize(glm::quat_cast(rotation));
+
+	int index = (int)skeleton.nodes.size();
+	skeleton.nodes.push_back(skeletonNode);
+	nodeTransforms.push_back(transform);
+	for (unsigned int i = 0; i < node->mNumChildren; i++)
+		buildSkeleton(node->mChildren[i], index);
+}
+
+void Model::loadAnimations(const aiScene* scene) {
+	for (unsigned int i = 0; i < scene->mNumAnimations; i++) {
+		const aiAnimation* animation = scene->mAnimations[i];
+		double ticksPerSecond = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : 25.0;
+
+		AnimationClip clip;
+		clip.name = animation->mName.C_Str();
+		clip.duration = (float)(animation->mDuration / ticksPerSecond);
+		for (unsigned int c = 0; c < animation->mNumChannels; c++) {
+			const aiNodeAnim* nodeAnim = animation->mChannels[c];
+			AnimationChannel channel;
+			channel.node = skeleton.FindNode(nodeAnim->mNodeName.C_Str());
+			if (channel.node < 0) continue;
+			for (unsigned int k = 0; k < nodeAnim->mNumPositionKeys; k++) {
+				const aiVectorKey & key = nodeAnim->mPositionKeys[k];
+				channel.positionTimes.push_back((float)(key.mTime / ticksPerSecond));
+				channel.positions.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+			}
+			for (unsigned int k = 0; k < nodeAnim->mNumRotationKeys; k++) {
+				const aiQuatKey & key = nodeAnim->mRotationKeys[k];
+				channel.rotationTimes.push_back((float)(key.mTime / ticksPerSecond));
+				channel.rotations.push_back(glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z));
+			}
+			for (unsigned int k = 0; k < nodeAnim->mNumScalingKeys; k++) {
+				const aiVectorKey & key = nodeAnim->mScalingKeys[k];
+				channel.scaleTimes.push_back((float)(key.mTime / ticksPerSecond));
+				channel.scales.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+			}
+			clip.channels.push_back(channel);
+		}
+		animations.push_back(clip);
+	}
+}
+
+void Model::processNode(aiNode* node, const aiScene* scene, const glm::mat4 & parentTransform, int & nodeIndex) {
+	// nodes are visited in the skeleton's order
+	int index = nodeIndex++;
+	glm::mat4 transform = parentTransform * toMat4(node->mTransformation);
+
 	// process all the node's meshes (if any)
 	for (unsigned int i = 0; i < node->mNumMeshes; i++) {
 		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-		meshes.push_back(processMesh(mesh, scene));
+		meshes.push_back(processMesh(mesh, scene, transform));
+		meshNodes.push_back(index);
+		// skinned meshes are placed by their bones instead
+		if (mesh->mNumBones == 0 && transform != glm::mat4(1.f)) nodeHierarchy = true;
 	}
 
 	// then do the same for each of its children
 	for (unsigned int i = 0; i < node->mNumChildren; i++)
-		processNode(node->mChildren[i], scene);
+		processNode(node->mChildren[i], scene, transform, nodeIndex);
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
+Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, const glm::mat4 & transform) {
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
 	std::vector<Texture> textures;
@@ -104,6 +315,10 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
 		vector.y = mesh->mVertices[i].y;
 		vector.z = mesh->mVertices[i].z;
 		vertex.Position = vector;
+		// model space bounds, with the node's transform
+		if (mesh->mNumBones == 0) vector = glm::vec3(transform * glm::vec4(vector, 1.f));
+		boundsMin = glm::min(boundsMin, vector);
+		boundsMax = glm::max(boundsMax, vector);
 
 		// normals
 		vector.x = mesh->mNormals[i].x;
@@ -123,6 +338,44 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
 		vertices.push_back(vertex);
 	}
 
+	// process bone weights, the strongest MAX_BONE_INFLUENCES of every vertex
+	std::vector<VertexBones> bones;
+	if (mesh->mNumBones > 0) {
+		skinned = true;
+		bones.assign(mesh->mNumVertices, VertexBones());
+		for (VertexBones & vertexBones : bones)
+			for (unsigned int k = 0; k < MAX_BONE_INFLUENCES; k++) { vertexBones.BoneIds[k] = 0; vertexBones.Weights[k] = 0.f; }
+
+		for (unsigned int b = 0; b < mesh->mNumBones; b++) {
+			const aiBone* bone = mesh->mBones[b];
+			int index = skeleton.FindBone(bone->mName.C_Str());
+			if (index < 0) {
+				int node = skeleton.FindNode(bone->mName.C_Str());
+				if (node < 0) {
+					std::cout << "CGL::WARNING::MODEL::PROCESSMESH() No node for bone " << bone->mName.C_Str() << std::endl;
+					continue;
+				}
+				skeleton.bones.push_back(Bone{ node, toMat4(bone->mOffsetMatrix) });
+				index = (int)skeleton.bones.size() - 1;
+			}
+			for (unsigned int w = 0; w < bone->mNumWeights; w++) {
+				const aiVertexWeight & weight = bone->mWeights[w];
+				VertexBones & vertexBones = bones[weight.mVertexId];
+				unsigned int weakest = 0;
+				for (unsigned int k = 1; k < MAX_BONE_INFLUENCES; k++)
+					if (vertexBones.Weights[k] < vertexBones.Weights[weakest]) weakest = k;
+				if (weight.mWeight <= vertexBones.Weights[weakest]) continue;
+				vertexBones.BoneIds[weakest] = (uint16_t)index;
+				vertexBones.Weights[weakest] = weight.mWeight;
+			}
+		}
+		for (VertexBones & vertexBones : bones) {
+			float sum = 0.f;
+			for (unsigned int k = 0; k < MAX_BONE_INFLUENCES; k++) sum += vertexBones.Weights[k];
+			if (sum > 0.f) for (unsigned int k = 0; k < MAX_BONE_INFLUENCES; k++) vertexBones.Weights[k] /= sum;
+		}
+	}
+
 	// process indices
 	for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
 		aiFace face = mesh->mFaces[i];
@@ -141,9 +394,98 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene) {
 		textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
 	}
 
-	return Mesh(vertices, indices, textures);
+	return Mesh(vertices, indices, textures, bones);
 }
 
+void Model::loadTextures(const aiScene* scene) {
+	// Unique textures of the types used by processMesh(), in order of appearance
+	std::vector<Texture> pending;
+	const aiTextureType types[] = { aiTextureType_DIFFUSE, aiTextureType_SPECULAR };
+	const char* typeNames[] = { "texture_diffuse", "texture_specular" };
+	for(unsigned int m = 0; m < scene->mNumMaterials; m++) {
+		for(int t = 0; t < 2; t++) {
+			for(unsigned int i = 0; i < scene->mMaterials[m]->GetTextureCount(types[t]); i++) {
+				aiString fileName;
+				scene->mMaterials[m]->GetTexture(types[t], i, &fileName);
+				bool known = false;
+				for(Texture & texture : pending)
+					if(texture.path == fileName.C_Str()) { known = true; break; }
+				if(known) continue;
+
+				Texture texture;
+				texture.id = 0;
+				texture.type = typeNames[t];
+				texture.path = fileName.C_Str();
+				pending.push_back(texture);
+			}
+		}
+	}
+	if(pending.empty()) return;
+
+	// Decode on workers, every task writes only its own slot
+	std::vector<DecodedTexture> decoded(pending.size());
+	std::vector<char> ok(pending.size(), 0);
+	if(textureLoadThreads == 1 || pending.size() == 1) {
+		for(size_t i = 0; i < pending.size(); i++)
+			ok[i] = DecodeTexture(directory + '/' + pending[i].path, false, decoded[i]);
+	}
+	else {
+		if(!texturePool) texturePool.reset(new ThreadPool(textureLoadThreads));
+		for(size_t i = 0; i < pending.size(); i++) {
+			std::string texturePath = directory + '/' + pending[i].path;
+			DecodedTexture * target = &decoded[i];
+			char * result = &ok[i];
+			texturePool->Submit([texturePath, target, result]() { *result = DecodeTexture(texturePath, false, *target); });
+		}
+		texturePool->Wait();
+	}
+
+	// Upload on this (GL) thread, failed textures keep id 0 like TextureFromFile()
+	if(packing == TexturePacking::ARRAYS) packTextureArrays(pending, decoded, ok);
+	for(size_t i = 0; i < pending.size(); i++) {
+		if(ok[i] && pending[i].layer < 0) {
+			pending[i].id = streamer ? streamer->Register(std::move(decoded[i])) : UploadDecodedTexture(decoded[i]);
+			if(packing == TexturePacking::BINDLESS && pending[i].id) {
+				pending[i].handle = glGetTextureHandleARB(pending[i].id);
+				glMakeTextureHandleResidentARB(pending[i].handle);
+			}
+		}
+		std::vector<unsigned char>().swap(decoded[i].compressedImage.data);
+		std::vector<std::vector<unsigned char>>().swap(decoded[i].levels);
+		textures_loaded.push_back(pending[i]);
+	}
+} /* Model::loadTextures(const aiScene* scene) */
+
+void Model::packTextureArrays(std::vector<Texture> & pending, const std::vector<DecodedTexture> & decoded, const std::vector<char> & ok) {
+	GLint maxLayers = 256;
+	glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+	std::vector<bool> packed(pending.size(), false);
+	for(size_t i = 0; i < pending.size(); i++) {
+		if(!ok[i] || packed[i]) continue;
+
+		// All not yet packed textures with the layout of this one, up to the layer limit
+		std::vector<size_t> group;
+		std::vector<const DecodedTexture*> layers;
+		for(size_t j = i; j < pending.size() && (GLint)group.size() < maxLayers; j++) {
+			if(!ok[j] || packed[j] || !IsSameTextureLayout(decoded[i], decoded[j])) continue;
+			group.push_back(j);
+			layers.push_back(&decoded[j]);
+			packed[j] = true;
+		}
+
+		unsigned int arrayID = UploadTextureArray(layers);
+		if(!arrayID) continue;
+		textureArrays.push_back(arrayID);
+		for(size_t layer = 0; layer < group.size(); layer++) {
+			Texture & texture = pending[group[layer]];
+			texture.id = arrayID;
+			texture.target = GL_TEXTURE_2D_ARRAY;
+			texture.layer = (int)layer;
+		}
+	}
+} /* Model::packTextureArrays(...) */
+
 std::vector<Texture> Model::loadMaterialTextures(aiMaterial* material, aiTextureType type, std::string typeName) {
 	std::vector<Texture> textures;
 
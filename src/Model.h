@@ -14,6 +14,11 @@
 #include "Resource.h"
 #include "ShaderProgram.h"
 #include "Mesh.h"
+#include "TextureLoader.h"
+#include "ThreadPool.h"
+#include "TextureStreamer.h"
+#include "ShaderPermutation.h"
+#include "Animation.h"
 
 #include <assimp/config.h>
 #include <assimp/Importer.hpp>
@@ -25,13 +30,18 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <limits>
+#include <memory>
 
 namespace CGL {
 
 /*
  * Load a texture from file and immediately store it on the GPU
  * also set OpenGL's texture parameters (glTexParameteri)
- * and generate Mipmaps
+ * and generate Mipmaps (on the CPU, see DecodeTexture())
+ * A .ktx2/.dds file with the same name next to the image is used instead
+ * when present (uploaded as it is, with its own mips)
+ * gamma loads the texture as sRGB
  * Returns only a OpenGL's texture ID
  * NOTE: If you are compiling this library on a Windows machine,
  *       you have to define one of these flags:
@@ -44,23 +54,127 @@ namespace CGL {
  */
 unsigned int TextureFromFile(const char* file, const std::string directory, bool gamma = false);
 
+/*
+ * How Model textures are stored on the GPU:
+ * NONE     - a GL_TEXTURE_2D each, bound per mesh
+ * ARRAYS   - textures of the same format/size/levels are layers of GL_TEXTURE_2D_ARRAYs
+ *            (sampler2DArray texture_diffuse1 + int texture_diffuse1_layer in GLSL)
+ * BINDLESS - resident ARB_bindless_texture handles set directly to sampler uniforms,
+ *            falls back to ARRAYS without the extension
+ * A StaticBatch passes layers and handles per vertex instead (see StaticBatch.h).
+ */
+enum class TexturePacking {
+	NONE,
+	ARRAYS,
+	BINDLESS
+};
+
 class Model : public Resource {
 public:
 	/*
 	 * Load a 3D model binary from given path
+	 * With a TextureStreamer, textures are handed over to it
+	 * and only their coarse mips are uploaded at first
 	 */
-	Model(std::string name, std::string path);
+	Model(std::string name, std::string path, std::shared_ptr<TextureStreamer> streamer=nullptr, TexturePacking packing=TexturePacking::NONE);
+
+	/*
+	 * Model of meshes generated in code (see PrimitiveMesh.h), no file and no nodes
+	 */
+	Model(std::string name, std::vector<Mesh> meshes);
+
+	/*
+	 * Delete textures of the model from the GPU
+	 */
+	~Model();
+
+	/*
+	 * Delete Copy Constructor and operator=
+	 */
+	Model(const Model & other) = delete;
+	Model & operator=(const Model & other) = delete;
 
 	/*
 	 * Draw all meshes with a given ShaderProgram
 	 */
 	void Draw(ShaderProgram * shader);
 
+	/*
+	 * Draw all meshes without binding any textures (depth only passes, e.g. shadows)
+	 */
+	void DrawGeometry();
+
+	/*
+	 * Draw with a vertex array per mesh replacing the mesh's own one (0 or missing
+	 * entries keep it), e.g. CPU skinned vertices of an Animator
+	 */
+	void Draw(ShaderProgram * shader, const std::vector<GLuint> & vertexArrays);
+	void DrawGeometry(const std::vector<GLuint> & vertexArrays);
+
+	/*
+	 * Draw a single mesh, e.g. with the model matrix of its node
+	 */
+	void DrawMesh(size_t index, ShaderProgram * shader);
+	void DrawMeshGeometry(size_t index);
+
 	/*
 	 * Get path to the model directory
 	 */
 	std::string GetDirectory() const;
 
+	/*
+	 * Packing in effect (it may differ from the requested one, see TexturePacking)
+	 * and the ShaderFeature its shaders need (TEXTURE_ARRAY, BINDLESS_TEXTURE or NONE)
+	 */
+	TexturePacking GetTexturePacking() const;
+	ShaderFeatures GetTexturePackingFeatures() const;
+
+	/*
+	 * Get all (unique) textures of the model
+	 */
+	const std::vector<Texture> & GetTextures() const;
+
+	/*
+	 * Get meshes with their CPU side vertex data (e.g. for occluder rasterization)
+	 */
+	const std::vector<Mesh> & GetMeshes() const;
+
+	/*
+	 * Skeletal animation data (see Animation.h); a Model is skinned
+	 * if any of its meshes has bones
+	 */
+	bool IsSkinned() const;
+	const Skeleton & GetSkeleton() const;
+	const std::vector<AnimationClip> & GetAnimations() const;
+	// Index of the clip, -1 if there is none
+	int FindAnimation(const std::string & name) const;
+
+	/*
+	 * Node hierarchy of the file (the Skeleton's nodes): a mesh is placed by the
+	 * transforms of its node and all ancestors. Models which meshes all sit at
+	 * the origin (true for most single object files) don't have node transforms,
+	 * their meshes are drawn with the model matrix alone.
+	 */
+	bool HasNodeTransforms() const;
+	// Local transform of a node (relative to its parent) in the file
+	const glm::mat4 & GetNodeTransform(int node) const;
+	int GetMeshNode(size_t mesh) const;
+
+	/*
+	 * Get axis aligned bounding box of all meshes in model space
+	 * (with node transforms of the file, bind pose of skinned meshes)
+	 */
+	void GetBounds(glm::vec3 & min, glm::vec3 & max) const;
+	// Bounding box of one mesh in the space of its node
+	void GetMeshBounds(size_t mesh, glm::vec3 & min, glm::vec3 & max) const;
+
+	/*
+	 * Number of threads decoding textures (and building their mips) while
+	 * Models load, 0 for one per hardware thread (default), 1 to decode on
+	 * the loading thread. Only uploads run on the thread with the GL context.
+	 */
+	static void SetTextureLoadThreads(unsigned threads);
+
 private:
 
 	/*
@@ -68,22 +182,49 @@ private:
 	 */
 	void loadModel(std::string path);
 
+	/*
+	 * Fill the node space boxes of all meshes from their vertices
+	 */
+	void computeMeshBounds();
+
 	/*
 	 * Process Assimp's node:
 	 * - check if there are any meshes, and if so, process them
+	 *   (remember their node, parentTransform places the node in model space)
 	 * - check if this node is a parent node for another node
+	 * nodeIndex counts nodes in the order of buildSkeleton()
+	 */
+	void processNode(aiNode* node, const aiScene* scene, const glm::mat4 & parentTransform, int & nodeIndex);
+
+	/*
+	 * Flatten the Assimp's node hierarchy into the skeleton (parent first)
+	 * and convert its animations to clips
 	 */
-	void processNode(aiNode* node, const aiScene* scene);
+	void buildSkeleton(aiNode* node, int parent);
+	void loadAnimations(const aiScene* scene);
 
 	/*
 	 * Process Assimp's mesh:
 	 * - extract all vertices -- position, normal, texture coordinates
 	 *   (there are more provided from Assimp, but for now only those three are used)
+	 * - extract bone weights of skinned meshes (at most MAX_BONE_INFLUENCES per vertex)
 	 * - extract all indices from a mesh
 	 * - get all textures categorized by a texture type
 	 *   (here, only DIFFUESE and SPECULAR, but there are more)
 	 */
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene);
+	Mesh processMesh(aiMesh* mesh, const aiScene* scene, const glm::mat4 & transform);
+
+	/*
+	 * Decode all textures of the model's materials in parallel, then upload
+	 * them in order and store them in textures_loaded
+	 */
+	void loadTextures(const aiScene* scene);
+
+	/*
+	 * Upload decoded textures grouped by layout as texture arrays
+	 * and point pending textures at their array and layer
+	 */
+	void packTextureArrays(std::vector<Texture> & pending, const std::vector<DecodedTexture> & decoded, const std::vector<char> & ok);
 
 	/*
 	 * Extract all of textures by a given TYPE and return them as an array
@@ -95,6 +236,26 @@ private:
 	std::vector<Mesh> meshes;
 	std::vector<Texture> textures_loaded;
 	std::string directory;
+	std::shared_ptr<TextureStreamer> streamer;
+	TexturePacking packing;
+	std::vector<GLuint> textureArrays;
+
+	// model space bounding box, node space box of every mesh
+	glm::vec3 boundsMin, boundsMax;
+	std::vector<glm::vec3> meshBoundsMin, meshBoundsMax;
+
+	Skeleton skeleton;
+	std::vector<AnimationClip> animations;
+	bool skinned;
+
+	// Local transform of every node, node of every mesh
+	std::vector<glm::mat4> nodeTransforms;
+	std::vector<int> meshNodes;
+	bool nodeHierarchy;
+
+	// Workers shared by all Models, created on first use
+	static unsigned textureLoadThreads;
+	static std::unique_ptr<ThreadPool> texturePool;
 };
 } // namespace CGL
 
@@ -0,0 +1,178 @@
+#include "OcclusionBuffer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CGL_OCCLUSION_SSE2
+#endif
+
+namespace CGL {
+
+namespace {
+	// Vertices closer than that (clip w) aren't projected, their triangles are skipped
+	const float MIN_W = 1e-4f;
+}
+
+/* Ctor & Dtor */
+OcclusionBuffer::OcclusionBuffer(int width, int height) {
+	this->width = std::max(4, (width + 3) & ~3);
+	this->height = std::max(1, height);
+
+	int levelWidth = this->width, levelHeight = this->height;
+	while(true) {
+		levels.push_back(Level{levelWidth, levelHeight, std::vector<float>((size_t)levelWidth * levelHeight, FLT_MAX)});
+		if(levelWidth == 1 && levelHeight == 1) break;
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+}
+/* Ctor & Dtor */
+/* Public Methods */
+void OcclusionBuffer::Clear(const glm::mat4 & viewProjection) {
+	this->viewProjection = viewProjection;
+	for(Level & level : levels)
+		std::fill(level.depth.begin(), level.depth.end(), FLT_MAX);
+}
+
+void OcclusionBuffer::RasterizeMesh(const Mesh & mesh, const glm::mat4 & modelMatrix) {
+	glm::mat4 mvp = viewProjection * modelMatrix;
+	clipVertices.resize(mesh.vertices.size());
+	for(size_t i = 0; i < mesh.vertices.size(); i++)
+		clipVertices[i] = mvp * glm::vec4(mesh.vertices[i].Position, 1.f);
+
+	for(size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		rasterizeTriangle(clipVertices[mesh.indices[i]], clipVertices[mesh.indices[i + 1]], clipVertices[mesh.indices[i + 2]]);
+}
+
+void OcclusionBuffer::BuildPyramid() {
+	for(size_t l = 1; l < levels.size(); l++) {
+		const Level & source = levels[l - 1];
+		Level & target = levels[l];
+		for(int y = 0; y < target.height; y++) {
+			int y0 = 2 * y, y1 = std::min(2 * y + 1, source.height - 1);
+			for(int x = 0; x < target.width; x++) {
+				int x0 = 2 * x, x1 = std::min(2 * x + 1, source.width - 1);
+				target.depth[(size_t)y * target.width + x] = std::max(
+						std::max(source.depth[(size_t)y0 * source.width + x0], source.depth[(size_t)y0 * source.width + x1]),
+						std::max(source.depth[(size_t)y1 * source.width + x0], source.depth[(size_t)y1 * source.width + x1]));
+			}
+		}
+	}
+}
+
+bool OcclusionBuffer::IsOccluded(glm::vec3 min, glm::vec3 max) const {
+	// Screen rectangle and the nearest depth of the box
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX, nearest = FLT_MAX;
+	for(int corner = 0; corner < 8; corner++) {
+		glm::vec4 clip = viewProjection * glm::vec4(
+				corner & 1 ? max.x : min.x,
+				corner & 2 ? max.y : min.y,
+				corner & 4 ? max.z : min.z, 1.f);
+		if(clip.w < MIN_W) return false;
+		float x = (clip.x / clip.w * .5f + .5f) * (float)width;
+		float y = (clip.y / clip.w * .5f + .5f) * (float)height;
+		minX = std::min(minX, x); maxX = std::max(maxX, x);
+		minY = std::min(minY, y); maxY = std::max(maxY, y);
+		nearest = std::min(nearest, clip.w);
+	}
+
+	// Every texel the rectangle touches
+	int x0 = std::max(0, (int)std::floor(minX)), x1 = std::min(width - 1, (int)std::ceil(maxX) - 1);
+	int y0 = std::max(0, (int)std::floor(minY)), y1 = std::min(height - 1, (int)std::ceil(maxY) - 1);
+	if(x0 > x1 || y0 > y1) return false;
+
+	// Coarsest useful level: the rectangle spans at most 4 texels per axis there
+	size_t l = 0;
+	while(l + 1 < levels.size() && ((x1 >> l) - (x0 >> l) >= 4 || (y1 >> l) - (y0 >> l) >= 4))
+		l++;
+
+	const Level & level = levels[l];
+	for(int y = y0 >> l; y <= y1 >> l; y++)
+		for(int x = x0 >> l; x <= x1 >> l; x++)
+			if(level.depth[(size_t)y * level.width + x] >= nearest) return false;
+	return true;
+}
+
+int OcclusionBuffer::GetWidth() const {
+	return width;
+}
+
+int OcclusionBuffer::GetHeight() const {
+	return height;
+}
+/* Public Methods */
+/* Private Methods */
+void OcclusionBuffer::rasterizeTriangle(const glm::vec4 & a, const glm::vec4 & b, const glm::vec4 & c) {
+	// Triangles crossing the near plane are left out (fewer occluders, never wrong results)
+	if(a.w < MIN_W || b.w < MIN_W || c.w < MIN_W) return;
+
+	glm::vec2 v[3] = {
+		glm::vec2((a.x / a.w * .5f + .5f) * (float)width, (a.y / a.w * .5f + .5f) * (float)height),
+		glm::vec2((b.x / b.w * .5f + .5f) * (float)width, (b.y / b.w * .5f + .5f) * (float)height),
+		glm::vec2((c.x / c.w * .5f + .5f) * (float)width, (c.y / c.w * .5f + .5f) * (float)height),
+	};
+	// The whole triangle counts as far as its farthest vertex
+	float depth = std::max(a.w, std::max(b.w, c.w));
+
+	// Edge functions E(x, y) = A*x + B*y + C, positive inside for both windings
+	float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+	if(area == 0.f) return;
+	float sign = area > 0.f ? 1.f : -1.f;
+	float A[3], B[3], C[3];
+	for(int i = 0; i < 3; i++) {
+		const glm::vec2 & from = v[i];
+		const glm::vec2 & to = v[(i + 1) % 3];
+		A[i] = sign * (from.y - to.y);
+		B[i] = sign * (to.x - from.x);
+		C[i] = -A[i] * from.x - B[i] * from.y;
+	}
+
+	// Pixel centers inside the bounding rectangle
+	int x0 = std::max(0, (int)std::floor(std::min(v[0].x, std::min(v[1].x, v[2].x))));
+	int x1 = std::min(width - 1, (int)std::ceil(std::max(v[0].x, std::max(v[1].x, v[2].x))));
+	int y0 = std::max(0, (int)std::floor(std::min(v[0].y, std::min(v[1].y, v[2].y))));
+	int y1 = std::min(height - 1, (int)std::ceil(std::max(v[0].y, std::max(v[1].y, v[2].y))));
+	if(x0 > x1 || y0 > y1) return;
+
+	std::vector<float> & buffer = levels[0].depth;
+#ifdef CGL_OCCLUSION_SSE2
+	// 4 pixels at a time, the width is a multiple of 4
+	x0 &= ~3;
+	__m128 depths = _mm_set1_ps(depth);
+	__m128 zero = _mm_setzero_ps();
+	__m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, .5f);
+	for(int y = y0; y <= y1; y++) {
+		float py = (float)y + .5f;
+		__m128 rows[3], steps[3];
+		for(int i = 0; i < 3; i++) {
+			rows[i] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A[i]), _mm_add_ps(_mm_set1_ps((float)x0), offsets)), _mm_set1_ps(B[i] * py + C[i]));
+			steps[i] = _mm_set1_ps(4.f * A[i]);
+		}
+		float * row = &buffer[(size_t)y * width];
+		for(int x = x0; x <= x1; x += 4) {
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(rows[0], zero), _mm_cmpge_ps(rows[1], zero)), _mm_cmpge_ps(rows[2], zero));
+			if(_mm_movemask_ps(inside)) {
+				__m128 old = _mm_loadu_ps(row + x);
+				__m128 nearer = _mm_min_ps(old, depths);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+			}
+			for(int i = 0; i < 3; i++) rows[i] = _mm_add_ps(rows[i], steps[i]);
+		}
+	}
+#else
+	for(int y = y0; y <= y1; y++) {
+		float py = (float)y + .5f;
+		float * row = &buffer[(size_t)y * width];
+		for(int x = x0; x <= x1; x++) {
+			float px = (float)x + .5f;
+			if(A[0] * px + B[0] * py + C[0] >= 0.f && A[1] * px + B[1] * py + C[1] >= 0.f && A[2] * px + B[2] * py + C[2] >= 0.f)
+				row[x] = std::min(row[x], depth);
+		}
+	}
+#endif
+}
+/* Private Methods */
+} /* namespace CGL */
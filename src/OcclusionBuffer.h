@@ -0,0 +1,76 @@
+/*
+ * OcclusionBuffer is a small CPU depth buffer for occlusion culling:
+ * - triangles of designated occluders (big, simple meshes: walls, buildings, terrain)
+ *   are rasterized into it, SSE2 accelerated, each at its farthest depth
+ * - a max depth pyramid (Hierarchical-Z) is built from it
+ * - bounding boxes are tested against the pyramid level where they cover a few texels;
+ *   a box is occluded when it's behind the occluders at all of them
+ * Depth is the clip space w (view space distance), so it works the same for
+ * standard, reverse-Z and infinite projections. Boxes crossing the near plane
+ * are never occluded.
+ */
+
+#ifndef OCCLUSIONBUFFER_H_
+#define OCCLUSIONBUFFER_H_
+
+#include "Mesh.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace CGL {
+
+class OcclusionBuffer {
+public:
+	/*
+	 * Resolution of the buffer (width is rounded up to a multiple of 4)
+	 */
+	OcclusionBuffer(int width=256, int height=128);
+
+	/*
+	 * Forget all occluders and set the view-projection of the new frame
+	 */
+	void Clear(const glm::mat4 & viewProjection);
+
+	/*
+	 * Rasterize triangles (indexed vertices) transformed by the model matrix
+	 */
+	void RasterizeMesh(const Mesh & mesh, const glm::mat4 & modelMatrix);
+
+	/*
+	 * Build the depth pyramid; call after all occluders are rasterized
+	 */
+	void BuildPyramid();
+
+	/*
+	 * True if the world space box is entirely hidden behind the occluders
+	 */
+	bool IsOccluded(glm::vec3 min, glm::vec3 max) const;
+
+	int GetWidth() const;
+	int GetHeight() const;
+
+private:
+	int width, height;
+	glm::mat4 viewProjection;
+
+	/*
+	 * levels[0] is the rasterized buffer, every next level holds the farthest
+	 * depth of 2x2 texels below (FLT_MAX where there is no occluder)
+	 */
+	struct Level {
+		int width, height;
+		std::vector<float> depth;
+	};
+	std::vector<Level> levels;
+
+	// Clip space vertices of the mesh being rasterized
+	std::vector<glm::vec4> clipVertices;
+
+	void rasterizeTriangle(const glm::vec4 & a, const glm::vec4 & b, const glm::vec4 & c);
+};
+
+} /* namespace CGL */
+
+#endif /* OCCLUSIONBUFFER_H_ */
@@ -0,0 +1,102 @@
+#include "PrimitiveMesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace CGL {
+
+namespace {
+	/*
+	 * Grid of segments x segments quads at center spanning -1..1 along u and v,
+	 * counter-clockwise seen from the side u x v points to
+	 */
+	void appendGrid(int segments, glm::vec3 center, glm::vec3 u, glm::vec3 v,
+			std::vector<Vertex> & vertices, std::vector<unsigned int> & indices) {
+		glm::vec3 normal = glm::cross(u, v);
+		unsigned int base = (unsigned int)vertices.size();
+		for(int j = 0; j <= segments; j++) {
+			for(int i = 0; i <= segments; i++) {
+				float s = (float)i / (float)segments, t = (float)j / (float)segments;
+				Vertex vertex;
+				vertex.Position = center + (2.f * s - 1.f) * u + (2.f * t - 1.f) * v;
+				vertex.Normal = normal;
+				vertex.TexCoords = glm::vec2(s, t);
+				vertices.push_back(vertex);
+			}
+		}
+		unsigned int row = (unsigned int)segments + 1;
+		for(unsigned int j = 0; j < (unsigned int)segments; j++) {
+			for(unsigned int i = 0; i < (unsigned int)segments; i++) {
+				unsigned int corner = base + j * row + i;
+				indices.insert(indices.end(), { corner, corner + 1, corner + row + 1 });
+				indices.insert(indices.end(), { corner, corner + row + 1, corner + row });
+			}
+		}
+	}
+}
+
+void GeneratePlane(int segments, std::vector<Vertex> & vertices, std::vector<unsigned int> & indices) {
+	segments = std::max(segments, 1);
+	appendGrid(segments, glm::vec3(0.f), glm::vec3(1.f, 0.f, 0.f), glm::vec3(0.f, 0.f, -1.f), vertices, indices);
+}
+
+void GenerateBox(int segments, std::vector<Vertex> & vertices, std::vector<unsigned int> & indices) {
+	segments = std::max(segments, 1);
+	// v = normal x u, which is +Y on the side faces
+	const glm::vec3 normals[6] = {
+		glm::vec3(1.f, 0.f, 0.f), glm::vec3(-1.f, 0.f, 0.f),
+		glm::vec3(0.f, 1.f, 0.f), glm::vec3(0.f, -1.f, 0.f),
+		glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 0.f, -1.f),
+	};
+	const glm::vec3 us[6] = {
+		glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 0.f, 1.f),
+		glm::vec3(1.f, 0.f, 0.f), glm::vec3(1.f, 0.f, 0.f),
+		glm::vec3(1.f, 0.f, 0.f), glm::vec3(-1.f, 0.f, 0.f),
+	};
+	for(int face = 0; face < 6; face++)
+		appendGrid(segments, normals[face], us[face], glm::cross(normals[face], us[face]), vertices, indices);
+}
+
+void GenerateSphere(int segments, std::vector<Vertex> & vertices, std::vector<unsigned int> & indices) {
+	const float pi = 3.14159265358979f;
+	unsigned int stacks = (unsigned int)std::max(segments, 2), slices = 2 * stacks;
+
+	// Rows from the north pole down; the seam and the poles have a vertex per slice
+	unsigned int base = (unsigned int)vertices.size();
+	for(unsigned int i = 0; i <= stacks; i++) {
+		float theta = pi * (float)i / (float)stacks;
+		for(unsigned int j = 0; j <= slices; j++) {
+			float phi = 2.f * pi * (float)j / (float)slices;
+			Vertex vertex;
+			vertex.Normal = glm::vec3(std::sin(theta) * std::sin(phi), std::cos(theta), std::sin(theta) * std::cos(phi));
+			vertex.Position = vertex.Normal;
+			vertex.TexCoords = glm::vec2((float)j / (float)slices, 1.f - (float)i / (float)stacks);
+			vertices.push_back(vertex);
+		}
+	}
+	unsigned int row = slices + 1;
+	for(unsigned int i = 0; i < stacks; i++) {
+		for(unsigned int j = 0; j < slices; j++) {
+			unsigned int corner = base + i * row + j;
+			// Triangles touching a pole would be degenerate
+			if(i != stacks - 1) indices.insert(indices.end(), { corner, corner + row, corner + row + 1 });
+			if(i != 0) indices.insert(indices.end(), { corner, corner + row + 1, corner + 1 });
+		}
+	}
+}
+
+std::shared_ptr<Model> CreatePrimitiveModel(std::string name, Shape shape, int segments) {
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	switch(shape) {
+	case Shape::PLANE: GeneratePlane(segments, vertices, indices); break;
+	case Shape::BOX: GenerateBox(segments, vertices, indices); break;
+	case Shape::SPHERE: GenerateSphere(segments, vertices, indices); break;
+	}
+
+	std::vector<Mesh> meshes;
+	meshes.push_back(Mesh(vertices, indices, std::vector<Texture>()));
+	return std::make_shared<Model>(name, meshes);
+}
+
+} /* namespace CGL */
@@ -0,0 +1,38 @@
+/*
+ * Built-in render meshes of PrimitiveShape types, generated in code instead of
+ * loaded with Assimp:
+ * - unit sized: PLANE is a 2x2 square in XZ facing +Y, BOX a cube of half extents 1,
+ *   SPHERE a UV sphere of radius 1; PrimitiveShape::GetMeshMatrix() fits them to a body
+ * - segments split every face of a plane or box into segments x segments quads,
+ *   a sphere into 2 * segments slices and segments stacks
+ * - texture coordinates span 0..1 over every face (over the whole sphere), no textures
+ * The Scene creates one Model per type and tessellation and shares it between Actors.
+ */
+
+#ifndef PRIMITIVEMESH_H_
+#define PRIMITIVEMESH_H_
+
+#include "Model.h"
+#include "PrimitiveShape.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace CGL {
+
+/*
+ * Append the geometry of a unit primitive to vertices and indices
+ */
+void GeneratePlane(int segments, std::vector<Vertex> & vertices, std::vector<unsigned int> & indices);
+void GenerateBox(int segments, std::vector<Vertex> & vertices, std::vector<unsigned int> & indices);
+void GenerateSphere(int segments, std::vector<Vertex> & vertices, std::vector<unsigned int> & indices);
+
+/*
+ * Model of one mesh of the given type (needs the OpenGL context)
+ */
+std::shared_ptr<Model> CreatePrimitiveModel(std::string name, Shape shape, int segments);
+
+} /* namespace CGL */
+
+#endif /* PRIMITIVEMESH_H_ */
@@ -1,5 +1,9 @@
 #include "PrimitiveShape.h"
 
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
 namespace CGL {
 /* Ctor & Dtor */
 PrimitiveShape::PrimitiveShape(std::string name, Shape shape) {
@@ -9,10 +13,13 @@ PrimitiveShape::PrimitiveShape(std::string name, Shape shape) {
 	// Physics body configuration
 	type = shape;
 	body = nullptr;
+	meshMatrix = glm::mat4(1.f);
+	sleeping = false;
+	activationChanged = false;
 } /* PrimitiveShape::PrimitiveShape(std::string name, Shape shape) */
 /* Ctor & Dtor */
 /* Public Methods */
-void PrimitiveShape::SetupPlane(btDiscreteDynamicsWorld * dynamicWorld, glm::mat4 initialModelMatrix, btVector3 planeNormal, btScalar planeConstnt) {
+void PrimitiveShape::SetupPlane(btDiscreteDynamicsWorld * dynamicWorld, glm::mat4 initialModelMatrix, btVector3 planeNormal, btScalar planeConstnt, btScalar renderHalfSize) {
 	if(type != Shape::PLANE) {
 		std::cout << "CGL::WARNING::PRIMITIVESHAPE::SETUPPLANE() This shape is NOT A PLANE, it cant't be setup like one\n";
 		return;
@@ -21,6 +28,15 @@ void PrimitiveShape::SetupPlane(btDiscreteDynamicsWorld * dynamicWorld, glm::mat
 	// Shape
 	btCollisionShape * bulletShape = new btStaticPlaneShape(planeNormal, planeConstnt);
 
+	// Mesh: +Y of the unit plane turned to the normal, X and Z in the plane
+	glm::vec3 normal = glm::normalize(glm::vec3(planeNormal.x(), planeNormal.y(), planeNormal.z()));
+	glm::vec3 axis = std::abs(normal.z) < .9f ? glm::vec3(0.f, 0.f, 1.f) : glm::vec3(1.f, 0.f, 0.f);
+	glm::vec3 tangent = glm::normalize(glm::cross(normal, axis));
+	glm::vec3 bitangent = glm::cross(tangent, normal);
+	glm::mat4 orientation(glm::vec4(tangent, 0.f), glm::vec4(normal, 0.f), glm::vec4(bitangent, 0.f),
+			glm::vec4(normal * (float)planeConstnt, 1.f));
+	meshMatrix = glm::scale(orientation, glm::vec3((float)renderHalfSize, 1.f, (float)renderHalfSize));
+
 	// Rigid body setup
 	setupRigidBody(dynamicWorld, bulletShape, initialModelMatrix, 0.f);
 } /* PrimitiveShape::SetupPlane(btDiscreteDynamicsWorld * dynamicWorld, glm::mat4 initialModelMatrix, btVector3 planeNormal, btScalar planeConstnt) */
@@ -33,6 +49,7 @@ void PrimitiveShape::SetupBox(btDiscreteDynamicsWorld * dynamicWorld, glm::mat4
 
 	// Shape
 	btCollisionShape * bulletShape = new btBoxShape(boxDimensions);
+	meshMatrix = glm::scale(glm::mat4(1.f), glm::vec3(boxDimensions.x(), boxDimensions.y(), boxDimensions.z()));
 
 	// Rigid body setup
 	setupRigidBody(dynamicWorld, bulletShape, initialModelMatrix, mass);
@@ -46,6 +63,7 @@ void PrimitiveShape::SetupSpeher(btDiscreteDynamicsWorld * dynamicWorld, glm::ma
 
 	// Shape
 	btCollisionShape * bulletShape = new btSphereShape(sphereRadius);
+	meshMatrix = glm::scale(glm::mat4(1.f), glm::vec3((float)sphereRadius));
 
 	// Rigid body setup
 	setupRigidBody(dynamicWorld, bulletShape, initialModelMatrix, mass);
@@ -63,9 +81,64 @@ glm::mat4 PrimitiveShape::GetModelMatrix() const {
 	return modelMatrix;
 } /* PrimitiveShape::GetModelMatrix(glm::mat4 & matrix) */
 
+glm::mat4 PrimitiveShape::GetMeshMatrix() const {
+	return meshMatrix;
+} /* PrimitiveShape::GetMeshMatrix() const */
+
+Shape PrimitiveShape::GetShapeType() const {
+	return type;
+} /* PrimitiveShape::GetShapeType() const */
+
+btRigidBody * PrimitiveShape::GetRigidBody() const {
+	return body;
+} /* PrimitiveShape::GetRigidBody() const */
+
 void PrimitiveShape::SetLinearVelocity(btVector3 vector, btScalar value) {
+	// A sleeping body ignores velocity changes until it is activated
+	body->activate(true);
 	body->setLinearVelocity(value*vector);
 } /* PrimitiveShape::SetLinearVelocity(btVector3 vector, btScalar value) */
+
+void PrimitiveShape::SetDeactivationThresholds(btScalar linearThreshold, btScalar angularThreshold) {
+	if(!body) {
+		std::cout << "CGL::WARNING::PRIMITIVESHAPE::SETDEACTIVATIONTHRESHOLDS() Shape " << GetName() << " has no rigid body set up yet\n";
+		return;
+	}
+	body->setSleepingThresholds(linearThreshold, angularThreshold);
+} /* PrimitiveShape::SetDeactivationThresholds(btScalar linearThreshold, btScalar angularThreshold) */
+
+void PrimitiveShape::SetDeactivationEnabled(bool enabled) {
+	if(!body) {
+		std::cout << "CGL::WARNING::PRIMITIVESHAPE::SETDEACTIVATIONENABLED() Shape " << GetName() << " has no rigid body set up yet\n";
+		return;
+	}
+	if(body->isStaticObject()) return;
+	body->forceActivationState(enabled ? ACTIVE_TAG : DISABLE_DEACTIVATION);
+	body->activate(true);
+} /* PrimitiveShape::SetDeactivationEnabled(bool enabled) */
+
+void PrimitiveShape::Activate() {
+	if(body && !body->isStaticObject()) body->activate(true);
+} /* PrimitiveShape::Activate() */
+
+bool PrimitiveShape::IsSleeping() const {
+	return sleeping;
+} /* PrimitiveShape::IsSleeping() const */
+
+bool PrimitiveShape::IsStatic() const {
+	return body && body->isStaticObject();
+} /* PrimitiveShape::IsStatic() const */
+
+bool PrimitiveShape::UpdateActivationState() {
+	bool nowSleeping = !body || body->getActivationState() == ISLAND_SLEEPING;
+	activationChanged = nowSleeping != sleeping;
+	sleeping = nowSleeping;
+	return activationChanged;
+} /* PrimitiveShape::UpdateActivationState() */
+
+bool PrimitiveShape::NeedsTransformSync() const {
+	return !sleeping || activationChanged;
+} /* PrimitiveShape::NeedsTransformSync() const */
 /* Public Methods */
 /* Private Methods */
 void PrimitiveShape::setupRigidBody(btDiscreteDynamicsWorld * dynamicWorld, btCollisionShape * bulletShape, glm::mat4 initialModelMatrix, btScalar mass) {
@@ -87,6 +160,11 @@ void PrimitiveShape::setupRigidBody(btDiscreteDynamicsWorld * dynamicWorld, btCo
 
 	// Add to the dynamic world
 	dynamicWorld->addRigidBody(body);
+
+	// Static bodies are put to sleep by the world right away
+	sleeping = false;
+	UpdateActivationState();
+	activationChanged = true;
 } /* PrimitiveShape::setupRigidBody(btDiscreteDynamicsWorld * dynamicWorld) */
 /* Private Methods */
 } /* namespace CGL */
@@ -36,8 +36,9 @@ public:
 
 	/*
 	 * Setup a PLANE (Only static for now)
+	 * The body is infinite, its built-in mesh is a square of renderHalfSize
 	 */
-	void SetupPlane(btDiscreteDynamicsWorld * dynamicWorld, glm::mat4 initialModelMatrix, btVector3 planeNormal, btScalar planeConstnt);
+	void SetupPlane(btDiscreteDynamicsWorld * dynamicWorld, glm::mat4 initialModelMatrix, btVector3 planeNormal, btScalar planeConstnt, btScalar renderHalfSize=50.f);
 
 	/*
 	 * Setup a BOX
@@ -60,13 +61,54 @@ public:
 	glm::mat4 GetModelMatrix() const;
 
 	/*
-	 * Set linear velocity of a body
+	 * Transform of the built-in unit mesh of the shape's type (see PrimitiveMesh.h)
+	 * in the body's space: scale of a box or sphere, orientation and offset of a plane
+	 */
+	glm::mat4 GetMeshMatrix() const;
+	Shape GetShapeType() const;
+
+	/*
+	 * Set linear velocity of a body (wakes the body up if it was sleeping)
 	 */
 	void SetLinearVelocity(btVector3 vector, btScalar value);
 
+	/*
+	 * Deactivation (sleeping) control
+	 * Bullet puts a body to sleep when both its linear and angular velocities
+	 * stay below the thresholds for a while (Bullet's defaults are .8 and 1.0).
+	 * Disabling deactivation keeps the body simulated all the time.
+	 */
+	void SetDeactivationThresholds(btScalar linearThreshold, btScalar angularThreshold);
+	void SetDeactivationEnabled(bool enabled);
+	void Activate();
+
+	/*
+	 * Body is sleeping when Bullet has deactivated its island
+	 * (static bodies are always reported as sleeping)
+	 */
+	bool IsSleeping() const;
+	bool IsStatic() const;
+
+	/*
+	 * Refresh cached activation state after a simulation step
+	 * Return true if the body has fallen asleep or woken up since the last call
+	 */
+	bool UpdateActivationState();
+
+	/*
+	 * True if the body moved during the last step, i.e. it's awake
+	 * or it has just fallen asleep and its final transform wasn't fetched yet
+	 */
+	bool NeedsTransformSync() const;
+
 private:
 	Shape type;
 	btRigidBody * body;
+	glm::mat4 meshMatrix;
+
+	// Activation state cached by UpdateActivationState()
+	bool sleeping;
+	bool activationChanged;
 
 	void setupRigidBody(btDiscreteDynamicsWorld * dynamicWorld, btCollisionShape * bulletShape, glm::mat4 initialModelMatrix, btScalar mass);
 
@@ -0,0 +1,270 @@
+#include "Profiler.h"
+
+namespace CGL {
+
+std::atomic<Profiler*> Profiler::current(nullptr);
+
+/* Ctor & Dtor */
+Profiler::Profiler(size_t eventCapacity, size_t frameCapacity) {
+	enabled = true;
+	gpuEnabled = false;
+	gpuScopeOpen = false;
+	origin = std::chrono::steady_clock::now();
+	frame = 0;
+	frameStart = 0.0;
+
+	this->eventCapacity = eventCapacity > 0 ? eventCapacity : 1;
+	this->frameCapacity = frameCapacity > 0 ? frameCapacity : 1;
+	eventNext = frameNext = 0;
+	events.reserve(this->eventCapacity);
+	frames.reserve(this->frameCapacity);
+
+	gpuQueriesCreated = false;
+	for(auto & gpuFrame : gpuFrames) {
+		gpuFrame.frame = 0;
+		gpuFrame.used = 0;
+	}
+
+	// Counts before the first frame (e.g. loading) go to the first Profiler
+	resetCounters();
+	Profiler * none = nullptr;
+	current.compare_exchange_strong(none, this);
+}
+
+Profiler::~Profiler() {
+	Profiler * self = this;
+	current.compare_exchange_strong(self, nullptr);
+	if(!gpuQueriesCreated) return;
+	for(auto & gpuFrame : gpuFrames)
+		for(auto & query : gpuFrame.queries)
+			glDeleteQueries(1, &query.query);
+}
+/* Ctor & Dtor */
+/* Public Methods */
+void Profiler::SetEnabled(bool enabled) {
+	this->enabled = enabled;
+}
+
+void Profiler::SetGpuTimingEnabled(bool enabled) {
+	gpuEnabled = enabled;
+}
+
+bool Profiler::IsEnabled() const {
+	return enabled;
+}
+
+void Profiler::BeginFrame() {
+	frameStart = now();
+	scopes.clear();
+	current = this;
+
+	// Reuse query slot of the frame GPU_FRAME_LATENCY frames ago, collect its results first
+	GpuFrame & gpuFrame = gpuFrames[frame % GPU_FRAME_LATENCY];
+	if(gpuFrame.used > 0) collectGpuFrame(gpuFrame);
+	gpuFrame.frame = frame;
+	gpuFrame.used = 0;
+} /* Profiler::BeginFrame() */
+
+void Profiler::EndFrame() {
+	if(gpuScopeOpen) EndGpuScope();
+	while(!scopes.empty()) EndScope();
+
+	FrameRecord record;
+	record.frame = frame;
+	record.start = frameStart;
+	record.cpuTime = (now() - frameStart) / 1000.0;
+	record.gpuTime = 0.0;
+	record.counters = GetCurrentCounters();
+
+	if(frames.size() < frameCapacity) frames.push_back(record);
+	else frames[frameNext] = record;
+	frameNext = (frameNext + 1) % frameCapacity;
+
+	resetCounters();
+	frame++;
+} /* Profiler::EndFrame() */
+
+void Profiler::BeginScope(const char * name) {
+	if(!enabled) return;
+	OpenScope scope;
+	scope.name = name;
+	scope.start = now();
+	scopes.push_back(scope);
+} /* Profiler::BeginScope(const char * name) */
+
+void Profiler::EndScope() {
+	if(!enabled || scopes.empty()) return;
+	OpenScope scope = scopes.back();
+	scopes.pop_back();
+
+	ProfileEvent event;
+	event.name = scope.name;
+	event.start = scope.start;
+	event.duration = now() - scope.start;
+	event.frame = frame;
+	event.depth = (unsigned short)scopes.size();
+	event.gpu = false;
+	pushEvent(event);
+} /* Profiler::EndScope() */
+
+void Profiler::BeginGpuScope(const char * name) {
+	if(!enabled || !gpuEnabled) return;
+	if(gpuScopeOpen) {
+		std::cout << "CGL::WARNING::PROFILER::BEGINGPUSCOPE() GPU scopes can't be nested, " << name << " ignored\n";
+		return;
+	}
+
+	if(!gpuQueriesCreated) {
+		for(auto & gpuFrame : gpuFrames)
+			for(auto & query : gpuFrame.queries)
+				glGenQueries(1, &query.query);
+		gpuQueriesCreated = true;
+	}
+
+	GpuFrame & gpuFrame = gpuFrames[frame % GPU_FRAME_LATENCY];
+	if(gpuFrame.used >= GPU_QUERIES_PER_FRAME) return;
+
+	GpuQuery & query = gpuFrame.queries[gpuFrame.used];
+	query.name = name;
+	query.start = now();
+	glBeginQuery(GL_TIME_ELAPSED, query.query);
+	gpuScopeOpen = true;
+} /* Profiler::BeginGpuScope(const char * name) */
+
+void Profiler::EndGpuScope() {
+	if(!gpuScopeOpen) return;
+	glEndQuery(GL_TIME_ELAPSED);
+	gpuFrames[frame % GPU_FRAME_LATENCY].used++;
+	gpuScopeOpen = false;
+} /* Profiler::EndGpuScope() */
+
+void Profiler::CountDrawCall(unsigned long long triangles) {
+	Profiler * profiler = current.load(std::memory_order_relaxed); if(!profiler) return;
+	profiler->counters.drawCalls.fetch_add(1, std::memory_order_relaxed);
+	profiler->counters.triangles.fetch_add(triangles, std::memory_order_relaxed);
+}
+
+void Profiler::CountStateChange() {
+	Profiler * profiler = current.load(std::memory_order_relaxed); if(!profiler) return;
+	profiler->counters.stateChanges.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Profiler::CountUpload(unsigned long long bytes) {
+	Profiler * profiler = current.load(std::memory_order_relaxed); if(!profiler) return;
+	profiler->counters.uploads.fetch_add(1, std::memory_order_relaxed);
+	profiler->counters.uploadBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+FrameCounters Profiler::GetCurrentCounters() const {
+	FrameCounters result;
+	result.drawCalls = counters.drawCalls.load(std::memory_order_relaxed);
+	result.triangles = counters.triangles.load(std::memory_order_relaxed);
+	result.stateChanges = counters.stateChanges.load(std::memory_order_relaxed);
+	result.uploads = counters.uploads.load(std::memory_order_relaxed);
+	result.uploadBytes = counters.uploadBytes.load(std::memory_order_relaxed);
+	return result;
+}
+
+std::vector<FrameRecord> Profiler::GetFrameRecords() const {
+	return unroll(frames, frameNext, frameCapacity);
+}
+
+std::vector<ProfileEvent> Profiler::GetEvents() const {
+	return unroll(events, eventNext, eventCapacity);
+}
+
+bool Profiler::DumpChromeTrace(std::string path) const {
+	std::ofstream file(path);
+	if(!file) {
+		std::cout << "CGL::ERROR::PROFILER::DUMPCHROMETRACE() Could not open file " << path << std::endl;
+		return false;
+	}
+
+	// Trace Event Format: complete events ("X") for scopes, counter events ("C") for frames
+	// CPU scopes go to thread 0, GPU scopes to thread 1
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"CPU\"}},\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+
+	for(auto & event : GetEvents())
+		file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu")
+			<< "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << (event.gpu ? 1 : 0)
+			<< ",\"ts\":" << event.start << ",\"dur\":" << event.duration
+			<< ",\"args\":{\"frame\":" << event.frame << "}}";
+
+	for(auto & record : GetFrameRecords())
+		file << ",\n{\"name\":\"counters\",\"ph\":\"C\",\"pid\":0,\"ts\":" << record.start
+			<< ",\"args\":{\"drawCalls\":" << record.counters.drawCalls
+			<< ",\"triangles\":" << record.counters.triangles
+			<< ",\"stateChanges\":" << record.counters.stateChanges
+			<< ",\"uploads\":" << record.counters.uploads
+			<< ",\"uploadBytes\":" << record.counters.uploadBytes
+			<< ",\"cpuTime\":" << record.cpuTime
+			<< ",\"gpuTime\":" << record.gpuTime << "}}";
+
+	file << "\n]}\n";
+	return (bool)file;
+} /* Profiler::DumpChromeTrace(std::string path) const */
+/* Public Methods */
+/* Private Methods */
+double Profiler::now() const {
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+}
+
+void Profiler::resetCounters() {
+	counters.drawCalls = 0;
+	counters.triangles = 0;
+	counters.stateChanges = 0;
+	counters.uploads = 0;
+	counters.uploadBytes = 0;
+}
+
+void Profiler::pushEvent(const ProfileEvent & event) {
+	if(events.size() < eventCapacity) events.push_back(event);
+	else events[eventNext] = event;
+	eventNext = (eventNext + 1) % eventCapacity;
+}
+
+void Profiler::collectGpuFrame(GpuFrame & gpuFrame) {
+	FrameRecord * record = findFrame(gpuFrame.frame);
+
+	for(unsigned int i = 0; i < gpuFrame.used; i++) {
+		GpuQuery & query = gpuFrame.queries[i];
+
+		// Never wait for the GPU; result not ready after GPU_FRAME_LATENCY frames is dropped
+		GLint available = 0;
+		glGetQueryObjectiv(query.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if(!available) continue;
+
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(query.query, GL_QUERY_RESULT, &elapsed);
+
+		ProfileEvent event;
+		event.name = query.name;
+		event.start = query.start;
+		event.duration = (double)elapsed / 1000.0;
+		event.frame = gpuFrame.frame;
+		event.depth = 0;
+		event.gpu = true;
+		if(enabled) pushEvent(event);
+
+		if(record) record->gpuTime += event.duration / 1000.0;
+	}
+	gpuFrame.used = 0;
+}
+
+FrameRecord * Profiler::findFrame(unsigned long long frame) {
+	for(auto & record : frames)
+		if(record.frame == frame) return &record;
+	return nullptr;
+}
+
+template<typename T>
+std::vector<T> Profiler::unroll(const std::vector<T> & ring, size_t next, size_t capacity) {
+	if(ring.size() < capacity) return ring;
+	std::vector<T> ordered(ring.begin() + next, ring.end());
+	ordered.insert(ordered.end(), ring.begin(), ring.begin() + next);
+	return ordered;
+}
+/* Private Methods */
+} /* namespace CGL */
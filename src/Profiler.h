@@ -0,0 +1,202 @@
+/*
+ * Profiler is a frame based instrumentation of a Scene:
+ * - nestable CPU timing scopes (BeginScope/EndScope or ProfileScope RAII helper)
+ * - GPU timing scopes with GL_TIME_ELAPSED queries; results are read back
+ *   without blocking a few frames later, when the GPU is done with them
+ * - per frame counters (draw calls, triangles, state changes, uploads),
+ *   incremented by Mesh/ShaderProgram through static Count*() methods; they
+ *   count for the Profiler which began the latest frame (its Scene's)
+ * - ring buffer of recent events which can be dumped as Chrome trace JSON
+ *   (load it in chrome://tracing or https://ui.perfetto.dev)
+ */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace CGL {
+
+/*
+ * Counters of a single frame
+ */
+struct FrameCounters {
+	unsigned int drawCalls;
+	unsigned long long triangles;
+	// Program, texture and vertex array binds
+	unsigned int stateChanges;
+	// Buffer/texture uploads and their size in bytes
+	unsigned int uploads;
+	unsigned long long uploadBytes;
+};
+
+/*
+ * Single timed scope (CPU or GPU) in the event ring buffer
+ * Times are in microseconds since the Profiler was created
+ */
+struct ProfileEvent {
+	const char * name;
+	double start;
+	double duration;
+	unsigned long long frame;
+	unsigned short depth;
+	bool gpu;
+};
+
+/*
+ * Summary of a finished frame
+ */
+struct FrameRecord {
+	unsigned long long frame;
+	double start;   // us since the Profiler was created
+	double cpuTime; // ms, from BeginFrame() to EndFrame()
+	double gpuTime; // ms, sum of top level GPU scopes (0 until read back)
+	FrameCounters counters;
+};
+
+class Profiler {
+public:
+	/*
+	 * eventCapacity - size of the event ring buffer
+	 * frameCapacity - number of FrameRecords kept
+	 */
+	Profiler(size_t eventCapacity=16384, size_t frameCapacity=256);
+	~Profiler();
+
+	/*
+	 * Delete to prevent from accidental copying (owns GL query objects)
+	 */
+	Profiler(const Profiler &other) = delete;
+	Profiler& operator=(const Profiler &other) = delete;
+
+	/*
+	 * Disabled Profiler ignores all scopes (counters are always counted)
+	 * GPU timing requires current OpenGL context, so it's off by default
+	 */
+	void SetEnabled(bool enabled);
+	void SetGpuTimingEnabled(bool enabled);
+	bool IsEnabled() const;
+
+	/*
+	 * Frame boundaries; BeginFrame() also collects GPU results of earlier frames
+	 */
+	void BeginFrame();
+	void EndFrame();
+
+	/*
+	 * CPU scopes may be nested; name has to be a string literal (it's not copied)
+	 */
+	void BeginScope(const char * name);
+	void EndScope();
+
+	/*
+	 * GPU scopes can't be nested (only one GL_TIME_ELAPSED query may be active)
+	 */
+	void BeginGpuScope(const char * name);
+	void EndGpuScope();
+
+	/*
+	 * Counters of the current frame, used by rendering code (thread safe)
+	 */
+	static void CountDrawCall(unsigned long long triangles);
+	static void CountStateChange();
+	static void CountUpload(unsigned long long bytes);
+
+	/*
+	 * Recorded data
+	 */
+	FrameCounters GetCurrentCounters() const;
+	std::vector<FrameRecord> GetFrameRecords() const;
+	std::vector<ProfileEvent> GetEvents() const;
+
+	/*
+	 * Write recorded events and frame counters as Chrome trace JSON
+	 * Return false if the file couldn't be written
+	 */
+	bool DumpChromeTrace(std::string path) const;
+
+private:
+	// GL queries of a frame are read back this many frames later
+	static const unsigned int GPU_FRAME_LATENCY = 4;
+	static const unsigned int GPU_QUERIES_PER_FRAME = 16;
+
+	// Counters of the current frame, uploads are counted from worker threads too
+	struct AtomicCounters {
+		std::atomic<unsigned int> drawCalls, stateChanges, uploads;
+		std::atomic<unsigned long long> triangles, uploadBytes;
+	};
+	AtomicCounters counters;
+	// Profiler the static Count*() methods count for
+	static std::atomic<Profiler*> current;
+
+	struct OpenScope {
+		const char * name;
+		double start;
+	};
+
+	struct GpuQuery {
+		GLuint query;
+		const char * name;
+		double start;
+	};
+
+	struct GpuFrame {
+		unsigned long long frame;
+		unsigned int used;
+		GpuQuery queries[GPU_QUERIES_PER_FRAME];
+	};
+
+	bool enabled, gpuEnabled, gpuScopeOpen;
+	std::chrono::steady_clock::time_point origin;
+	unsigned long long frame;
+	double frameStart;
+
+	std::vector<OpenScope> scopes;
+	std::vector<ProfileEvent> events;
+	size_t eventCapacity, eventNext;
+
+	std::vector<FrameRecord> frames;
+	size_t frameCapacity, frameNext;
+
+	GpuFrame gpuFrames[GPU_FRAME_LATENCY];
+	bool gpuQueriesCreated;
+
+	double now() const;
+	void resetCounters();
+	void pushEvent(const ProfileEvent & event);
+	void collectGpuFrame(GpuFrame & gpuFrame);
+	FrameRecord * findFrame(unsigned long long frame);
+
+	/*
+	 * Events and frames in chronological order
+	 */
+	template<typename T>
+	static std::vector<T> unroll(const std::vector<T> & ring, size_t next, size_t capacity);
+};
+
+/*
+ * Times a CPU scope until the end of a C++ scope
+ */
+class ProfileScope {
+public:
+	ProfileScope(Profiler & profiler, const char * name) : profiler(profiler) { profiler.BeginScope(name); }
+	~ProfileScope() { profiler.EndScope(); }
+
+	ProfileScope(const ProfileScope &other) = delete;
+	ProfileScope& operator=(const ProfileScope &other) = delete;
+
+private:
+	Profiler & profiler;
+};
+
+} /* namespace CGL */
+
+#endif /* PROFILER_H_ */
@@ -13,9 +13,11 @@ namespace CGL {
 enum class Type {
 	CAMERA,
 	SHADERPROGRAM,
+	SHADERPERMUTATION,
 	MODEL,
 	ACTOR,
 	PHYSICSBODY,
+	LIGHT,
 };
 
 class Resource {
@@ -3,11 +3,33 @@
 namespace CGL {
 
 /* Ctor & Dtor */
-Scene::Scene() {
+Scene::Scene(bool headless) : lightGrid(MAX_FRAMES_IN_FLIGHT + 1) {
 	// Default settings
+	this->headless = headless;
+	simulationStep = 0;
 	freeCam = false;
 	scr_width = 0.f;
 	scr_height = 0.f;
+	stats = SceneStats();
+	texturePacking = TexturePacking::NONE;
+	frameDataAlignment = 0;
+	for(GLsync & fence : frameFences) fence = nullptr;
+	frameIndex = 0;
+	framesInFlight = 2;
+	lowLatency = false;
+	simulationPending = false;
+	reverseZApplied = false;
+	occlusionCulling = false;
+	occlusionWidth = 256; occlusionHeight = 128;
+	lightGridStats = LightGridStats();
+	shadowStats = ShadowStats();
+	skinningMode = SkinningMode::GPU;
+	boneDataSize = 0;
+	boneDataAlignment = 0;
+	staticBatching = false;
+	staticBatchDirty = false;
+	transparentBegin = 0;
+	planeSegments = 1; boxSegments = 1; sphereSegments = 16;
 
 	// Initialize resource manager
 	rman = std::make_shared<ResourceManager>();
@@ -25,9 +47,31 @@ Scene::Scene() {
 	solver = new btSequentialImpulseConstraintSolver();
 	dynamicWorld = new btDiscreteDynamicsWorld(dispatcher, broadphaseInterface, solver, collisionConfiguration);
 	dynamicWorld->setGravity(btVector3(0.f, -9.81f, 0.f));
+
+#if BT_THREADSAFE
+	// Bullet's scheduler is global, the last created Scene provides it
+	bulletScheduler.reset(new BulletTaskScheduler(jobs));
+	btSetTaskScheduler(bulletScheduler.get());
+#endif
+
+	// GPU timer queries need OpenGL context
+	profiler.SetGpuTimingEnabled(!headless);
+
+	// Keep the solver deterministic (no randomized constraint order; fixed seed)
+	dynamicWorld->getSolverInfo().m_solverMode &= ~SOLVER_RANDMIZE_ORDER;
+	solver->setRandSeed(0);
 }
 
 Scene::~Scene(){
+	waitForSimulation();
+	for(GLsync fence : frameFences)
+		if(fence) glDeleteSync(fence);
+
+#if BT_THREADSAFE
+	if(btGetTaskScheduler() == bulletScheduler.get())
+		btSetTaskScheduler(btGetSequentialTaskScheduler());
+#endif
+
 	// Delete all Bullet members
 	delete dynamicWorld;
 	delete solver;
@@ -45,34 +89,57 @@ std::string Scene::AddCamera(std::string camera_name, glm::vec3 camera_position,
 	return camera_name;
 }
 
-std::string Scene::AddShaderProgram(std::string shader_name, std::string vertex_path, std::string fragment_path){
-	if(! rman->AddResource(std::make_shared<ShaderProgram>(shader_name, vertex_path.c_str(), fragment_path.c_str()))) {
+std::string Scene::AddShaderProgram(std::string shader_name, std::string vertex_path, std::string fragment_path, bool async){
+	if(headless) {
+		std::cout << "CGL::WARNING::SCENE::ADDCSHADERPROGRAM() Headless Scene can't create ShaderProgram " << shader_name << "\n";
+		return std::string();
+	}
+	if(! rman->AddResource(std::make_shared<ShaderProgram>(shader_name, vertex_path.c_str(), fragment_path.c_str(), async))) {
 		std::cout << "CGL::WARNING::SCENE::ADDCSHADERPROGRAM() ShaderProgram with name " << shader_name << " is already present in the ResourceManager\n";
 		return std::string();
 	}
 	return shader_name;
 }
 
+std::string Scene::AddShaderPermutation(std::string permutation_name, std::string vertex_path, std::string fragment_path, bool async){
+	if(headless) {
+		std::cout << "CGL::WARNING::SCENE::ADDSHADERPERMUTATION() Headless Scene can't create ShaderPermutation " << permutation_name << "\n";
+		return std::string();
+	}
+	if(! rman->AddResource(std::make_shared<ShaderPermutation>(permutation_name, vertex_path, fragment_path, async))) {
+		std::cout << "CGL::WARNING::SCENE::ADDSHADERPERMUTATION() ShaderPermutation with name " << permutation_name << " is already present in the ResourceManager\n";
+		return std::string();
+	}
+	return permutation_name;
+}
+
 std::string Scene::AddModel(std::string model_name, std::string model_path){
-	if(! rman->AddResource(std::make_shared<Model>(model_name, model_path.c_str()))) {
+	if(headless) {
+		std::cout << "CGL::WARNING::SCENE::ADDMODEL() Headless Scene can't load Model " << model_name << "\n";
+		return std::string();
+	}
+	if(! rman->AddResource(std::make_shared<Model>(model_name, model_path.c_str(), textureStreamer, texturePacking))) {
 		std::cout << "CGL::WARNING::SCENE::ADDMODEL() Model with name " << model_name << " is already present in the ResourceManager\n";
 		return std::string();
 	}
 	return model_name;
 }
 
-std::string Scene::AddPrimitivePlane(std::string body_name, glm::mat4 modelMatrix, btVector3 planeNormal, btScalar planeConstatnt) {
+std::string Scene::AddPrimitivePlane(std::string body_name, glm::mat4 modelMatrix, btVector3 planeNormal, btScalar planeConstatnt, btScalar renderHalfSize) {
+	finishSimulation();
 	if(! rman->AddResource(std::make_shared<PrimitiveShape>(body_name, Shape::PLANE))) {
 		std::cout << "CGL::WARNING::SCENE::ADDPRIMITIVEPLANE() Primitive with name " << body_name << " is already present in the ResourceManager\n";
 		return std::string();
 	}
 	// Setup PrimitiveShape Plane
 	std::shared_ptr<PrimitiveShape> shape = getPrimitiveShape(body_name); if(shape == NULL) return std::string();
-	shape->SetupPlane(dynamicWorld, modelMatrix, planeNormal, planeConstatnt);
+	shape->SetupPlane(dynamicWorld, modelMatrix, planeNormal, planeConstatnt, renderHalfSize);
+	bodies.push_back(shape);
 	return body_name;
 }
 
 std::string Scene::AddPrimitiveBox(std::string body_name, glm::mat4 modelMatrix, btScalar mass, btVector3 boxDimensions) {
+	finishSimulation();
 	if(! rman->AddResource(std::make_shared<PrimitiveShape>(body_name, Shape::BOX))) {
 		std::cout << "CGL::WARNING::SCENE::ADDPRIMITIVEBOX() Primitive with name " << body_name << " is already present in the ResourceManager\n";
 		return std::string();
@@ -80,10 +147,12 @@ std::string Scene::AddPrimitiveBox(std::string body_name, glm::mat4 modelMatrix,
 	// Setup PrimitiveShape Box
 	std::shared_ptr<PrimitiveShape> shape = getPrimitiveShape(body_name); if(shape == NULL) return std::string();
 	shape->SetupBox(dynamicWorld, modelMatrix, mass, boxDimensions);
+	bodies.push_back(shape);
 	return body_name;
 }
 
 std::string Scene::AddPrimitiveSphere(std::string body_name, glm::mat4 modelMatrix, btScalar mass, btScalar sphereRadius) {
+	finishSimulation();
 	if(! rman->AddResource(std::make_shared<PrimitiveShape>(body_name, Shape::SPHERE))) {
 		std::cout << "CGL::WARNING::SCENE::ADDPRIMITVESPHERE() Primitive with name " << body_name << " is already present in the ResourceManager\n";
 		return std::string();
@@ -91,55 +160,358 @@ std::string Scene::AddPrimitiveSphere(std::string body_name, glm::mat4 modelMatr
 	// Setup PrimitiveShape Sphere
 	std::shared_ptr<PrimitiveShape> shape = getPrimitiveShape(body_name); if(shape == NULL) return std::string();
 	shape->SetupSpeher(dynamicWorld, modelMatrix, mass, sphereRadius);
+	bodies.push_back(shape);
 	return body_name;
 }
 
-std::string Scene::AddActor(std::string actor_name, std::string model_name, std::string shaderProgram_name, std::string primitiveShape_name, bool isTransparent) {
-	/*
-	 * Search if there are model_name, shaderProgram_name
-	 * and primitiveShape_name present in the ResourceManager
-	 */
+std::string Scene::AddActor(std::string actor_name, std::string model_name, std::string shaderProgram_name, std::string primitiveShape_name, bool isTransparent, ShaderFeatures shaderFeatures) {
 	// Model search
 	std::shared_ptr<Model> model = getModel(model_name); if(model == NULL) return std::string();
+	return addActor(actor_name, model, shaderProgram_name, primitiveShape_name, isTransparent, shaderFeatures, false);
+} /* Scene::AddActor(...) */
 
-	// ShaderProgram search
-	std::shared_ptr<ShaderProgram> shader = getShaderProgram(shaderProgram_name); if(shader == NULL) return std::string();
-
-	// PrimitiveShape search
+std::string Scene::AddPrimitiveActor(std::string actor_name, std::string shaderProgram_name, std::string primitiveShape_name, bool isTransparent, ShaderFeatures shaderFeatures) {
+	if(headless) {
+		std::cout << "CGL::WARNING::SCENE::ADDPRIMITIVEACTOR() Headless Scene can't hold Actor " << actor_name << "\n";
+		return std::string();
+	}
 	std::shared_ptr<PrimitiveShape> shape = getPrimitiveShape(primitiveShape_name); if(shape == NULL) return std::string();
 
-	// Add Actor to the ResourceManager
-	if(! rman->AddResource(std::make_shared<Actor>(actor_name, shader, model, shape, isTransparent))) {
-		std::cout << "CGL::WARNING::SCENE::ADDACTOR() Actor with name " << actor_name << " is already present in the ResourceManager\n";
-		return std::string();
+	// One Model per type and tessellation, created on first use
+	Shape type = shape->GetShapeType();
+	int segments = type == Shape::PLANE ? planeSegments : type == Shape::BOX ? boxSegments : sphereSegments;
+	std::shared_ptr<Model> & model = primitiveModels[std::make_pair((int)type, segments)];
+	if(!model) {
+		const char * names[] = { "plane", "box", "sphere" };
+		model = CreatePrimitiveModel(std::string("primitive-") + names[(int)type] + "-" + std::to_string(segments), type, segments);
 	}
-	return actor_name;
-} /* Scene::AddActor(...) */
+	return addActor(actor_name, model, shaderProgram_name, primitiveShape_name, isTransparent, shaderFeatures, true);
+} /* Scene::AddPrimitiveActor(...) */
+
+void Scene::SetPrimitiveTessellation(int planeSegments, int boxSegments, int sphereSegments) {
+	this->planeSegments = std::max(planeSegments, 1);
+	this->boxSegments = std::max(boxSegments, 1);
+	this->sphereSegments = std::max(sphereSegments, 2);
+}
+
 
 void Scene::DelActor(std::string actorName) {
+	std::shared_ptr<Actor> actor = getActor(actorName); if(actor == NULL) return;
+	// Attached Actors stay, the Actor's own transforms go with its node transforms
+	for(auto & other : actors)
+		if(other->GetParent() == actor.get()) DetachActor(other->GetName());
+	transforms.Destroy(actor->GetTransform());
+	actors.erase(std::find(actors.begin(), actors.end(), actor));
+	spatialIndex.Remove(actor.get());
+	if(shadowMap && actor->GetShapePtr()->IsStatic()) shadowMap->InvalidateStatic();
+	if(actor->IsBatched()) staticBatchDirty = true;
+	auto animated = std::find(animatedActors.begin(), animatedActors.end(), actor.get());
+	if(animated != animatedActors.end()) animatedActors.erase(animated);
+
 	std::vector<std::string> names; names.push_back(actorName);
 	rman->DeleteResourcesByNames(names);
 } /* Scene::DelActor(actorName) */
 
 void Scene::RunScene(GLFWwindow* window, float deltaTime, bool freeze, bool freeCam) {
+	if(headless) {
+		std::cout << "CGL::WARNING::SCENE::RUNSCENE() Headless Scene can't be rendered, use StepScene() instead\n";
+		return;
+	}
+	profiler.BeginFrame();
+	waitForFrameSlot();
 	// freeCam for the Camera
 	this->freeCam = freeCam;
 	// check for size of a frame buffer
 	updateSceneParameters(window);
 	// handle inputs by the Camera
+	profiler.BeginScope("Input");
 	handleKeyboardInput(window, deltaTime);
 	handleMouseInput(window);
-	// Run physics if not freeze
-	if(!freeze) dynamicWorld->stepSimulation(1.f/60.f, 10.f);
-	// render everything
-	draw();
+	profiler.EndScope();
+	// physics, synchronization and rendering
+	runFrame(freeze, deltaTime);
+	profiler.EndFrame();
+}
+
+void Scene::RunScene(int framebuffer_width, int framebuffer_height, bool freeze) {
+	if(headless) {
+		std::cout << "CGL::WARNING::SCENE::RUNSCENE() Headless Scene can't be rendered, use StepScene() instead\n";
+		return;
+	}
+	profiler.BeginFrame();
+	waitForFrameSlot();
+	scr_width = (float)framebuffer_width;
+	scr_height = (float)framebuffer_height;
+	// Animations advance by the simulation's step
+	runFrame(freeze, 1.f/60.f);
+	profiler.EndFrame();
+}
+
+void Scene::StepScene(float fixedDeltaTime, unsigned int steps) {
+	finishSimulation();
+	profiler.BeginFrame();
+	profiler.BeginScope("Physics");
+	for(unsigned int i = 0; i < steps; i++)
+		stepSimulation(fixedDeltaTime);
+	profiler.EndScope();
+	if(!headless) {
+		ProfileScope scope(profiler, "Sync");
+		syncActorTransforms();
+	}
+	profiler.EndFrame();
+}
+
+bool Scene::AttachActor(std::string child_name, std::string parent_name, glm::mat4 localMatrix) {
+	auto child = getActor(child_name); if(child == NULL) return false;
+	auto parent = getActor(parent_name); if(parent == NULL) return false;
+	if(!transforms.SetParent(child->GetTransform(), parent->GetTransform())) {
+		std::cout << "CGL::WARNING::SCENE::ATTACHACTOR() Actor " << parent_name << " is attached to " << child_name << "\n";
+		return false;
+	}
+	transforms.SetLocal(child->GetTransform(), localMatrix);
+	child->SetParent(parent.get());
+	if(child->IsBatched()) staticBatchDirty = true;
+	return true;
+}
+
+void Scene::DetachActor(std::string actor_name) {
+	auto actor = getActor(actor_name); if(actor == NULL || !actor->GetParent()) return;
+	transforms.SetParent(actor->GetTransform(), INVALID_TRANSFORM);
+	transforms.SetLocal(actor->GetTransform(), actor->GetModelMatrix());
+	actor->SetParent(nullptr);
+	if(isBatchable(*actor)) staticBatchDirty = true;
+}
+
+void Scene::SetActorLocalTransform(std::string actor_name, glm::mat4 localMatrix) {
+	auto actor = getActor(actor_name); if(actor == NULL) return;
+	transforms.SetLocal(actor->GetTransform(), localMatrix);
+	if(actor->IsBatched()) staticBatchDirty = true;
+	if(shadowMap && actor->GetShapePtr()->IsStatic()) shadowMap->InvalidateStatic();
+}
+
+bool Scene::SetActorNodeTransform(std::string actor_name, std::string node_name, glm::mat4 localMatrix) {
+	auto actor = getActor(actor_name); if(actor == NULL) return false;
+	std::shared_ptr<Model> model = actor->GetModelPtr();
+	if(model->IsSkinned()) {
+		std::cout << "CGL::WARNING::SCENE::SETACTORNODETRANSFORM() Nodes of Actor " << actor_name << " follow its Animator\n";
+		return false;
+	}
+	int node = model->GetSkeleton().FindNode(node_name);
+	if(node < 0) {
+		std::cout << "CGL::WARNING::SCENE::SETACTORNODETRANSFORM() Model of Actor " << actor_name << " doesn't have node " << node_name << "\n";
+		return false;
+	}
+	// Models without node transforms get them on the first change
+	if(actor->GetNodeTransforms().empty()) createNodeTransforms(*actor);
+	transforms.SetLocal(actor->GetNodeTransforms()[node], localMatrix);
+	if(actor->IsBatched()) staticBatchDirty = true;
+	if(shadowMap && actor->GetShapePtr()->IsStatic()) shadowMap->InvalidateStatic();
+	return true;
 }
 
 void Scene::SetActorLinearVelocity(std::string actor_name, glm::vec3 direction, float value) {
+	finishSimulation();
 	auto actor = getActor(actor_name);
 	if(actor != NULL) actor->SetLinearVelocity(direction, value);
 }
 
+void Scene::SetActorShaderFeatures(std::string actor_name, ShaderFeatures shaderFeatures) {
+	auto actor = getActor(actor_name); if(actor == NULL) return;
+	actor->SetShaderFeatures(shaderFeatures | actor->GetModelPtr()->GetTexturePackingFeatures());
+	// Keeps ShaderFeature::SKINNING in GPU skinning mode
+	if(actor->GetAnimator()) applySkinningMode(*actor);
+	if(actor->IsBatched()) staticBatchDirty = true;
+}
+
+void Scene::SetPrimitiveDeactivationThresholds(std::string body_name, btScalar linearThreshold, btScalar angularThreshold) {
+	finishSimulation();
+	auto shape = getPrimitiveShape(body_name);
+	if(shape != NULL) shape->SetDeactivationThresholds(linearThreshold, angularThreshold);
+}
+
+void Scene::SetPrimitiveDeactivationEnabled(std::string body_name, bool enabled) {
+	finishSimulation();
+	auto shape = getPrimitiveShape(body_name);
+	if(shape != NULL) shape->SetDeactivationEnabled(enabled);
+}
+
+void Scene::SetFallbackShaderProgram(std::string shaderProgram_name) {
+	if(shaderProgram_name.empty()) fallbackShader = nullptr;
+	else fallbackShader = getShaderProgram(shaderProgram_name);
+}
+
+void Scene::SetTexturePacking(TexturePacking packing) {
+	texturePacking = packing;
+}
+
+void Scene::EnableTextureStreaming(size_t budgetBytes, size_t uploadBytesPerFrame) {
+	if(headless) {
+		std::cout << "CGL::WARNING::SCENE::ENABLETEXTURESTREAMING() Headless Scene has no textures to stream\n";
+		return;
+	}
+	if(textureStreamer) textureStreamer->SetBudget(budgetBytes);
+	else textureStreamer = std::make_shared<TextureStreamer>(budgetBytes, uploadBytesPerFrame);
+}
+
+std::string Scene::AddView(std::string camera_name, int x, int y, int width, int height, GLuint framebuffer) {
+	auto camera = getCamera(camera_name);
+	if(camera == NULL) return std::string();
+	if(views.size() >= 32) {
+		std::cout << "CGL::WARNING::SCENE::ADDVIEW() Scene can't render more than 32 views\n";
+		return std::string();
+	}
+	views.push_back(View{camera, x, y, width, height, framebuffer});
+	return camera_name;
+}
+
+void Scene::ClearViews() {
+	views.clear();
+}
+
+void Scene::SetOcclusionCulling(bool enabled, int width, int height) {
+	occlusionCulling = enabled;
+	if(width != occlusionWidth || height != occlusionHeight) {
+		occlusionWidth = width; occlusionHeight = height;
+		occlusionBuffers.clear();
+	}
+}
+
+void Scene::SetActorOccluder(std::string actor_name, bool occluder) {
+	auto actor = getActor(actor_name);
+	if(actor != NULL) actor->SetOccluder(occluder);
+}
+
+std::string Scene::AddPointLight(std::string light_name, glm::vec3 position, glm::vec3 color, float intensity, float radius) {
+	auto light = std::make_shared<Light>(light_name, LightType::POINT, color, intensity);
+	light->SetPosition(position);
+	light->SetRadius(radius);
+	if(! rman->AddResource(light)) {
+		std::cout << "CGL::WARNING::SCENE::ADDPOINTLIGHT() Light with name " << light_name << " is already present in the ResourceManager\n";
+		return std::string();
+	}
+	lights.push_back(light);
+	return light_name;
+}
+
+std::string Scene::AddDirectionalLight(std::string light_name, glm::vec3 direction, glm::vec3 color, float intensity) {
+	auto light = std::make_shared<Light>(light_name, LightType::DIRECTIONAL, color, intensity);
+	light->SetDirection(direction);
+	if(! rman->AddResource(light)) {
+		std::cout << "CGL::WARNING::SCENE::ADDDIRECTIONALLIGHT() Light with name " << light_name << " is already present in the ResourceManager\n";
+		return std::string();
+	}
+	lights.push_back(light);
+	return light_name;
+}
+
+void Scene::SetLightPosition(std::string light_name, glm::vec3 position) {
+	auto light = getLight(light_name);
+	if(light != NULL) light->SetPosition(position);
+}
+
+void Scene::SetLightColor(std::string light_name, glm::vec3 color, float intensity) {
+	auto light = getLight(light_name);
+	if(light != NULL) light->SetColor(color, intensity);
+}
+
+void Scene::DelLight(std::string light_name) {
+	std::shared_ptr<Light> light = getLight(light_name); if(light == NULL) return;
+	lights.erase(std::find(lights.begin(), lights.end(), light));
+	if(light == shadowLight) SetShadows(std::string());
+
+	std::vector<std::string> names; names.push_back(light_name);
+	rman->DeleteResourcesByNames(names);
+}
+
+void Scene::SetLightGrid(int x, int y, int z, float maxDistance) {
+	lightGrid.SetGridSize(x, y, z);
+	lightGrid.SetMaxDistance(maxDistance);
+}
+
+void Scene::SetShadows(std::string light_name, int cascades, int resolution, float distance) {
+	if(light_name.empty()) {
+		shadowLight.reset();
+		shadowMap.reset();
+		shadowStats = ShadowStats();
+		return;
+	}
+	if(headless) {
+		std::cout << "CGL::WARNING::SCENE::SETSHADOWS() Headless Scene doesn't render shadows\n";
+		return;
+	}
+	auto light = getLight(light_name); if(light == NULL) return;
+	if(light->GetLightType() != LightType::DIRECTIONAL) {
+		std::cout << "CGL::WARNING::SCENE::SETSHADOWS() Light " << light_name << " isn't a directional light\n";
+		return;
+	}
+	bool caching = shadowMap ? shadowMap->IsStaticCaching() : true;
+	shadowLight = light;
+	shadowMap.reset(new ShadowMap(cascades, resolution));
+	shadowMap->SetDistance(distance);
+	shadowMap->SetStaticCaching(caching);
+}
+
+void Scene::SetShadowCaching(bool enabled) {
+	if(shadowMap) shadowMap->SetStaticCaching(enabled);
+}
+
+void Scene::SetStaticBatching(bool enabled, float chunkSize) {
+	if(headless) {
+		std::cout << "CGL::WARNING::SCENE::SETSTATICBATCHING() Headless Scene doesn't render\n";
+		return;
+	}
+	staticBatching = enabled;
+	staticBatch.SetChunkSize(chunkSize);
+	staticBatchDirty = true;
+}
+
+bool Scene::PlayAnimation(std::string actor_name, std::string clip_name, bool loop, float speed, float fadeSeconds) {
+	auto actor = getActor(actor_name); if(actor == NULL) return false;
+	if(!actor->GetAnimator()) {
+		std::cout << "CGL::WARNING::SCENE::PLAYANIMATION() Actor " << actor_name << " doesn't have a skinned Model\n";
+		return false;
+	}
+	if(!actor->GetAnimator()->Play(clip_name, loop, speed, fadeSeconds)) {
+		std::cout << "CGL::WARNING::SCENE::PLAYANIMATION() Model of Actor " << actor_name << " doesn't have animation " << clip_name << "\n";
+		return false;
+	}
+	return true;
+}
+
+void Scene::StopAnimation(std::string actor_name) {
+	auto actor = getActor(actor_name);
+	if(actor != NULL && actor->GetAnimator()) actor->GetAnimator()->Stop();
+}
+
+void Scene::SetSkinningMode(SkinningMode mode) {
+	skinningMode = mode;
+	for(Actor * actor : animatedActors) applySkinningMode(*actor);
+}
+
+void Scene::SetCameraProjection(float fieldOfView, float nearPlane, float farPlane) {
+	current_camera->SetProjection(fieldOfView, nearPlane, farPlane);
+}
+
+void Scene::SetCameraReverseZ(bool enabled) {
+	current_camera->SetReverseZ(enabled);
+}
+
+void Scene::SetFramesInFlight(unsigned int frames) {
+	if(frames < 1 || frames > MAX_FRAMES_IN_FLIGHT) {
+		std::cout << "CGL::WARNING::SCENE::SETFRAMESINFLIGHT() " << frames << " frames in flight is out of range 1.." << MAX_FRAMES_IN_FLIGHT << "\n";
+		frames = glm::clamp(frames, 1u, MAX_FRAMES_IN_FLIGHT);
+	}
+	framesInFlight = frames;
+}
+
+void Scene::SetLowLatencyMode(bool enabled) {
+	lowLatency = enabled;
+}
+
+void Scene::SetActivationCallback(ActivationCallback callback) {
+	activationCallback = callback;
+}
+
 std::vector<std::string> Scene::GetCollectionNames(Type type) const {
 	std::vector<std::shared_ptr<Resource>> resources = rman->GetAllResourcesByType(type);
 	std::vector<std::string> names;
@@ -156,8 +528,210 @@ glm::vec3 Scene::GetCameraFront() const {
 	return current_camera->GetFront();
 }
 
+std::vector<std::string> Scene::QueryActorsInBox(glm::vec3 min, glm::vec3 max) const {
+	std::vector<Actor*> found;
+	spatialIndex.QueryBox(min, max, found);
+	std::vector<std::string> names;
+	for(auto actor : found)
+		names.push_back(actor->GetName());
+	return names;
+}
+
+std::vector<std::string> Scene::QueryActorsInRadius(glm::vec3 center, float radius) const {
+	std::vector<Actor*> found;
+	spatialIndex.QuerySphere(center, radius, found);
+	std::vector<std::string> names;
+	for(auto actor : found)
+		names.push_back(actor->GetName());
+	return names;
+}
+
+TextureStreamerStats Scene::GetTextureStreamerStats() const {
+	if(!textureStreamer) return TextureStreamerStats();
+	return textureStreamer->GetStats();
+}
+
+LightGridStats Scene::GetLightGridStats() const {
+	return lightGridStats;
+}
+
+ShadowStats Scene::GetShadowStats() const {
+	return shadowStats;
+}
+
+StaticBatchStats Scene::GetStaticBatchStats() const {
+	return staticBatch.GetStats();
+}
+
+SceneStats Scene::GetSceneStats() const {
+	return stats;
+}
+
+Profiler & Scene::GetProfiler() {
+	return profiler;
+}
+
+JobSystem & Scene::GetJobSystem() {
+	return jobs;
+}
+
+bool Scene::IsHeadless() const {
+	return headless;
+}
+
+unsigned long long Scene::GetSimulationStep() const {
+	return waitForSimulation();
+}
+
+glm::mat4 Scene::GetPrimitiveModelMatrix(std::string body_name) {
+	finishSimulation();
+	auto shape = getPrimitiveShape(body_name);
+	if(shape == NULL) return glm::mat4(1.f);
+	return shape->GetModelMatrix();
+}
+
+unsigned long long Scene::GetSimulationStateHash() const {
+	waitForSimulation();
+	unsigned long long hash = 14695981039346656037ULL;
+	auto hashBytes = [&hash](const void * data, size_t size) {
+		const unsigned char * bytes = static_cast<const unsigned char *>(data);
+		for(size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+	};
+
+	for(auto & body : bodies) {
+		btRigidBody * rigidBody = body->GetRigidBody();
+		if(!rigidBody) continue;
+		btScalar matrix[16];
+		rigidBody->getWorldTransform().getOpenGLMatrix(matrix);
+		hashBytes(matrix, sizeof(matrix));
+		hashBytes(&rigidBody->getLinearVelocity()[0], 3*sizeof(btScalar));
+		hashBytes(&rigidBody->getAngularVelocity()[0], 3*sizeof(btScalar));
+		int state = rigidBody->getActivationState();
+		hashBytes(&state, sizeof(state));
+	}
+	return hash;
+}
+
+void Scene::SaveSnapshot(std::vector<unsigned char> & buffer) const {
+	unsigned long long step = waitForSimulation();
+	SnapshotHeader header;
+	header.magic = SNAPSHOT_MAGIC;
+	header.version = SNAPSHOT_VERSION;
+	header.kind = SnapshotKind::FULL;
+	header.scalarSize = sizeof(btScalar);
+	header.bodyCount = header.recordCount = (uint32_t)bodies.size();
+	header.reserved = 0;
+	header.simulationStep = step;
+
+	buffer.resize(sizeof(SnapshotHeader) + bodies.size()*sizeof(BodySnapshot));
+	std::memcpy(buffer.data(), &header, sizeof(SnapshotHeader));
+
+	BodySnapshot state;
+	unsigned char * out = buffer.data() + sizeof(SnapshotHeader);
+	for(auto & body : bodies) {
+		if(body->GetRigidBody()) CaptureBodyState(body->GetRigidBody(), state);
+		else std::memset(&state, 0, sizeof(BodySnapshot));
+		std::memcpy(out, &state, sizeof(BodySnapshot));
+		out += sizeof(BodySnapshot);
+	}
+}
+
+bool Scene::LoadSnapshot(const std::vector<unsigned char> & buffer) {
+	finishSimulation();
+	const SnapshotHeader * header = ValidateSnapshot(buffer, SnapshotKind::FULL);
+	if(!header) {
+		std::cout << "CGL::ERROR::SCENE::LOADSNAPSHOT() Buffer is not a valid snapshot\n";
+		return false;
+	}
+	if(header->bodyCount != bodies.size()) {
+		std::cout << "CGL::ERROR::SCENE::LOADSNAPSHOT() Snapshot has " << header->bodyCount << " bodies, Scene has " << bodies.size() << "\n";
+		return false;
+	}
+
+	BodySnapshot state;
+	const unsigned char * in = buffer.data() + sizeof(SnapshotHeader);
+	for(auto & body : bodies) {
+		std::memcpy(&state, in, sizeof(BodySnapshot));
+		in += sizeof(BodySnapshot);
+		if(body->GetRigidBody()) RestoreBodyState(body->GetRigidBody(), state);
+	}
+	simulationStep = header->simulationStep;
+
+	// Contact points, overlapping pairs and warmstarting data belong to the state before rollback
+	for(int i = 0; i < dispatcher->getNumManifolds(); i++)
+		dispatcher->getManifoldByIndexInternal(i)->clearManifold();
+	resetBroadphase();
+	solver->reset();
+
+	// Restored bodies might have moved while staying asleep
+	updateActivationStates();
+	if(!headless) syncActorTransforms(true);
+	return true;
+}
+
+bool Scene::SaveSnapshotDelta(const std::vector<unsigned char> & base, std::vector<unsigned char> & delta) const {
+	waitForSimulation();
+	std::vector<unsigned char> current;
+	SaveSnapshot(current);
+	if(!EncodeSnapshotDelta(base, current, delta)) {
+		std::cout << "CGL::ERROR::SCENE::SAVESNAPSHOTDELTA() Base snapshot doesn't match the Scene\n";
+		return false;
+	}
+	return true;
+}
+
+bool Scene::LoadSnapshotDelta(const std::vector<unsigned char> & base, const std::vector<unsigned char> & delta) {
+	finishSimulation();
+	std::vector<unsigned char> full;
+	if(!ApplySnapshotDelta(base, delta, full)) {
+		std::cout << "CGL::ERROR::SCENE::LOADSNAPSHOTDELTA() Delta snapshot doesn't match the base snapshot\n";
+		return false;
+	}
+	return LoadSnapshot(full);
+}
+
 /* Public Methods */
 /* Private Methods */
+std::string Scene::addActor(std::string actor_name, std::shared_ptr<Model> model, std::string shaderProgram_name, std::string primitiveShape_name, bool isTransparent, ShaderFeatures shaderFeatures, bool fitToShape) {
+	finishSimulation();
+	// ShaderPermutation or ShaderProgram search
+	std::shared_ptr<ShaderPermutation> permutation = std::dynamic_pointer_cast<ShaderPermutation>(rman->GetResourceByName(shaderProgram_name));
+	std::shared_ptr<ShaderProgram> shader;
+	if(permutation == nullptr) {
+		shader = getShaderProgram(shaderProgram_name); if(shader == NULL) return std::string();
+	}
+
+	// PrimitiveShape search
+	std::shared_ptr<PrimitiveShape> shape = getPrimitiveShape(primitiveShape_name); if(shape == NULL) return std::string();
+
+	// Add Actor to the ResourceManager
+	std::shared_ptr<Actor> actor = permutation
+			? std::make_shared<Actor>(actor_name, permutation, shaderFeatures | model->GetTexturePackingFeatures(), model, shape, isTransparent)
+			: std::make_shared<Actor>(actor_name, shader, model, shape, isTransparent);
+	if(fitToShape) actor->SetShapeMatrix(shape->GetMeshMatrix());
+	if(! rman->AddResource(actor)) {
+		std::cout << "CGL::WARNING::SCENE::ADDACTOR() Actor with name " << actor_name << " is already present in the ResourceManager\n";
+		return std::string();
+	}
+	actors.push_back(actor);
+	if(shadowMap && shape->IsStatic()) shadowMap->InvalidateStatic();
+	if(shape->IsStatic()) staticBatchDirty = true;
+	actor->SetTransform(transforms.Create(INVALID_TRANSFORM, actor->GetModelMatrix()));
+	if(model->HasNodeTransforms() && !model->IsSkinned()) createNodeTransforms(*actor);
+	if(model->IsSkinned()) {
+		actor->SetAnimator(std::make_shared<Animator>(model));
+		applySkinningMode(*actor);
+		animatedActors.push_back(actor.get());
+	}
+
+	glm::vec3 min, max; actor->GetWorldBounds(min, max);
+	spatialIndex.Insert(actor.get(), min, max);
+	return actor_name;
+} /* Scene::addActor(...) */
+
 std::shared_ptr<ShaderProgram> Scene::getShaderProgram(std::string shaderProgram_name) {
 	std::shared_ptr<ShaderProgram> shader = std::dynamic_pointer_cast<ShaderProgram>(rman->GetResourceByName(shaderProgram_name));
 	if(shader == nullptr){
@@ -198,6 +772,14 @@ std::shared_ptr<Actor> Scene::getActor(std::string actor_name) {
 	}
 	return actor;
 }
+std::shared_ptr<Light> Scene::getLight(std::string light_name) {
+	std::shared_ptr<Light> light = std::dynamic_pointer_cast<Light>(rman->GetResourceByName(light_name));
+	if(light == nullptr){
+		std::cout << "CGL::ERROR::SCENE::GETLIGHT() No " << light_name << " Light found in the ResourceManager\n";
+		return NULL;
+	}
+	return light;
+}
 
 void Scene::updateSceneParameters(GLFWwindow* window) {
 	// update scr_width and scr_height fields
@@ -221,14 +803,572 @@ void Scene::handleMouseInput(GLFWwindow* window) {
 }
 
 void Scene::draw() {
-	// Get view and projection matrices for current frame from the Camera
-	glm::mat4 viewMatrix = current_camera->GetViewMatrix();
-	glm::mat4 projectionMatrix = glm::perspective(glm::radians(45.f), scr_width/scr_height, .1f, 100.f);
+	// Views of this frame: the current Camera over the frame buffer set up by the application
+	// unless views were added
+	frameViews.clear();
+	if(views.empty()) frameViews.push_back(View{current_camera, 0, 0, (int)scr_width, (int)scr_height, 0});
+	else frameViews.insert(frameViews.end(), views.begin(), views.end());
 
-	// Iterator over all Actor type Resources and render them
-	std::vector<std::shared_ptr<Resource>> resources = rman->GetAllResourcesByType(Type::ACTOR);
-	for(auto & r : resources)
-		std::dynamic_pointer_cast<Actor>(r)->Draw(viewMatrix, projectionMatrix);
+	// Cameras recalculate their matrices only if they moved or their viewport was resized
+	frameFrusta.resize(frameViews.size());
+	for(size_t i = 0; i < frameViews.size(); i++) {
+		const View & view = frameViews[i];
+		if(view.height > 0) view.camera->SetAspectRatio((float)view.width / (float)view.height);
+		frameFrusta[i].planeCount = view.camera->GetFrustumPlanes(frameFrusta[i].planes);
+	}
+
+	// Render only Actors which bounding boxes are inside a view frustum,
+	// a single traversal tells which views each of them is visible in
+	profiler.BeginScope("Culling");
+	visibleActors.clear();
+	visibleViews.clear();
+	spatialIndex.QueryFrusta(frameFrusta, visibleActors, visibleViews);
+	// Shadow casters too, their animated poses are evaluated with the visible ones
+	if(shadowMap) cullShadowCasters();
+	profiler.EndScope();
+	stats.culledActors = (unsigned int)(actors.size() - visibleActors.size());
+
+	stats.occludedActors = stats.occluders = 0;
+	if(occlusionCulling) {
+		ProfileScope scope(profiler, "Occlusion");
+		cullOccluded();
+	}
+
+	if(staticBatchDirty) {
+		ProfileScope scope(profiler, "Batching");
+		buildStaticBatch();
+	}
+
+	profiler.BeginScope("Queue");
+	buildRenderQueue(frameViews[0].camera->GetPosition());
+	profiler.EndScope();
+
+	stats.animatedActors = 0;
+	if(!animatedActors.empty()) {
+		ProfileScope scope(profiler, "Animation");
+		animateActors();
+	}
+
+	if(textureStreamer) {
+		ProfileScope scope(profiler, "Streaming");
+		streamTextures();
+	}
+
+	if(shadowMap) {
+		ProfileScope scope(profiler, "Shadows");
+		profiler.BeginGpuScope("Shadows");
+		renderShadows();
+		profiler.EndGpuScope();
+	}
+
+	profiler.BeginScope("Draw");
+	profiler.BeginGpuScope("Draw");
+	Mesh::ResetTextureBindings();
+	if(!frameData) {
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &frameDataAlignment);
+		// Plenty for FrameUniforms of all views; more per-frame data can share the ring
+		frameData.reset(new StreamBuffer(64 * 1024, MAX_FRAMES_IN_FLIGHT + 1));
+	}
+	frameData->BeginFrame();
+	lightGrid.BeginFrame();
+	if(shadowMap) uploadShadowUniforms();
+
+	GLint previousFramebuffer = 0, previousViewport[4] = { 0, 0, 0, 0 };
+	if(!views.empty()) {
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+		glGetIntegerv(GL_VIEWPORT, previousViewport);
+	}
+
+	stats.pendingActors = stats.staticBatchDraws = stats.visibleChunks = 0;
+	for(size_t i = 0; i < frameViews.size(); i++) {
+		const View & view = frameViews[i];
+		bool switched = applyDepthConvention(*view.camera);
+		if(!views.empty()) {
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, view.framebuffer);
+			glViewport(view.x, view.y, view.width, view.height);
+			glEnable(GL_SCISSOR_TEST);
+			glScissor(view.x, view.y, view.width, view.height);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			glDisable(GL_SCISSOR_TEST);
+			Profiler::CountStateChange();
+		}
+		// The depth buffer was cleared with the previous convention's far value
+		else if(switched) glClear(GL_DEPTH_BUFFER_BIT);
+
+		uploadFrameUniforms(*view.camera);
+		if(!lights.empty()) {
+			ProfileScope scope(profiler, "Lights");
+			lightGrid.Build(*view.camera, view.x, view.y, view.width, view.height, lights, jobs);
+			if(i == 0) lightGridStats = lightGrid.GetStats();
+		}
+		const glm::mat4 & viewMatrix = view.camera->GetViewMatrix();
+		const glm::mat4 & projectionMatrix = view.camera->GetProjectionMatrix();
+		if(staticBatching) {
+			const OcclusionBuffer * occlusion = occlusionCulling && stats.occluders ? occlusionBuffers[i].get() : nullptr;
+			stats.staticBatchDraws += staticBatch.Draw(frameFrusta[i], occlusion, viewMatrix, projectionMatrix,
+					fallbackShader.get(), stats.visibleChunks);
+		}
+		uint32_t bit = 1u << i;
+		// Pending Actors are counted in the first view they are visible in
+		auto drawItem = [&](const RenderItem & item) {
+			if(!item.actor->Draw(viewMatrix, projectionMatrix, fallbackShader.get()) && !(item.views & (bit - 1)))
+				stats.pendingActors++;
+		};
+		for(size_t k = 0; k < transparentBegin; k++)
+			if(renderQueue[k].views & bit) drawItem(renderQueue[k]);
+		sortTransparent(bit, view.camera->GetPosition());
+		for(auto & entry : viewTransparent) drawItem(*entry.second);
+	}
+
+	if(!views.empty()) {
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+		glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	}
+	lightGrid.EndFrame();
+	frameData->EndFrame();
+	if(boneData) boneData->EndFrame();
+	profiler.EndGpuScope();
+	endFrame();
+	profiler.EndScope();
+
+	stats.drawnActors = (unsigned int)visibleActors.size();
+}
+
+bool Scene::applyDepthConvention(Camera & camera) {
+	bool reverseZ = camera.IsReverseZ();
+	if(reverseZ == reverseZApplied) return false;
+
+	if(reverseZ && !GLEW_ARB_clip_control) {
+		std::cout << "CGL::WARNING::SCENE::DRAW() Reverse-Z needs glClipControl(), using the standard depth range for Camera " << camera.GetName() << "\n";
+		camera.SetReverseZ(false);
+		return false;
+	}
+	setDepthConvention(reverseZ);
+	return true;
+}
+
+void Scene::setDepthConvention(bool reverseZ) {
+	reverseZApplied = reverseZ;
+	glClipControl(GL_LOWER_LEFT, reverseZ ? GL_ZERO_TO_ONE : GL_NEGATIVE_ONE_TO_ONE);
+	glDepthFunc(reverseZ ? GL_GREATER : GL_LESS);
+	glClearDepth(reverseZ ? 0.0 : 1.0);
+	Profiler::CountStateChange();
+}
+
+void Scene::cullShadowCasters() {
+	shadowFrusta.clear();
+	shadowCasters.clear();
+	shadowMasks.clear();
+	glm::vec3 min, max;
+	if(!spatialIndex.GetBounds(min, max)) return;
+	shadowMap->Update(*frameViews[0].camera, shadowLight->GetDirection(), min, max, shadowFrusta);
+
+	// The same traversal as the views' culling, one frustum per cascade
+	spatialIndex.QueryFrusta(shadowFrusta, shadowCasters, shadowMasks);
+}
+
+void Scene::renderShadows() {
+	shadowStats = ShadowStats();
+	if(shadowFrusta.empty()) return;
+
+	// Cascades are orthographic projections of the standard depth range; the
+	// main framebuffer's convention is restored so draw() sees no switch to clear for
+	bool reverseZ = reverseZApplied;
+	if(reverseZ) setDepthConvention(false);
+	shadowMap->Render(shadowCasters, shadowMasks);
+	if(reverseZ) setDepthConvention(true);
+	shadowStats = shadowMap->GetStats();
+}
+
+void Scene::uploadShadowUniforms() {
+	StreamAllocation allocation = frameData->Allocate(sizeof(ShadowUniforms), frameDataAlignment > 0 ? frameDataAlignment : 256);
+	if(!allocation.data) return;
+	*(ShadowUniforms*)allocation.data = shadowMap->GetUniforms();
+	frameData->Flush();
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, SHADOW_UNIFORM_BINDING, allocation.buffer, allocation.offset, sizeof(ShadowUniforms));
+	shadowMap->Bind();
+	Profiler::CountStateChange();
+}
+
+void Scene::uploadFrameUniforms(const Camera & camera) {
+	StreamAllocation allocation = frameData->Allocate(sizeof(FrameUniforms), frameDataAlignment > 0 ? frameDataAlignment : 256);
+	if(!allocation.data) return;
+	FrameUniforms * uniforms = (FrameUniforms*)allocation.data;
+	uniforms->view = camera.GetViewMatrix();
+	uniforms->projection = camera.GetProjectionMatrix();
+	uniforms->viewProjection = camera.GetViewProjectionMatrix();
+	uniforms->cameraPosition = glm::vec4(camera.GetPosition(), 1.f);
+	frameData->Flush();
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, allocation.buffer, allocation.offset, sizeof(FrameUniforms));
+	Profiler::CountStateChange();
+}
+
+void Scene::animateActors() {
+	animators.clear();
+	for(Actor * actor : visibleActors)
+		if(actor->GetAnimator()) animators.push_back(actor->GetAnimator().get());
+	// Shadows of animated Actors outside the views need their poses as well
+	if(!shadowCasters.empty()) {
+		for(Actor * actor : shadowCasters)
+			if(actor->GetAnimator()) animators.push_back(actor->GetAnimator().get());
+		std::sort(animators.begin(), animators.end());
+		animators.erase(std::unique(animators.begin(), animators.end()), animators.end());
+	}
+	stats.animatedActors = (unsigned int)animators.size();
+	if(animators.empty()) return;
+
+	// Poses only touch their own Animator
+	jobs.ParallelFor(animators.size(), 8, [this](size_t begin, size_t end) {
+		for(size_t i = begin; i < end; i++) {
+			animators[i]->Evaluate();
+			if(animators[i]->GetSkinningMode() == SkinningMode::CPU) animators[i]->Skin();
+		}
+	});
+
+	// Palettes of all GPU skinned Actors share one allocation of the ring
+	if(!boneDataAlignment) glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &boneDataAlignment);
+	size_t align = boneDataAlignment > 0 ? (size_t)boneDataAlignment : 256;
+	size_t needed = 0;
+	for(Animator * animator : animators) {
+		if(animator->GetSkinningMode() == SkinningMode::CPU) animator->Upload();
+		else needed += (std::max<size_t>(animator->GetPalette().size(), 1) * sizeof(glm::mat4) + align - 1) / align * align;
+	}
+	if(!needed) return;
+
+	StreamAllocation allocation;
+	for(int attempt = 0; attempt < 2; attempt++) {
+		if(!boneData || attempt > 0) {
+			boneDataSize = std::max<size_t>(boneDataSize * 2, std::max<size_t>(needed * 2, 1 << 20));
+			boneData.reset(new StreamBuffer(boneDataSize, MAX_FRAMES_IN_FLIGHT + 1));
+		}
+		boneData->BeginFrame();
+		allocation = boneData->Allocate(needed, align);
+		if(allocation.data) break;
+	}
+	if(!allocation.data) return;
+
+	size_t offset = 0;
+	for(Animator * animator : animators) {
+		if(animator->GetSkinningMode() == SkinningMode::CPU) continue;
+		const std::vector<glm::mat4> & palette = animator->GetPalette();
+		size_t size = std::max<size_t>(palette.size(), 1) * sizeof(glm::mat4);
+		if(!palette.empty()) std::memcpy((unsigned char*)allocation.data + offset, palette.data(), palette.size() * sizeof(glm::mat4));
+		animator->SetPaletteRange(allocation.buffer, allocation.offset + offset, size);
+		offset += (size + align - 1) / align * align;
+	}
+	boneData->Flush();
+}
+
+void Scene::applySkinningMode(Actor & actor) {
+	if(skinningMode == SkinningMode::GPU && !GLEW_ARB_shader_storage_buffer_object) {
+		std::cout << "CGL::WARNING::SCENE::SETSKINNINGMODE() GPU skinning needs shader storage buffers, using CPU skinning\n";
+		skinningMode = SkinningMode::CPU;
+	}
+	actor.GetAnimator()->SetSkinningMode(skinningMode);
+	if(!actor.GetShaderPermutationPtr()) return;
+	ShaderFeatures features = actor.GetShaderFeatures() & ~ShaderFeature::SKINNING;
+	if(skinningMode == SkinningMode::GPU) features |= ShaderFeature::SKINNING;
+	actor.SetShaderFeatures(features);
+}
+
+void Scene::cullOccluded() {
+	while(occlusionBuffers.size() < frameViews.size())
+		occlusionBuffers.emplace_back(new OcclusionBuffer(occlusionWidth, occlusionHeight));
+
+	// Views have their own buffers, they are filled in parallel
+	std::vector<size_t> occluders;
+	// Animated Actors don't occlude, their CPU side vertices are the bind pose
+	for(size_t i = 0; i < visibleActors.size(); i++)
+		if(visibleActors[i]->IsOccluder() && !visibleActors[i]->GetAnimator()) occluders.push_back(i);
+	stats.occluders = (unsigned int)occluders.size();
+	if(occluders.empty()) return;
+
+	jobs.ParallelFor(frameViews.size(), 1, [this, &occluders](size_t begin, size_t end) {
+		for(size_t view = begin; view < end; view++) {
+			OcclusionBuffer & buffer = *occlusionBuffers[view];
+			buffer.Clear(frameViews[view].camera->GetViewProjectionMatrix());
+			for(size_t index : occluders) {
+				if(!(visibleViews[index] & (1u << view))) continue;
+				Actor * actor = visibleActors[index];
+				const std::vector<Mesh> & meshes = actor->GetModelPtr()->GetMeshes();
+				for(size_t mesh = 0; mesh < meshes.size(); mesh++)
+					buffer.RasterizeMesh(meshes[mesh], actor->GetMeshMatrix(mesh));
+			}
+			buffer.BuildPyramid();
+		}
+	});
+
+	// Occluders themselves are always drawn
+	jobs.ParallelFor(visibleActors.size(), 128, [this](size_t begin, size_t end) {
+		glm::vec3 min, max;
+		for(size_t i = begin; i < end; i++) {
+			Actor * actor = visibleActors[i];
+			if(actor->IsOccluder()) continue;
+			actor->GetWorldBounds(min, max);
+			for(uint32_t pending = visibleViews[i]; pending; pending &= pending - 1) {
+				size_t view = 0;
+				while(!(pending & (1u << view))) view++;
+				if(occlusionBuffers[view]->IsOccluded(min, max)) visibleViews[i] &= ~(1u << view);
+			}
+		}
+	});
+
+	// Drop Actors hidden in all views
+	size_t kept = 0;
+	for(size_t i = 0; i < visibleActors.size(); i++) {
+		if(!visibleViews[i]) continue;
+		visibleActors[kept] = visibleActors[i];
+		visibleViews[kept] = visibleViews[i];
+		kept++;
+	}
+	stats.occludedActors = (unsigned int)(visibleActors.size() - kept);
+	visibleActors.resize(kept);
+	visibleViews.resize(kept);
+}
+
+void Scene::buildStaticBatch() {
+	staticBatchDirty = false;
+	std::vector<Actor*> batched;
+	for(auto & actor : actors) {
+		bool batchable = staticBatching && isBatchable(*actor);
+		actor->SetBatched(batchable);
+		if(batchable) batched.push_back(actor.get());
+	}
+	if(batched.empty()) staticBatch.Clear();
+	else staticBatch.Build(batched);
+}
+
+bool Scene::isBatchable(const Actor & actor) const {
+	return actor.GetShapePtr()->IsStatic() && !actor.IsTransparent() && !actor.GetAnimator() && !actor.GetParent();
+}
+
+void Scene::buildRenderQueue(glm::vec3 cameraPosition) {
+	renderQueue.resize(visibleActors.size());
+	jobs.ParallelFor(visibleActors.size(), 256, [this, cameraPosition](size_t begin, size_t end) {
+		glm::vec3 min, max;
+		for(size_t i = begin; i < end; i++) {
+			Actor * actor = visibleActors[i];
+			RenderItem & item = renderQueue[i];
+			item.actor = actor;
+			// Not resolved yet variants of a ShaderPermutation land in one group
+			item.program = actor->GetShaderProgramPtr().get();
+			item.model = actor->GetModelPtr().get();
+			actor->GetWorldBounds(min, max);
+			item.center = .5f * (min + max);
+			glm::vec3 offset = item.center - cameraPosition;
+			item.depth = glm::dot(offset, offset);
+			item.transparent = actor->IsTransparent();
+			item.batched = actor->IsBatched();
+			item.views = visibleViews[i];
+		}
+	});
+
+	// Batched Actors go last and are dropped, the StaticBatch draws them;
+	// transparent ones are ordered per view by sortTransparent()
+	std::sort(renderQueue.begin(), renderQueue.end(), [](const RenderItem & a, const RenderItem & b) {
+		if(a.batched != b.batched) return b.batched;
+		if(a.transparent != b.transparent) return b.transparent;
+		if(a.transparent) return false;
+		if(a.program != b.program) return a.program < b.program;
+		if(a.model != b.model) return a.model < b.model;
+		return a.depth < b.depth;
+	});
+	while(!renderQueue.empty() && renderQueue.back().batched) renderQueue.pop_back();
+	transparentBegin = renderQueue.size();
+	while(transparentBegin > 0 && renderQueue[transparentBegin - 1].transparent) transparentBegin--;
+}
+
+void Scene::sortTransparent(uint32_t bit, glm::vec3 cameraPosition) {
+	viewTransparent.clear();
+	for(size_t i = transparentBegin; i < renderQueue.size(); i++) {
+		const RenderItem & item = renderQueue[i];
+		if(!(item.views & bit)) continue;
+		glm::vec3 offset = item.center - cameraPosition;
+		viewTransparent.push_back(std::make_pair(glm::dot(offset, offset), &item));
+	}
+	std::sort(viewTransparent.begin(), viewTransparent.end(),
+			[](const std::pair<float, const RenderItem*> & a, const std::pair<float, const RenderItem*> & b) { return a.first > b.first; });
+}
+
+void Scene::streamTextures() {
+	// Pixels per world unit at distance 1 of every view
+	std::vector<float> pixelScales(frameViews.size());
+	for(size_t v = 0; v < frameViews.size(); v++)
+		pixelScales[v] = .5f * frameViews[v].camera->GetProjectionMatrix()[1][1] * (float)frameViews[v].height;
+
+	for(size_t i = 0; i < visibleActors.size(); i++) {
+		Actor * actor = visibleActors[i];
+		const std::vector<Texture> & textures = actor->GetModelPtr()->GetTextures();
+		if(textures.empty()) continue;
+
+		// The view the Actor is largest in decides
+		glm::vec3 min, max; actor->GetWorldBounds(min, max);
+		float radius = .5f * glm::length(max - min);
+		float pixels = 0.f;
+		for(size_t v = 0; v < frameViews.size(); v++) {
+			if(!(visibleViews[i] & (1u << v))) continue;
+			float distance = glm::length(.5f * (min + max) - frameViews[v].camera->GetPosition());
+			pixels = std::max(pixels, distance > radius ? 2.f * radius * pixelScales[v] / distance : (float)frameViews[v].height * 8.f);
+		}
+
+		for(const Texture & texture : textures)
+			textureStreamer->Request(texture.id, pixels);
+	}
+	textureStreamer->Update();
+}
+
+void Scene::updateActivationStates() {
+	stats.activeBodies = stats.sleepingBodies = stats.staticBodies = 0;
+	for(auto & body : bodies) {
+		bool changed = body->UpdateActivationState();
+		if(body->IsStatic()) { stats.staticBodies++; continue; }
+
+		if(body->IsSleeping()) stats.sleepingBodies++;
+		else stats.activeBodies++;
+
+		if(changed && activationCallback)
+			activationCallback(body->GetName(), body->IsSleeping());
+	}
+}
+
+void Scene::resetBroadphase() {
+	// Removing a body drops its proxy with all its pairs, collision algorithms and manifolds;
+	// resetPool() only resets the (then empty) tree and its proxy ids
+	for(auto & body : bodies)
+		if(body->GetRigidBody()) dynamicWorld->removeRigidBody(body->GetRigidBody());
+	broadphaseInterface->resetPool(dispatcher);
+	for(auto & body : bodies)
+		if(body->GetRigidBody()) dynamicWorld->addRigidBody(body->GetRigidBody());
+	dynamicWorld->updateAabbs();
+}
+
+void Scene::runFrame(bool freeze, float deltaTime) {
+	// Run physics if not freeze (unless the step was started with the previous frame)
+	if(simulationPending) {
+		ProfileScope scope(profiler, "Physics");
+		finishSimulation();
+	}
+	else if(!freeze) {
+		ProfileScope scope(profiler, "Physics");
+		dynamicWorld->stepSimulation(1.f/60.f, 10.f);
+		simulationStep++;
+		updateActivationStates();
+	}
+	// animation clips follow the simulation, poses are evaluated for the visible Actors by draw()
+	if(!freeze)
+		for(Actor * actor : animatedActors) actor->GetAnimator()->Advance(deltaTime);
+	// fetch transforms of moving bodies only
+	profiler.BeginScope("Sync");
+	syncActorTransforms();
+	profiler.EndScope();
+	// render everything
+	draw();
+	// simulate the next frame while the GPU renders this one
+	if(!freeze && !lowLatency && framesInFlight > 1)
+		startSimulation();
+}
+
+void Scene::waitForFrameSlot() {
+	unsigned int limit = lowLatency ? 1 : framesInFlight;
+	if(frameIndex < limit) return;
+	GLsync fence = frameFences[(frameIndex - limit) % MAX_FRAMES_IN_FLIGHT];
+	if(!fence) return;
+
+	ProfileScope scope(profiler, "FrameWait");
+	GLenum result;
+	do result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+	while(result == GL_TIMEOUT_EXPIRED);
+}
+
+void Scene::endFrame() {
+	GLsync & fence = frameFences[frameIndex % MAX_FRAMES_IN_FLIGHT];
+	if(fence) glDeleteSync(fence);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	// Let the GPU start on this frame while the CPU prepares the next one
+	glFlush();
+	frameIndex++;
+}
+
+void Scene::startSimulation() {
+	// The step touches Bullet objects only, Actors keep their cached matrices
+	pendingSimulation = jobs.Schedule([this]() {
+		dynamicWorld->stepSimulation(1.f/60.f, 10.f);
+	});
+	simulationPending = true;
+}
+
+void Scene::finishSimulation() {
+	if(!simulationPending) return;
+	jobs.Wait(pendingSimulation);
+	simulationPending = false;
+	simulationStep++;
+	updateActivationStates();
+}
+
+unsigned long long Scene::waitForSimulation() const {
+	while(!pendingSimulation.IsDone())
+		std::this_thread::yield();
+	// A finished but not yet processed step has already moved the bodies
+	return simulationPending ? simulationStep + 1 : simulationStep;
+}
+
+void Scene::stepSimulation(float deltaTime) {
+	// maxSubSteps == 0 makes Bullet do exactly one step of deltaTime
+	// instead of accumulating time and interpolating motion states
+	dynamicWorld->stepSimulation(deltaTime, 0);
+	simulationStep++;
+	updateActivationStates();
+}
+
+void Scene::syncActorTransforms(bool force) {
+	// Bodies in parallel, every Actor sets only its own transform
+	jobs.ParallelFor(actors.size(), 256, [this, force](size_t begin, size_t end) {
+		for(size_t i = begin; i < end; i++)
+			if(actors[i]->SyncTransform(force)) transforms.SetLocal(actors[i]->GetTransform(), actors[i]->GetModelMatrix());
+	});
+
+	// One pass over the parent sorted transforms, only changed subtrees are recomputed
+	stats.updatedTransforms = transforms.Update(force);
+
+	// Matrices and bounds of the Actors which moved, the SpatialIndex (btDbvt) isn't thread safe
+	syncedBounds.resize(actors.size());
+	jobs.ParallelFor(actors.size(), 256, [this](size_t begin, size_t end) {
+		for(size_t i = begin; i < end; i++) {
+			Actor & actor = *actors[i];
+			SyncedBounds & bounds = syncedBounds[i];
+			bounds.synced = transforms.WasUpdated(actor.GetTransform());
+			if(bounds.synced) actor.SetModelMatrix(transforms.GetWorld(actor.GetTransform()));
+			// Nodes moved alone change the bounds as well
+			const std::vector<TransformHandle> & nodes = actor.GetNodeTransforms();
+			for(size_t node = 0; node < nodes.size(); node++) {
+				if(!transforms.WasUpdated(nodes[node])) continue;
+				actor.SetNodeMatrix(node, transforms.GetWorld(nodes[node]));
+				bounds.synced = true;
+			}
+			if(bounds.synced) actor.GetWorldBounds(bounds.min, bounds.max);
+		}
+	});
+
+	stats.syncedActors = 0;
+	for(size_t i = 0; i < actors.size(); i++) {
+		if(!syncedBounds[i].synced) continue;
+		spatialIndex.Update(actors[i].get(), syncedBounds[i].min, syncedBounds[i].max);
+		stats.syncedActors++;
+	}
+	spatialIndex.Optimize();
+}
+
+void Scene::createNodeTransforms(Actor & actor) {
+	std::shared_ptr<Model> model = actor.GetModelPtr();
+	const std::vector<SkeletonNode> & nodes = model->GetSkeleton().nodes;
+	std::vector<TransformHandle> handles;
+	for(size_t i = 0; i < nodes.size(); i++) {
+		TransformHandle parent = nodes[i].parent < 0 ? actor.GetTransform() : handles[nodes[i].parent];
+		handles.push_back(transforms.Create(parent, model->GetNodeTransform((int)i)));
+	}
+	actor.SetNodeTransforms(handles);
 }
 /* Private Methods */
 } /* namespace CGL */
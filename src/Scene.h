@@ -13,6 +13,11 @@
  * 3. add a ShaderProgram with it's name
  * 4. create a new Actor wit added Model and ShaderProgram
  * 5. Run cycle of the Scene with RunScene() (normally inside your "Game Loop")
+ *
+ * A headless Scene (no OpenGL context, no GLFW window) only simulates physics bodies:
+ * 1. create a Scene object with headless=true
+ * 2. add physics primitives
+ * 3. advance the simulation with StepScene() and a fixed time step
  */
 
 #ifndef SCENE_H_
@@ -20,9 +25,22 @@
 
 #include "ResourceManager.h"
 #include "ShaderProgram.h"
+#include "ShaderPermutation.h"
 #include "Camera.h"
 #include "Model.h"
+#include "PrimitiveMesh.h"
 #include "Actor.h"
+#include "Snapshot.h"
+#include "SpatialIndex.h"
+#include "OcclusionBuffer.h"
+#include "Light.h"
+#include "LightGrid.h"
+#include "ShadowMap.h"
+#include "StaticBatch.h"
+#include "TransformHierarchy.h"
+#include "Profiler.h"
+#include "StreamBuffer.h"
+#include "JobSystem.h"
 
 #include <GLFW/glfw3.h>
 
@@ -32,10 +50,51 @@
 
 #include <vector>
 #include <map>
+#include <memory>
 #include <iterator>
+#include <functional>
+#include <algorithm>
 
 namespace CGL {
 
+/*
+ * Per frame statistics of a Scene
+ */
+struct SceneStats {
+	// Physics bodies by their activation state after the last simulation step
+	unsigned int activeBodies;
+	unsigned int sleepingBodies;
+	unsigned int staticBodies;
+	// Actors which model matrix changed (moved bodies, moved parents)
+	unsigned int syncedActors;
+	// Transforms (Actors and their Models' nodes) which world matrix was recomputed
+	unsigned int updatedTransforms;
+	// Actors which passed frustum and occlusion culling and were drawn
+	unsigned int drawnActors;
+	unsigned int culledActors;
+	// Actors inside a view frustum but hidden behind occluders (in all views)
+	unsigned int occludedActors;
+	// Occluder Actors rasterized into the occlusion buffers
+	unsigned int occluders;
+	// Visible Actors which ShaderProgram is still compiling (skipped or drawn with the fallback)
+	unsigned int pendingActors;
+	// Visible animated Actors which pose was evaluated (and skinned)
+	unsigned int animatedActors;
+	// Draw calls and visible chunks of the StaticBatch (all views)
+	unsigned int staticBatchDraws;
+	unsigned int visibleChunks;
+};
+
+/*
+ * Upper limit of Scene::SetFramesInFlight()
+ */
+const unsigned int MAX_FRAMES_IN_FLIGHT = 4;
+
+/*
+ * Called when a physics body falls asleep (sleeping=true) or wakes up (sleeping=false)
+ */
+typedef std::function<void(const std::string & body_name, bool sleeping)> ActivationCallback;
+
 class Scene {
 public:
 
@@ -44,8 +103,10 @@ public:
 	 * screen size parameters and camera settings,
 	 * collection of 2D/3D models,
 	 * and collection of shader programs to render with
+	 * Headless Scene doesn't touch OpenGL nor GLFW, thus it can't hold
+	 * Models, ShaderPrograms or Actors -- only physics bodies
 	 */
-	Scene();
+	Scene(bool headless=false);
 
 	/*
 	 * Delete dynamic world ptr and all of it's dependencies
@@ -72,22 +133,50 @@ public:
 
 	/*
 	 * Model (loaded wit Assimp) and ShaderProgram for rendering
+	 * Async ShaderProgram returns immediately and is compiled in the background,
+	 * Actors using it are drawn with the fallback program (or skipped) until it's ready
 	 */
-	std::string AddShaderProgram(std::string shader_name, std::string vert_path, std::string frag_path);
+	std::string AddShaderProgram(std::string shader_name, std::string vert_path, std::string frag_path, bool async=false);
 	std::string AddModel(std::string model_name, std::string model_path);
 
+	/*
+	 * Texture packing of Models added after the call (see TexturePacking)
+	 * Actors using a ShaderPermutation get the matching ShaderFeature automatically
+	 */
+	void SetTexturePacking(TexturePacking packing);
+
+	/*
+	 * Base shader for feature variants (see ShaderPermutation)
+	 * Its name can be used in AddActor() in place of a ShaderProgram name
+	 */
+	std::string AddShaderPermutation(std::string permutation_name, std::string vert_path, std::string frag_path, bool async=false);
+
 
 	/*
 	 * This method adds Actor to the scene.
 	 * Model, ShaderProgram and PrimitiveShape objects has to be
 	 * present at the time of calling AddActor()
+	 * shaderFeatures select the variant when shaderProgram_name is a ShaderPermutation
 	 */
-	std::string AddActor(std::string actor_name, std::string model_name, std::string shaderProgram_name, std::string primitiveShape_name, bool isTransparent=false);
+	std::string AddActor(std::string actor_name, std::string model_name, std::string shaderProgram_name, std::string primitiveShape_name, bool isTransparent=false, ShaderFeatures shaderFeatures=ShaderFeature::NONE);
+
+	/*
+	 * Actor drawn with the built-in mesh of its PrimitiveShape's type (see PrimitiveMesh.h),
+	 * no Model has to be added: all such Actors of a type share one mesh, scaled to their
+	 * bodies, so they are grouped (and batched) together
+	 */
+	std::string AddPrimitiveActor(std::string actor_name, std::string shaderProgram_name, std::string primitiveShape_name, bool isTransparent=false, ShaderFeatures shaderFeatures=ShaderFeature::NONE);
+
+	/*
+	 * Tessellation of built-in meshes of Actors added after the call (1, 1 and 16 by default)
+	 */
+	void SetPrimitiveTessellation(int planeSegments, int boxSegments, int sphereSegments);
 
 	/*
 	 * Add physics primitives for actors
+	 * (planes are infinite, the built-in mesh covers renderHalfSize around the body)
 	 */
-	std::string AddPrimitivePlane(std::string body_name, glm::mat4 modelMatrix, btVector3 planeNormal, btScalar planeConstatnt);
+	std::string AddPrimitivePlane(std::string body_name, glm::mat4 modelMatrix, btVector3 planeNormal, btScalar planeConstatnt, btScalar renderHalfSize=50.f);
 	std::string AddPrimitiveBox(std::string body_name, glm::mat4 modelMatrix, btScalar mass, btVector3 boxDimensions);
 	std::string AddPrimitiveSphere(std::string body_name, glm::mat4 modelMatrix, btScalar mass, btScalar sphereRadius);
 
@@ -96,17 +185,167 @@ public:
 	 */
 	void DelActor(std::string actorName);
 
+	/*
+	 * Transform hierarchy of Actors and the nodes of their Models:
+	 * an attached Actor follows its parent with a local transform (its own body's
+	 * transform isn't used then), DetachActor() leaves it where it is until its body moves.
+	 * Nodes of an Actor's Model can be moved for this Actor alone (not for skinned Models,
+	 * their nodes follow the Animator). Only transforms below changed ones are
+	 * recomputed every frame.
+	 */
+	bool AttachActor(std::string child_name, std::string parent_name, glm::mat4 localMatrix=glm::mat4(1.f));
+	void DetachActor(std::string actor_name);
+	void SetActorLocalTransform(std::string actor_name, glm::mat4 localMatrix);
+	bool SetActorNodeTransform(std::string actor_name, std::string node_name, glm::mat4 localMatrix);
+
 	/*
 	 * Set Acotr's linear velocity in Bullet
 	 */
 	void SetActorLinearVelocity(std::string actor_name, glm::vec3 direction, float value);
 
+	/*
+	 * Switch Actor to another variant of its ShaderPermutation
+	 */
+	void SetActorShaderFeatures(std::string actor_name, ShaderFeatures shaderFeatures);
+
+	/*
+	 * Control over deactivation (sleeping) of physics bodies.
+	 * Sleeping bodies are neither simulated nor synchronized with their Actors.
+	 */
+	void SetPrimitiveDeactivationThresholds(std::string body_name, btScalar linearThreshold, btScalar angularThreshold);
+	void SetPrimitiveDeactivationEnabled(std::string body_name, bool enabled);
+
+	/*
+	 * ShaderProgram used for Actors which own program isn't ready yet
+	 * (empty name to skip such Actors, which is the default)
+	 */
+	void SetFallbackShaderProgram(std::string shaderProgram_name);
+
+	/*
+	 * Stream Model textures within a GPU memory budget (see TextureStreamer)
+	 * Affects Models added after the call; calling it again changes the budget
+	 */
+	void EnableTextureStreaming(size_t budgetBytes, size_t uploadBytesPerFrame=4 << 20);
+
+	/*
+	 * Render the Scene from several Cameras in one frame (split-screen, minimaps, ...):
+	 * every view is a Camera drawn into a viewport of a framebuffer (0 is the default one).
+	 * Actors are culled in one traversal against all views and sorted once (transparent ones
+	 * back to front for the first view), then every view draws those inside its frustum.
+	 * Depth of a view's viewport is cleared before it's drawn, color is left to the application.
+	 * Without views the current Camera is drawn into the framebuffer and viewport
+	 * set up by the application.
+	 */
+	std::string AddView(std::string camera_name, int x, int y, int width, int height, GLuint framebuffer=0);
+	void ClearViews();
+
+	/*
+	 * Occlusion culling: every frame the visible occluder Actors are rasterized
+	 * on the CPU into a width x height depth buffer per view, other Actors hidden
+	 * behind them aren't drawn. Good occluders are big, low-poly and opaque
+	 * (walls, buildings, terrain); their bounding boxes don't need to be filled.
+	 */
+	void SetOcclusionCulling(bool enabled, int width=256, int height=128);
+	void SetActorOccluder(std::string actor_name, bool occluder);
+
+	/*
+	 * Lights of the Scene, evaluated by Actors' shaders with clustered forward lighting:
+	 * every view assigns the point lights to clusters of its frustum and binds them
+	 * as shader storage buffers (see LightGrid.h for their GLSL declarations)
+	 */
+	std::string AddPointLight(std::string light_name, glm::vec3 position, glm::vec3 color, float intensity, float radius);
+	std::string AddDirectionalLight(std::string light_name, glm::vec3 direction, glm::vec3 color, float intensity);
+	void SetLightPosition(std::string light_name, glm::vec3 position);
+	void SetLightColor(std::string light_name, glm::vec3 color, float intensity);
+	void DelLight(std::string light_name);
+
+	/*
+	 * Clusters in x, y and z (16x9x24 by default) and the depth covered by the slices
+	 */
+	void SetLightGrid(int x, int y, int z, float maxDistance=500.f);
+
+	/*
+	 * Cascaded shadow maps of a directional Light (empty name turns shadows off),
+	 * fitted to the first view's Camera up to distance. Shadows of static Actors
+	 * (mass 0) are cached and re-rendered only when a cascade moves, so the per frame
+	 * cost follows the moving Actors; caching can be turned off for comparison.
+	 * Actors' shaders sample them through CGLShadows and cglShadowMap (see ShaderProgram.h).
+	 */
+	void SetShadows(std::string light_name, int cascades=4, int resolution=2048, float distance=100.f);
+	void SetShadowCaching(bool enabled);
+
+	/*
+	 * Skeletal animation of Actors with skinned Models (every such Actor gets an Animator).
+	 * Clips advance with the frame time; poses of visible Actors (and shadow casters)
+	 * are evaluated on the JobSystem.
+	 * GPU skinning (default, needs shader storage buffers) binds the bone palette
+	 * at BONE_BUFFER_BINDING and adds ShaderFeature::SKINNING to ShaderPermutation Actors
+	 * (see Animator.h for the GLSL), CPU skinning draws skinned vertex buffers instead.
+	 * Shadows are skinned in both modes; animated Actors are never occluders.
+	 */
+	bool PlayAnimation(std::string actor_name, std::string clip_name, bool loop=true, float speed=1.f, float fadeSeconds=0.f);
+	void StopAnimation(std::string actor_name);
+	void SetSkinningMode(SkinningMode mode);
+
+	/*
+	 * Static batching: opaque Actors with static bodies (mass 0), no Animator and
+	 * no parent are merged into a StaticBatch (world space chunks of chunkSize,
+	 * see StaticBatch.h) and drawn with a few glMultiDrawElements() calls instead of
+	 * one draw per Actor. The batch is rebuilt on the next frame whenever such Actors
+	 * are added, deleted, attached or change their ShaderFeatures. Shadows are still
+	 * cast per Actor. Off by default.
+	 */
+	void SetStaticBatching(bool enabled, float chunkSize=32.f);
+
+	/*
+	 * Projection of the current Camera: vertical field of view in degrees and
+	 * clip planes (farPlane <= 0 for an infinite projection); 45, .1 and 100 by default
+	 * Reverse-Z (needs glClipControl()) switches the depth test to GL_GREATER and
+	 * depth clear value to 0, the depth buffer is cleared once on the switch
+	 */
+	void SetCameraProjection(float fieldOfView, float nearPlane, float farPlane);
+	void SetCameraReverseZ(bool enabled);
+
+	/*
+	 * Frame pipeline of RunScene():
+	 * - at most frames (1..MAX_FRAMES_IN_FLIGHT, 2 by default) submitted frames
+	 *   are waited for by the GPU, RunScene() blocks before input handling otherwise
+	 * - with more than one frame in flight the simulation step of the next frame
+	 *   runs on the JobSystem while the GPU renders the current one; changes of
+	 *   bodies made between RunScene() calls take effect a step later then
+	 * Low latency mode waits until the GPU finished the previous frame and
+	 * simulates in RunScene() itself, which minimizes input to display latency
+	 * at the cost of CPU/GPU overlap
+	 */
+	void SetFramesInFlight(unsigned int frames);
+	void SetLowLatencyMode(bool enabled);
+
+	/*
+	 * Callback invoked after a simulation step for every body
+	 * that has fallen asleep or woken up during that step
+	 */
+	void SetActivationCallback(ActivationCallback callback);
+
 	/*
 	 * Update information about screen, process input events,
 	 * make Bullet dynamic world simulation step and render all actors.
 	 */
 	void RunScene(GLFWwindow* window, float deltaFrame, bool freeze, bool freeCam);
 
+	/*
+	 * Same as above, but without a GLFW window and input handling,
+	 * e.g. for rendering into a framebuffer object of an offscreen context
+	 */
+	void RunScene(int framebuffer_width, int framebuffer_height, bool freeze);
+
+	/*
+	 * Advance the simulation by a given number of steps of exactly fixedDeltaTime each
+	 * without input handling and rendering (works in both normal and headless mode).
+	 * With the same bodies created in the same order the resulting state is bit-identical
+	 * between runs.
+	 */
+	void StepScene(float fixedDeltaTime, unsigned int steps=1);
+
 	/*
 	 * Get names of Resources of a given Type loaded into the ResourceManger
 	 */
@@ -118,6 +357,81 @@ public:
 	glm::vec3 GetCameraPosition() const;
 	glm::vec3 GetCameraFront() const;
 
+	/*
+	 * Get names of Actors which bounding boxes overlap a given box or sphere (in world space)
+	 */
+	std::vector<std::string> QueryActorsInBox(glm::vec3 min, glm::vec3 max) const;
+	std::vector<std::string> QueryActorsInRadius(glm::vec3 center, float radius) const;
+
+	/*
+	 * Get statistics of the last RunScene() call
+	 */
+	SceneStats GetSceneStats() const;
+
+	/*
+	 * Texture streaming statistics after the last frame (zeros if disabled)
+	 */
+	TextureStreamerStats GetTextureStreamerStats() const;
+
+	/*
+	 * Light assignment statistics of the first view in the last frame
+	 */
+	LightGridStats GetLightGridStats() const;
+
+	/*
+	 * Shadow casters drawn in the last frame (zeros without shadows)
+	 */
+	ShadowStats GetShadowStats() const;
+
+	/*
+	 * Contents of the StaticBatch as of its last build (zeros if disabled)
+	 */
+	StaticBatchStats GetStaticBatchStats() const;
+
+	/*
+	 * Every RunScene()/StepScene() call is a Profiler frame with scopes:
+	 * FrameWait, Input, Physics, Sync, Culling, Occlusion, Batching, Queue, Animation, Streaming, Shadows and Draw (both also timed on the GPU)
+	 * with Lights inside it
+	 */
+	Profiler & GetProfiler();
+
+	/*
+	 * Work stealing scheduler running the per frame work of the Scene
+	 * (and Bullet's parallel loops when it's built with BT_THREADSAFE),
+	 * free for the application's own jobs as well
+	 */
+	JobSystem & GetJobSystem();
+
+	/*
+	 * Headless mode and simulation state queries
+	 */
+	bool IsHeadless() const;
+	unsigned long long GetSimulationStep() const;
+	glm::mat4 GetPrimitiveModelMatrix(std::string body_name);
+
+	/*
+	 * FNV-1a hash of transforms, velocities and activation states of all bodies
+	 * Equal hashes of two runs mean bit-identical simulation state
+	 */
+	unsigned long long GetSimulationStateHash() const;
+
+	/*
+	 * Snapshot of all physics bodies (transforms, velocities, activation states)
+	 * in a flat buffer (see Snapshot.h). LoadSnapshot() requires the same bodies
+	 * as at the time of saving and returns false otherwise.
+	 * Loading also drops cached contacts and solver state, thus simulating
+	 * from the same snapshot always gives the same results.
+	 */
+	void SaveSnapshot(std::vector<unsigned char> & buffer) const;
+	bool LoadSnapshot(const std::vector<unsigned char> & buffer);
+
+	/*
+	 * Delta snapshots contain only the bodies which state has changed since the base snapshot
+	 * (sleeping and static bodies are skipped this way)
+	 */
+	bool SaveSnapshotDelta(const std::vector<unsigned char> & base, std::vector<unsigned char> & delta) const;
+	bool LoadSnapshotDelta(const std::vector<unsigned char> & base, const std::vector<unsigned char> & delta);
+
 private:
 	/*
 	 * Screen width and height from GLFW frame buffer
@@ -132,6 +446,154 @@ private:
 	std::shared_ptr<Camera> current_camera;
 	// Is freeCam mode enabled (affect all Cameras)
 	bool freeCam;
+	// No OpenGL context and GLFW window
+	bool headless;
+	// Number of simulation steps done so far
+	unsigned long long simulationStep;
+
+	/*
+	 * Actors and physics bodies in order of their creation,
+	 * so the per frame paths don't have to search the ResourceManager
+	 */
+	std::vector<std::shared_ptr<Actor>> actors;
+	std::vector<std::shared_ptr<PrimitiveShape>> bodies;
+
+	// World matrices of Actors and their Models' nodes
+	TransformHierarchy transforms;
+
+	ActivationCallback activationCallback;
+	SceneStats stats;
+
+	std::shared_ptr<ShaderProgram> fallbackShader;
+
+	// Depth convention the GL state was set up for (see applyDepthConvention())
+	bool reverseZApplied;
+
+	/*
+	 * Per-frame uniform data (FrameUniforms) ring, created with the first frame drawn
+	 */
+	std::unique_ptr<StreamBuffer> frameData;
+	GLint frameDataAlignment;
+
+	// Shared with Models, which hand their textures over to it
+	std::shared_ptr<TextureStreamer> textureStreamer;
+	TexturePacking texturePacking;
+
+	/*
+	 * Built-in meshes by (Shape, segments), shared by all Actors of the Scene
+	 */
+	std::map<std::pair<int, int>, std::shared_ptr<Model>> primitiveModels;
+	int planeSegments, boxSegments, sphereSegments;
+
+	/*
+	 * World space bounding boxes of Actors, refreshed for awake bodies only
+	 * visibleActors is reused between frames to avoid allocations
+	 */
+	SpatialIndex spatialIndex;
+	std::vector<Actor*> visibleActors;
+
+	/*
+	 * Cameras rendered into viewports (AddView()); frameViews, frameFrusta and
+	 * visibleViews (bit mask of views per visible Actor) are per frame scratch
+	 */
+	struct View {
+		std::shared_ptr<Camera> camera;
+		int x, y, width, height;
+		GLuint framebuffer;
+	};
+	std::vector<View> views;
+	std::vector<View> frameViews;
+	std::vector<Frustum> frameFrusta;
+	std::vector<uint32_t> visibleViews;
+
+	/*
+	 * Occlusion buffers, one per view, created on demand
+	 */
+	bool occlusionCulling;
+	int occlusionWidth, occlusionHeight;
+	std::vector<std::unique_ptr<OcclusionBuffer>> occlusionBuffers;
+
+	/*
+	 * Lights in order of their creation, assigned to clusters per view
+	 */
+	std::vector<std::shared_ptr<Light>> lights;
+	LightGrid lightGrid;
+	LightGridStats lightGridStats;
+
+	/*
+	 * Shadows of shadowLight; casters and their cascade masks are per frame scratch
+	 */
+	std::shared_ptr<Light> shadowLight;
+	std::unique_ptr<ShadowMap> shadowMap;
+	std::vector<Frustum> shadowFrusta;
+	std::vector<Actor*> shadowCasters;
+	std::vector<uint32_t> shadowMasks;
+	ShadowStats shadowStats;
+
+	/*
+	 * Actors with an Animator; animators is per frame scratch (visible ones),
+	 * their GPU palettes are written to the boneData ring
+	 */
+	std::vector<Actor*> animatedActors;
+	std::vector<Animator*> animators;
+	SkinningMode skinningMode;
+	std::unique_ptr<StreamBuffer> boneData;
+	size_t boneDataSize;
+	GLint boneDataAlignment;
+
+	/*
+	 * Static Actors merged into staticBatch, rebuilt in draw() when staticBatchDirty
+	 */
+	bool staticBatching;
+	bool staticBatchDirty;
+	StaticBatch staticBatch;
+
+	/*
+	 * Visible Actors in drawing order: opaque ones grouped by ShaderProgram and Model,
+	 * then transparent ones from transparentBegin (batched ones aren't in it).
+	 * Every view draws the transparent ones back to front from its own camera.
+	 */
+	struct RenderItem {
+		Actor * actor;
+		const void * program;
+		const void * model;
+		glm::vec3 center;
+		float depth;
+		bool transparent;
+		bool batched;
+		uint32_t views;
+	};
+	std::vector<RenderItem> renderQueue;
+	size_t transparentBegin;
+	std::vector<std::pair<float, const RenderItem*>> viewTransparent;
+
+	/*
+	 * Results of the parallel part of syncActorTransforms(), one per Actor
+	 */
+	struct SyncedBounds {
+		glm::vec3 min, max;
+		bool synced;
+	};
+	std::vector<SyncedBounds> syncedBounds;
+
+	JobSystem jobs;
+
+	/*
+	 * Frame pipeline: fences of the last submitted frames (frame % MAX_FRAMES_IN_FLIGHT)
+	 * and the simulation step started for the next frame
+	 */
+	GLsync frameFences[MAX_FRAMES_IN_FLIGHT];
+	unsigned long long frameIndex;
+	unsigned int framesInFlight;
+	bool lowLatency;
+	JobHandle pendingSimulation;
+	bool simulationPending;
+
+#if BT_THREADSAFE
+	std::unique_ptr<BulletTaskScheduler> bulletScheduler;
+#endif
+
+	Profiler profiler;
 
 	/*
 	 * Bullet Dynamic World with it's dependencies
@@ -144,6 +606,12 @@ private:
 	btSequentialImpulseConstraintSolver * solver;
 	btDiscreteDynamicsWorld * dynamicWorld;
 
+	/*
+	 * Common part of AddActor() and AddPrimitiveActor(), fitToShape applies
+	 * the PrimitiveShape's mesh matrix
+	 */
+	std::string addActor(std::string actor_name, std::shared_ptr<Model> model, std::string shaderProgram_name, std::string primitiveShape_name, bool isTransparent, ShaderFeatures shaderFeatures, bool fitToShape);
+
 	/*
 	 * Get shared_ptr to specific resources
 	 */
@@ -152,12 +620,129 @@ private:
 	std::shared_ptr<Model> getModel(std::string model_name);
 	std::shared_ptr<Camera> getCamera(std::string camera_name);
 	std::shared_ptr<Actor> getActor(std::string actor_name);
+	std::shared_ptr<Light> getLight(std::string light_name);
 
 	/*
 	 * Draw all actors with respect of their model matrices.
 	 */
 	void draw();
 
+	/*
+	 * Request texture levels for the visible Actors by their largest size in
+	 * any view they are visible in and let the TextureStreamer upload/evict levels
+	 */
+	void streamTextures();
+
+	/*
+	 * Write FrameUniforms of a Camera to the frameData ring
+	 * and bind them at FRAME_UNIFORM_BINDING
+	 */
+	void uploadFrameUniforms(const Camera & camera);
+
+	/*
+	 * Clip depth range, depth test and clear value for the Camera's projection;
+	 * returns true if they changed (between standard and reverse-Z)
+	 */
+	bool applyDepthConvention(Camera & camera);
+	void setDepthConvention(bool reverseZ);
+
+	/*
+	 * Fit the cascades to the first view and cull the shadow casters (with the views,
+	 * before animation), render them later; uploadShadowUniforms() binds the result for the views
+	 */
+	void cullShadowCasters();
+	void renderShadows();
+	void uploadShadowUniforms();
+
+	/*
+	 * Evaluate (and CPU skin) the poses of visible animated Actors (and animated
+	 * shadow casters) in parallel,
+	 * then upload the palettes or skinned vertices; applySkinningMode() sets up
+	 * an Actor for the Scene's SkinningMode
+	 */
+	void animateActors();
+	void applySkinningMode(Actor & actor);
+
+	/*
+	 * Rasterize visible occluders and drop views (and Actors) in which
+	 * visible Actors are hidden behind them
+	 */
+	void cullOccluded();
+
+	/*
+	 * Rebuild the StaticBatch from the eligible Actors and mark them batched
+	 */
+	void buildStaticBatch();
+	bool isBatchable(const Actor & actor) const;
+
+	/*
+	 * Fill and sort the renderQueue from visibleActors
+	 * (opaque ones front to back from cameraPosition within their group)
+	 */
+	void buildRenderQueue(glm::vec3 cameraPosition);
+
+	/*
+	 * Fill viewTransparent with the transparent items visible in the view (bit),
+	 * back to front from its camera
+	 */
+	void sortTransparent(uint32_t bit, glm::vec3 cameraPosition);
+
+	/*
+	 * Refresh activation state of all bodies after a simulation step,
+	 * count them and report those which fell asleep or woke up.
+	 */
+	void updateActivationStates();
+
+	/*
+	 * Rebuild the broadphase from scratch with the bodies in Scene order, so the
+	 * overlapping pairs (and the contact order they lead to) don't depend on history
+	 */
+	void resetBroadphase();
+
+	/*
+	 * Fetch model matrices of Actors with awake bodies (or all of them if forced)
+	 * on all threads of the JobSystem, propagate them through the TransformHierarchy
+	 * and move the Actors which changed in the SpatialIndex.
+	 */
+	void syncActorTransforms(bool force=false);
+
+	/*
+	 * Transforms of the Actor's Model nodes under the Actor's transform
+	 */
+	void createNodeTransforms(Actor & actor);
+
+	/*
+	 * Common part of RunScene(): simulation step and animations (unless frozen),
+	 * Actors synchronization and drawing
+	 */
+	void runFrame(bool freeze, float deltaTime);
+
+	/*
+	 * Block until the GPU is done with the frame framesInFlight frames back
+	 * (the previous one in low latency mode)
+	 */
+	void waitForFrameSlot();
+
+	/*
+	 * Fence the submitted frame and flush it to the GPU
+	 */
+	void endFrame();
+
+	/*
+	 * Start the simulation step of the next frame on the JobSystem;
+	 * finishSimulation() waits for it and processes its results,
+	 * waitForSimulation() only waits (for const readers of the world) and
+	 * returns the step the bodies are at, counting the unprocessed one
+	 */
+	void startSimulation();
+	void finishSimulation();
+	unsigned long long waitForSimulation() const;
+
+	/*
+	 * Make a single simulation step of exactly deltaTime (no interpolation, no substeps)
+	 */
+	void stepSimulation(float deltaTime);
+
 	/*
 	 * Get screen size from GLFW frame buffer.
 	 */
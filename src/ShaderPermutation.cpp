@@ -0,0 +1,68 @@
+#include "ShaderPermutation.h"
+
+#include <iomanip>
+
+namespace CGL {
+
+/* Ctor & Dtor */
+ShaderPermutation::ShaderPermutation(std::string name, std::string vertexFile, std::string fragmentFile, bool async) {
+	// Resource configuration
+	setName(name); setType(Type::SHADERPERMUTATION);
+
+	this->vertexFile = vertexFile;
+	this->fragmentFile = fragmentFile;
+	this->async = async;
+
+	featureDefines[0] = "CGL_INSTANCING";
+	featureDefines[1] = "CGL_SKINNING";
+	featureDefines[2] = "CGL_ALPHA_TEST";
+	featureDefines[3] = "CGL_NORMAL_MAP";
+	featureDefines[4] = "CGL_TEXTURE_ARRAY";
+	featureDefines[5] = "CGL_BINDLESS_TEXTURE";
+	featureDefines[6] = "CGL_CLUSTERED_LIGHTING";
+}
+/* Ctor & Dtor */
+/* Public Methods */
+std::shared_ptr<ShaderProgram> ShaderPermutation::GetVariant(ShaderFeatures features) {
+	std::unordered_map<ShaderFeatures, std::shared_ptr<ShaderProgram>>::iterator it = variants.find(features);
+	if(it != variants.end()) return it->second;
+
+	// Variant name: base name and the key, e.g. "lit#0000000000000006"
+	std::stringstream variantName;
+	variantName << mName << "#" << std::hex << std::setw(16) << std::setfill('0') << features;
+
+	std::shared_ptr<ShaderProgram> variant = std::make_shared<ShaderProgram>(
+			variantName.str(), vertexFile.c_str(), fragmentFile.c_str(), async, definesFor(features));
+	variants[features] = variant;
+	return variant;
+} /* ShaderPermutation::GetVariant(ShaderFeatures features) */
+
+void ShaderPermutation::SetFeatureDefine(ShaderFeatures feature, std::string define) {
+	for(int bit = 0; bit < 64; bit++) {
+		if(feature == (1ull << bit)) {
+			featureDefines[bit] = define;
+			return;
+		}
+	}
+	std::cout << "CGL::WARNING::SHADERPERMUTATION::SETFEATUREDEFINE() Feature of " << mName << " has to be a single bit\n";
+}
+
+size_t ShaderPermutation::GetVariantCount() const {
+	return variants.size();
+}
+/* Public Methods */
+/* Private Methods */
+std::string ShaderPermutation::definesFor(ShaderFeatures features) const {
+	std::string defines;
+	for(int bit = 0; bit < 64; bit++) {
+		if(!(features & (1ull << bit))) continue;
+		if(featureDefines[bit].empty()) {
+			std::cout << "CGL::WARNING::SHADERPERMUTATION::DEFINESFOR() Feature bit " << bit << " of " << mName << " has no define\n";
+			continue;
+		}
+		defines += "#define " + featureDefines[bit] + " 1\n";
+	}
+	return defines;
+}
+/* Private Methods */
+} /* namespace CGL */
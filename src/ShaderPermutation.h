@@ -0,0 +1,87 @@
+/*
+ * ShaderPermutation is a base shader (one vertex and one fragment file)
+ * from which variants are built by feature flags:
+ * - every flag set in the key becomes a #define injected after #version
+ * - a variant is compiled the first time it's requested
+ * - compiled variants are cached by their 64-bit feature key
+ * Shaders select code paths with #ifdef CGL_SKINNING etc. instead of
+ * runtime branching or near-identical copies of the same file.
+ */
+
+#ifndef SHADERPERMUTATION_H_
+#define SHADERPERMUTATION_H_
+
+#include "Resource.h"
+#include "ShaderProgram.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace CGL {
+
+typedef uint64_t ShaderFeatures;
+
+namespace ShaderFeature {
+	const ShaderFeatures NONE        = 0;
+	const ShaderFeatures INSTANCING  = 1ull << 0; // CGL_INSTANCING
+	const ShaderFeatures SKINNING    = 1ull << 1; // CGL_SKINNING
+	const ShaderFeatures ALPHA_TEST  = 1ull << 2; // CGL_ALPHA_TEST
+	const ShaderFeatures NORMAL_MAP  = 1ull << 3; // CGL_NORMAL_MAP
+	// Set by Scene for Models with packed textures (see TexturePacking)
+	const ShaderFeatures TEXTURE_ARRAY    = 1ull << 4; // CGL_TEXTURE_ARRAY
+	const ShaderFeatures BINDLESS_TEXTURE = 1ull << 5; // CGL_BINDLESS_TEXTURE
+	// Light evaluation from the Scene's clustered light grid (see LightGrid)
+	const ShaderFeatures CLUSTERED_LIGHTING = 1ull << 6; // CGL_CLUSTERED_LIGHTING
+} // namespace ShaderFeature
+
+class ShaderPermutation : public Resource {
+public:
+	/*
+	 * Nothing is compiled here, only the paths are stored
+	 * Async variants are compiled like async ShaderPrograms
+	 */
+	ShaderPermutation(std::string name, std::string vertexFile, std::string fragmentFile, bool async=false);
+
+	/*
+	 * Delete Copy Constructor and operator=
+	 */
+	ShaderPermutation(const ShaderPermutation & other) = delete;
+	ShaderPermutation & operator=(const ShaderPermutation & other) = delete;
+
+	/*
+	 * Get the variant for features, compile it if it's not cached yet
+	 */
+	std::shared_ptr<ShaderProgram> GetVariant(ShaderFeatures features);
+
+	/*
+	 * Name the #define of a custom feature bit (the six lowest bits are built-in)
+	 * Has to be called before any variant using that bit is compiled
+	 */
+	void SetFeatureDefine(ShaderFeatures feature, std::string define);
+
+	/*
+	 * Number of variants compiled so far
+	 */
+	size_t GetVariantCount() const;
+
+private:
+	std::string vertexFile;
+	std::string fragmentFile;
+	bool async;
+
+	// #define name of each feature bit (empty for unnamed bits)
+	std::string featureDefines[64];
+
+	std::unordered_map<ShaderFeatures, std::shared_ptr<ShaderProgram>> variants;
+
+	/*
+	 * Build "#define ...\n" lines for every feature set in the key
+	 */
+	std::string definesFor(ShaderFeatures features) const;
+};
+
+} /* namespace CGL */
+
+#endif /* SHADERPERMUTATION_H_ */
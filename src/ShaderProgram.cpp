@@ -1,60 +1,87 @@
 #include "ShaderProgram.h"
 namespace CGL {
 
+std::string ShaderProgram::binaryCacheDirectory;
+
+/*
+ * Header of a cached program binary file
+ */
+struct ProgramBinaryHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t format;
+	uint32_t length;
+};
+static const uint32_t PROGRAM_BINARY_MAGIC = 0x42524743; // "CGRB"
+static const uint32_t PROGRAM_BINARY_VERSION = 1;
+
 /* Ctor & Dtor */
-ShaderProgram::ShaderProgram(std::string name, const char* vertexFile, const char* fragmentFile) {
+ShaderProgram::ShaderProgram(std::string name, const char* vertexFile, const char* fragmentFile, bool async, std::string defines) {
 	// Resource configuration
 	setName(name); setType(Type::SHADERPROGRAM);
 
 	// OpenGL stuff
 	vertex_path = std::string(vertexFile);
 	fragment_path = std::string(fragmentFile);
+	fromBinaryCache = false;
+	frameUniforms = false;
+	status = ProgramStatus::PENDING;
+	vertexShader = fragmentShader = 0;
 	ID = glCreateProgram();
 
-	addShaderToProgram(vertexFile, ShaderType::VERTEX);
-	addShaderToProgram(fragmentFile, ShaderType::FRAGMENT);
+	std::string vertexSource = injectDefines(readFileToSource(vertexFile), defines);
+	std::string fragmentSource = injectDefines(readFileToSource(fragmentFile), defines);
 
-	glLinkProgram(ID);
-#ifdef _DEBUG
-	int success;
-	glGetProgramiv(ID, GL_LINK_STATUS, &success);
-	if (!success) {
-		char infoLog[512];
-		glGetProgramInfoLog(ID, 512, NULL, infoLog);
-		std::cout << "CGL::ERROR::GL::SHADERPROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-		std::cout << "Program created, but could not be linked\n";
+	// Fast path: linked binary from the cache
+	cachePath = binaryCachePath(vertexSource, fragmentSource);
+	if(!cachePath.empty() && loadProgramBinary(cachePath)) {
+		fromBinaryCache = true;
+		status = ProgramStatus::READY;
+		bindUniformBlocks();
+		return;
 	}
-#endif // _DEBUG
+
+	// Let the driver compile on as many threads as it wants
+	static bool parallelCompileConfigured = false;
+	if(!parallelCompileConfigured && GLEW_KHR_parallel_shader_compile) {
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		parallelCompileConfigured = true;
+	}
+
+	// Submit both shaders and the link without asking for any status,
+	// so nothing waits for the compiler here
+	vertexShader = addShaderToProgram(vertexSource, ShaderType::VERTEX);
+	fragmentShader = addShaderToProgram(fragmentSource, ShaderType::FRAGMENT);
+
+	if(!cachePath.empty()) glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(ID);
+
+	if(!async) finishLinking();
 }
 
 ShaderProgram::~ShaderProgram() {
 //	std::cout << "CGL::INFO::SHADERPROGRAM ShaderProgram ID: " << ID << " deleted\n";
+	if(vertexShader) glDeleteShader(vertexShader);
+	if(fragmentShader) glDeleteShader(fragmentShader);
 	glDeleteProgram(this->ID);
 }
 /* Ctor & Dtor */
 /* Public Methods */
 void ShaderProgram::SetUniform1i(const char * name, int value) {
-	int	location = glGetUniformLocation(ID, name);
-#ifdef _DEBUG
-	if(-1==location)
-		std::cout << "CGL::ERROR::SHADERPROGRAM::Returned value of location is " << location <<
-			" Name \"" << name << "\" doesn't correspond to an active unifrom variable in program or" <<
-			" name starts with the reserved prefix \"gl_\".\n";
-#endif //_DEBUG
+	int	location = getUniformLocation(name);
 	if(-1!=location) glUniform1i(location, value);
 }
 
 void ShaderProgram::SetUniformMatrix4f(const char * name, glm::mat4 mat) {
-	int location = glGetUniformLocation(this->ID, name);
-#ifdef _DEBUG
-	if(-1==location)
-		std::cout << "CGL::ERROR::SHADERPROGRAM::Returned value of location is " << location <<
-			" Name \"" << name << "\" doesn't correspond to an active unifrom variable in program or" <<
-			" name starts with the reserved prefix \"gl_\".\n";
-#endif //_DEBUG
+	int location = getUniformLocation(name);
 	if(-1!=location) glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
 }
 
+void ShaderProgram::SetUniformHandle(const char * name, GLuint64 handle) {
+	int location = getUniformLocation(name);
+	if(-1!=location) glUniformHandleui64ARB(location, handle);
+}
+
 std::string ShaderProgram::GetVertexPath() const {
 	return vertex_path;
 }
@@ -62,8 +89,55 @@ std::string ShaderProgram::GetVertexPath() const {
 std::string ShaderProgram::GetFragmentPaht() const {
 	return fragment_path;
 }
+
+bool ShaderProgram::IsReady() {
+	if(status != ProgramStatus::PENDING) return status == ProgramStatus::READY;
+
+	// Without GL_KHR_parallel_shader_compile there is no way to ask without waiting
+	if(GLEW_KHR_parallel_shader_compile) {
+		GLint completed = GL_FALSE;
+		glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+		if(!completed) return false;
+	}
+
+	finishLinking();
+	return status == ProgramStatus::READY;
+}
+
+ProgramStatus ShaderProgram::GetStatus() const {
+	return status;
+}
+
+bool ShaderProgram::IsFromBinaryCache() const {
+	return fromBinaryCache;
+}
+
+bool ShaderProgram::UsesFrameUniforms() const {
+	return frameUniforms;
+}
+
+void ShaderProgram::SetBinaryCacheDirectory(std::string directory) {
+	binaryCacheDirectory = directory;
+}
 /* Public Methods */
 /* Private Methods */
+GLint ShaderProgram::getUniformLocation(const char * name) {
+	// Locations are only final once the program is linked
+	if(status != ProgramStatus::READY) return glGetUniformLocation(ID, name);
+	auto found = uniformLocations.find(name);
+	if(found != uniformLocations.end()) return found->second;
+
+	GLint location = glGetUniformLocation(ID, name);
+#ifdef _DEBUG
+	if(-1==location)
+		std::cout << "CGL::ERROR::SHADERPROGRAM::Returned value of location is " << location <<
+			" Name \"" << name << "\" doesn't correspond to an active unifrom variable in program or" <<
+			" name starts with the reserved prefix \"gl_\".\n";
+#endif //_DEBUG
+	uniformLocations.emplace(name, location);
+	return location;
+}
+
 std::string ShaderProgram::readFileToSource(const char* filePath) {
 	std::ifstream file(filePath);
 	if (file) {
@@ -77,13 +151,29 @@ std::string ShaderProgram::readFileToSource(const char* filePath) {
 		std::cout << "ERRORR::IFSTREAM::Could not open file " << filePath << std::endl;
 #endif // _DEBUG
 		file.close();
-		return 0;
+		return std::string();
 	}
 }
 
-void ShaderProgram::addShaderToProgram(const char* filePath, ShaderType type) {
+std::string ShaderProgram::injectDefines(const std::string & source, const std::string & defines) {
+	if(defines.empty()) return source;
+
+	size_t version = source.find("#version");
+	if(version == std::string::npos) return defines + "#line 1\n" + source;
+
+	size_t lineEnd = source.find('\n', version);
+	if(lineEnd == std::string::npos) return source + "\n" + defines;
+
+	// Number of the line following #version
+	size_t nextLine = 2;
+	for(size_t i = 0; i < version; i++)
+		if(source[i] == '\n') nextLine++;
+
+	return source.substr(0, lineEnd + 1) + defines + "#line " + std::to_string(nextLine) + "\n" + source.substr(lineEnd + 1);
+}
+
+GLuint ShaderProgram::addShaderToProgram(const std::string & string_source, ShaderType type) {
 	GLuint shader;
-	std::string string_source = readFileToSource(filePath);
 	const char* source = string_source.c_str();
 
 	if (type == ShaderType::VERTEX)
@@ -93,21 +183,153 @@ void ShaderProgram::addShaderToProgram(const char* filePath, ShaderType type) {
 
 	glShaderSource(shader, 1, &source, NULL);
 	glCompileShader(shader);
+	glAttachShader(ID, shader);
+	return shader;
+}
 
+void ShaderProgram::finishLinking() {
+	// Blocks until the driver is done with compiling and linking
 	int success;
+	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	if (!success) {
 		char infoLog[512];
-		glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-		if (!success) {
+		int compiled;
+		GLuint shaders[] = { vertexShader, fragmentShader };
+		for(GLuint shader : shaders) {
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+			if(compiled) continue;
 			glGetShaderInfoLog(shader, 512, NULL, infoLog);
 #ifdef _DEBUG
 			std::cout << "ERROR::GL::SHADER::COMPILATION_FAILED\n" << infoLog << std::endl;
 #endif // _DEBUG
-			glDeleteShader(shader);
 		}
-		else {
-			glAttachShader(ID, shader);
-			glDeleteShader(shader);
+#ifdef _DEBUG
+		glGetProgramInfoLog(ID, 512, NULL, infoLog);
+		std::cout << "CGL::ERROR::GL::SHADERPROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+		std::cout << "Program created, but could not be linked\n";
+#endif // _DEBUG
+		status = ProgramStatus::FAILED;
+	}
+	else {
+		status = ProgramStatus::READY;
+		bindUniformBlocks();
+		if(!cachePath.empty()) saveProgramBinary(cachePath);
+	}
+
+	// Single GL shader objects are no longer required
+	glDetachShader(ID, vertexShader); glDeleteShader(vertexShader);
+	glDetachShader(ID, fragmentShader); glDeleteShader(fragmentShader);
+	vertexShader = fragmentShader = 0;
+}
+
+void ShaderProgram::bindUniformBlocks() {
+	GLuint frameBlock = glGetUniformBlockIndex(ID, "CGLFrame");
+	frameUniforms = frameBlock != GL_INVALID_INDEX;
+	if(frameUniforms) glUniformBlockBinding(ID, frameBlock, FRAME_UNIFORM_BINDING);
+
+	GLuint shadowBlock = glGetUniformBlockIndex(ID, "CGLShadows");
+	if(shadowBlock != GL_INVALID_INDEX) glUniformBlockBinding(ID, shadowBlock, SHADOW_UNIFORM_BINDING);
+	GLint shadowMap = glGetUniformLocation(ID, "cglShadowMap");
+	if(shadowMap >= 0) {
+		// Sampler uniforms are set on the current program only
+		GLint current = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+		glUseProgram(ID);
+		glUniform1i(shadowMap, (GLint)SHADOW_TEXTURE_UNIT);
+		glUseProgram((GLuint)current);
+	}
+}
+
+std::string ShaderProgram::binaryCachePath(const std::string & vertexSource, const std::string & fragmentSource) {
+	if(binaryCacheDirectory.empty()) return std::string();
+
+	// Driver has to support at least one binary format
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if(formats < 1) return std::string();
+
+	uint64_t hash = 14695981039346656037ULL;
+	auto hashString = [&hash](const char * text) {
+		if(text) for(; *text; text++) {
+			hash ^= (unsigned char)*text;
+			hash *= 1099511628211ULL;
 		}
+		// separator, so "ab"+"c" and "a"+"bc" differ
+		hash ^= 0xFF;
+		hash *= 1099511628211ULL;
+	};
+	hashString(vertexSource.c_str());
+	hashString(fragmentSource.c_str());
+	hashString((const char*)glGetString(GL_VENDOR));
+	hashString((const char*)glGetString(GL_RENDERER));
+	hashString((const char*)glGetString(GL_VERSION));
+
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+	return binaryCacheDirectory + "/" + name;
+}
+
+bool ShaderProgram::loadProgramBinary(const std::string & path) {
+	std::ifstream file(path, std::ios::binary);
+	if(!file) return false;
+
+	ProgramBinaryHeader header;
+	std::vector<char> binary;
+	if(file.read((char*)&header, sizeof(header)) &&
+			header.magic == PROGRAM_BINARY_MAGIC && header.version == PROGRAM_BINARY_VERSION) {
+		binary.resize(header.length);
+		file.read(binary.data(), header.length);
+	}
+	bool complete = !binary.empty() && file.gcount() == (std::streamsize)header.length;
+	file.close();
+
+	GLint success = 0;
+	if(complete) {
+		glProgramBinary(ID, header.format, binary.data(), header.length);
+		glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	}
+
+	// Corrupted file or binary rejected by the driver (e.g. after a driver update)
+	if(!success) {
+#ifdef _DEBUG
+		std::cout << "CGL::INFO::SHADERPROGRAM::BINARY_CACHE Binary " << path << " rejected, compiling from source\n";
+#endif // _DEBUG
+		std::remove(path.c_str());
+		return false;
+	}
+	return true;
+}
+
+void ShaderProgram::saveProgramBinary(const std::string & path) {
+	GLint success = 0, length = 0;
+	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	if(!success) return;
+	glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if(length <= 0) return;
+
+	ProgramBinaryHeader header;
+	header.magic = PROGRAM_BINARY_MAGIC;
+	header.version = PROGRAM_BINARY_VERSION;
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(ID, length, NULL, &format, binary.data());
+	header.format = format;
+	header.length = (uint32_t)length;
+
+	// Write to a temporary file first, so a crash never leaves a truncated binary behind
+	std::string temporary = path + ".tmp";
+	std::ofstream file(temporary, std::ios::binary);
+	if(!file) {
+#ifdef _DEBUG
+		std::cout << "CGL::WARNING::SHADERPROGRAM::BINARY_CACHE Could not write " << temporary << std::endl;
+#endif // _DEBUG
+		return;
+	}
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), length);
+	file.close();
+	if(!file || std::rename(temporary.c_str(), path.c_str()) != 0)
+		std::remove(temporary.c_str());
 }
 /* Private Methods */
 
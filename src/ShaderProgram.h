@@ -10,6 +10,7 @@
 #define SHADERHPP
 
 #include "Resource.h"
+#include "Profiler.h"
 
 #include <GL/glew.h>
 
@@ -19,10 +20,14 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <cstdint>
+#include <cstdio>
 #include <iostream>
 #include <string>
 #include <sstream>
 #include <fstream>
+#include <unordered_map>
+#include <vector>
 
 namespace CGL {
 
@@ -31,14 +36,65 @@ namespace CGL {
 		FRAGMENT
 	};
 
+	/*
+	 * Per-frame data shared by all programs through a uniform buffer
+	 * bound at FRAME_UNIFORM_BINDING by the Scene. In GLSL:
+	 *   layout(std140) uniform CGLFrame {
+	 *       mat4 view;
+	 *       mat4 projection;
+	 *       mat4 viewProjection;
+	 *       vec4 cameraPosition;
+	 *   };
+	 * Programs without the block get view/projection as plain uniforms.
+	 */
+	const GLuint FRAME_UNIFORM_BINDING = 0;
+
+	struct FrameUniforms {
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::mat4 viewProjection;
+		glm::vec4 cameraPosition;
+	};
+
+	/*
+	 * Cascaded shadow maps of the Scene's shadow casting light (see ShadowMap),
+	 * bound at SHADOW_UNIFORM_BINDING and texture unit SHADOW_TEXTURE_UNIT. In GLSL:
+	 *   layout(std140) uniform CGLShadows {
+	 *       mat4 cglShadowMatrices[4];  // world space to shadow map coordinates (0..1) per cascade
+	 *       vec4 cglShadowParams;       // cascade count, 1 / resolution
+	 *   };
+	 *   uniform sampler2DArrayShadow cglShadowMap;
+	 * A fragment uses the first cascade its coordinates fall into (0..1 in x and y),
+	 * e.g. texture(cglShadowMap, vec4(coords.xy, cascade, coords.z)) is 1 when lit.
+	 */
+	const GLuint SHADOW_UNIFORM_BINDING = 4;
+	const GLuint SHADOW_TEXTURE_UNIT = 15;
+	const int MAX_SHADOW_CASCADES = 4;
+
+	struct ShadowUniforms {
+		glm::mat4 matrices[MAX_SHADOW_CASCADES];
+		glm::vec4 params;
+	};
+
+	enum class ProgramStatus {
+		PENDING, // compiling/linking in progress
+		READY,
+		FAILED
+	};
+
 	class ShaderProgram : public Resource {
 	public:
 		// Ctor & Dtor
 
 		/*
 		 * Create a ShaderProgram from vertex and fragment shader source code
+		 * With async, compilation and linking are only submitted to the driver;
+		 * poll IsReady() before using the program (drivers with
+		 * GL_KHR_parallel_shader_compile compile on their own threads meanwhile)
+		 * Defines (e.g. "#define CGL_SKINNING 1\n") are injected right after
+		 * the #version line of both shaders
 		 */
-		ShaderProgram(std::string name, const char* vertexFile, const char* fragmentFile);
+		ShaderProgram(std::string name, const char* vertexFile, const char* fragmentFile, bool async=false, std::string defines=std::string());
 
 		/*
 		 * OpenGL is given the information that this shader
@@ -63,7 +119,7 @@ namespace CGL {
 		/*
 		 * Use ShaderProgram described by ID given by OpenGL
 		 */
-		void Use() { glUseProgram(this->ID); }
+		void Use() { glUseProgram(this->ID); Profiler::CountStateChange(); }
 
 		/*
 		 * Bunch of setters for setting uniforms
@@ -71,6 +127,8 @@ namespace CGL {
 		 */
 		void SetUniform1i(const char * name, int v);
 		void SetUniformMatrix4f(const char * name, glm::mat4 mat);
+		// Bindless texture handle for a sampler uniform (ARB_bindless_texture)
+		void SetUniformHandle(const char * name, GLuint64 handle);
 
 		/*
 		 * Get vertex or fragment shader source file path
@@ -78,9 +136,38 @@ namespace CGL {
 		std::string GetVertexPath() const;
 		std::string GetFragmentPaht() const;
 
+		/*
+		 * Check if the program is linked and can be used
+		 * Never blocks with GL_KHR_parallel_shader_compile; otherwise the first call
+		 * waits for the driver to finish
+		 */
+		bool IsReady();
+		ProgramStatus GetStatus() const;
+
+		/*
+		 * True if the program was loaded from the binary cache instead of being compiled
+		 */
+		bool IsFromBinaryCache() const;
+
+		/*
+		 * True if the program declares the CGLFrame uniform block
+		 */
+		bool UsesFrameUniforms() const;
+
+		/*
+		 * Directory for linked program binaries (glGetProgramBinary) shared by all ShaderPrograms;
+		 * empty string (default) disables the cache.
+		 * Binaries are keyed by a hash of shader sources and GL vendor/renderer/version,
+		 * so a driver update or changed source never picks an old binary.
+		 * A binary rejected by the driver is deleted and the program is compiled from source.
+		 */
+		static void SetBinaryCacheDirectory(std::string directory);
+
 	private:
 		// Fields
 
+		static std::string binaryCacheDirectory;
+
 		/*
 		 * ShaderProgram ID given by OpenGL; defaults to 0
 		 */
@@ -89,20 +176,60 @@ namespace CGL {
 		std::string vertex_path;
 		std::string fragment_path;
 
+		bool fromBinaryCache;
+		std::string cachePath;
+		bool frameUniforms;
+
+		ProgramStatus status;
+		// Uniform locations looked up so far (of the linked program)
+		std::unordered_map<std::string, GLint> uniformLocations;
+		// Shaders kept until linking is finished, for their info logs
+		GLuint vertexShader, fragmentShader;
+
 		// Methods
 
 		/*
-		 * Basically whole creation of a shader program pipeline:
-		 * Get source file data, create a GL shader program, compile shader,
-		 * attache shader to the GL shader program (ID), and
-		 * delete no longer required single GL shader object
+		 * Location of a uniform, queried from GL once per name after linking
+		 */
+		GLint getUniformLocation(const char * name);
+
+		/*
+		 * Create a GL shader from the source, submit its compilation
+		 * and attach it to the GL shader program (ID)
+		 * Compile status is checked in finishLinking()
+		 */
+		GLuint addShaderToProgram(const std::string & source, ShaderType type);
+
+		/*
+		 * Wait for the link status, report errors, store the binary in the cache,
+		 * and delete no longer required single GL shader objects
 		 */
-		void addShaderToProgram(const char* filePath, ShaderType type);
+		void finishLinking();
+
+		/*
+		 * Bind known uniform blocks (CGLFrame, CGLShadows) of a linked program to their
+		 * binding points, and the cglShadowMap sampler to its texture unit
+		 */
+		void bindUniformBlocks();
+
+		/*
+		 * Program binary cache
+		 * Key is FNV-1a hash of sources and driver identification strings
+		 */
+		std::string binaryCachePath(const std::string & vertexSource, const std::string & fragmentSource);
+		bool loadProgramBinary(const std::string & path);
+		void saveProgramBinary(const std::string & path);
 
 		/*
 		 * Read source file and store it as a std::string
 		 */
 		std::string readFileToSource(const char* filePath);
+
+		/*
+		 * Insert defines after the #version directive (which has to stay first)
+		 * followed by #line, so compiler messages keep line numbers of the file
+		 */
+		static std::string injectDefines(const std::string & source, const std::string & defines);
 	};
 } // namespace CGL
 
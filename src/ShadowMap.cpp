@@ -0,0 +1,385 @@
+#include "ShadowMap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+namespace CGL {
+
+namespace {
+	// Depth only program: transform is the cascade's view-projection times the model matrix
+	const char * SHADOW_VERTEX_SHADER =
+		"#version 330 core\n"
+		"layout (location = 0) in vec3 aPos;\n"
+		"uniform mat4 transform;\n"
+		"void main() {\n"
+		"	gl_Position = transform * vec4(aPos, 1.0);\n"
+		"}\n";
+	// The same for GPU skinned Actors, with the bone palette bound by their Animator
+	const char * SKINNED_SHADOW_VERTEX_SHADER =
+		"#version 430 core\n"
+		"layout (location = 0) in vec3 aPos;\n"
+		"layout (location = 3) in uvec4 aBoneIds;\n"
+		"layout (location = 4) in vec4 aBoneWeights;\n"
+		"layout(std430, binding = 5) readonly buffer CGLBones { mat4 cglBones[]; };\n"
+		"uniform mat4 transform;\n"
+		"void main() {\n"
+		"	mat4 skin = aBoneWeights.x * cglBones[aBoneIds.x] + aBoneWeights.y * cglBones[aBoneIds.y]\n"
+		"			+ aBoneWeights.z * cglBones[aBoneIds.z] + aBoneWeights.w * cglBones[aBoneIds.w];\n"
+		"	gl_Position = transform * skin * vec4(aPos, 1.0);\n"
+		"}\n";
+	const char * SHADOW_FRAGMENT_SHADER =
+		"#version 330 core\n"
+		"void main() {}\n";
+
+	// Weight of the logarithmic split distribution (the rest is uniform)
+	const float SPLIT_LAMBDA = .75f;
+
+	GLuint compileShader(GLenum type, const char * source) {
+		GLuint shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, NULL);
+		glCompileShader(shader);
+		GLint compiled = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+		if(!compiled) {
+			char infoLog[512];
+			glGetShaderInfoLog(shader, 512, NULL, infoLog);
+			std::cout << "CGL::ERROR::SHADOWMAP::SHADOWMAP() Depth shader compilation failed\n" << infoLog << std::endl;
+		}
+		return shader;
+	}
+
+	GLuint linkProgram(const char * vertexSource, const char * fragmentSource) {
+		GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
+		GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+		GLint linked = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if(!linked) {
+			std::cout << "CGL::ERROR::SHADOWMAP::SHADOWMAP() Depth program could not be linked\n";
+			glDeleteProgram(program);
+			program = 0;
+		}
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return program;
+	}
+
+	bool isGpuSkinned(const Actor * actor) {
+		return actor->GetAnimator() && actor->GetAnimator()->GetSkinningMode() == SkinningMode::GPU;
+	}
+
+	// Gribb & Hartmann planes of a view-projection matrix (as Camera::GetFrustumPlanes())
+	void extractPlanes(const glm::mat4 & m, Frustum & frustum) {
+		glm::vec4 rows[4];
+		for(int i = 0; i < 4; i++)
+			rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+		frustum.planes[0] = rows[3] + rows[0];
+		frustum.planes[1] = rows[3] - rows[0];
+		frustum.planes[2] = rows[3] + rows[1];
+		frustum.planes[3] = rows[3] - rows[1];
+		frustum.planes[4] = rows[3] + rows[2];
+		frustum.planes[5] = rows[3] - rows[2];
+		frustum.planeCount = 6;
+		for(int i = 0; i < 6; i++) {
+			float length = glm::length(glm::vec3(frustum.planes[i]));
+			if(length > 0.f) frustum.planes[i] /= length;
+		}
+	}
+}
+
+/* Ctor & Dtor */
+ShadowMap::ShadowMap(int cascades, int resolution) {
+	this->cascades = glm::clamp(cascades, 1, MAX_SHADOW_CASCADES);
+	this->resolution = std::max(16, resolution);
+	distance = 100.f;
+	staticCaching = true;
+	lightDirection = glm::vec3(0.f);
+	lightView = glm::mat4(1.f);
+	depthMin = std::numeric_limits<float>::max();
+	depthMax = -std::numeric_limits<float>::max();
+	for(int i = 0; i < MAX_SHADOW_CASCADES; i++) {
+		cascadeMatrices[i] = glm::mat4(1.f);
+		cacheValid[i] = false;
+	}
+	uniforms = ShadowUniforms();
+	stats = ShadowStats();
+
+	program = linkProgram(SHADOW_VERTEX_SHADER, SHADOW_FRAGMENT_SHADER);
+	transformLocation = program ? glGetUniformLocation(program, "transform") : -1;
+	// GPU skinning needs shader storage buffers as well
+	skinnedProgram = GLEW_ARB_shader_storage_buffer_object ? linkProgram(SKINNED_SHADOW_VERTEX_SHADER, SHADOW_FRAGMENT_SHADER) : 0;
+	skinnedTransformLocation = skinnedProgram ? glGetUniformLocation(skinnedProgram, "transform") : -1;
+
+	glGenFramebuffers(1, &framebuffer);
+	glGenFramebuffers(1, &readFramebuffer);
+	createTextures();
+}
+
+ShadowMap::~ShadowMap() {
+	glDeleteTextures(1, &shadowTexture);
+	glDeleteTextures(1, &cacheTexture);
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteFramebuffers(1, &readFramebuffer);
+	if(program) glDeleteProgram(program);
+	if(skinnedProgram) glDeleteProgram(skinnedProgram);
+}
+/* Ctor & Dtor */
+/* Public Methods */
+void ShadowMap::SetDistance(float distance) {
+	if(distance > 0.f) this->distance = distance;
+}
+
+void ShadowMap::SetStaticCaching(bool enabled) {
+	if(enabled && !staticCaching) InvalidateStatic();
+	staticCaching = enabled;
+}
+
+bool ShadowMap::IsStaticCaching() const {
+	return staticCaching;
+}
+
+void ShadowMap::InvalidateStatic() {
+	for(int i = 0; i < MAX_SHADOW_CASCADES; i++) cacheValid[i] = false;
+}
+
+void ShadowMap::Update(const Camera & camera, glm::vec3 lightDirection, glm::vec3 sceneMin, glm::vec3 sceneMax, std::vector<Frustum> & frusta) {
+	lightDirection = glm::normalize(lightDirection);
+	if(glm::dot(lightDirection, this->lightDirection) < .99999f) {
+		this->lightDirection = lightDirection;
+		glm::vec3 up = std::abs(lightDirection.y) > .99f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f);
+		lightView = glm::lookAt(glm::vec3(0.f), lightDirection, up);
+		depthMin = std::numeric_limits<float>::max();
+		depthMax = -std::numeric_limits<float>::max();
+	}
+
+	// Light space depth range of the casters grows with some slack, so it rarely changes
+	float sceneDepthMin = std::numeric_limits<float>::max(), sceneDepthMax = -std::numeric_limits<float>::max();
+	for(int corner = 0; corner < 8; corner++) {
+		glm::vec3 point((corner & 1) ? sceneMax.x : sceneMin.x, (corner & 2) ? sceneMax.y : sceneMin.y, (corner & 4) ? sceneMax.z : sceneMin.z);
+		float depth = -(lightView * glm::vec4(point, 1.f)).z;
+		sceneDepthMin = std::min(sceneDepthMin, depth);
+		sceneDepthMax = std::max(sceneDepthMax, depth);
+	}
+	if(sceneDepthMin < depthMin || sceneDepthMax > depthMax) {
+		float slack = .25f * (sceneDepthMax - sceneDepthMin) + 1.f;
+		depthMin = std::min(depthMin, sceneDepthMin - slack);
+		depthMax = std::max(depthMax, sceneDepthMax + slack);
+	}
+
+	// Split the view depth up to the shadow distance
+	const glm::mat4 & viewMatrix = camera.GetViewMatrix();
+	glm::mat4 inverseView = glm::inverse(viewMatrix);
+	glm::vec3 position(inverseView[3]), front(-glm::vec3(inverseView[2]));
+	float tanY = std::tan(glm::radians(camera.GetFieldOfView()) * .5f);
+	float tanX = tanY * camera.GetAspectRatio();
+	float nearDepth = camera.GetNearPlane();
+	float farDepth = camera.IsInfiniteProjection() ? distance : std::min(distance, camera.GetFarPlane());
+	farDepth = std::max(farDepth, nearDepth * 2.f);
+
+	glm::mat4 bias(.5f);
+	bias[3] = glm::vec4(.5f, .5f, .5f, 1.f);
+	frusta.resize(cascades);
+	float splitNear = nearDepth;
+	for(int i = 0; i < cascades; i++) {
+		float fraction = (float)(i + 1) / (float)cascades;
+		float splitFar = SPLIT_LAMBDA * nearDepth * std::pow(farDepth / nearDepth, fraction)
+				+ (1.f - SPLIT_LAMBDA) * (nearDepth + (farDepth - nearDepth) * fraction);
+
+		// Bounding sphere of the split, centered on the view axis: its radius
+		// doesn't change with the camera's rotation
+		float center = .5f * (splitNear + splitFar);
+		float spread = tanX * tanX + tanY * tanY;
+		float radius = std::sqrt(std::max(
+				(center - splitNear) * (center - splitNear) + splitNear * splitNear * spread,
+				(splitFar - center) * (splitFar - center) + splitFar * splitFar * spread));
+
+		// The box is a quarter larger than the sphere, so its center can be snapped
+		// to a grid of up to a quarter radius (whole texels) and still contain it
+		float halfSize = radius * 1.25f;
+		float texel = 2.f * halfSize / (float)resolution;
+		float snap = std::max(texel, std::floor(radius * .25f / texel) * texel);
+		glm::vec3 lightCenter(lightView * glm::vec4(position + front * center, 1.f));
+		float x = std::floor(lightCenter.x / snap) * snap + .5f * snap;
+		float y = std::floor(lightCenter.y / snap) * snap + .5f * snap;
+
+		glm::mat4 matrix = glm::ortho(x - halfSize, x + halfSize, y - halfSize, y + halfSize, depthMin, depthMax) * lightView;
+		if(matrix != cascadeMatrices[i]) {
+			cascadeMatrices[i] = matrix;
+			cacheValid[i] = false;
+		}
+		uniforms.matrices[i] = bias * matrix;
+		extractPlanes(matrix, frusta[i]);
+		splitNear = splitFar;
+	}
+	uniforms.params = glm::vec4((float)cascades, 1.f / (float)resolution, 0.f, 0.f);
+}
+
+void ShadowMap::Render(const std::vector<Actor*> & casters, const std::vector<uint32_t> & masks) {
+	stats = ShadowStats();
+	if(!IsValid()) return;
+
+	GLint previousDrawFramebuffer = 0, previousReadFramebuffer = 0, previousViewport[4] = { 0, 0, 0, 0 };
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousDrawFramebuffer);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previousReadFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, resolution, resolution);
+	glUseProgram(program);
+	glDepthMask(GL_TRUE);
+	// Slope scaled bias against shadow acne
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(2.f, 4.f);
+	Profiler::CountStateChange();
+
+	for(int cascade = 0; cascade < cascades; cascade++) {
+		if(!staticCaching) {
+			attachLayer(shadowTexture, cascade);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			drawCasters(casters, masks, cascade, true, true);
+			continue;
+		}
+		if(!cacheValid[cascade]) {
+			attachLayer(cacheTexture, cascade);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			drawCasters(casters, masks, cascade, true, false);
+			cacheValid[cascade] = true;
+			stats.cacheUpdates++;
+		}
+		copyCache(cascade);
+		attachLayer(shadowTexture, cascade);
+		drawCasters(casters, masks, cascade, false, true);
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousDrawFramebuffer);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, previousReadFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	Profiler::CountStateChange();
+}
+
+void ShadowMap::Bind() const {
+	glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, shadowTexture);
+	glActiveTexture(GL_TEXTURE0);
+	Profiler::CountStateChange();
+}
+
+const ShadowUniforms & ShadowMap::GetUniforms() const {
+	return uniforms;
+}
+
+ShadowStats ShadowMap::GetStats() const {
+	return stats;
+}
+
+int ShadowMap::GetCascadeCount() const {
+	return cascades;
+}
+
+bool ShadowMap::IsValid() const {
+	return program != 0 && shadowTexture != 0;
+}
+/* Public Methods */
+/* Private Methods */
+void ShadowMap::createTextures() {
+	GLuint textures[2];
+	glGenTextures(2, textures);
+	shadowTexture = textures[0];
+	cacheTexture = textures[1];
+	for(int i = 0; i < 2; i++) {
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textures[i]);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, cascades, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, 0);
+		if(textures[i] == shadowTexture) {
+			// Hardware 2x2 PCF through sampler2DArrayShadow, everything outside is lit
+			GLfloat border[] = { 1.f, 1.f, 1.f, 1.f };
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+			glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		}
+		else {
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// Depth only framebuffer; layers are attached per cascade
+	GLint previousFramebuffer = 0;
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	attachLayer(shadowTexture, 0);
+	if(glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "CGL::ERROR::SHADOWMAP::SHADOWMAP() Shadow framebuffer is incomplete\n";
+		glDeleteTextures(2, textures);
+		shadowTexture = cacheTexture = 0;
+	}
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, previousFramebuffer);
+}
+
+void ShadowMap::drawCasters(const std::vector<Actor*> & casters, const std::vector<uint32_t> & masks, int cascade, bool staticCasters, bool dynamicCasters) {
+	uint32_t bit = 1u << cascade;
+	batch.clear();
+	for(size_t i = 0; i < casters.size(); i++) {
+		if(!(masks[i] & bit)) continue;
+		bool isStatic = casters[i]->GetShapePtr()->IsStatic();
+		if(isStatic ? staticCasters : dynamicCasters) batch.push_back(casters[i]);
+	}
+
+	// Grouped by Model, like the render queue, GPU skinned ones last with their own program
+	std::sort(batch.begin(), batch.end(), [](const Actor * a, const Actor * b) {
+		bool skinnedA = isGpuSkinned(a), skinnedB = isGpuSkinned(b);
+		if(skinnedA != skinnedB) return skinnedB;
+		return a->GetModelPtr().get() < b->GetModelPtr().get();
+	});
+	bool skinning = false;
+	for(Actor * actor : batch) {
+		if(isGpuSkinned(actor)) {
+			if(!skinnedProgram) break;
+			if(!skinning) {
+				glUseProgram(skinnedProgram);
+				Profiler::CountStateChange();
+				skinning = true;
+			}
+			actor->DrawGeometry(skinnedTransformLocation, cascadeMatrices[cascade]);
+		}
+		else actor->DrawGeometry(transformLocation, cascadeMatrices[cascade]);
+	}
+	if(skinning) {
+		glUseProgram(program);
+		Profiler::CountStateChange();
+	}
+	if(staticCasters && !dynamicCasters) stats.staticCasters += (unsigned int)batch.size();
+	else stats.dynamicCasters += (unsigned int)batch.size();
+}
+
+void ShadowMap::attachLayer(GLuint texture, int layer) {
+	glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+	Profiler::CountStateChange();
+}
+
+void ShadowMap::copyCache(int layer) {
+	if(GLEW_ARB_copy_image) {
+		glCopyImageSubData(cacheTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer,
+				shadowTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, resolution, resolution, 1);
+		return;
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+	glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cacheTexture, 0, layer);
+	attachLayer(shadowTexture, layer);
+	glBlitFramebuffer(0, 0, resolution, resolution, 0, 0, resolution, resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+}
+/* Private Methods */
+} /* namespace CGL */
@@ -0,0 +1,138 @@
+/*
+ * ShadowMap renders cascaded shadow maps of a directional light:
+ * - the view depth up to a distance is split into cascades (practical split scheme),
+ *   each one an orthographic light view around the bounding sphere of its part of the
+ *   view frustum, snapped to a coarse grid so it only moves after the camera moved
+ *   a fair bit (and its texels never swim)
+ * - casters are culled per cascade by the caller (frusta from Update()) and drawn
+ *   depth only, grouped by Model (GPU skinned ones with a skinning depth program)
+ * - shadows of static Actors are cached in a second texture array and re-rendered
+ *   only when a cascade moves or the static set changes; every frame the cache is
+ *   copied into the shadow map and only the dynamic casters are drawn on top
+ * Shaders sample it through the CGLShadows block and cglShadowMap (see ShaderProgram.h).
+ */
+
+#ifndef SHADOWMAP_H_
+#define SHADOWMAP_H_
+
+#include "Actor.h"
+#include "Camera.h"
+#include "ShaderProgram.h"
+#include "SpatialIndex.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace CGL {
+
+struct ShadowStats {
+	// Casters drawn into the static caches (when re-rendered) and on top of them, over all cascades
+	unsigned int staticCasters;
+	unsigned int dynamicCasters;
+	// Cascades which static cache was re-rendered
+	unsigned int cacheUpdates;
+};
+
+class ShadowMap {
+public:
+	/*
+	 * Needs the OpenGL context; 1..MAX_SHADOW_CASCADES cascades of resolution x resolution texels
+	 */
+	ShadowMap(int cascades, int resolution);
+	~ShadowMap();
+
+	/*
+	 * Delete Copy Constructor and operator=
+	 */
+	ShadowMap(const ShadowMap & other) = delete;
+	ShadowMap & operator=(const ShadowMap & other) = delete;
+
+	/*
+	 * View depth covered by the cascades (100 by default)
+	 */
+	void SetDistance(float distance);
+
+	/*
+	 * Static caching on (default) or off (all casters are drawn every frame)
+	 */
+	void SetStaticCaching(bool enabled);
+	bool IsStaticCaching() const;
+
+	/*
+	 * Re-render the static caches, e.g. after a static Actor was added or deleted
+	 */
+	void InvalidateStatic();
+
+	/*
+	 * Fit the cascades to the Camera and the direction the light travels in;
+	 * sceneMin/Max bound all casters (light space depth range).
+	 * Fills frusta with the volume of every cascade for caster culling.
+	 */
+	void Update(const Camera & camera, glm::vec3 lightDirection, glm::vec3 sceneMin, glm::vec3 sceneMax, std::vector<Frustum> & frusta);
+
+	/*
+	 * Render the casters; masks tell which cascades each one is in (SpatialIndex::QueryFrusta())
+	 * Changes the draw framebuffer, viewport and program, expects the standard depth convention
+	 */
+	void Render(const std::vector<Actor*> & casters, const std::vector<uint32_t> & masks);
+
+	/*
+	 * Bind the shadow map to SHADOW_TEXTURE_UNIT
+	 */
+	void Bind() const;
+
+	const ShadowUniforms & GetUniforms() const;
+	ShadowStats GetStats() const;
+	int GetCascadeCount() const;
+	bool IsValid() const;
+
+private:
+	int cascades;
+	int resolution;
+	float distance;
+	bool staticCaching;
+
+	GLuint shadowTexture;
+	GLuint cacheTexture;
+	GLuint framebuffer;
+	// Source of the copies when glCopyImageSubData isn't available
+	GLuint readFramebuffer;
+	GLuint program;
+	GLint transformLocation;
+	// Depth program of GPU skinned Actors (0 without shader storage buffers)
+	GLuint skinnedProgram;
+	GLint skinnedTransformLocation;
+
+	/*
+	 * Light space of the current light direction, its caster depth range
+	 * (only grows, so moving casters don't invalidate the caches)
+	 */
+	glm::vec3 lightDirection;
+	glm::mat4 lightView;
+	float depthMin, depthMax;
+
+	/*
+	 * Light view-projection of every cascade and whether its static cache is up to date
+	 */
+	glm::mat4 cascadeMatrices[MAX_SHADOW_CASCADES];
+	bool cacheValid[MAX_SHADOW_CASCADES];
+
+	ShadowUniforms uniforms;
+	ShadowStats stats;
+
+	// Casters of one cascade sorted by Model
+	std::vector<Actor*> batch;
+
+	void createTextures();
+	void drawCasters(const std::vector<Actor*> & casters, const std::vector<uint32_t> & masks, int cascade, bool staticCasters, bool dynamicCasters);
+	void attachLayer(GLuint texture, int layer);
+	void copyCache(int layer);
+};
+
+} /* namespace CGL */
+
+#endif /* SHADOWMAP_H_ */
@@ -0,0 +1,132 @@
+#include "Snapshot.h"
+
+namespace CGL {
+
+void CaptureBodyState(const btRigidBody * body, BodySnapshot & state) {
+	// Padding too (tail padding with double btScalar), records are compared byte by byte
+	std::memset(&state, 0, sizeof(BodySnapshot));
+
+	const btTransform & transform = body->getWorldTransform();
+	const btMatrix3x3 & basis = transform.getBasis();
+	for(int row = 0; row < 3; row++)
+		for(int column = 0; column < 3; column++)
+			state.basis[3*row + column] = basis[row][column];
+
+	for(int i = 0; i < 3; i++) {
+		state.origin[i] = transform.getOrigin()[i];
+		state.linearVelocity[i] = body->getLinearVelocity()[i];
+		state.angularVelocity[i] = body->getAngularVelocity()[i];
+	}
+
+	state.deactivationTime = body->getDeactivationTime();
+	state.activationState = body->getActivationState();
+} /* CaptureBodyState(const btRigidBody * body, BodySnapshot & state) */
+
+void RestoreBodyState(btRigidBody * body, const BodySnapshot & state) {
+	btTransform transform;
+	btMatrix3x3 & basis = transform.getBasis();
+	for(int row = 0; row < 3; row++)
+		for(int column = 0; column < 3; column++)
+			basis[row][column] = state.basis[3*row + column];
+	transform.setOrigin(btVector3(state.origin[0], state.origin[1], state.origin[2]));
+
+	btVector3 linearVelocity(state.linearVelocity[0], state.linearVelocity[1], state.linearVelocity[2]);
+	btVector3 angularVelocity(state.angularVelocity[0], state.angularVelocity[1], state.angularVelocity[2]);
+
+	body->setWorldTransform(transform);
+	body->setInterpolationWorldTransform(transform);
+	if(body->getMotionState())
+		body->getMotionState()->setWorldTransform(transform);
+
+	body->setLinearVelocity(linearVelocity);
+	body->setAngularVelocity(angularVelocity);
+	body->setInterpolationLinearVelocity(linearVelocity);
+	body->setInterpolationAngularVelocity(angularVelocity);
+	body->clearForces();
+
+	body->forceActivationState(state.activationState);
+	body->setDeactivationTime(state.deactivationTime);
+} /* RestoreBodyState(btRigidBody * body, const BodySnapshot & state) */
+
+const SnapshotHeader * ValidateSnapshot(const std::vector<unsigned char> & buffer, SnapshotKind kind) {
+	if(buffer.size() < sizeof(SnapshotHeader)) return nullptr;
+
+	const SnapshotHeader * header = reinterpret_cast<const SnapshotHeader *>(buffer.data());
+	if(header->magic != SNAPSHOT_MAGIC || header->version != SNAPSHOT_VERSION) return nullptr;
+	if(header->kind != kind || header->scalarSize != sizeof(btScalar)) return nullptr;
+
+	size_t recordSize = sizeof(BodySnapshot);
+	if(kind == SnapshotKind::DELTA) recordSize += sizeof(uint32_t);
+	if(buffer.size() != sizeof(SnapshotHeader) + (size_t)header->recordCount * recordSize) return nullptr;
+	// Readers of FULL snapshots copy bodyCount records
+	if(kind == SnapshotKind::FULL && header->recordCount != header->bodyCount) return nullptr;
+
+	return header;
+} /* ValidateSnapshot(const std::vector<unsigned char> & buffer, SnapshotKind kind) */
+
+bool EncodeSnapshotDelta(const std::vector<unsigned char> & base, const std::vector<unsigned char> & current, std::vector<unsigned char> & delta) {
+	const SnapshotHeader * baseHeader = ValidateSnapshot(base, SnapshotKind::FULL);
+	const SnapshotHeader * currentHeader = ValidateSnapshot(current, SnapshotKind::FULL);
+	if(!baseHeader || !currentHeader || baseHeader->bodyCount != currentHeader->bodyCount)
+		return false;
+
+	const unsigned char * baseRecords = base.data() + sizeof(SnapshotHeader);
+	const unsigned char * currentRecords = current.data() + sizeof(SnapshotHeader);
+	const size_t recordSize = sizeof(BodySnapshot);
+
+	// Worst case every body has changed; shrink afterwards
+	delta.resize(sizeof(SnapshotHeader) + currentHeader->bodyCount * (sizeof(uint32_t) + recordSize));
+	unsigned char * out = delta.data() + sizeof(SnapshotHeader);
+
+	uint32_t changed = 0;
+	for(uint32_t i = 0; i < currentHeader->bodyCount; i++) {
+		const unsigned char * record = currentRecords + i*recordSize;
+		if(std::memcmp(baseRecords + i*recordSize, record, recordSize) == 0) continue;
+
+		std::memcpy(out, &i, sizeof(uint32_t)); out += sizeof(uint32_t);
+		std::memcpy(out, record, recordSize); out += recordSize;
+		changed++;
+	}
+	delta.resize(out - delta.data());
+
+	SnapshotHeader header = *currentHeader;
+	header.kind = SnapshotKind::DELTA;
+	header.recordCount = changed;
+	std::memcpy(delta.data(), &header, sizeof(SnapshotHeader));
+	return true;
+} /* EncodeSnapshotDelta(...) */
+
+bool ApplySnapshotDelta(const std::vector<unsigned char> & base, const std::vector<unsigned char> & delta, std::vector<unsigned char> & result) {
+	const SnapshotHeader * baseHeader = ValidateSnapshot(base, SnapshotKind::FULL);
+	const SnapshotHeader * deltaHeader = ValidateSnapshot(delta, SnapshotKind::DELTA);
+	if(!baseHeader || !deltaHeader || baseHeader->bodyCount != deltaHeader->bodyCount)
+		return false;
+
+	const uint32_t changed = deltaHeader->recordCount;
+	const size_t recordSize = sizeof(BodySnapshot);
+
+	// Check all indices first, result (which might alias base or delta) is only written on success
+	const unsigned char * in = delta.data() + sizeof(SnapshotHeader);
+	for(uint32_t i = 0; i < changed; i++) {
+		uint32_t index;
+		std::memcpy(&index, in + i*(sizeof(uint32_t) + recordSize), sizeof(uint32_t));
+		if(index >= baseHeader->bodyCount) return false;
+	}
+
+	std::vector<unsigned char> full(base);
+	SnapshotHeader header = *deltaHeader;
+	header.kind = SnapshotKind::FULL;
+	header.recordCount = header.bodyCount;
+	std::memcpy(full.data(), &header, sizeof(SnapshotHeader));
+
+	unsigned char * records = full.data() + sizeof(SnapshotHeader);
+	for(uint32_t i = 0; i < changed; i++) {
+		uint32_t index;
+		std::memcpy(&index, in, sizeof(uint32_t)); in += sizeof(uint32_t);
+		std::memcpy(records + index*recordSize, in, recordSize); in += recordSize;
+	}
+	result.swap(full);
+	return true;
+} /* ApplySnapshotDelta(...) */
+
+} /* namespace CGL */
@@ -0,0 +1,86 @@
+/*
+ * Binary snapshot format of a Scene physics state.
+ * A snapshot is a flat buffer:
+ * - SnapshotHeader
+ * - FULL snapshot: one BodySnapshot per body, in order of bodies creation
+ * - DELTA snapshot: pairs of (unsigned int body index, BodySnapshot) for bodies
+ *   which state differs from the base snapshot
+ * Snapshots are meant for checkpoints and rollbacks within the same build,
+ * so they're stored in the native byte order and with native btScalar size.
+ */
+
+#ifndef SNAPSHOT_H_
+#define SNAPSHOT_H_
+
+#include <btBulletDynamicsCommon.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace CGL {
+
+const uint32_t SNAPSHOT_MAGIC = 0x534C4743; // "CGLS"
+const uint16_t SNAPSHOT_VERSION = 1;
+
+enum class SnapshotKind : uint16_t {
+	FULL,
+	DELTA,
+};
+
+struct SnapshotHeader {
+	uint32_t magic;
+	uint16_t version;
+	SnapshotKind kind;
+	uint32_t scalarSize;
+	// Number of bodies in the scene and number of records stored after the header
+	uint32_t bodyCount;
+	uint32_t recordCount;
+	uint32_t reserved;
+	uint64_t simulationStep;
+};
+
+/*
+ * State of a single rigid body
+ * Basis is stored as a full matrix (not a quaternion), so a restored body
+ * is bit-identical to the captured one
+ */
+struct BodySnapshot {
+	btScalar basis[9];
+	btScalar origin[3];
+	btScalar linearVelocity[3];
+	btScalar angularVelocity[3];
+	btScalar deactivationTime;
+	int32_t activationState;
+};
+
+/*
+ * Copy state of a rigid body from/to a BodySnapshot
+ * Capturing zeroes the whole record first, padding bytes included
+ */
+void CaptureBodyState(const btRigidBody * body, BodySnapshot & state);
+void RestoreBodyState(btRigidBody * body, const BodySnapshot & state);
+
+/*
+ * Check magic, version, scalar size and buffer size of a snapshot of a given kind
+ * (FULL snapshots have to hold a record for every body)
+ * Return nullptr if the buffer isn't a valid snapshot
+ */
+const SnapshotHeader * ValidateSnapshot(const std::vector<unsigned char> & buffer, SnapshotKind kind);
+
+/*
+ * Store in delta only these bodies of current snapshot which differ from base snapshot.
+ * Both have to be FULL snapshots of the same bodies.
+ * Return false if snapshots don't match
+ */
+bool EncodeSnapshotDelta(const std::vector<unsigned char> & base, const std::vector<unsigned char> & current, std::vector<unsigned char> & delta);
+
+/*
+ * Reconstruct FULL snapshot from the base FULL snapshot and a DELTA snapshot
+ * Return false if snapshots don't match (result is left untouched then)
+ */
+bool ApplySnapshotDelta(const std::vector<unsigned char> & base, const std::vector<unsigned char> & delta, std::vector<unsigned char> & result);
+
+} /* namespace CGL */
+
+#endif /* SNAPSHOT_H_ */
@@ -0,0 +1,189 @@
+#include "SpatialIndex.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace CGL {
+
+/* Ctor & Dtor */
+SpatialIndex::SpatialIndex(float margin) {
+	this->margin = margin;
+}
+
+SpatialIndex::~SpatialIndex() {
+	tree.clear();
+}
+/* Ctor & Dtor */
+/* Public Methods */
+void SpatialIndex::Insert(Actor * actor, glm::vec3 min, glm::vec3 max) {
+	if(leaves.find(actor) != leaves.end()) {
+		Update(actor, min, max);
+		return;
+	}
+
+	btDbvtVolume volume = btDbvtVolume::FromMM(
+			btVector3(min.x - margin, min.y - margin, min.z - margin),
+			btVector3(max.x + margin, max.y + margin, max.z + margin));
+	leaves[actor] = tree.insert(volume, actor);
+} /* SpatialIndex::Insert(Actor * actor, glm::vec3 min, glm::vec3 max) */
+
+void SpatialIndex::Update(Actor * actor, glm::vec3 min, glm::vec3 max) {
+	auto it = leaves.find(actor);
+	if(it == leaves.end()) {
+		Insert(actor, min, max);
+		return;
+	}
+
+	// Reinserted (with the margin) only if it has left the stored box
+	btDbvtVolume volume = btDbvtVolume::FromMM(btVector3(min.x, min.y, min.z), btVector3(max.x, max.y, max.z));
+	tree.update(it->second, volume, margin);
+} /* SpatialIndex::Update(Actor * actor, glm::vec3 min, glm::vec3 max) */
+
+void SpatialIndex::Remove(Actor * actor) {
+	auto it = leaves.find(actor);
+	if(it == leaves.end()) return;
+	tree.remove(it->second);
+	leaves.erase(it);
+} /* SpatialIndex::Remove(Actor * actor) */
+
+void SpatialIndex::Optimize(int passes) {
+	tree.optimizeIncremental(passes);
+} /* SpatialIndex::Optimize(int passes) */
+
+void SpatialIndex::QueryBox(glm::vec3 min, glm::vec3 max, std::vector<Actor*> & result) const {
+	if(tree.empty()) return;
+	btDbvtVolume volume = btDbvtVolume::FromMM(btVector3(min.x, min.y, min.z), btVector3(max.x, max.y, max.z));
+	Collector collector(result);
+	btDbvt::collideTV(tree.m_root, volume, collector);
+} /* SpatialIndex::QueryBox(glm::vec3 min, glm::vec3 max, std::vector<Actor*> & result) const */
+
+void SpatialIndex::QuerySphere(glm::vec3 center, float radius, std::vector<Actor*> & result) const {
+	if(tree.empty()) return;
+
+	// Boxes overlapping sphere's bounding box, then exact sphere vs box test
+	struct SphereCollector : public btDbvt::ICollide {
+		std::vector<Actor*> & result;
+		btVector3 center;
+		btScalar radius2;
+		SphereCollector(std::vector<Actor*> & result, btVector3 center, btScalar radius2)
+			: result(result), center(center), radius2(radius2) {}
+		void Process(const btDbvtNode * leaf) override {
+			const btVector3 & min = leaf->volume.Mins();
+			const btVector3 & max = leaf->volume.Maxs();
+			btScalar distance2 = 0.f;
+			for(int i = 0; i < 3; i++) {
+				if(center[i] < min[i]) distance2 += (min[i] - center[i]) * (min[i] - center[i]);
+				else if(center[i] > max[i]) distance2 += (center[i] - max[i]) * (center[i] - max[i]);
+			}
+			if(distance2 <= radius2) result.push_back(static_cast<Actor*>(leaf->data));
+		}
+	};
+
+	btVector3 btCenter(center.x, center.y, center.z);
+	btDbvtVolume volume = btDbvtVolume::FromCR(btCenter, radius);
+	SphereCollector collector(result, btCenter, radius*radius);
+	btDbvt::collideTV(tree.m_root, volume, collector);
+} /* SpatialIndex::QuerySphere(glm::vec3 center, float radius, std::vector<Actor*> & result) const */
+
+void SpatialIndex::QueryFrustum(const glm::mat4 & viewProjection, std::vector<Actor*> & result) const {
+	// Frustum planes from the rows of the view-projection matrix (Gribb & Hartmann);
+	// a point p is inside when dot(normal, p) + offset >= 0 for all planes
+	glm::vec4 planes[6];
+	const glm::mat4 & m = viewProjection;
+	for(int i = 0; i < 3; i++) {
+		for(int side = 0; side < 2; side++) {
+			float sign = side == 0 ? 1.f : -1.f;
+			planes[2*i + side] = glm::vec4(
+					m[0][3] + sign*m[0][i],
+					m[1][3] + sign*m[1][i],
+					m[2][3] + sign*m[2][i],
+					m[3][3] + sign*m[3][i]);
+			// Normalize, so the plane distance is meaningful
+			float length = glm::length(glm::vec3(planes[2*i + side]));
+			if(length > 0.f) planes[2*i + side] /= length;
+		}
+	}
+	QueryFrustum(planes, 6, result);
+} /* SpatialIndex::QueryFrustum(const glm::mat4 & viewProjection, std::vector<Actor*> & result) const */
+
+void SpatialIndex::QueryFrustum(const glm::vec4 * planes, int planeCount, std::vector<Actor*> & result) const {
+	if(tree.empty() || planeCount <= 0) return;
+
+	btVector3 normals[6];
+	btScalar offsets[6];
+	planeCount = std::min(planeCount, 6);
+	for(int i = 0; i < planeCount; i++) {
+		normals[i] = btVector3(planes[i].x, planes[i].y, planes[i].z);
+		offsets[i] = planes[i].w;
+	}
+
+	Collector collector(result);
+	btDbvt::collideKDOP(tree.m_root, normals, offsets, planeCount, collector);
+} /* SpatialIndex::QueryFrustum(const glm::vec4 * planes, int planeCount, std::vector<Actor*> & result) const */
+
+void SpatialIndex::QueryFrusta(const std::vector<Frustum> & frusta, std::vector<Actor*> & result, std::vector<uint32_t> & masks) const {
+	if(tree.empty() || frusta.empty()) return;
+	if(frusta.size() > 32)
+		std::cout << "CGL::WARNING::SPATIALINDEX::QUERYFRUSTA() Only the first 32 of " << frusta.size() << " frusta are tested\n";
+
+	uint32_t all = frusta.size() >= 32 ? 0xffffffffu : (1u << frusta.size()) - 1u;
+	collectFrusta(tree.m_root, frusta, all, 0u, result, masks);
+} /* SpatialIndex::QueryFrusta(const std::vector<Frustum> & frusta, std::vector<Actor*> & result, std::vector<uint32_t> & masks) const */
+
+size_t SpatialIndex::Size() const {
+	return leaves.size();
+} /* SpatialIndex::Size() const */
+
+bool SpatialIndex::GetBounds(glm::vec3 & min, glm::vec3 & max) const {
+	if(!tree.m_root) return false;
+	const btVector3 & mins = tree.m_root->volume.Mins();
+	const btVector3 & maxs = tree.m_root->volume.Maxs();
+	min = glm::vec3(mins.x(), mins.y(), mins.z());
+	max = glm::vec3(maxs.x(), maxs.y(), maxs.z());
+	return true;
+} /* SpatialIndex::GetBounds(...) const */
+/* Public Methods */
+/* Private Methods */
+void SpatialIndex::collectFrusta(const btDbvtNode * node, const std::vector<Frustum> & frusta, uint32_t partial, uint32_t inside,
+		std::vector<Actor*> & result, std::vector<uint32_t> & masks) const {
+	const btVector3 & min = node->volume.Mins();
+	const btVector3 & max = node->volume.Maxs();
+
+	for(uint32_t pending = partial; pending; pending &= pending - 1) {
+		int index = 0;
+		while(!(pending & (1u << index))) index++;
+
+		const Frustum & frustum = frusta[index];
+		bool contained = true;
+		for(int i = 0; i < frustum.planeCount; i++) {
+			const glm::vec4 & plane = frustum.planes[i];
+			// The box corners furthest along and against the plane normal
+			float outer = plane.w, inner = plane.w;
+			for(int axis = 0; axis < 3; axis++) {
+				outer += plane[axis] * (plane[axis] > 0.f ? max[axis] : min[axis]);
+				inner += plane[axis] * (plane[axis] > 0.f ? min[axis] : max[axis]);
+			}
+			if(outer < 0.f) { partial &= ~(1u << index); contained = false; break; }
+			if(inner < 0.f) contained = false;
+		}
+		if(contained) {
+			partial &= ~(1u << index);
+			inside |= 1u << index;
+		}
+	}
+	if(!(partial | inside)) return;
+
+	if(node->isleaf()) {
+		result.push_back(static_cast<Actor*>(node->data));
+		masks.push_back(partial | inside);
+		return;
+	}
+	collectFrusta(node->childs[0], frusta, partial, inside, result, masks);
+	collectFrusta(node->childs[1], frusta, partial, inside, result, masks);
+} /* SpatialIndex::collectFrusta(...) const */
+
+void SpatialIndex::Collector::Process(const btDbvtNode * leaf) {
+	result.push_back(static_cast<Actor*>(leaf->data));
+} /* SpatialIndex::Collector::Process(const btDbvtNode * leaf) */
+/* Private Methods */
+} /* namespace CGL */
@@ -0,0 +1,108 @@
+/*
+ * SpatialIndex keeps world space bounding boxes of Actors in a dynamic AABB tree
+ * (Bullet's btDbvt, the same structure its broadphase is built on).
+ * Boxes are stored enlarged by a margin, so an Actor which moves a little
+ * doesn't have to be reinserted every frame.
+ * It serves:
+ * - frustum culling
+ * - "which Actors are near X" queries (box and sphere)
+ */
+
+#ifndef SPATIALINDEX_H_
+#define SPATIALINDEX_H_
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/BroadphaseCollision/btDbvt.h>
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace CGL {
+
+class Actor;
+
+/*
+ * Convex view volume for QueryFrusta(): planes with xyz normal pointing inside
+ * and w offset (see Camera::GetFrustumPlanes())
+ */
+struct Frustum {
+	glm::vec4 planes[6];
+	int planeCount;
+};
+
+class SpatialIndex {
+public:
+	SpatialIndex(float margin=.25f);
+	~SpatialIndex();
+
+	/*
+	 * Delete to prevent from accidental copying (tree nodes are owned by the index)
+	 */
+	SpatialIndex(const SpatialIndex &other) = delete;
+	SpatialIndex& operator=(const SpatialIndex &other) = delete;
+
+	/*
+	 * Insert, update or remove an Actor with its world space bounding box
+	 * Update() is cheap when the new box still fits in the enlarged stored one
+	 */
+	void Insert(Actor * actor, glm::vec3 min, glm::vec3 max);
+	void Update(Actor * actor, glm::vec3 min, glm::vec3 max);
+	void Remove(Actor * actor);
+
+	/*
+	 * Rebalance a part of the tree; call once per frame after updates
+	 */
+	void Optimize(int passes=1);
+
+	/*
+	 * Queries -- found Actors are appended to the result
+	 * (as boxes are enlarged, results are conservative)
+	 */
+	void QueryBox(glm::vec3 min, glm::vec3 max, std::vector<Actor*> & result) const;
+	void QuerySphere(glm::vec3 center, float radius, std::vector<Actor*> & result) const;
+	void QueryFrustum(const glm::mat4 & viewProjection, std::vector<Actor*> & result) const;
+	// Planes (xyz normal pointing inside, w offset) e.g. from Camera::GetFrustumPlanes()
+	void QueryFrustum(const glm::vec4 * planes, int planeCount, std::vector<Actor*> & result) const;
+
+	/*
+	 * Single traversal for up to 32 frusta: Actors inside any of them are appended
+	 * to the result, with a bit mask of the frusta they are in appended to masks.
+	 * Subtrees fully inside a frustum aren't tested against it any more.
+	 */
+	void QueryFrusta(const std::vector<Frustum> & frusta, std::vector<Actor*> & result, std::vector<uint32_t> & masks) const;
+
+	size_t Size() const;
+
+	/*
+	 * Box around all Actors (enlarged like the stored boxes); false if the index is empty
+	 */
+	bool GetBounds(glm::vec3 & min, glm::vec3 & max) const;
+
+private:
+	float margin;
+	btDbvt tree;
+	std::unordered_map<Actor*, btDbvtNode*> leaves;
+
+	/*
+	 * Collect all leaves handed by btDbvt into a vector of Actors
+	 */
+	struct Collector : public btDbvt::ICollide {
+		std::vector<Actor*> & result;
+		Collector(std::vector<Actor*> & result) : result(result) {}
+		void Process(const btDbvtNode * leaf) override;
+	};
+
+	/*
+	 * Recursive part of QueryFrusta(); partial are frusta the node's box
+	 * intersects, inside are frusta containing it entirely
+	 */
+	void collectFrusta(const btDbvtNode * node, const std::vector<Frustum> & frusta, uint32_t partial, uint32_t inside,
+			std::vector<Actor*> & result, std::vector<uint32_t> & masks) const;
+};
+
+} /* namespace CGL */
+
+#endif /* SPATIALINDEX_H_ */
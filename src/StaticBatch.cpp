@@ -0,0 +1,259 @@
+#include "StaticBatch.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <map>
+
+namespace CGL {
+
+/* Ctor & Dtor */
+StaticBatch::StaticBatch(float chunkSize) {
+	this->chunkSize = chunkSize;
+	stats = StaticBatchStats();
+}
+
+StaticBatch::~StaticBatch() {
+	Clear();
+}
+/* Ctor & Dtor */
+/* Public Methods */
+void StaticBatch::SetChunkSize(float chunkSize) {
+	if(chunkSize <= 0.f) {
+		std::cout << "CGL::WARNING::STATICBATCH::SETCHUNKSIZE() Chunk size has to be positive\n";
+		return;
+	}
+	this->chunkSize = chunkSize;
+}
+
+void StaticBatch::Build(const std::vector<Actor*> & actors) {
+	Clear();
+
+	// Every mesh of every Actor goes into the group of its program and bound textures;
+	// layers of one array and bindless handles differ per mesh, not per group
+	struct Entry {
+		size_t group;
+		int cell[3];
+		Actor * actor;
+		size_t mesh;
+	};
+	std::vector<Entry> entries;
+	std::map<std::vector<uint64_t>, size_t> groupIndices;
+	std::hash<std::string> hashType;
+	for(Actor * actor : actors) {
+		std::shared_ptr<ShaderProgram> program = actor->ResolveShaderProgram();
+		glm::vec3 min, max;
+		actor->GetWorldBounds(min, max);
+		glm::vec3 center = .5f * (min + max);
+		int cell[3];
+		for(int axis = 0; axis < 3; axis++) cell[axis] = (int)std::floor(center[axis] / chunkSize);
+
+		const std::vector<Mesh> & meshes = actor->GetModelPtr()->GetMeshes();
+		for(size_t m = 0; m < meshes.size(); m++) {
+			const Mesh & mesh = meshes[m];
+			if(mesh.indices.empty()) continue;
+			std::vector<uint64_t> key;
+			key.push_back((uint64_t)(uintptr_t)program.get());
+			for(const Texture & texture : mesh.textures) {
+				key.push_back(texture.handle ? 0 : texture.id);
+				key.push_back(texture.target);
+				key.push_back(hashType(texture.type));
+			}
+			auto found = groupIndices.find(key);
+			size_t group;
+			if(found != groupIndices.end()) group = found->second;
+			else {
+				group = groups.size();
+				groupIndices[key] = group;
+				Group created;
+				created.program = program;
+				created.material = &mesh;
+				created.vertexArray = created.vertexBuffer = created.elementBuffer = 0;
+				created.materialIndexBuffer = created.materialBuffer = 0;
+				groups.push_back(created);
+			}
+			std::vector<std::shared_ptr<Model>> & models = groups[group].models;
+			if(std::find(models.begin(), models.end(), actor->GetModelPtr()) == models.end())
+				models.push_back(actor->GetModelPtr());
+			entries.push_back(Entry{ group, { cell[0], cell[1], cell[2] }, actor, m });
+		}
+		stats.actors++;
+	}
+
+	// Chunks of a group are contiguous ranges of its index buffer
+	std::stable_sort(entries.begin(), entries.end(), [](const Entry & a, const Entry & b) {
+		if(a.group != b.group) return a.group < b.group;
+		return std::lexicographical_compare(a.cell, a.cell + 3, b.cell, b.cell + 3);
+	});
+
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+	std::vector<GLuint> materialIndices;
+	std::vector<BatchMaterial> materials;
+	std::map<const Mesh*, GLuint> meshMaterials;
+	for(size_t begin = 0; begin < entries.size();) {
+		Group & group = groups[entries[begin].group];
+		vertices.clear();
+		indices.clear();
+		materialIndices.clear();
+		materials.clear();
+		meshMaterials.clear();
+
+		size_t end = begin;
+		for(; end < entries.size() && entries[end].group == entries[begin].group; end++) {
+			const Entry & entry = entries[end];
+			if(end == begin || !std::equal(entry.cell, entry.cell + 3, entries[end - 1].cell)) {
+				Chunk chunk;
+				chunk.min = glm::vec3(std::numeric_limits<float>::max());
+				chunk.max = glm::vec3(-std::numeric_limits<float>::max());
+				chunk.count = 0;
+				chunk.offset = indices.size() * sizeof(unsigned int);
+				group.chunks.push_back(chunk);
+			}
+			Chunk & chunk = group.chunks.back();
+
+			// Pre-transformed into world space, normals with the inverse transpose
+			const Mesh & mesh = entry.actor->GetModelPtr()->GetMeshes()[entry.mesh];
+			const glm::mat4 & modelMatrix = entry.actor->GetMeshMatrix(entry.mesh);
+			auto found = meshMaterials.find(&mesh);
+			GLuint material;
+			if(found != meshMaterials.end()) material = found->second;
+			else {
+				MaterialRef ref = mesh.GetMaterialRef();
+				material = (GLuint)materials.size();
+				meshMaterials[&mesh] = material;
+				materials.push_back(BatchMaterial{ ref.diffuseHandle, ref.specularHandle, ref.diffuseLayer, ref.specularLayer });
+			}
+			glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(modelMatrix)));
+			unsigned int base = (unsigned int)vertices.size();
+			for(const Vertex & vertex : mesh.vertices) {
+				Vertex transformed;
+				transformed.Position = glm::vec3(modelMatrix * glm::vec4(vertex.Position, 1.f));
+				glm::vec3 normal = normalMatrix * vertex.Normal;
+				float length = glm::length(normal);
+				transformed.Normal = length > 0.f ? normal / length : vertex.Normal;
+				transformed.TexCoords = vertex.TexCoords;
+				chunk.min = glm::min(chunk.min, transformed.Position);
+				chunk.max = glm::max(chunk.max, transformed.Position);
+				vertices.push_back(transformed);
+			}
+			materialIndices.insert(materialIndices.end(), mesh.vertices.size(), material);
+			for(unsigned int index : mesh.indices) indices.push_back(base + index);
+			chunk.count += (GLsizei)mesh.indices.size();
+			stats.triangles += mesh.indices.size() / 3;
+		}
+		begin = end;
+
+		// The Mesh's vertex layout
+		glGenVertexArrays(1, &group.vertexArray);
+		glGenBuffers(1, &group.vertexBuffer);
+		glGenBuffers(1, &group.elementBuffer);
+		glBindVertexArray(group.vertexArray);
+		glBindBuffer(GL_ARRAY_BUFFER, group.vertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, group.elementBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+		Profiler::CountUpload(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+
+		// Materials: an index per vertex into the group's CGLMaterials
+		glGenBuffers(1, &group.materialIndexBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, group.materialIndexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, materialIndices.size() * sizeof(GLuint), materialIndices.data(), GL_STATIC_DRAW);
+		glEnableVertexAttribArray(5);
+		glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		glGenBuffers(1, &group.materialBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, group.materialBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, materials.size() * sizeof(BatchMaterial), materials.data(), GL_STATIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+		Profiler::CountUpload(materialIndices.size() * sizeof(GLuint) + materials.size() * sizeof(BatchMaterial));
+
+		stats.chunks += (unsigned int)group.chunks.size();
+	}
+	stats.groups = (unsigned int)groups.size();
+}
+
+void StaticBatch::Clear() {
+	for(Group & group : groups) {
+		if(group.vertexArray) glDeleteVertexArrays(1, &group.vertexArray);
+		if(group.vertexBuffer) glDeleteBuffers(1, &group.vertexBuffer);
+		if(group.elementBuffer) glDeleteBuffers(1, &group.elementBuffer);
+		if(group.materialIndexBuffer) glDeleteBuffers(1, &group.materialIndexBuffer);
+		if(group.materialBuffer) glDeleteBuffers(1, &group.materialBuffer);
+	}
+	groups.clear();
+	stats = StaticBatchStats();
+}
+
+unsigned int StaticBatch::Draw(const Frustum & frustum, const OcclusionBuffer * occlusion,
+		const glm::mat4 & viewMatrix, const glm::mat4 & projectionMatrix,
+		ShaderProgram * fallback, unsigned int & visibleChunks) {
+	unsigned int drawCalls = 0;
+	for(Group & group : groups) {
+		ShaderProgram * program = group.program.get();
+		if(!program->IsReady()) {
+			if(!fallback || !fallback->IsReady()) continue;
+			program = fallback;
+		}
+
+		counts.clear();
+		offsets.clear();
+		unsigned long long triangles = 0;
+		for(const Chunk & chunk : group.chunks) {
+			if(!isVisible(frustum, chunk.min, chunk.max)) continue;
+			if(occlusion && occlusion->IsOccluded(chunk.min, chunk.max)) continue;
+			counts.push_back(chunk.count);
+			offsets.push_back((const void*)chunk.offset);
+			triangles += chunk.count / 3;
+		}
+		if(counts.empty()) continue;
+		visibleChunks += (unsigned int)counts.size();
+
+		// Vertices are in world space already
+		program->Use();
+		program->SetUniformMatrix4f("model", glm::mat4(1.f));
+		if(!program->UsesFrameUniforms()) {
+			program->SetUniformMatrix4f("view", viewMatrix);
+			program->SetUniformMatrix4f("projection", projectionMatrix);
+		}
+		group.material->BindTextures(program);
+		program->SetUniform1i("cglStaticBatch", 1);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BUFFER_BINDING, group.materialBuffer);
+		glBindVertexArray(group.vertexArray);
+		Profiler::CountStateChange();
+		glMultiDrawElements(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), (GLsizei)counts.size());
+		Profiler::CountDrawCall(triangles);
+		// The program is shared with Actors drawn on their own
+		program->SetUniform1i("cglStaticBatch", 0);
+		drawCalls++;
+	}
+	glBindVertexArray(0);
+	return drawCalls;
+}
+
+StaticBatchStats StaticBatch::GetStats() const {
+	return stats;
+}
+/* Public Methods */
+/* Private Methods */
+bool StaticBatch::isVisible(const Frustum & frustum, glm::vec3 min, glm::vec3 max) {
+	// Outside if the corner farthest along a plane's normal is behind it
+	for(int i = 0; i < frustum.planeCount; i++) {
+		const glm::vec4 & plane = frustum.planes[i];
+		glm::vec3 corner(plane.x >= 0.f ? max.x : min.x, plane.y >= 0.f ? max.y : min.y, plane.z >= 0.f ? max.z : min.z);
+		if(plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.f) return false;
+	}
+	return true;
+}
+/* Private Methods */
+} /* namespace CGL */
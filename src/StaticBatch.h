@@ -0,0 +1,131 @@
+/*
+ * StaticBatch merges the meshes of Actors which never move (mass 0 bodies) into
+ * a few big vertex/index buffers, so level geometry takes a handful of draw calls:
+ * - vertices are transformed into world space once, when the batch is built
+ * - meshes are grouped by ShaderProgram and bound textures: meshes of one texture
+ *   array (different layers) or with bindless handles share a group, every group
+ *   is one buffer set drawn with its first mesh's textures bound
+ * - the layers and handles of every mesh are per vertex data instead of uniforms
+ *   (see below), so many materials take one draw
+ * - within a group, geometry is sorted into chunks of a world space grid; chunks
+ *   are culled against the view (and the occlusion buffer) and the visible ones
+ *   are drawn with one glMultiDrawElements() per group
+ * The batch doesn't follow changes of its Actors, it's rebuilt by the Scene
+ * whenever the set of static Actors changes.
+ *
+ * Materials in GLSL (#version 430), instead of texture_diffuse1_layer and the
+ * sampler handles while cglStaticBatch is true:
+ *   layout (location = 5) in uint aMaterial;
+ *   struct CGLMaterial { uvec2 diffuseHandle; uvec2 specularHandle; int diffuseLayer; int specularLayer; };
+ *   layout(std430, binding = 6) readonly buffer CGLMaterials { CGLMaterial cglMaterials[]; };
+ *   uniform bool cglStaticBatch;
+ * e.g. texture(texture_diffuse1, vec3(uv, cglMaterials[material].diffuseLayer)) or
+ * texture(sampler2D(cglMaterials[material].diffuseHandle), uv) with aMaterial passed
+ * on as a flat varying.
+ */
+
+#ifndef STATICBATCH_H_
+#define STATICBATCH_H_
+
+#include "Actor.h"
+#include "OcclusionBuffer.h"
+#include "ShaderProgram.h"
+#include "SpatialIndex.h"
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <vector>
+
+namespace CGL {
+
+const GLuint MATERIAL_BUFFER_BINDING = 6;
+
+/*
+ * CGLMaterial of the shader storage buffer (std430 layout)
+ */
+struct BatchMaterial {
+	GLuint64 diffuseHandle, specularHandle;
+	GLint diffuseLayer, specularLayer;
+};
+
+struct StaticBatchStats {
+	// Batched Actors, material groups and chunks of all groups
+	unsigned int actors;
+	unsigned int groups;
+	unsigned int chunks;
+	unsigned long long triangles;
+};
+
+class StaticBatch {
+public:
+	/*
+	 * Chunks are cubes of chunkSize world units
+	 */
+	StaticBatch(float chunkSize=32.f);
+	~StaticBatch();
+
+	/*
+	 * Delete Copy Constructor and operator=
+	 */
+	StaticBatch(const StaticBatch & other) = delete;
+	StaticBatch & operator=(const StaticBatch & other) = delete;
+
+	/*
+	 * Takes effect with the next Build()
+	 */
+	void SetChunkSize(float chunkSize);
+
+	/*
+	 * Replace the batch with the meshes of the given Actors (needs the OpenGL context);
+	 * their ShaderPrograms are resolved here
+	 */
+	void Build(const std::vector<Actor*> & actors);
+	void Clear();
+
+	/*
+	 * Draw the chunks inside the frustum (and not hidden in occlusion, if given);
+	 * programs still compiling are replaced by fallback (if ready) or skipped.
+	 * Returns the number of draw calls, visibleChunks is increased by the drawn chunks.
+	 */
+	unsigned int Draw(const Frustum & frustum, const OcclusionBuffer * occlusion,
+			const glm::mat4 & viewMatrix, const glm::mat4 & projectionMatrix,
+			ShaderProgram * fallback, unsigned int & visibleChunks);
+
+	StaticBatchStats GetStats() const;
+
+private:
+	float chunkSize;
+
+	struct Chunk {
+		glm::vec3 min, max;
+		GLsizei count;
+		// Byte offset of the first index
+		size_t offset;
+	};
+
+	struct Group {
+		std::shared_ptr<ShaderProgram> program;
+		// Mesh providing the bound textures, Models of all meshes (kept alive for their textures)
+		const Mesh * material;
+		std::vector<std::shared_ptr<Model>> models;
+		GLuint vertexArray, vertexBuffer, elementBuffer;
+		// Material index of every vertex and the materials (CGLMaterials)
+		GLuint materialIndexBuffer, materialBuffer;
+		std::vector<Chunk> chunks;
+	};
+	std::vector<Group> groups;
+	StaticBatchStats stats;
+
+	// Per Draw() scratch
+	std::vector<GLsizei> counts;
+	std::vector<const void*> offsets;
+
+	static bool isVisible(const Frustum & frustum, glm::vec3 min, glm::vec3 max);
+};
+
+} /* namespace CGL */
+
+#endif /* STATICBATCH_H_ */
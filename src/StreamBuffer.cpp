@@ -0,0 +1,108 @@
+#include "StreamBuffer.h"
+
+#include <iostream>
+
+namespace CGL {
+
+/* Ctor & Dtor */
+StreamBuffer::StreamBuffer(size_t regionSize, unsigned int regions) {
+	this->regionSize = regionSize;
+	regionCount = regions > 0 ? regions : 1;
+	// BeginFrame() starts with the first region
+	region = regionCount - 1;
+	head = flushed = 0;
+	mapped = nullptr;
+	fences.assign(regionCount, nullptr);
+	stats = StreamBufferStats();
+
+	size_t size = regionSize * regionCount;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if(GLEW_ARB_buffer_storage) {
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, size, nullptr, flags);
+		mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags);
+	}
+	if(!mapped) {
+		glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+		shadow.resize(size);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+StreamBuffer::~StreamBuffer() {
+	for(GLsync fence : fences)
+		if(fence) glDeleteSync(fence);
+	if(mapped) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+	glDeleteBuffers(1, &buffer);
+}
+/* Ctor & Dtor */
+/* Public Methods */
+void StreamBuffer::BeginFrame() {
+	region = (region + 1) % regionCount;
+	head = flushed = 0;
+	stats.frameBytes = 0;
+
+	GLsync & fence = fences[region];
+	if(!fence) return;
+	// The GPU is normally done with a region written regionCount frames ago
+	GLenum result = glClientWaitSync(fence, 0, 0);
+	if(result == GL_TIMEOUT_EXPIRED) {
+		stats.stalls++;
+		do result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		while(result == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+StreamAllocation StreamBuffer::Allocate(size_t size, size_t alignment) {
+	StreamAllocation allocation = { nullptr, buffer, 0, size };
+	size_t start = alignment > 1 ? (head + alignment - 1) / alignment * alignment : head;
+	if(start + size > regionSize) {
+		if(stats.overflows++ == 0)
+			std::cout << "CGL::WARNING::STREAMBUFFER::ALLOCATE() Region of " << regionSize << " bytes is full\n";
+		return allocation;
+	}
+
+	allocation.offset = region * regionSize + start;
+	allocation.data = (mapped ? mapped : shadow.data()) + allocation.offset;
+	stats.frameBytes += start + size - head;
+	head = start + size;
+	return allocation;
+}
+
+void StreamBuffer::Flush() {
+	// Coherent persistent mapping needs no flush
+	if(mapped || head == flushed) return;
+	size_t offset = region * regionSize + flushed;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, offset, head - flushed, shadow.data() + offset);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	Profiler::CountUpload(head - flushed);
+	flushed = head;
+}
+
+void StreamBuffer::EndFrame() {
+	Flush();
+	if(fences[region]) glDeleteSync(fences[region]);
+	fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLuint StreamBuffer::GetBuffer() const {
+	return buffer;
+}
+
+bool StreamBuffer::IsPersistent() const {
+	return mapped != nullptr;
+}
+
+StreamBufferStats StreamBuffer::GetStats() const {
+	return stats;
+}
+/* Public Methods */
+} /* namespace CGL */
@@ -0,0 +1,86 @@
+/*
+ * StreamBuffer is a ring of N regions (3 by default) of one OpenGL buffer
+ * for data rewritten every frame (uniforms, instance matrices, debug geometry):
+ * - BeginFrame() moves to the next region and waits for its fence,
+ *   which was set N frames ago, so it normally doesn't wait at all
+ * - Allocate() is a bump allocation within the region
+ * - EndFrame() fences the region after the frame's commands
+ * With ARB_buffer_storage the buffer is mapped once (persistent, coherent)
+ * and allocations are written directly. Without it they are written to
+ * a copy in RAM and Flush() uploads them with glBufferSubData.
+ */
+
+#ifndef STREAMBUFFER_H_
+#define STREAMBUFFER_H_
+
+#include "Profiler.h"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace CGL {
+
+/*
+ * Memory for the current frame; data is nullptr if the region is full
+ * Bind with buffer and offset (e.g. glBindBufferRange)
+ */
+struct StreamAllocation {
+	void * data;
+	GLuint buffer;
+	size_t offset;
+	size_t size;
+};
+
+struct StreamBufferStats {
+	// Bytes allocated in the current/last frame
+	size_t frameBytes;
+	// BeginFrame() calls which had to wait for the GPU, and failed allocations
+	unsigned long long stalls;
+	unsigned long long overflows;
+};
+
+class StreamBuffer {
+public:
+	/*
+	 * Needs the OpenGL context; the buffer can be bound to any target
+	 * (it's set up through GL_COPY_WRITE_BUFFER, so no other binding is disturbed)
+	 */
+	StreamBuffer(size_t regionSize, unsigned int regions=3);
+	~StreamBuffer();
+
+	/*
+	 * Delete Copy Constructor and operator=
+	 */
+	StreamBuffer(const StreamBuffer & other) = delete;
+	StreamBuffer & operator=(const StreamBuffer & other) = delete;
+
+	void BeginFrame();
+	StreamAllocation Allocate(size_t size, size_t alignment=16);
+	void Flush();
+	void EndFrame();
+
+	GLuint GetBuffer() const;
+	bool IsPersistent() const;
+	StreamBufferStats GetStats() const;
+
+private:
+	GLuint buffer;
+	size_t regionSize;
+	unsigned int regionCount;
+	unsigned int region;
+	// Bump pointer and the part already uploaded (RAM copy only) within the region
+	size_t head;
+	size_t flushed;
+
+	unsigned char * mapped;
+	std::vector<unsigned char> shadow;
+	std::vector<GLsync> fences;
+
+	StreamBufferStats stats;
+};
+
+} /* namespace CGL */
+
+#endif /* STREAMBUFFER_H_ */
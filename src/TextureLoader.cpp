@@ -0,0 +1,491 @@
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CGL_TEXTURE_SSE2
+#endif
+
+namespace CGL {
+
+namespace {
+
+struct BlockFormat {
+	GLenum linear;
+	GLenum srgb;       // 0 if the format has no sRGB variant
+	unsigned int blockBytes;
+};
+
+const BlockFormat BC1 = { GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT, 8 };
+const BlockFormat BC2 = { GL_COMPRESSED_RGBA_S3TC_DXT3_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT, 16 };
+const BlockFormat BC3 = { GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT, 16 };
+const BlockFormat BC4 = { GL_COMPRESSED_RED_RGTC1, 0, 8 };
+const BlockFormat BC4S = { GL_COMPRESSED_SIGNED_RED_RGTC1, 0, 8 };
+const BlockFormat BC5 = { GL_COMPRESSED_RG_RGTC2, 0, 16 };
+const BlockFormat BC5S = { GL_COMPRESSED_SIGNED_RG_RGTC2, 0, 16 };
+const BlockFormat BC6H = { GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT, 0, 16 };
+const BlockFormat BC6HS = { GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT, 0, 16 };
+const BlockFormat BC7 = { GL_COMPRESSED_RGBA_BPTC_UNORM, GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM, 16 };
+
+/*
+ * File layouts
+ */
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+const uint32_t DDPF_FOURCC = 0x4;
+
+struct DDSPixelFormat {
+	uint32_t size, flags, fourCC, rgbBitCount, rMask, gMask, bMask, aMask;
+};
+
+struct DDSHeader {
+	uint32_t size, flags, height, width, pitchOrLinearSize, depth, mipMapCount;
+	uint32_t reserved1[11];
+	DDSPixelFormat pixelFormat;
+	uint32_t caps, caps2, caps3, caps4, reserved2;
+};
+
+struct DDSHeaderDX10 {
+	uint32_t dxgiFormat, resourceDimension, miscFlag, arraySize, miscFlags2;
+};
+
+const unsigned char KTX2_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+struct KTX2Header {
+	unsigned char identifier[12];
+	uint32_t vkFormat, typeSize, pixelWidth, pixelHeight, pixelDepth;
+	uint32_t layerCount, faceCount, levelCount, supercompressionScheme;
+	uint32_t dfdByteOffset, dfdByteLength, kvdByteOffset, kvdByteLength;
+	uint64_t sgdByteOffset, sgdByteLength;
+};
+
+struct KTX2Level {
+	uint64_t byteOffset, byteLength, uncompressedByteLength;
+};
+
+uint32_t fourCC(const char* code) {
+	return (uint32_t)code[0] | ((uint32_t)code[1] << 8) | ((uint32_t)code[2] << 16) | ((uint32_t)code[3] << 24);
+}
+
+/*
+ * Formats by their identifiers in each container, srgbFile is set
+ * when the identifier itself says the data is sRGB encoded
+ */
+const BlockFormat* fromFourCC(uint32_t code) {
+	if(code == fourCC("DXT1")) return &BC1;
+	if(code == fourCC("DXT2") || code == fourCC("DXT3")) return &BC2;
+	if(code == fourCC("DXT4") || code == fourCC("DXT5")) return &BC3;
+	if(code == fourCC("ATI1") || code == fourCC("BC4U")) return &BC4;
+	if(code == fourCC("BC4S")) return &BC4S;
+	if(code == fourCC("ATI2") || code == fourCC("BC5U")) return &BC5;
+	if(code == fourCC("BC5S")) return &BC5S;
+	return nullptr;
+}
+
+const BlockFormat* fromDXGI(uint32_t format, bool & srgbFile) {
+	srgbFile = format == 72 || format == 75 || format == 78 || format == 99;
+	switch(format) {
+	case 70: case 71: case 72: return &BC1;
+	case 73: case 74: case 75: return &BC2;
+	case 76: case 77: case 78: return &BC3;
+	case 79: case 80: return &BC4;
+	case 81: return &BC4S;
+	case 82: case 83: return &BC5;
+	case 84: return &BC5S;
+	case 94: case 95: return &BC6H;
+	case 96: return &BC6HS;
+	case 97: case 98: case 99: return &BC7;
+	default: return nullptr;
+	}
+}
+
+const BlockFormat* fromVkFormat(uint32_t format, bool & srgbFile) {
+	srgbFile = format == 132 || format == 134 || format == 136 || format == 138 || format == 146;
+	switch(format) {
+	case 131: case 132: case 133: case 134: return &BC1;
+	case 135: case 136: return &BC2;
+	case 137: case 138: return &BC3;
+	case 139: return &BC4;
+	case 140: return &BC4S;
+	case 141: return &BC5;
+	case 142: return &BC5S;
+	case 143: return &BC6H;
+	case 144: return &BC6HS;
+	case 145: case 146: return &BC7;
+	default: return nullptr;
+	}
+}
+
+size_t levelSize(const BlockFormat & format, unsigned int width, unsigned int height) {
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * format.blockBytes;
+}
+
+unsigned int levelExtent(unsigned int extent, unsigned int level) {
+	extent >>= level;
+	return extent ? extent : 1;
+}
+
+// floor(log2(max(width, height))) + 1, the levels of a full mip chain
+unsigned int maxLevelCount(unsigned int width, unsigned int height) {
+	unsigned int extent = std::max(width, height), count = 0;
+	for(; extent; extent >>= 1) count++;
+	return count;
+}
+
+bool readDDS(const std::vector<unsigned char> & file, bool srgb, CompressedImage & image) {
+	if(file.size() < 4 + sizeof(DDSHeader)) return false;
+	DDSHeader header;
+	std::memcpy(&header, file.data() + 4, sizeof(header));
+	size_t offset = 4 + sizeof(header);
+	if(header.size != sizeof(DDSHeader) || !(header.pixelFormat.flags & DDPF_FOURCC)) return false;
+
+	const BlockFormat* format = nullptr;
+	bool srgbFile = false;
+	if(header.pixelFormat.fourCC == fourCC("DX10")) {
+		if(file.size() < offset + sizeof(DDSHeaderDX10)) return false;
+		DDSHeaderDX10 dx10;
+		std::memcpy(&dx10, file.data() + offset, sizeof(dx10));
+		offset += sizeof(dx10);
+		// Only a single 2D texture (D3D10_RESOURCE_DIMENSION_TEXTURE2D)
+		if(dx10.resourceDimension != 3 || dx10.arraySize > 1) return false;
+		format = fromDXGI(dx10.dxgiFormat, srgbFile);
+	}
+	else format = fromFourCC(header.pixelFormat.fourCC);
+	if(format == nullptr || header.width == 0 || header.height == 0) return false;
+
+	image.internalFormat = (srgb || srgbFile) && format->srgb ? format->srgb : format->linear;
+	image.width = header.width;
+	image.height = header.height;
+	image.levels.clear();
+
+	// Levels are stored level 0 first right after the header(s)
+	size_t dataStart = offset;
+	unsigned int levelCount = header.mipMapCount ? header.mipMapCount : 1;
+	if(levelCount > maxLevelCount(header.width, header.height)) return false;
+	for(unsigned int level = 0; level < levelCount; level++) {
+		CompressedLevel l;
+		l.width = levelExtent(header.width, level);
+		l.height = levelExtent(header.height, level);
+		l.offset = offset - dataStart;
+		l.size = levelSize(*format, l.width, l.height);
+		if(l.size > file.size() - offset) return false;
+		offset += l.size;
+		image.levels.push_back(l);
+	}
+	image.data.assign(file.begin() + dataStart, file.begin() + offset);
+	return true;
+}
+
+bool readKTX2(const std::vector<unsigned char> & file, bool srgb, CompressedImage & image) {
+	if(file.size() < sizeof(KTX2Header)) return false;
+	KTX2Header header;
+	std::memcpy(&header, file.data(), sizeof(header));
+	if(std::memcmp(header.identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) return false;
+
+	// Single 2D texture without supercompression (zstd/BasisLZ need a transcoder)
+	if(header.supercompressionScheme != 0 || header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1) return false;
+
+	bool srgbFile = false;
+	const BlockFormat* format = fromVkFormat(header.vkFormat, srgbFile);
+	if(format == nullptr || header.pixelWidth == 0 || header.pixelHeight == 0) return false;
+
+	unsigned int levelCount = header.levelCount ? header.levelCount : 1;
+	if(levelCount > maxLevelCount(header.pixelWidth, header.pixelHeight)) return false;
+	if(file.size() < sizeof(header) + levelCount * sizeof(KTX2Level)) return false;
+
+	image.internalFormat = (srgb || srgbFile) && format->srgb ? format->srgb : format->linear;
+	image.width = header.pixelWidth;
+	image.height = header.pixelHeight;
+	image.levels.clear();
+	image.data.clear();
+
+	// Levels in KTX2 are stored smallest first, copy them out level 0 first
+	for(unsigned int level = 0; level < levelCount; level++) {
+		KTX2Level index;
+		std::memcpy(&index, file.data() + sizeof(header) + level * sizeof(KTX2Level), sizeof(index));
+
+		CompressedLevel l;
+		l.width = levelExtent(header.pixelWidth, level);
+		l.height = levelExtent(header.pixelHeight, level);
+		l.offset = image.data.size();
+		l.size = levelSize(*format, l.width, l.height);
+		if(index.byteLength < l.size || index.byteOffset > file.size() || l.size > file.size() - index.byteOffset) return false;
+
+		image.data.insert(image.data.end(), file.begin() + index.byteOffset, file.begin() + index.byteOffset + l.size);
+		image.levels.push_back(l);
+	}
+	return true;
+}
+
+bool hasExtension(const std::string & path, const std::string & extension) {
+	if(path.size() < extension.size()) return false;
+	for(size_t i = 0; i < extension.size(); i++)
+		if(std::tolower(path[path.size() - extension.size() + i]) != extension[i]) return false;
+	return true;
+}
+
+bool fileExists(const std::string & path) {
+	std::ifstream file(path, std::ios::binary);
+	return file.good();
+}
+
+/*
+ * sRGB <-> linear conversion tables for mip filtering
+ */
+struct SRGBTables {
+	float toLinear[256];
+	unsigned char fromLinear[4096];
+
+	SRGBTables() {
+		for(int i = 0; i < 256; i++) {
+			float value = i / 255.f;
+			toLinear[i] = value <= .04045f ? value / 12.92f : std::pow((value + .055f) / 1.055f, 2.4f);
+		}
+		for(int i = 0; i < 4096; i++) {
+			float value = i / 4095.f;
+			value = value <= .0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - .055f;
+			fromLinear[i] = (unsigned char)std::min(255.f, value * 255.f + .5f);
+		}
+	}
+};
+
+const SRGBTables & srgbTables() {
+	// Initialization of a local static is thread safe
+	static const SRGBTables tables;
+	return tables;
+}
+
+} // namespace
+
+bool ReadCompressedImage(const std::string & path, bool srgb, CompressedImage & image) {
+	std::ifstream in(path, std::ios::binary);
+	if(!in) return false;
+	std::vector<unsigned char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+	bool ok = hasExtension(path, ".ktx2") ? readKTX2(file, srgb, image) : readDDS(file, srgb, image);
+	if(!ok) std::cout << "CGL::ERROR::TEXTURELOADER::READCOMPRESSEDIMAGE() Unsupported or malformed file " << path << "\n";
+	return ok;
+} /* ReadCompressedImage(...) */
+
+unsigned int UploadCompressedImage(const CompressedImage & image) {
+	if(image.levels.empty()) return 0;
+	while(glGetError() != GL_NO_ERROR);
+
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	for(size_t level = 0; level < image.levels.size(); level++) {
+		const CompressedLevel & l = image.levels[level];
+		glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, image.internalFormat, l.width, l.height, 0, (GLsizei)l.size, image.data.data() + l.offset);
+		Profiler::CountUpload(l.size);
+	}
+
+	// Formats without driver support (e.g. BPTC before GL 4.2) end up here
+	if(glGetError() != GL_NO_ERROR) {
+		std::cout << "CGL::ERROR::TEXTURELOADER::UPLOADCOMPRESSEDIMAGE() Format 0x" << std::hex << image.internalFormat << std::dec << " rejected by the driver\n";
+		glDeleteTextures(1, &textureID);
+		return 0;
+	}
+
+	// Incomplete chains are fine, sampling stops at the last stored level
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, image.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return textureID;
+} /* UploadCompressedImage(const CompressedImage & image) */
+
+unsigned int LoadCompressedTexture(const std::string & path, bool srgb) {
+	CompressedImage image;
+	if(!ReadCompressedImage(path, srgb, image)) return 0;
+	return UploadCompressedImage(image);
+}
+
+void DownsampleRGBA8(const unsigned char* src, unsigned int width, unsigned int height, unsigned char* dst, bool srgb) {
+	unsigned int dstWidth = std::max(1u, width / 2), dstHeight = std::max(1u, height / 2);
+	const SRGBTables & tables = srgbTables();
+
+	for(unsigned int y = 0; y < dstHeight; y++) {
+		// Rows and columns are clamped only for 1 pixel wide/high sources
+		const unsigned char* row0 = src + (size_t)std::min(2 * y, height - 1) * width * 4;
+		const unsigned char* row1 = src + (size_t)std::min(2 * y + 1, height - 1) * width * 4;
+		unsigned char* out = dst + (size_t)y * dstWidth * 4;
+		unsigned int x = 0;
+
+#ifdef CGL_TEXTURE_SSE2
+		// Two output pixels from 4x2 source pixels per iteration
+		if(!srgb && width >= 2) {
+			const __m128i zero = _mm_setzero_si128(), round = _mm_set1_epi16(2);
+			for(; x + 1 < dstWidth; x += 2) {
+				__m128i a = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+				__m128i b = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+				__m128i low = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i high = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+				__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(low, high), _mm_unpackhi_epi64(low, high));
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+				_mm_storel_epi64((__m128i*)(out + x * 4), _mm_packus_epi16(sum, zero));
+			}
+		}
+#endif
+
+		for(; x < dstWidth; x++) {
+			unsigned int x0 = std::min(2 * x, width - 1) * 4, x1 = std::min(2 * x + 1, width - 1) * 4;
+			for(int c = 0; c < 4; c++) {
+				if(srgb && c < 3) {
+					float sum = tables.toLinear[row0[x0 + c]] + tables.toLinear[row0[x1 + c]] + tables.toLinear[row1[x0 + c]] + tables.toLinear[row1[x1 + c]];
+					out[x * 4 + c] = tables.fromLinear[(int)(sum * (4095.f / 4.f) + .5f)];
+				}
+				else out[x * 4 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+			}
+		}
+	}
+} /* DownsampleRGBA8(...) */
+
+bool DecodeTexture(const std::string & path, bool srgb, DecodedTexture & texture) {
+	texture.srgb = srgb;
+	texture.levels.clear();
+
+	std::string compressedPath = FindCompressedTexture(path);
+	if(!compressedPath.empty() && ReadCompressedImage(compressedPath, srgb, texture.compressedImage)) {
+		texture.compressed = true;
+		texture.width = texture.compressedImage.width;
+		texture.height = texture.compressedImage.height;
+		return true;
+	}
+	texture.compressed = false;
+
+	int width, height, channels;
+	unsigned char* pixels = SOIL_load_image(path.c_str(), &width, &height, &channels, SOIL_LOAD_RGBA);
+	if(!pixels) {
+#ifdef _DEBUG
+		// SOIL_last_result() is shared by all threads, so it may be another image's error
+		printf("CGL::ERROR::TEXTURELOADER::SOIL2::LOADING '%s' %s\n", path.c_str(), SOIL_last_result());
+#endif // _DEBUG
+		return false;
+	}
+	texture.width = width;
+	texture.height = height;
+	texture.levels.emplace_back(pixels, pixels + (size_t)width * height * 4);
+	SOIL_free_image_data(pixels);
+
+	std::vector<unsigned char> & base = texture.levels.back();
+#if defined(WIN32) || defined(_WIN32) || defined(__WIN32) && !defined(__CYGWIN__)
+	// Same as SOIL_FLAG_INVERT_Y, see TextureFromFile()
+	for(int y = 0; y < height / 2; y++)
+		std::swap_ranges(base.begin() + (size_t)y * width * 4, base.begin() + (size_t)(y + 1) * width * 4, base.begin() + (size_t)(height - 1 - y) * width * 4);
+#endif
+	// Same as SOIL_FLAG_NTSC_SAFE_RGB: color channels scaled to 16..235
+	for(size_t i = 0; i < base.size(); i++)
+		if(i % 4 != 3) base[i] = (unsigned char)(16 + base[i] * 219 / 255);
+
+	unsigned int levelWidth = texture.width, levelHeight = texture.height;
+	while(levelWidth > 1 || levelHeight > 1) {
+		unsigned int nextWidth = std::max(1u, levelWidth / 2), nextHeight = std::max(1u, levelHeight / 2);
+		std::vector<unsigned char> next((size_t)nextWidth * nextHeight * 4);
+		DownsampleRGBA8(texture.levels.back().data(), levelWidth, levelHeight, next.data(), srgb);
+		texture.levels.push_back(std::move(next));
+		levelWidth = nextWidth; levelHeight = nextHeight;
+	}
+	return true;
+} /* DecodeTexture(...) */
+
+unsigned int UploadDecodedTexture(const DecodedTexture & texture) {
+	if(texture.compressed) return UploadCompressedImage(texture.compressedImage);
+	if(texture.levels.empty()) return 0;
+
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	for(size_t level = 0; level < texture.levels.size(); level++) {
+		GLsizei width = std::max(1u, texture.width >> level), height = std::max(1u, texture.height >> level);
+		glTexImage2D(GL_TEXTURE_2D, (GLint)level, texture.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture.levels[level].data());
+		Profiler::CountUpload(texture.levels[level].size());
+	}
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)texture.levels.size() - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return textureID;
+} /* UploadDecodedTexture(const DecodedTexture & texture) */
+
+bool IsSameTextureLayout(const DecodedTexture & a, const DecodedTexture & b) {
+	if(a.compressed != b.compressed || a.width != b.width || a.height != b.height) return false;
+	if(a.compressed)
+		return a.compressedImage.internalFormat == b.compressedImage.internalFormat
+				&& a.compressedImage.levels.size() == b.compressedImage.levels.size();
+	return a.srgb == b.srgb && a.levels.size() == b.levels.size();
+}
+
+unsigned int UploadTextureArray(const std::vector<const DecodedTexture*> & layers) {
+	if(layers.empty()) return 0;
+	const DecodedTexture & first = *layers.front();
+	size_t levelCount = first.compressed ? first.compressedImage.levels.size() : first.levels.size();
+	if(levelCount == 0) return 0;
+	while(glGetError() != GL_NO_ERROR);
+
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// Every level of all layers is uploaded with a single call
+	std::vector<unsigned char> staging;
+	for(size_t level = 0; level < levelCount; level++) {
+		staging.clear();
+		for(const DecodedTexture * layer : layers) {
+			if(layer->compressed) {
+				const CompressedLevel & l = layer->compressedImage.levels[level];
+				staging.insert(staging.end(), layer->compressedImage.data.begin() + l.offset, layer->compressedImage.data.begin() + l.offset + l.size);
+			}
+			else staging.insert(staging.end(), layer->levels[level].begin(), layer->levels[level].end());
+		}
+
+		GLsizei width = std::max(1u, first.width >> level), height = std::max(1u, first.height >> level);
+		if(first.compressed)
+			glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, first.compressedImage.internalFormat, width, height, (GLsizei)layers.size(), 0, (GLsizei)staging.size(), staging.data());
+		else
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, first.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, width, height, (GLsizei)layers.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, staging.data());
+		Profiler::CountUpload(staging.size());
+	}
+
+	if(glGetError() != GL_NO_ERROR) {
+		std::cout << "CGL::ERROR::TEXTURELOADER::UPLOADTEXTUREARRAY() Texture array of " << layers.size() << " layers rejected by the driver\n";
+		glDeleteTextures(1, &textureID);
+		return 0;
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)levelCount - 1);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	return textureID;
+} /* UploadTextureArray(const std::vector<const DecodedTexture*> & layers) */
+
+std::string FindCompressedTexture(const std::string & path) {
+	if(hasExtension(path, ".ktx2") || hasExtension(path, ".dds")) return path;
+
+	size_t dot = path.find_last_of('.');
+	size_t slash = path.find_last_of("/\\");
+	std::string stem = (dot == std::string::npos || (slash != std::string::npos && dot < slash)) ? path : path.substr(0, dot);
+
+	if(fileExists(stem + ".ktx2")) return stem + ".ktx2";
+	if(fileExists(stem + ".dds")) return stem + ".dds";
+	return std::string();
+}
+
+} /* namespace CGL */
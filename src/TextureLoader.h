@@ -0,0 +1,126 @@
+/*
+ * Texture loading split into two steps:
+ * - reading/decoding, which doesn't touch OpenGL and can run on any thread
+ * - uploading, which has to run on the thread owning the GL context
+ * Block compressed files prepared offline (see tools/texconv.cpp):
+ * - DDS (legacy DXT1/DXT3/DXT5/ATI1/ATI2 FourCC and DX10 header)
+ * - KTX2 (without supercompression)
+ * with BC1-BC7 formats and a precomputed mip chain are uploaded as they are
+ * stored with glCompressedTexImage2D. Other images (PNG, JPG, ...) are decoded
+ * with SOIL2 and get their mip chain built on the CPU.
+ */
+
+#ifndef TEXTURELOADER_H_
+#define TEXTURELOADER_H_
+
+#include "Profiler.h"
+
+#include <GL/glew.h>
+
+#include <SOIL2/SOIL2.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CGL {
+
+/*
+ * Single mip level, stored in CompressedImage::data at offset
+ */
+struct CompressedLevel {
+	unsigned int width;
+	unsigned int height;
+	size_t offset;
+	size_t size;
+};
+
+/*
+ * Block compressed image read from a container file, level 0 first
+ */
+struct CompressedImage {
+	GLenum internalFormat;
+	unsigned int width;
+	unsigned int height;
+	std::vector<unsigned char> data;
+	std::vector<CompressedLevel> levels;
+};
+
+/*
+ * Read a .dds or .ktx2 file into image (no OpenGL calls)
+ * srgb selects the sRGB variant of BC1/BC2/BC3/BC7 color formats
+ * stored without the color space information
+ * Return false if the file is missing, malformed or in an unsupported format
+ */
+bool ReadCompressedImage(const std::string & path, bool srgb, CompressedImage & image);
+
+/*
+ * Upload every level of the image to a new 2D texture
+ * Returns OpenGL's texture ID or 0 if the driver rejected the format
+ */
+unsigned int UploadCompressedImage(const CompressedImage & image);
+
+/*
+ * ReadCompressedImage() followed by UploadCompressedImage()
+ */
+unsigned int LoadCompressedTexture(const std::string & path, bool srgb=false);
+
+/*
+ * Texture decoded on the CPU, ready to be uploaded:
+ * either a block compressed image or an RGBA8 mip chain (level 0 first)
+ */
+struct DecodedTexture {
+	bool compressed;
+	CompressedImage compressedImage;
+
+	bool srgb;
+	unsigned int width;
+	unsigned int height;
+	std::vector<std::vector<unsigned char>> levels;
+};
+
+/*
+ * Decode the texture of an image path (no OpenGL calls, safe to run on worker threads)
+ * A pre-compressed version next to the image is read instead when present
+ * (see FindCompressedTexture()), otherwise the image is decoded and its
+ * full mip chain is generated (filtered in linear space if srgb)
+ * Return false if the image can't be loaded
+ */
+bool DecodeTexture(const std::string & path, bool srgb, DecodedTexture & texture);
+
+/*
+ * Upload a decoded texture to a new 2D texture with all its levels
+ * Returns OpenGL's texture ID or 0 on failure
+ */
+unsigned int UploadDecodedTexture(const DecodedTexture & texture);
+
+/*
+ * Can both textures be layers of the same texture array
+ * (same format, size and number of levels)
+ */
+bool IsSameTextureLayout(const DecodedTexture & a, const DecodedTexture & b);
+
+/*
+ * Upload textures of the same layout (see IsSameTextureLayout()) as layers
+ * of a new GL_TEXTURE_2D_ARRAY, in the given order
+ * Returns OpenGL's texture ID or 0 on failure
+ */
+unsigned int UploadTextureArray(const std::vector<const DecodedTexture*> & layers);
+
+/*
+ * Halve an RGBA8 image with a 2x2 box filter (SSE2 where available)
+ * dst has to hold max(1, width/2) x max(1, height/2) pixels
+ * With srgb, color channels are averaged in linear space, alpha always is linear
+ */
+void DownsampleRGBA8(const unsigned char* src, unsigned int width, unsigned int height, unsigned char* dst, bool srgb);
+
+/*
+ * Path of the pre-compressed version of an image: the path itself if it's
+ * already a .ktx2/.dds file, otherwise a .ktx2 or .dds file with the same stem
+ * next to it. Empty string if there is none.
+ */
+std::string FindCompressedTexture(const std::string & path);
+
+} /* namespace CGL */
+
+#endif /* TEXTURELOADER_H_ */
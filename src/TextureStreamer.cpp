@@ -0,0 +1,207 @@
+#include "TextureStreamer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace CGL {
+
+/* Ctor & Dtor */
+TextureStreamer::TextureStreamer(size_t budgetBytes, size_t uploadBytesPerFrame, unsigned int initialSize) {
+	this->budgetBytes = budgetBytes;
+	this->uploadBytesPerFrame = uploadBytesPerFrame;
+	this->initialSize = initialSize > 0 ? initialSize : 1;
+	frame = 1;
+	stats = TextureStreamerStats();
+	stats.budgetBytes = budgetBytes;
+}
+
+TextureStreamer::~TextureStreamer() {
+	for(auto & pair : entries) {
+		unsigned int textureID = pair.first;
+		glDeleteTextures(1, &textureID);
+	}
+}
+/* Ctor & Dtor */
+/* Public Methods */
+unsigned int TextureStreamer::Register(DecodedTexture && texture) {
+	Entry entry;
+	entry.texture = std::move(texture);
+	entry.levelCount = (unsigned int)(entry.texture.compressed ? entry.texture.compressedImage.levels.size() : entry.texture.levels.size());
+	if(entry.levelCount == 0) return 0;
+
+	// Coarsest level not larger than initialSize (or the last one)
+	entry.minimumLevel = 0;
+	while(entry.minimumLevel + 1 < entry.levelCount
+			&& std::max(entry.texture.width >> entry.minimumLevel, entry.texture.height >> entry.minimumLevel) > initialSize)
+		entry.minimumLevel++;
+	entry.residentLevel = entry.levelCount;
+	entry.wantedLevel = entry.minimumLevel;
+	entry.requestedLevel = entry.minimumLevel;
+	entry.lastRequested = 0;
+
+	unsigned int textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)entry.levelCount - 1);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	// Coarse levels first, so the texture is complete at every step
+	for(unsigned int level = entry.levelCount; level-- > entry.minimumLevel;)
+		uploadLevel(textureID, entry, level);
+
+	entries[textureID] = std::move(entry);
+	stats.streamedTextures = entries.size();
+	return textureID;
+} /* TextureStreamer::Register(DecodedTexture && texture) */
+
+void TextureStreamer::Unregister(unsigned int textureID) {
+	auto it = entries.find(textureID);
+	if(it == entries.end()) return;
+	for(unsigned int level = it->second.residentLevel; level < it->second.levelCount; level++)
+		stats.residentBytes -= levelBytes(it->second, level);
+	glDeleteTextures(1, &textureID);
+	entries.erase(it);
+	stats.streamedTextures = entries.size();
+}
+
+void TextureStreamer::Request(unsigned int textureID, float screenPixels) {
+	auto it = entries.find(textureID);
+	if(it == entries.end()) return;
+	Entry & entry = it->second;
+
+	// One texel per pixel: every halving of the on-screen size skips a level
+	float size = (float)std::max(entry.texture.width, entry.texture.height);
+	unsigned int level = 0;
+	if(screenPixels < size)
+		level = screenPixels > 1.f ? (unsigned int)std::log2(size / screenPixels) : entry.minimumLevel;
+	level = std::min(level, entry.minimumLevel);
+
+	if(entry.lastRequested != frame) {
+		entry.lastRequested = frame;
+		entry.requestedLevel = level;
+	}
+	else entry.requestedLevel = std::min(entry.requestedLevel, level);
+}
+
+void TextureStreamer::Update() {
+	stats.uploadedLevels = stats.evictedLevels = 0;
+	stats.uploadedBytes = 0;
+
+	// Textures not seen this frame keep what they have until memory is needed
+	for(auto & pair : entries)
+		if(pair.second.lastRequested == frame) pair.second.wantedLevel = pair.second.requestedLevel;
+
+	// Drop one level of the texture which needs it the least (stale first, then surplus)
+	auto evictOne = [this](unsigned int keep) {
+		unsigned int victimID = 0;
+		Entry * victim = nullptr;
+		for(auto & pair : entries) {
+			Entry & entry = pair.second;
+			if(pair.first == keep || entry.residentLevel >= entry.minimumLevel) continue;
+			bool stale = entry.lastRequested != frame;
+			bool surplus = entry.residentLevel < entry.wantedLevel;
+			if(!stale && !surplus) continue;
+			if(victim == nullptr
+					|| (stale && victim->lastRequested == frame)
+					|| (stale == (victim->lastRequested != frame) && entry.lastRequested < victim->lastRequested)) {
+				victimID = pair.first;
+				victim = &entry;
+			}
+		}
+		if(victim == nullptr) return false;
+		releaseLevel(victimID, *victim, victim->residentLevel);
+		return true;
+	};
+
+	// Budget lowered (or data of registration larger than it)
+	while(stats.residentBytes > budgetBytes && evictOne(0));
+
+	// Stream in the next finer level of the most starved visible textures first
+	std::vector<unsigned int> blocked;
+	while(true) {
+		unsigned int bestID = 0;
+		Entry * best = nullptr;
+		for(auto & pair : entries) {
+			Entry & entry = pair.second;
+			if(entry.lastRequested != frame || entry.residentLevel <= entry.wantedLevel) continue;
+			if(std::find(blocked.begin(), blocked.end(), pair.first) != blocked.end()) continue;
+			if(best == nullptr || entry.residentLevel - entry.wantedLevel > best->residentLevel - best->wantedLevel) {
+				bestID = pair.first;
+				best = &entry;
+			}
+		}
+		if(best == nullptr) break;
+
+		unsigned int level = best->residentLevel - 1;
+		size_t bytes = levelBytes(*best, level);
+		if(stats.uploadedBytes > 0 && stats.uploadedBytes + bytes > uploadBytesPerFrame) break;
+
+		while(stats.residentBytes + bytes > budgetBytes && evictOne(bestID));
+		if(stats.residentBytes + bytes > budgetBytes) {
+			blocked.push_back(bestID);
+			continue;
+		}
+		uploadLevel(bestID, *best, level);
+		stats.uploadedLevels++;
+		stats.uploadedBytes += bytes;
+	}
+
+	frame++;
+} /* TextureStreamer::Update() */
+
+void TextureStreamer::SetBudget(size_t budgetBytes) {
+	this->budgetBytes = budgetBytes;
+	stats.budgetBytes = budgetBytes;
+}
+
+TextureStreamerStats TextureStreamer::GetStats() const {
+	return stats;
+}
+/* Public Methods */
+/* Private Methods */
+size_t TextureStreamer::levelBytes(const Entry & entry, unsigned int level) const {
+	if(entry.texture.compressed) return entry.texture.compressedImage.levels[level].size;
+	return entry.texture.levels[level].size();
+}
+
+void TextureStreamer::uploadLevel(unsigned int textureID, Entry & entry, unsigned int level) {
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	if(entry.texture.compressed) {
+		const CompressedImage & image = entry.texture.compressedImage;
+		const CompressedLevel & l = image.levels[level];
+		glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, image.internalFormat, l.width, l.height, 0, (GLsizei)l.size, image.data.data() + l.offset);
+	}
+	else {
+		GLsizei width = std::max(1u, entry.texture.width >> level), height = std::max(1u, entry.texture.height >> level);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexImage2D(GL_TEXTURE_2D, (GLint)level, entry.texture.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, entry.texture.levels[level].data());
+	}
+	Profiler::CountUpload(levelBytes(entry, level));
+
+	stats.residentBytes += levelBytes(entry, level);
+	entry.residentLevel = level;
+	setBaseLevel(textureID, level);
+}
+
+void TextureStreamer::releaseLevel(unsigned int textureID, Entry & entry, unsigned int level) {
+	// Sampling moves to the next level before the storage goes away
+	setBaseLevel(textureID, level + 1);
+	if(entry.texture.compressed)
+		glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, entry.texture.compressedImage.internalFormat, 0, 0, 0, 0, nullptr);
+	else
+		glTexImage2D(GL_TEXTURE_2D, (GLint)level, entry.texture.srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+	stats.residentBytes -= levelBytes(entry, level);
+	stats.evictedLevels++;
+	entry.residentLevel = level + 1;
+}
+
+void TextureStreamer::setBaseLevel(unsigned int textureID, unsigned int level) {
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)level);
+}
+/* Private Methods */
+} /* namespace CGL */
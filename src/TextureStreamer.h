@@ -0,0 +1,105 @@
+/*
+ * TextureStreamer keeps textures partially resident on the GPU:
+ * - a registered texture starts with its small mips only (up to initialSize)
+ * - every frame the renderer requests the on-screen size of what each texture
+ *   is mapped onto, which gives the finest mip level worth having
+ * - Update() uploads missing finer levels (limited per frame) and evicts
+ *   unneeded fine levels, keeping resident bytes under the budget
+ * Residency is expressed with GL_TEXTURE_BASE_LEVEL. Dropped levels are
+ * respecified with zero size, so their storage is released by the driver
+ * and the texture ID (held by Meshes) never changes.
+ * The decoded data of every level stays in RAM to be uploaded again.
+ */
+
+#ifndef TEXTURESTREAMER_H_
+#define TEXTURESTREAMER_H_
+
+#include "TextureLoader.h"
+
+#include <GL/glew.h>
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace CGL {
+
+struct TextureStreamerStats {
+	size_t streamedTextures;
+	size_t residentBytes;
+	size_t budgetBytes;
+	// Levels uploaded/dropped by the last Update()
+	unsigned int uploadedLevels;
+	unsigned int evictedLevels;
+	size_t uploadedBytes;
+};
+
+class TextureStreamer {
+public:
+	/*
+	 * budgetBytes - GPU memory all streamed textures may take together
+	 * uploadBytesPerFrame - upper bound of data uploaded by a single Update()
+	 * initialSize - textures start with levels of at most this size resident
+	 */
+	TextureStreamer(size_t budgetBytes, size_t uploadBytesPerFrame=4 << 20, unsigned int initialSize=64);
+	~TextureStreamer();
+
+	/*
+	 * Delete Copy Constructor and operator=
+	 */
+	TextureStreamer(const TextureStreamer & other) = delete;
+	TextureStreamer & operator=(const TextureStreamer & other) = delete;
+
+	/*
+	 * Create a texture with the coarse levels of a decoded texture and take over its data
+	 * Returns OpenGL's texture ID (0 on failure)
+	 */
+	unsigned int Register(DecodedTexture && texture);
+
+	/*
+	 * Delete the texture and its data
+	 */
+	void Unregister(unsigned int textureID);
+
+	/*
+	 * Texture is visible this frame, mapped onto something about screenPixels wide
+	 */
+	void Request(unsigned int textureID, float screenPixels);
+
+	/*
+	 * Stream levels in and out according to the requests since the last Update()
+	 */
+	void Update();
+
+	void SetBudget(size_t budgetBytes);
+	TextureStreamerStats GetStats() const;
+
+private:
+	struct Entry {
+		DecodedTexture texture;
+		unsigned int levelCount;
+		// Coarsest level always kept, finest level resident now and wanted
+		unsigned int minimumLevel;
+		unsigned int residentLevel;
+		unsigned int wantedLevel;
+		// Finest level requested in the frame lastRequested
+		unsigned int requestedLevel;
+		unsigned long long lastRequested;
+	};
+
+	std::unordered_map<unsigned int, Entry> entries;
+	size_t budgetBytes;
+	size_t uploadBytesPerFrame;
+	unsigned int initialSize;
+	unsigned long long frame;
+	TextureStreamerStats stats;
+
+	size_t levelBytes(const Entry & entry, unsigned int level) const;
+	void uploadLevel(unsigned int textureID, Entry & entry, unsigned int level);
+	void releaseLevel(unsigned int textureID, Entry & entry, unsigned int level);
+	void setBaseLevel(unsigned int textureID, unsigned int level);
+};
+
+} /* namespace CGL */
+
+#endif /* TEXTURESTREAMER_H_ */
@@ -0,0 +1,68 @@
+#include "ThreadPool.h"
+
+namespace CGL {
+
+/* Ctor & Dtor */
+ThreadPool::ThreadPool(unsigned threads) {
+	busy = 0;
+	stopping = false;
+
+	if(threads == 0) threads = std::thread::hardware_concurrency();
+	if(threads == 0) threads = 1;
+	for(unsigned i = 0; i < threads; i++)
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	taskAvailable.notify_all();
+	for(std::thread & worker : workers)
+		worker.join();
+}
+/* Ctor & Dtor */
+/* Public Methods */
+void ThreadPool::Submit(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	taskAvailable.notify_one();
+}
+
+void ThreadPool::Wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+	tasksFinished.wait(lock, [this]() { return tasks.empty() && busy == 0; });
+}
+
+unsigned ThreadPool::GetThreadCount() const {
+	return (unsigned)workers.size();
+}
+/* Public Methods */
+/* Private Methods */
+void ThreadPool::workerLoop() {
+	while(true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+			// Queued tasks are still finished when stopping
+			if(tasks.empty()) return;
+			task = std::move(tasks.front());
+			tasks.pop_front();
+			busy++;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy--;
+			if(tasks.empty() && busy == 0) tasksFinished.notify_all();
+		}
+	}
+}
+/* Private Methods */
+} /* namespace CGL */
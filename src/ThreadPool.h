@@ -0,0 +1,63 @@
+/*
+ * ThreadPool is a fixed set of worker threads executing submitted tasks
+ * in submission order (FIFO). It's meant for CPU heavy work which doesn't
+ * touch OpenGL, e.g. image decoding while loading a Model.
+ */
+
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CGL {
+
+class ThreadPool {
+public:
+	/*
+	 * Start threads workers (0 means one per hardware thread)
+	 */
+	ThreadPool(unsigned threads=0);
+
+	/*
+	 * Finish queued tasks and join the workers
+	 */
+	~ThreadPool();
+
+	/*
+	 * Delete Copy Constructor and operator=
+	 */
+	ThreadPool(const ThreadPool & other) = delete;
+	ThreadPool & operator=(const ThreadPool & other) = delete;
+
+	/*
+	 * Queue a task, it's run by the first free worker
+	 */
+	void Submit(std::function<void()> task);
+
+	/*
+	 * Block until all submitted tasks are finished
+	 */
+	void Wait();
+
+	unsigned GetThreadCount() const;
+
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable taskAvailable;
+	std::condition_variable tasksFinished;
+	unsigned busy;
+	bool stopping;
+
+	void workerLoop();
+};
+
+} /* namespace CGL */
+
+#endif /* THREADPOOL_H_ */
@@ -0,0 +1,178 @@
+#include "TransformHierarchy.h"
+
+namespace CGL {
+
+namespace {
+	// values[i] = old values[order[i]]
+	template<typename T>
+	void permute(std::vector<T> & values, const std::vector<int> & order) {
+		std::vector<T> result;
+		result.reserve(order.size());
+		for(int slot : order) result.push_back(values[slot]);
+		values.swap(result);
+	}
+}
+
+/* Ctor & Dtor */
+TransformHierarchy::TransformHierarchy() {
+	unsorted = false;
+}
+/* Ctor & Dtor */
+/* Public Methods */
+TransformHandle TransformHierarchy::Create(TransformHandle parent, const glm::mat4 & local) {
+	TransformHandle handle;
+	if(!freeHandles.empty()) {
+		handle = freeHandles.back();
+		freeHandles.pop_back();
+	}
+	else {
+		handle = (TransformHandle)slots.size();
+		slots.push_back(-1);
+	}
+
+	// Appended after all others, so after its parent as well
+	slots[handle] = (int)handles.size();
+	parents.push_back(IsValid(parent) ? slots[parent] : -1);
+	locals.push_back(local);
+	worlds.push_back(local);
+	dirty.push_back(1);
+	updated.push_back(0);
+	handles.push_back(handle);
+	return handle;
+}
+
+void TransformHierarchy::Destroy(TransformHandle handle) {
+	if(!IsValid(handle)) return;
+	if(unsorted) sort();
+
+	// Descendants follow their parents, one pass finds the whole subtree
+	int first = slots[handle];
+	std::vector<uint8_t> removed(handles.size(), 0);
+	removed[first] = 1;
+	for(size_t i = first + 1; i < handles.size(); i++)
+		if(parents[i] >= 0 && removed[parents[i]]) removed[i] = 1;
+
+	std::vector<int> order, remap(handles.size(), -1);
+	for(size_t i = 0; i < handles.size(); i++) {
+		if(removed[i]) {
+			slots[handles[i]] = -1;
+			freeHandles.push_back(handles[i]);
+			continue;
+		}
+		remap[i] = (int)order.size();
+		order.push_back((int)i);
+	}
+	permute(parents, order);
+	permute(locals, order);
+	permute(worlds, order);
+	permute(dirty, order);
+	permute(updated, order);
+	permute(handles, order);
+	for(size_t i = 0; i < handles.size(); i++) {
+		slots[handles[i]] = (int)i;
+		if(parents[i] >= 0) parents[i] = remap[parents[i]];
+	}
+}
+
+bool TransformHierarchy::SetParent(TransformHandle handle, TransformHandle parent) {
+	if(!IsValid(handle)) return false;
+	for(TransformHandle ancestor = parent; IsValid(ancestor); ancestor = GetParent(ancestor))
+		if(ancestor == handle) return false;
+
+	int slot = slots[handle];
+	parents[slot] = IsValid(parent) ? slots[parent] : -1;
+	if(parents[slot] > slot) unsorted = true;
+	dirty[slot] = 1;
+	return true;
+}
+
+void TransformHierarchy::SetLocal(TransformHandle handle, const glm::mat4 & local) {
+	int slot = slots[handle];
+	locals[slot] = local;
+	dirty[slot] = 1;
+}
+
+unsigned int TransformHierarchy::Update(bool force) {
+	if(unsorted) sort();
+
+	unsigned int count = 0;
+	for(size_t i = 0; i < handles.size(); i++) {
+		int parent = parents[i];
+		bool recompute = force || dirty[i] || (parent >= 0 && updated[parent]);
+		if(recompute) {
+			worlds[i] = parent >= 0 ? worlds[parent] * locals[i] : locals[i];
+			count++;
+		}
+		updated[i] = recompute;
+		dirty[i] = 0;
+	}
+	return count;
+}
+
+const glm::mat4 & TransformHierarchy::GetLocal(TransformHandle handle) const {
+	return locals[slots[handle]];
+}
+
+const glm::mat4 & TransformHierarchy::GetWorld(TransformHandle handle) const {
+	return worlds[slots[handle]];
+}
+
+bool TransformHierarchy::WasUpdated(TransformHandle handle) const {
+	return updated[slots[handle]] != 0;
+}
+
+TransformHandle TransformHierarchy::GetParent(TransformHandle handle) const {
+	int parent = parents[slots[handle]];
+	return parent >= 0 ? handles[parent] : INVALID_TRANSFORM;
+}
+
+bool TransformHierarchy::IsValid(TransformHandle handle) const {
+	return handle >= 0 && handle < (TransformHandle)slots.size() && slots[handle] >= 0;
+}
+
+size_t TransformHierarchy::GetSize() const {
+	return handles.size();
+}
+/* Public Methods */
+/* Private Methods */
+void TransformHierarchy::sort() {
+	unsorted = false;
+	size_t count = handles.size();
+
+	// Children of every slot (in slot order) as offsets into one array
+	std::vector<int> firstChild(count + 1, 0), children(count);
+	for(size_t i = 0; i < count; i++)
+		if(parents[i] >= 0) firstChild[parents[i] + 1]++;
+	for(size_t i = 0; i < count; i++) firstChild[i + 1] += firstChild[i];
+	std::vector<int> fill(firstChild.begin(), firstChild.end() - 1);
+	for(size_t i = 0; i < count; i++)
+		if(parents[i] >= 0) children[fill[parents[i]]++] = (int)i;
+
+	// Depth first from the roots, subtrees end up contiguous
+	std::vector<int> order, stack;
+	order.reserve(count);
+	for(size_t root = count; root-- > 0;)
+		if(parents[root] < 0) stack.push_back((int)root);
+	while(!stack.empty()) {
+		int slot = stack.back();
+		stack.pop_back();
+		order.push_back(slot);
+		for(int child = firstChild[slot + 1]; child-- > firstChild[slot];)
+			stack.push_back(children[child]);
+	}
+
+	std::vector<int> remap(count);
+	for(size_t i = 0; i < count; i++) remap[order[i]] = (int)i;
+	permute(parents, order);
+	permute(locals, order);
+	permute(worlds, order);
+	permute(dirty, order);
+	permute(updated, order);
+	permute(handles, order);
+	for(size_t i = 0; i < count; i++) {
+		slots[handles[i]] = (int)i;
+		if(parents[i] >= 0) parents[i] = remap[parents[i]];
+	}
+}
+/* Private Methods */
+} /* namespace CGL */
@@ -0,0 +1,91 @@
+/*
+ * TransformHierarchy keeps local and world matrices of a forest of transforms
+ * (Actors attached to each other, nodes of their Models) in flat arrays sorted
+ * parent first, so one linear pass computes all world matrices:
+ * - SetLocal() only marks the transform dirty
+ * - Update() walks the array once; a transform is recomputed if it's dirty or
+ *   its parent was recomputed in the same pass, everything else is skipped
+ * Handles stay valid while transforms are created, reparented or destroyed;
+ * structural changes re-sort the array (depth first, subtrees contiguous) on
+ * the next Update().
+ */
+
+#ifndef TRANSFORMHIERARCHY_H_
+#define TRANSFORMHIERARCHY_H_
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace CGL {
+
+typedef int TransformHandle;
+const TransformHandle INVALID_TRANSFORM = -1;
+
+class TransformHierarchy {
+public:
+	TransformHierarchy();
+
+	/*
+	 * New transform under parent (INVALID_TRANSFORM for a root)
+	 */
+	TransformHandle Create(TransformHandle parent, const glm::mat4 & local);
+
+	/*
+	 * Destroy a transform with all its descendants
+	 */
+	void Destroy(TransformHandle handle);
+
+	/*
+	 * Move a transform (with its subtree) under another parent, keeping its local matrix
+	 * Returns false if parent is the transform itself or one of its descendants
+	 */
+	bool SetParent(TransformHandle handle, TransformHandle parent);
+
+	/*
+	 * Local matrix relative to the parent; the world matrix follows on Update()
+	 * (different handles may be set from different threads)
+	 */
+	void SetLocal(TransformHandle handle, const glm::mat4 & local);
+
+	/*
+	 * Recompute world matrices of dirty subtrees (all of them if forced)
+	 * Returns the number of recomputed transforms
+	 */
+	unsigned int Update(bool force=false);
+
+	const glm::mat4 & GetLocal(TransformHandle handle) const;
+	// As of the last Update()
+	const glm::mat4 & GetWorld(TransformHandle handle) const;
+	// Whether the world matrix was recomputed by the last Update()
+	bool WasUpdated(TransformHandle handle) const;
+	TransformHandle GetParent(TransformHandle handle) const;
+	bool IsValid(TransformHandle handle) const;
+	size_t GetSize() const;
+
+private:
+	/*
+	 * Transforms by slot, parents always at lower slots (unless unsorted is set)
+	 */
+	std::vector<int> parents;
+	std::vector<glm::mat4> locals;
+	std::vector<glm::mat4> worlds;
+	std::vector<uint8_t> dirty;
+	std::vector<uint8_t> updated;
+	std::vector<TransformHandle> handles;
+
+	// Slot of every handle (-1 for free ones) and the free handles
+	std::vector<int> slots;
+	std::vector<TransformHandle> freeHandles;
+	bool unsorted;
+
+	/*
+	 * Restore the parent first order: depth first from the roots in their current order
+	 */
+	void sort();
+};
+
+} /* namespace CGL */
+
+#endif /* TRANSFORMHIERARCHY_H_ */
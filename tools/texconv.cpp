@@ -0,0 +1,257 @@
+/*
+ * cgl-texconv -- offline conversion of PNG/JPG/... images to block compressed DDS
+ *
+ * Usage: cgl-texconv [--bc1|--bc3] [--srgb] <input image> [output.dds]
+ *   --bc1   opaque BC1 (DXT1), 4 bits per pixel
+ *   --bc3   BC3 (DXT5) with alpha, 8 bits per pixel
+ *           (default: BC1 if every pixel is opaque, BC3 otherwise)
+ *   --srgb  color data is sRGB: mips are filtered in linear space
+ *           and the file is tagged as sRGB (DX10 header)
+ * The output defaults to the input path with .dds extension, which is where
+ * TextureFromFile() looks for it. The full mip chain is stored in the file.
+ */
+
+#include <SOIL2/SOIL2.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Image {
+	int width, height;
+	std::vector<unsigned char> rgba;
+};
+
+/*
+ * Mip generation, 2x2 box filter (odd extents clamp the last row/column)
+ */
+float toLinear[256];
+
+unsigned char fromLinear(float value) {
+	value = value <= .0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - .055f;
+	return (unsigned char)std::min(255.f, std::max(0.f, value * 255.f + .5f));
+}
+
+Image downsample(const Image & src, bool srgb) {
+	Image dst;
+	dst.width = std::max(1, src.width / 2);
+	dst.height = std::max(1, src.height / 2);
+	dst.rgba.resize((size_t)dst.width * dst.height * 4);
+
+	for(int y = 0; y < dst.height; y++) {
+		int y0 = std::min(2 * y, src.height - 1), y1 = std::min(2 * y + 1, src.height - 1);
+		for(int x = 0; x < dst.width; x++) {
+			int x0 = std::min(2 * x, src.width - 1), x1 = std::min(2 * x + 1, src.width - 1);
+			const unsigned char* p[4] = {
+				&src.rgba[((size_t)y0 * src.width + x0) * 4], &src.rgba[((size_t)y0 * src.width + x1) * 4],
+				&src.rgba[((size_t)y1 * src.width + x0) * 4], &src.rgba[((size_t)y1 * src.width + x1) * 4] };
+			unsigned char* out = &dst.rgba[((size_t)y * dst.width + x) * 4];
+			for(int c = 0; c < 4; c++) {
+				if(srgb && c < 3) {
+					out[c] = fromLinear(.25f * (toLinear[p[0][c]] + toLinear[p[1][c]] + toLinear[p[2][c]] + toLinear[p[3][c]]));
+				}
+				else out[c] = (unsigned char)((p[0][c] + p[1][c] + p[2][c] + p[3][c] + 2) / 4);
+			}
+		}
+	}
+	return dst;
+}
+
+/*
+ * BC1/BC3 block encoding: endpoints from the (inset) bounding box of the block,
+ * every pixel takes the nearest palette entry
+ */
+uint16_t to565(const int c[3]) {
+	return (uint16_t)(((c[0] * 31 + 127) / 255) << 11 | ((c[1] * 63 + 127) / 255) << 5 | ((c[2] * 31 + 127) / 255));
+}
+
+void from565(uint16_t v, int c[3]) {
+	int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+	c[0] = (r << 3) | (r >> 2); c[1] = (g << 2) | (g >> 4); c[2] = (b << 3) | (b >> 2);
+}
+
+void encodeColorBlock(const unsigned char block[16][4], unsigned char out[8]) {
+	int lo[3] = { 255, 255, 255 }, hi[3] = { 0, 0, 0 };
+	for(int i = 0; i < 16; i++)
+		for(int c = 0; c < 3; c++) { lo[c] = std::min(lo[c], (int)block[i][c]); hi[c] = std::max(hi[c], (int)block[i][c]); }
+	for(int c = 0; c < 3; c++) {
+		int inset = (hi[c] - lo[c]) / 16;
+		lo[c] += inset; hi[c] -= inset;
+	}
+
+	uint16_t c0 = to565(hi), c1 = to565(lo);
+	// c0 > c1 selects the 4 color mode
+	if(c0 < c1) std::swap(c0, c1);
+
+	int palette[4][3];
+	from565(c0, palette[0]); from565(c1, palette[1]);
+	for(int c = 0; c < 3; c++) {
+		palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+		palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+	}
+
+	uint32_t indices = 0;
+	if(c0 != c1) {
+		for(int i = 0; i < 16; i++) {
+			int best = 0, bestDistance = 1 << 30;
+			for(int p = 0; p < 4; p++) {
+				int distance = 0;
+				for(int c = 0; c < 3; c++) distance += (block[i][c] - palette[p][c]) * (block[i][c] - palette[p][c]);
+				if(distance < bestDistance) { bestDistance = distance; best = p; }
+			}
+			indices |= (uint32_t)best << (2 * i);
+		}
+	}
+
+	out[0] = c0 & 0xFF; out[1] = c0 >> 8; out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+	for(int i = 0; i < 4; i++) out[4 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+void encodeAlphaBlock(const unsigned char block[16][4], unsigned char out[8]) {
+	int a0 = 0, a1 = 255;
+	for(int i = 0; i < 16; i++) { a0 = std::max(a0, (int)block[i][3]); a1 = std::min(a1, (int)block[i][3]); }
+
+	// a0 > a1 selects the 8 value mode
+	int palette[8] = { a0, a1 };
+	for(int p = 1; p < 7; p++) palette[p + 1] = ((7 - p) * a0 + p * a1) / 7;
+
+	uint64_t indices = 0;
+	if(a0 != a1) {
+		for(int i = 0; i < 16; i++) {
+			int best = 0, bestDistance = 256;
+			for(int p = 0; p < 8; p++) {
+				int distance = std::abs(block[i][3] - palette[p]);
+				if(distance < bestDistance) { bestDistance = distance; best = p; }
+			}
+			indices |= (uint64_t)best << (3 * i);
+		}
+	}
+
+	out[0] = (unsigned char)a0; out[1] = (unsigned char)a1;
+	for(int i = 0; i < 6; i++) out[2 + i] = (indices >> (8 * i)) & 0xFF;
+}
+
+void encodeLevel(const Image & image, bool bc3, std::vector<unsigned char> & out) {
+	for(int by = 0; by < image.height; by += 4) {
+		for(int bx = 0; bx < image.width; bx += 4) {
+			unsigned char block[16][4];
+			for(int i = 0; i < 16; i++) {
+				int x = std::min(bx + i % 4, image.width - 1), y = std::min(by + i / 4, image.height - 1);
+				std::memcpy(block[i], &image.rgba[((size_t)y * image.width + x) * 4], 4);
+			}
+			unsigned char encoded[16];
+			if(bc3) {
+				encodeAlphaBlock(block, encoded);
+				encodeColorBlock(block, encoded + 8);
+			}
+			else encodeColorBlock(block, encoded);
+			out.insert(out.end(), encoded, encoded + (bc3 ? 16 : 8));
+		}
+	}
+}
+
+/*
+ * DDS container (layout matches src/TextureLoader.cpp)
+ */
+void put32(std::vector<unsigned char> & out, uint32_t value) {
+	for(int i = 0; i < 4; i++) out.push_back((value >> (8 * i)) & 0xFF);
+}
+
+std::vector<unsigned char> ddsHeader(int width, int height, int levels, bool bc3, bool srgb, size_t level0Size) {
+	std::vector<unsigned char> out;
+	put32(out, 0x20534444); // "DDS "
+	put32(out, 124);
+	put32(out, 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x80000); // CAPS HEIGHT WIDTH PIXELFORMAT MIPMAPCOUNT LINEARSIZE
+	put32(out, height); put32(out, width);
+	put32(out, (uint32_t)level0Size);
+	put32(out, 0); put32(out, levels);
+	for(int i = 0; i < 11; i++) put32(out, 0);
+	// Pixel format
+	put32(out, 32); put32(out, 0x4); // FOURCC
+	put32(out, srgb ? 0x30315844 : (bc3 ? 0x35545844 : 0x31545844)); // "DX10" / "DXT5" / "DXT1"
+	for(int i = 0; i < 5; i++) put32(out, 0);
+	put32(out, 0x1000 | 0x8 | 0x400000); // TEXTURE COMPLEX MIPMAP
+	for(int i = 0; i < 4; i++) put32(out, 0);
+	if(srgb) {
+		put32(out, bc3 ? 78 : 72); // DXGI_FORMAT_BC3_UNORM_SRGB / DXGI_FORMAT_BC1_UNORM_SRGB
+		put32(out, 3);             // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+		put32(out, 0); put32(out, 1); put32(out, 0);
+	}
+	return out;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+	std::string input, output;
+	int forced = 0; // 1 = BC1, 3 = BC3
+	bool srgb = false;
+	for(int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if(arg == "--bc1") forced = 1;
+		else if(arg == "--bc3") forced = 3;
+		else if(arg == "--srgb") srgb = true;
+		else if(input.empty()) input = arg;
+		else output = arg;
+	}
+	if(input.empty()) {
+		std::cerr << "Usage: cgl-texconv [--bc1|--bc3] [--srgb] <input image> [output.dds]\n";
+		return 1;
+	}
+	if(output.empty()) {
+		size_t dot = input.find_last_of('.');
+		output = (dot == std::string::npos ? input : input.substr(0, dot)) + ".dds";
+	}
+
+	Image image;
+	int channels;
+	unsigned char* pixels = SOIL_load_image(input.c_str(), &image.width, &image.height, &channels, SOIL_LOAD_RGBA);
+	if(!pixels) {
+		std::cerr << "cgl-texconv: can't load " << input << ": " << SOIL_last_result() << "\n";
+		return 1;
+	}
+	image.rgba.assign(pixels, pixels + (size_t)image.width * image.height * 4);
+	SOIL_free_image_data(pixels);
+
+	bool bc3 = forced == 3;
+	if(!forced)
+		for(size_t i = 3; i < image.rgba.size() && !bc3; i += 4) bc3 = image.rgba[i] != 255;
+
+	for(int i = 0; i < 256; i++) {
+		float value = i / 255.f;
+		toLinear[i] = value <= .04045f ? value / 12.92f : std::pow((value + .055f) / 1.055f, 2.4f);
+	}
+
+	// Encode the whole chain down to 1x1
+	std::vector<unsigned char> data;
+	size_t level0Size = 0;
+	int levels = 0;
+	Image level = image;
+	while(true) {
+		encodeLevel(level, bc3, data);
+		if(levels++ == 0) level0Size = data.size();
+		if(level.width == 1 && level.height == 1) break;
+		level = downsample(level, srgb);
+	}
+
+	std::vector<unsigned char> header = ddsHeader(image.width, image.height, levels, bc3, srgb, level0Size);
+	std::ofstream out(output, std::ios::binary);
+	out.write((const char*)header.data(), header.size());
+	out.write((const char*)data.data(), data.size());
+	if(!out) {
+		std::cerr << "cgl-texconv: can't write " << output << "\n";
+		return 1;
+	}
+
+	std::cout << output << ": " << image.width << "x" << image.height << " " << (bc3 ? "BC3" : "BC1")
+			<< (srgb ? " sRGB" : "") << ", " << levels << " levels, " << data.size() << " bytes\n";
+	return 0;
+}